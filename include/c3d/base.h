@@ -3,6 +3,7 @@
 #include "maths.h"
 
 #define C3D_DEFAULT_CMDBUF_SIZE 0x40000
+#define C3D_MAX_CMDBUFS 2 // Frames share one gx queue, so only one frame can run behind the CPU
 
 enum
 {
@@ -10,11 +11,46 @@ enum
 	C3D_UNSIGNED_SHORT = 1,
 };
 
+typedef struct
+{
+	size_t cmdBufSize;
+	u8 cmdBufCount; // 2 lets the CPU record a frame while the GPU runs the previous one
+	u16 gxQueueSize;  // gx command queue entries, 0 for 32 per command buffer
+	u16 gxQueueLimit; // Size the queue may grow to when a frame runs short of entries, 0 to never grow
+	bool gxQueueMerge; // Appends adjacent command lists to one queue entry, off by default as it leaves
+	                   // a finalize write without enabled bytes in the list that is not verified on hardware
+} C3D_InitParams;
+
 bool C3D_Init(size_t cmdBufSize);
+bool C3D_InitWithParams(const C3D_InitParams* params);
 void C3D_Fini(void);
 
 float C3D_GetCmdBufUsage(void);
 
+// Command buffer usage telemetry, based on the highest usage reached in each frame
+#define C3D_CMDBUF_HISTORY   64
+#define C3D_CMDBUF_HIST_BINS 10
+
+float C3D_GetCmdBufPeakUsage(void);
+void C3D_ResetCmdBufPeakUsage(void);
+u32 C3D_GetCmdBufHistory(float* out, u32 max); // Most recent frames, oldest first
+void C3D_ResetCmdBufHistory(void); // Also empties the histogram
+void C3D_GetCmdBufHistogram(u32 bins[C3D_CMDBUF_HIST_BINS]); // Frames per 10% usage step
+
+// Reserves room for words raw command words (rounded up to an even count) in the current
+// command buffer and returns where to write them, or NULL if they do not fit. Each command is a
+// value followed by its header, see C3D_CMD. The register cache is not updated.
+u32* C3D_CmdReserve(u32 words);
+#define C3D_CMD(reg, mask, val) (val), GPUCMD_HEADER(0, (mask), (reg))
+
+// Optional shadow copy of the GPU registers, used to skip redundant state writes.
+// Call C3D_RegCacheInvalidate after writing registers directly through GPUCMD.
+bool C3D_RegCacheEnable(bool enable);
+void C3D_RegCacheInvalidate(void);
+
+// Each shader unit holds the code of a single DVLP. Switching between programs whose DVLPs are
+// already in place (e.g. the DVLEs of one shbin) only sends their entry points and outputs, a
+// program from another shbin uploads its code again and evicts the code held before it.
 void C3D_BindProgram(shaderProgram_s* program);
 
 void C3D_SetViewport(u32 x, u32 y, u32 w, u32 h);
@@ -23,9 +59,24 @@ void C3D_SetScissor(GPU_SCISSORMODE mode, u32 left, u32 top, u32 right, u32 bott
 void C3D_DrawArrays(GPU_Primitive_t primitive, int first, int size);
 void C3D_DrawElements(GPU_Primitive_t primitive, int count, int type, const void* indices);
 
+// Several draws sharing the same state, the state is sent once and each draw only sets its range
+void C3D_MultiDrawArrays(GPU_Primitive_t primitive, const int* first, const int* count, int drawcount);
+void C3D_MultiDrawElements(GPU_Primitive_t primitive, const int* count, int type, const void* const* indices, int drawcount);
+
+// Draws the same elements instanceCount times. Before each copy, the vertex shader uniforms from
+// uniformBase on are loaded with that instance's rows of perInstanceData (stride bytes apart, a
+// multiple of 16, laid out as C3D_FVec). Only the rows that differ from the previous instance are
+// written. Afterwards the uniforms hold the rows of the last instance.
+void C3D_DrawElementsInstanced(GPU_Primitive_t primitive, int count, int type, const void* indices,
+	int instanceCount, int uniformBase, const void* perInstanceData, size_t stride);
+
 // Immediate-mode vertex submission
 void C3D_ImmDrawBegin(GPU_Primitive_t primitive);
 void C3D_ImmSendAttrib(float x, float y, float z, float w);
+// Sends count attributes of four floats each, packed into as few commands as possible
+void C3D_ImmSendAttribs(const float* data, int count);
+// Sends count vertices spaced stride bytes apart, each made of numAttribs attributes of sizes[i] floats
+void C3D_ImmSendVertices(const void* vertices, size_t stride, int count, const u8* sizes, int numAttribs);
 void C3D_ImmDrawEnd(void);
 
 static inline void C3D_ImmDrawRestartPrim(void)
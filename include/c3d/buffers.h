@@ -15,6 +15,8 @@ typedef struct
 } C3D_BufInfo;
 
 void BufInfo_Init(C3D_BufInfo* info);
+// The base address is moved to follow the buffers, which can be anywhere in linear memory or VRAM
+// as long as they, and the indices drawn with them, span less than 256 MiB. Returns -2 otherwise.
 int  BufInfo_Add(C3D_BufInfo* info, const void* data, ptrdiff_t stride, int attribCount, u64 permutation);
 
 C3D_BufInfo* C3D_GetBufInfo(void);
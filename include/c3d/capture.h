@@ -0,0 +1,67 @@
+#pragma once
+#include <stdio.h>
+#include "types.h"
+
+// Frame captures: every gx queue entry of one frame with the command lists it submitted,
+// followed by the vertex, index and texture memory the draws read. The file is a header
+// and a sequence of chunks, all little endian.
+
+#define C3D_CAPTURE_MAGIC   0x43443343 // "C3DC"
+#define C3D_CAPTURE_VERSION 1
+#define C3D_CAPTURE_MAX_TIMES 64
+
+enum
+{
+	C3D_CAPTURE_TRUNCATED = 1, // The capture buffer or the range table ran out, the frame is incomplete
+};
+
+enum
+{
+	C3D_CAPCHUNK_GXCMD = 1, // The 8 words of a gx queue entry
+	C3D_CAPCHUNK_CMDLIST,   // Words of the command list submitted by the preceding GXCMD
+	C3D_CAPCHUNK_MEMORY,    // Physical address, then the contents of the range
+};
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 flags;
+	u32 numChunks;
+} C3D_CaptureHeader;
+
+typedef struct
+{
+	u32 type;
+	u32 size; // Bytes of payload that follow, always a multiple of 4
+} C3D_CaptureChunk;
+
+typedef struct
+{
+	u32 numGxCmds;
+	u32 numCmdLists;
+	u32 cmdListWords;
+	float totalTime;    // ms summed over every entry run on its own, the gaps between them are not counted
+	float transferTime; // ms spent in memory fills, transfers and cache flushes
+	float cmdListTime[C3D_CAPTURE_MAX_TIMES]; // ms per command list, in submission order
+} C3D_CaptureStats;
+
+#if defined(__3DS__) || defined(_3DS)
+
+// Records the next frame started with C3D_FrameBegin into a buffer of bufSize bytes (0 picks
+// a default) and writes it to path at the start of the frame after it finished on the GPU.
+// Memory ranges hold their contents at that point, not while the frame was drawn.
+// Returns false if a capture is already pending or the buffer could not be allocated.
+bool C3D_CaptureFrame(const char* path, size_t bufSize);
+bool C3D_CaptureBusy(void);
+
+// Resubmits a capture one queue entry at a time and times each entry. Must be called outside
+// of a frame. restoreMemory writes the captured ranges back first, which is only meaningful
+// in the session that recorded the capture since the addresses are those of its allocations.
+bool C3D_CaptureReplay(const char* path, C3D_CaptureStats* stats, bool restoreMemory);
+
+#endif
+
+// Prints every queue entry of a capture and the words each state group wrote per command list.
+// listWrites additionally prints every register write with its group. Also works on the host.
+bool C3D_CaptureDump(const char* path, FILE* out, bool listWrites);
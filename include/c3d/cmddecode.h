@@ -0,0 +1,64 @@
+#pragma once
+#include "types.h"
+
+// Walker for PICA200 command buffers as produced by GPUCMD_Add. Only depends on the C library,
+// so captures can be inspected on the host as well as on the console.
+
+// Register ranges, named after the piece of context state (C3DiF_*) that writes them
+typedef enum
+{
+	C3D_REGGROUP_MISC,     // Finalize, interrupts and anything not listed below
+	C3D_REGGROUP_VIEWPORT, // Rasterizer: culling, viewport, scissor, depth map, output map
+	C3D_REGGROUP_TEX,      // Texture units
+	C3D_REGGROUP_PROCTEX,  // Procedural texture and its LUTs
+	C3D_REGGROUP_TEXENV,   // Combiner stages
+	C3D_REGGROUP_FOG,      // Combiner buffer, fog and its LUT
+	C3D_REGGROUP_EFFECT,   // Blending, alpha/stencil/depth test, write masks
+	C3D_REGGROUP_FRAMEBUF, // Framebuffer flush, invalidate and configuration
+	C3D_REGGROUP_GAS,      // Gas rendering
+	C3D_REGGROUP_LIGHT,    // Light environment and its LUTs
+	C3D_REGGROUP_ATTRIB,   // Attribute loaders and vertex buffers
+	C3D_REGGROUP_DRAW,     // Index buffer, vertex count, draw triggers and immediate mode
+	C3D_REGGROUP_PROGRAM,  // Shader program and geometry stage configuration
+	C3D_REGGROUP_UNIFORM,  // Bool, int and float uniforms of both shader units
+	C3D_REGGROUP_SHADER,   // Shader code and operand descriptors
+
+	C3D_REGGROUP_COUNT,
+} C3D_RegGroup;
+
+// Called for every register write. Consecutive writes have already been split into one call per
+// register and mask is the 4-bit byte enable of the command.
+typedef void (* C3D_CmdDecodeFunc)(void* param, u32 reg, u32 mask, u32 value);
+
+// Walks numWords words of commands. Returns the number of register writes,
+// or -1 if a command runs past the end of the buffer.
+int C3D_CmdDecode(const u32* cmds, u32 numWords, C3D_CmdDecodeFunc func, void* param);
+
+C3D_RegGroup C3D_RegGroupOf(u32 reg);
+const char* C3D_RegGroupName(C3D_RegGroup group);
+
+typedef struct
+{
+	u32 words[C3D_REGGROUP_COUNT];     // Command words including headers and padding
+	u32 writes[C3D_REGGROUP_COUNT];
+	u32 redundant[C3D_REGGROUP_COUNT]; // Writes that left the register as it was
+	u32 draws;
+	u32 cycles;                        // Estimated command processor cost
+
+	// Shadow of the register file used to find redundant writes
+	u32 regs[0x300];
+	u32 known[0x300/32];
+} C3D_CmdStats;
+
+// Clears the counters and forgets the shadow registers
+void C3D_CmdStatsInit(C3D_CmdStats* stats);
+
+// Accumulates the counters over a command buffer, see C3D_CmdDecode for the return value.
+// Writes to data ports (uniforms, LUT and shader code uploads, draw triggers) are never
+// counted as redundant. The cycle estimate charges every word, then every write according
+// to its group, weighting the ones that drain the pipeline, and every draw. It is meant
+// for comparing two command streams, not for predicting GPU time.
+int C3D_CmdStatsAdd(C3D_CmdStats* stats, const u32* cmds, u32 numWords);
+
+// Fraction of all writes that were redundant
+float C3D_CmdStatsRedundancy(const C3D_CmdStats* stats);
@@ -0,0 +1,42 @@
+#pragma once
+#include "types.h"
+#include "maths.h"
+#include "renderqueue.h"
+
+typedef struct
+{
+	u32* buf;
+	u32 size; // in words
+	u32 used; // in words
+	DVLP_s* residentVsh; // Shader code left in the shader units by the list
+	DVLP_s* residentGsh;
+	bool residentGshPartial;
+	bool ownsBuf;
+	int stereoProj; // Vertex shader projection uniform left out of a stereo recording, -1 if none
+} C3D_CmdList;
+
+// Command lists record binds and draws once and replay them into the current frame.
+// A recording is self-contained: it does not depend on the state that was set before it.
+// The framebuffer is not recorded, the list draws onto whichever target is active on replay.
+bool C3D_CmdListInit(C3D_CmdList* list, size_t size);
+void C3D_CmdListInitWithBuffer(C3D_CmdList* list, u32* buf, size_t size);
+void C3D_CmdListDelete(C3D_CmdList* list);
+
+bool C3D_CmdListBegin(C3D_CmdList* list);
+bool C3D_CmdListEnd(C3D_CmdList* list);
+void C3D_CmdListCall(C3D_CmdList* list);
+
+// Stereo recordings leave out the 4x4 projection uniform at projUniform, so the eye-independent
+// commands are generated once and replayed per eye with its own projection (see Mtx_PerspStereoTilt).
+// The recording is finished with C3D_CmdListEnd and the projection must not change during it.
+bool C3D_CmdListBeginStereo(C3D_CmdList* list, int projUniform);
+void C3D_CmdListCallStereo(C3D_CmdList* list, C3D_RenderTarget* left, const C3D_Mtx* projLeft, C3D_RenderTarget* right, const C3D_Mtx* projRight);
+
+// Replays a recording started with C3D_CmdListBeginStereo once onto target with the given
+// matrix, e.g. once per face of a cube map
+void C3D_CmdListCallProj(C3D_CmdList* list, C3D_RenderTarget* target, const C3D_Mtx* proj);
+
+static inline bool C3D_CmdListIsEmpty(C3D_CmdList* list)
+{
+	return list->used == 0;
+}
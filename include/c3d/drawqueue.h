@@ -0,0 +1,74 @@
+#pragma once
+#include "pipeline.h"
+#include "texture.h"
+#include "light.h"
+#include "buffers.h"
+
+// A deferred draw. NULL state, texture, light environment or buffer pointers keep whatever
+// the previous draw of the flush (or the caller, for the first one) had bound.
+typedef struct
+{
+	u32 key;
+	const C3D_PipelineState* state;
+	C3D_Tex* tex[3];
+	C3D_LightEnv* lightEnv;
+	C3D_BufInfo* bufInfo;
+	void (* setup)(void* param); // Called right before the draw, e.g. to set the model matrix
+	void* param;
+	const void* indices; // NULL to use C3D_DrawArrays
+	int first, count;    // first is not used when drawing elements
+	u16 primitive; // GPU_Primitive_t, strips and fans do not fit in a byte
+	u8 indexType;
+} C3D_DrawItem;
+
+typedef struct
+{
+	C3D_DrawItem* items;
+	u16* order; // 2*capacity entries
+	u32 count, capacity;
+	bool ownsBuf;
+} C3D_DrawQueue;
+
+bool C3D_DrawQueueInit(C3D_DrawQueue* q, u32 capacity); // capacity must be between 1 and 65535
+void C3D_DrawQueueInitWithBuffer(C3D_DrawQueue* q, C3D_DrawItem* items, u16* order, u32 capacity);
+void C3D_DrawQueueDelete(C3D_DrawQueue* q);
+
+// Returns a cleared item to fill in, or NULL if the queue is full
+C3D_DrawItem* C3D_DrawQueuePush(C3D_DrawQueue* q, u32 key);
+
+// Sorts the queued draws by ascending key, issues them with only the state changes needed
+// between neighbours and empties the queue. Draws with equal keys keep their push order.
+void C3D_DrawQueueFlush(C3D_DrawQueue* q);
+
+static inline void C3D_DrawQueueClear(C3D_DrawQueue* q)
+{
+	q->count = 0;
+}
+
+// Sort keys: opaque draws come first, grouped by state and then front to back within a
+// state; blended draws follow, back to front. depth is in [0,1], 0 being the nearest.
+#define C3D_DRAWKEY_BLENDED BIT(31)
+
+static inline u32 C3D_DrawKeyDepth(float depth)
+{
+	if (!(depth > 0.0f)) return 0;
+	if (depth >= 1.0f) return 0x7FFF;
+	return (u32)(depth*0x7FFF);
+}
+
+static inline u32 C3D_DrawKeyOpaque(u16 stateId, float depth)
+{
+	return ((u32)stateId << 15) | C3D_DrawKeyDepth(depth);
+}
+
+// Opaque draws ordered front to back first and by state second, for when the early depth test
+// (C3D_EarlyDepthAuto) rejects more than grouping by state saves
+static inline u32 C3D_DrawKeyFrontToBack(u16 stateId, float depth)
+{
+	return (C3D_DrawKeyDepth(depth) << 16) | stateId;
+}
+
+static inline u32 C3D_DrawKeyBlended(u16 stateId, float depth)
+{
+	return C3D_DRAWKEY_BLENDED | ((0x7FFF - C3D_DrawKeyDepth(depth)) << 16) | stateId;
+}
@@ -7,6 +7,11 @@ void C3D_StencilTest(bool enable, GPU_TESTFUNC function, int ref, int inputMask,
 void C3D_StencilOp(GPU_STENCILOP sfail, GPU_STENCILOP dfail, GPU_STENCILOP pass);
 void C3D_BlendingColor(u32 color);
 void C3D_EarlyDepthTest(bool enable, GPU_EARLYDEPTHFUNC function, u32 ref);
+// Keeps the early depth test in line with C3D_DepthTest, for opaque passes drawn front to back
+// (see C3D_DrawKeyFrontToBack). It is only enabled while nothing but the depth test can discard a
+// fragment, and the early depth buffer is cleared to the depth the bound target was last cleared
+// to whenever the target changes or its depth is cleared. C3D_EarlyDepthTest turns it off again.
+void C3D_EarlyDepthAuto(bool enable);
 void C3D_DepthTest(bool enable, GPU_TESTFUNC function, GPU_WRITEMASK writemask);
 void C3D_AlphaTest(bool enable, GPU_TESTFUNC function, int ref);
 void C3D_AlphaBlend(GPU_BLENDEQUATION colorEq, GPU_BLENDEQUATION alphaEq, GPU_BLENDFACTOR srcClr, GPU_BLENDFACTOR dstClr, GPU_BLENDFACTOR srcAlpha, GPU_BLENDFACTOR dstAlpha);
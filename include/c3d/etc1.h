@@ -0,0 +1,23 @@
+#pragma once
+#include "texture.h"
+
+typedef enum
+{
+	C3D_ETC1_FAST   = 0, // Base colours are the quantised averages of the sub-blocks
+	C3D_ETC1_MEDIUM = 1, // Also tries the base colours next to them
+	C3D_ETC1_HIGH   = 2, // Searches two steps around them
+} C3D_ETC1Quality;
+
+// Encodes a linear RGBA8 image (bytes in R, G, B, A order, top row first, rows stride bytes apart) into
+// ETC1 or, with alpha, ETC1A4 blocks in PICA order. Width and height must be multiples of 8.
+// The encoder does not touch the context and may run on any thread; upload the result with
+// C3D_TexLoadImage or C3D_TexLoadImageAsync.
+bool C3D_ETC1Encode(void* dst, const void* src, u32 stride, u32 width, u32 height, bool alpha, C3D_ETC1Quality quality);
+
+// Encodes straight into a level of an ETC1 or ETC1A4 texture in linear memory
+bool C3D_TexEncodeETC1(C3D_Tex* tex, GPU_TEXFACE face, int level, const void* src, u32 stride, C3D_ETC1Quality quality);
+
+static inline size_t C3D_ETC1CalcSize(u32 width, u32 height, bool alpha)
+{
+	return alpha ? width*height : width*height/2;
+}
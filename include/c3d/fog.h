@@ -5,6 +5,7 @@
 typedef struct
 {
 	u32 data[128];
+	u32 gen; // Identifies the contents for upload skipping, 0 means always upload
 } C3D_FogLut;
 
 typedef struct
@@ -20,6 +21,8 @@ static inline float FogLut_CalcZ(float depth, float near, float far)
 
 void FogLut_FromArray(C3D_FogLut* lut, const float data[256]);
 void FogLut_Exp(C3D_FogLut* lut, float density, float gradient, float near, float far);
+void FogLut_ExpFast(C3D_FogLut* lut, float density, float gradient, float near, float far); // No expf/powf per entry
+void FogLut_Changed(C3D_FogLut* lut); // Call after writing to lut->data directly
 
 void C3D_FogGasMode(GPU_FOGMODE fogMode, GPU_GASMODE gasMode, bool zFlip);
 void C3D_FogColor(u32 color);
@@ -12,6 +12,7 @@ typedef struct
 	bool block32;
 	u8 colorMask : 4;
 	u8 depthMask : 4;
+	u32 depthClear; // Depth the buffer was last cleared to, scaled to 24 bits for the early depth test
 } C3D_FrameBuf;
 
 // Flags for C3D_FrameBufClear
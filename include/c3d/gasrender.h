@@ -0,0 +1,42 @@
+#pragma once
+#include "fog.h"
+#include "texenv.h"
+#include "renderqueue.h"
+
+// Geometry of one gas volume, drawn from the currently bound program, attributes and buffers
+typedef struct
+{
+	GPU_Primitive_t primitive;
+	int first, count;    // Vertex range, or the index count if indices is set
+	const void* indices; // NULL for C3D_DrawArrays
+	int indexType;
+} C3D_GasVolume;
+
+// Draws the geometry covering the shading pass (usually a fullscreen quad with the
+// density texture mapped to the screen), after the gas state has been set up
+typedef void (* C3D_GasShadeFunc)(void* param);
+
+typedef struct
+{
+	C3D_GasLut lut;
+	C3D_RenderTarget* densityTarget; // Must share the depth buffer of the scene
+	C3D_Tex* densityTex;             // Colour buffer of densityTarget
+	GPU_GASMODE mode;
+	GPU_GASLUTINPUT lutInput;
+	float deltaZ, accMax, attn;
+	float planar[3], view[3]; // min, max, attn
+	float lightDir;
+} C3D_GasRenderer;
+
+void C3D_GasRendererInit(C3D_GasRenderer* r, C3D_RenderTarget* densityTarget, C3D_Tex* densityTex, const u32 colors[9]);
+
+static inline void C3D_GasRendererColors(C3D_GasRenderer* r, const u32 colors[9])
+{
+	GasLut_FromArray(&r->lut, colors);
+}
+
+// Accumulates the density of all volumes in one pass on densityTarget, then shades the
+// result onto target in a second pass. The effect, combiners, texture unit 0 and fog mode
+// are restored afterwards; the bound draw target is left on target.
+void C3D_GasRendererDraw(C3D_GasRenderer* r, const C3D_GasVolume* volumes, int count,
+	C3D_RenderTarget* target, C3D_GasShadeFunc shade, void* param);
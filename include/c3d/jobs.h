@@ -0,0 +1,63 @@
+#pragma once
+#include "maths.h"
+#include "skeleton.h"
+
+#define C3D_JOBS_MAX_WORKERS 4
+#define C3D_JOBS_QUEUE_SIZE  256 // Pending jobs per thread, must be a power of two
+
+// Jobs run func on the index range [begin, end)
+typedef void (*C3D_JobFunc)(void* param, u32 begin, u32 end);
+
+// Counts the unfinished jobs pushed against it, zero it before the first push
+typedef struct
+{
+	u32 pending;
+} C3D_JobGroup;
+
+// Starts one worker thread per bit of coreMask, running at the priority of the calling thread.
+// The calling thread is the owner of the system and helps out while it waits. Core 1 only gets
+// time once APT_SetAppCpuTimeLimit was called, cores 2 and 3 only exist on the New 3DS.
+// Every thread keeps its own queue of jobs, idle workers steal from the others.
+bool C3D_JobsInit(u32 coreMask);
+void C3D_JobsExit(void);
+int  C3D_JobsThreads(void); // Threads running jobs including the owner, 1 when the system is not running
+
+// Jobs may be pushed from the owner thread and from inside other jobs. When the system is not
+// running, the queue is full or the caller is some other thread, the job runs right away.
+// Jobs must not touch the context or the GPU command buffer; commands are recorded into
+// C3D_SecondaryList (one per job) and called by the owner after the jobs finished.
+void C3D_JobPush(C3D_JobGroup* group, C3D_JobFunc func, void* param, u32 begin, u32 end);
+// Jobs that block, e.g. on file I/O, only run on the workers so that the owner never picks them up
+// while it waits for something else. Like C3D_JobPush they run right away when pushed from another
+// thread, without workers or when the queue is full.
+void C3D_JobPushBackground(C3D_JobGroup* group, C3D_JobFunc func, void* param, u32 begin, u32 end);
+void C3D_JobWait(C3D_JobGroup* group); // Runs queued jobs until the group is done
+
+static inline bool C3D_JobDone(const C3D_JobGroup* group)
+{
+	return __atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+// Splits [0, count) into chunks of at least grain indices and waits for all of them
+void C3D_JobParallelFor(C3D_JobFunc func, void* param, u32 count, u32 grain);
+
+// Batched kernels of maths.h spread over all threads, same results as the serial versions
+void C3D_JobsMtxMultiplyArray(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b, size_t count);
+void C3D_JobsMtxMultiplyFVec4Array(const C3D_Mtx* mtx, C3D_FVec* out, const C3D_FVec* in, size_t count, bool homogeneous);
+void C3D_JobsCullSpheres(const C3D_Frustum* f, int numFrusta, const C3D_FVec* spheres, size_t count, u32* visible);
+void C3D_JobsCullAABBs(const C3D_Frustum* f, int numFrusta, const C3D_FVec* mins, const C3D_FVec* maxs, size_t count, u32* visible);
+
+// One animated model: samples clip into pose and, if skel and world are set, computes the model
+// space bone matrices. The palette upload (C3D_SkeletonUpload) stays on the owner thread.
+typedef struct
+{
+	const C3D_AnimClip* clip;
+	float time;
+	bool loop;
+	C3D_BonePose* pose;
+	u16* cursors;
+	const C3D_Skeleton* skel;
+	C3D_Mtx* world;
+} C3D_AnimInstance;
+
+void C3D_JobsAnimSample(const C3D_AnimInstance* inst, size_t count);
@@ -57,6 +57,7 @@ struct C3D_LightEnv_t
 	C3D_Light* lights[8];
 	C3D_LightEnvConf conf;
 	C3D_Material material;
+	u32 colorGen; // Bumped when a colour the material blends depend on changes
 };
 
 void C3D_LightEnvInit(C3D_LightEnv* env);
@@ -109,6 +110,14 @@ enum
 	//C3DF_Light_Spot     = BIT(4),
 	//C3DF_Light_DistAttn = BIT(5),
 
+	// Parts of C3D_LightConf, C3DF_Light_Dirty covers all of them
+	C3DF_Light_ColorDirty   = BIT(6),
+	C3DF_Light_PosDirty     = BIT(7),
+	C3DF_Light_SpotDirDirty = BIT(8),
+	C3DF_Light_ConfigDirty  = BIT(9),
+	C3DF_Light_AttnDirty    = BIT(10),
+	C3DF_Light_PartsDirty   = 0x1F<<6,
+
 	C3DF_Light_SPDirty  = BIT(14),
 	C3DF_Light_DADirty  = BIT(15),
 };
@@ -134,6 +143,9 @@ void C3D_LightDiffuse(C3D_Light* light, float r, float g, float b);
 void C3D_LightSpecular0(C3D_Light* light, float r, float g, float b);
 void C3D_LightSpecular1(C3D_Light* light, float r, float g, float b);
 void C3D_LightPosition(C3D_Light* light, C3D_FVec* pos);
+
+// Transforms count world space positions by view and sets them on lights[n], w = 0 for directional lights
+void C3D_LightPositionArray(C3D_Light* const* lights, const C3D_FVec* pos, size_t count, const C3D_Mtx* view);
 void C3D_LightShadowEnable(C3D_Light* light, bool enable);
 void C3D_LightSpotEnable(C3D_Light* light, bool enable);
 void C3D_LightSpotDir(C3D_Light* light, float x, float y, float z);
@@ -147,3 +159,32 @@ static inline void C3D_LightColor(C3D_Light* light, float r, float g, float b)
 	C3D_LightSpecular0(light, r, g, b);
 	C3D_LightSpecular1(light, r, g, b);
 }
+
+//-----------------------------------------------------------------------------
+// Material table
+//-----------------------------------------------------------------------------
+
+// Material x light colour products of an env, baked for a list of materials
+typedef struct
+{
+	C3D_LightEnv* env;
+	const C3D_Material* materials;
+	int count;
+	u32 gen;
+	bool valid;
+	u32* ambient;           // One per material
+	C3D_LightMatConf* conf; // 8 per material, one for each light slot
+} C3D_MaterialTable;
+
+// materials is referenced, not copied; call C3D_MaterialTableDirty after changing them
+bool C3D_MaterialTableInit(C3D_MaterialTable* table, C3D_LightEnv* env, const C3D_Material* materials, int count);
+void C3D_MaterialTableDelete(C3D_MaterialTable* table);
+
+// Makes the given material current in the env using the baked colours. The table is rebuilt
+// first if a light or the ambient colour of the env changed since it was last built.
+void C3D_MaterialTableApply(C3D_MaterialTable* table, int id);
+
+static inline void C3D_MaterialTableDirty(C3D_MaterialTable* table)
+{
+	table->valid = false;
+}
@@ -5,6 +5,7 @@
 typedef struct
 {
 	u32 data[256];
+	u32 gen; // Identifies the contents for upload skipping, 0 means always upload
 } C3D_LightLut;
 
 typedef struct
@@ -30,6 +31,13 @@ void LightLut_FromArray(C3D_LightLut* lut, float* data);
 void LightLut_FromFunc(C3D_LightLut* lut, C3D_LightLutFunc func, float param, bool negative);
 void LightLutDA_Create(C3D_LightLutDA* lut, C3D_LightLutFuncDA func, float from, float to, float arg0, float arg1);
 
+// Same as LightLut_Phong without calling powf for every entry
+void LightLut_PhongFast(C3D_LightLut* lut, float shininess);
+
+// Must be called after writing to lut->data directly while the LUT is in use,
+// otherwise the previous contents may be considered still resident on the GPU
+void LightLut_Changed(C3D_LightLut* lut);
+
 #define LightLut_Phong(lut, shininess) LightLut_FromFunc((lut), powf, (shininess), false)
 #define LightLut_Spotlight(lut, angle) LightLut_FromFunc((lut), spot_step, cosf(angle), true)
 #define LightLutDA_Quadratic(lut, from, to, linear, quad) LightLutDA_Create((lut), quadratic_dist_attn, (from), (to), (linear), (quad))
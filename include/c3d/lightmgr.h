@@ -0,0 +1,35 @@
+#pragma once
+#include "light.h"
+
+// A scene light that can be bound to any of the 8 hardware lights
+typedef struct
+{
+	C3D_FVec position; // View space, w = 0 for directional lights
+	C3D_FVec spotDir;  // Only used with a spot LUT
+	float radius;      // Distance beyond which the light has no influence
+	float intensity;   // Weight used when ranking against other lights
+	float ambient[3], diffuse[3], specular0[3], specular1[3]; // r, g, b
+	C3D_LightLut* spot;
+	C3D_LightLutDA* distAttn;
+	u16 gen; // Increment after changing the light so bound copies are refreshed
+} C3D_SceneLight;
+
+typedef struct
+{
+	C3D_LightEnv* env;
+	C3D_SceneLight* lights;
+	int numLights;
+	int numSlots;
+	C3D_Light slots[8];
+	s16 slotLight[8]; // Scene light bound to each hardware light, -1 if none
+	u16 slotGen[8];
+} C3D_LightManager;
+
+// Takes over the free hardware lights of env. Returns false if env has none left.
+bool C3D_LightManagerInit(C3D_LightManager* mgr, C3D_LightEnv* env, C3D_SceneLight* lights, int numLights);
+
+// Picks the lights with the most influence on a bounding sphere (in view space) and
+// binds them to the env. Lights that stay selected keep their hardware light, so only
+// the lights that changed and the light permutation are written again.
+// Returns the number of lights enabled.
+int C3D_LightManagerSelect(C3D_LightManager* mgr, C3D_FVec center, float radius);
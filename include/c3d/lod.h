@@ -0,0 +1,42 @@
+#pragma once
+#include "maths.h"
+#include "drawqueue.h"
+
+#define C3D_LOD_MAX_LEVELS 4
+
+// Culling, level selection and sort depths of one camera. A stereo pair culls against both
+// eye frusta but measures with the shared projection, so both eyes always draw the same level.
+typedef struct
+{
+	C3D_Frustum frusta[2];
+	int numFrusta;
+	C3D_Mtx proj, view;
+	float far;
+} C3D_LodView;
+
+void C3D_LodViewInit(C3D_LodView* v, const C3D_Mtx* proj, const C3D_Mtx* view, float far);
+void C3D_LodViewStereoTilt(C3D_LodView* v, const C3D_Mtx* view, float fovx, float invaspect, float near, float far, float iod, float screen, bool isLeftHanded);
+
+// Levels share the sort key of the model. A level with a count of 0 draws nothing, which
+// lets the last one fade far objects out entirely.
+typedef struct
+{
+	int numLevels;
+	float minSizes[C3D_LOD_MAX_LEVELS-1]; // See Lod_Select
+	float hysteresis;
+	u16 stateId;
+	bool blended;
+	C3D_DrawItem levels[C3D_LOD_MAX_LEVELS]; // key and param are filled in per object
+} C3D_LodModel;
+
+typedef struct
+{
+	const C3D_LodModel* model;
+	void* param; // Passed to the setup callback of the draw, e.g. the model matrix
+	u8 level;    // Level drawn last, kept between frames; 0 for new objects
+} C3D_LodObject;
+
+// Culls the world space spheres, picks a level for each visible object and pushes its draw,
+// keyed by state and depth. Culled objects keep their level. Returns the number of draws
+// pushed, which stops early if the queue fills up.
+u32 C3D_LodQueue(C3D_DrawQueue* q, const C3D_LodView* v, const C3D_FVec* spheres, C3D_LodObject* objects, size_t count);
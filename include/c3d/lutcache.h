@@ -0,0 +1,40 @@
+#pragma once
+#include "lightlut.h"
+#include "fog.h"
+
+// Keeps recently built LUTs keyed by their builder and parameters, so that animated
+// settings which revisit the same values do not rebuild them
+typedef struct
+{
+	const void* func;
+	float params[4];
+	u32 kind;
+	u32 lastUse;
+	u32 gen; // Generation given to light LUTs copied from this entry
+	float bias, scale;
+	u32 data[256];
+} C3D_LutCacheEntry;
+
+typedef struct
+{
+	C3D_LutCacheEntry* entries;
+	int count;
+	u32 clock;
+	bool ownsBuf;
+} C3D_LutCache;
+
+bool C3D_LutCacheInit(C3D_LutCache* cache, int count); // count must be at least 1
+void C3D_LutCacheInitWithBuffer(C3D_LutCache* cache, C3D_LutCacheEntry* entries, int count);
+void C3D_LutCacheDelete(C3D_LutCache* cache);
+void C3D_LutCacheClear(C3D_LutCache* cache);
+
+// Cached versions of the builders, the result is copied into lut. A LUT that already
+// holds the cached contents is left untouched and keeps its place on the GPU.
+// FogLut_ExpCached builds missing entries with FogLut_ExpFast.
+void LightLut_FromFuncCached(C3D_LutCache* cache, C3D_LightLut* lut, C3D_LightLutFunc func, float param, bool negative);
+void LightLutDA_CreateCached(C3D_LutCache* cache, C3D_LightLutDA* lut, C3D_LightLutFuncDA func, float from, float to, float arg0, float arg1);
+void FogLut_ExpCached(C3D_LutCache* cache, C3D_FogLut* lut, float density, float gradient, float near, float far);
+
+#define LightLut_PhongCached(cache, lut, shininess) LightLut_FromFuncCached((cache), (lut), powf, (shininess), false)
+#define LightLut_SpotlightCached(cache, lut, angle) LightLut_FromFuncCached((cache), (lut), spot_step, cosf(angle), true)
+#define LightLutDA_QuadraticCached(cache, lut, from, to, linear, quad) LightLutDA_CreateCached((cache), (lut), quadratic_dist_attn, (from), (to), (linear), (quad))
@@ -398,12 +398,79 @@ static inline C3D_FVec Mtx_MultiplyFVecH(const C3D_Mtx* mtx, C3D_FVec v)
 	return Mtx_MultiplyFVec4(mtx, v);
 }
 
+/**
+ * @brief Multiply two affine matrices
+ * @note Both matrices must have (0,0,0,1) as their bottom row. out may be a or b.
+ * @param[out] out Output matrix
+ * @param[in]  a   Multiplicand
+ * @param[in]  b   Multiplier
+ */
+void Mtx_MultiplyAffine(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b);
+
+/**
+ * @brief Inverse an affine matrix
+ * @note The matrix must have (0,0,0,1) as its bottom row
+ * @param[in,out] out Matrix to inverse
+ * @retval 0.0f Degenerate matrix (no inverse)
+ * @return determinant
+ */
+float Mtx_InverseAffine(C3D_Mtx* out);
+
+/**
+ * @brief Inverse a rigid transform (rotation and translation only)
+ * @note The upper 3x3 part must be orthonormal and the bottom row (0,0,0,1)
+ * @param[in,out] out Matrix to inverse
+ */
+void Mtx_InverseOrthonormal(C3D_Mtx* out);
+
+/**
+ * @brief Transform a point by an affine matrix
+ * @param[in] mtx Matrix
+ * @param[in] v   Point
+ * @return mtx*v (product), with w = 1
+ */
+static inline C3D_FVec Mtx_MultiplyFVecHAffine(const C3D_Mtx* mtx, C3D_FVec v)
+{
+	v.w = 1.0f;
+
+	return FVec4_New(FVec4_Dot(mtx->r[0], v), FVec4_Dot(mtx->r[1], v), FVec4_Dot(mtx->r[2], v), 1.0f);
+}
+
 /**
  * @brief Get 4x4 matrix equivalent to Quaternion
  * @param[out] m Output matrix
  * @param[in]  q Input Quaternion
  */
 void Mtx_FromQuat(C3D_Mtx* m, C3D_FQuat q);
+
+/**
+ * @brief Multiply an array of matrices by one matrix
+ * @note out may be the same array as b
+ * @param[out] out   Output matrices, out[n] = a*b[n]
+ * @param[in]  a     Multiplicand
+ * @param[in]  b     Multipliers
+ * @param[in]  count Number of matrices
+ */
+void Mtx_MultiplyArray(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b, size_t count);
+
+/**
+ * @brief Multiply an array of FVec4 by a 4x4 matrix
+ * @note out may be the same array as in
+ * @param[in]  mtx         Matrix
+ * @param[out] out         Output vectors, out[n] = mtx*in[n]
+ * @param[in]  in          Input vectors
+ * @param[in]  count       Number of vectors
+ * @param[in]  homogeneous Whether to treat the inputs as FVec3 with w = 1 (see @ref Mtx_MultiplyFVecH)
+ */
+void Mtx_MultiplyFVec4Array(const C3D_Mtx* mtx, C3D_FVec* out, const C3D_FVec* in, size_t count, bool homogeneous);
+
+/**
+ * @brief Get 4x4 matrices equivalent to an array of Quaternions
+ * @param[out] out   Output matrices
+ * @param[in]  q     Input Quaternions
+ * @param[in]  count Number of Quaternions
+ */
+void Mtx_FromQuatArray(C3D_Mtx* out, const C3D_FQuat* q, size_t count);
 /** @} */
 
 /**
@@ -579,6 +646,112 @@ void Mtx_PerspStereoTilt(C3D_Mtx* mtx, float fovy, float aspect, float near, flo
 void Mtx_LookAt(C3D_Mtx* out, C3D_FVec cameraPosition, C3D_FVec cameraTarget, C3D_FVec cameraUpVector, bool isLeftHanded);
 /** @} */
 
+/**
+ * @name Frustum Culling
+ * @{
+ */
+
+/**
+ * @brief View frustum as six planes facing inwards
+ * @note A point p is inside a plane when p.x*x + p.y*y + p.z*z + w >= 0
+ */
+typedef struct
+{
+	C3D_FVec planes[6]; ///< Left, right, bottom, top, near and far planes of clip space
+} C3D_Frustum;
+
+/**
+ * @brief Extract the frustum of a clip matrix
+ * @note Works with any of the Mtx_Ortho* and Mtx_Persp* projections. Pass projection*view
+ *       to cull in world space, or projection*view*model to cull in model space.
+ * @param[out] f    Output frustum
+ * @param[in]  clip Matrix mapping into clip space
+ */
+void Frustum_FromMtx(C3D_Frustum* f, const C3D_Mtx* clip);
+
+/**
+ * @brief Extract the frusta of both eyes of a tilted stereo projection
+ * @note Pass both frusta to the culling functions to keep what either eye sees
+ * @param[out] f   Output frusta, left eye first
+ * @param[in]  view View matrix, or NULL to cull in view space
+ * @sa Mtx_PerspStereoTilt for the other parameters
+ */
+void Frustum_FromPerspStereoTilt(C3D_Frustum f[2], const C3D_Mtx* view, float fovx, float invaspect, float near, float far, float iod, float screen, bool isLeftHanded);
+
+/**
+ * @brief Cull an array of spheres
+ * @param[in]  f         Frusta, a sphere is visible if it touches any of them
+ * @param[in]  numFrusta Number of frusta
+ * @param[in]  spheres   Spheres, with the radius in w
+ * @param[in]  count     Number of spheres
+ * @param[out] visible   Bitmask with bit n%32 of word n/32 set for each visible sphere, (count+31)/32 words
+ */
+void Frustum_CullSpheres(const C3D_Frustum* f, int numFrusta, const C3D_FVec* spheres, size_t count, u32* visible);
+
+/**
+ * @brief Cull an array of axis-aligned bounding boxes
+ * @param[in]  f         Frusta, a box is visible if it touches any of them
+ * @param[in]  numFrusta Number of frusta
+ * @param[in]  mins      Minimum corners
+ * @param[in]  maxs      Maximum corners
+ * @param[in]  count     Number of boxes
+ * @param[out] visible   Bitmask with bit n%32 of word n/32 set for each visible box, (count+31)/32 words
+ */
+void Frustum_CullAABBs(const C3D_Frustum* f, int numFrusta, const C3D_FVec* mins, const C3D_FVec* maxs, size_t count, u32* visible);
+
+/**
+ * @brief Check one visibility bit
+ * @param[in] visible Bitmask from Frustum_CullSpheres or Frustum_CullAABBs
+ * @param[in] n       Index
+ * @return Whether object n is visible
+ */
+static inline bool Frustum_IsVisible(const u32* visible, size_t n)
+{
+	return (visible[n/32] >> (n%32)) & 1;
+}
+/** @} */
+
+/**
+ * @name Level of Detail
+ * @{
+ */
+
+/**
+ * @brief Projected size of an array of spheres
+ * @note The size is the part of the shorter screen side covered by the diameter, 1 when the
+ *       sphere spans it. Spheres reaching the eye get INFINITY. Both eyes of a stereo pair
+ *       share the scale and depth terms, so either projection gives the same sizes.
+ * @param[in]  proj    Projection matrix, any of the Mtx_Ortho* and Mtx_Persp* ones
+ * @param[in]  view    View matrix, or NULL for spheres in view space
+ * @param[in]  spheres Spheres, with the radius in w
+ * @param[in]  count   Number of spheres
+ * @param[out] sizes   Projected sizes
+ */
+void Lod_ProjectedSizes(const C3D_Mtx* proj, const C3D_Mtx* view, const C3D_FVec* spheres, size_t count, float* sizes);
+
+/**
+ * @brief Pick a level of detail with hysteresis
+ * @note An object only moves past a threshold once its size is further than hysteresis times
+ *       the threshold away from it, so sizes hovering around it do not flicker between levels.
+ * @param[in] minSizes   Smallest size each level but the last is used for, in descending order
+ * @param[in] numLevels  Number of levels
+ * @param[in] hysteresis Width of the band around each threshold, e.g. 0.1f
+ * @param[in] size       Projected size (see @ref Lod_ProjectedSizes)
+ * @param[in] level      Level picked the last time, 0 for new objects
+ * @return Level to use, 0 being the most detailed
+ */
+static inline int Lod_Select(const float* minSizes, int numLevels, float hysteresis, float size, int level)
+{
+	if (level >= numLevels)
+		level = numLevels-1;
+	while (level < numLevels-1 && size < minSizes[level]*(1.0f-hysteresis))
+		level++;
+	while (level > 0 && size > minSizes[level-1]*(1.0f+hysteresis))
+		level--;
+	return level;
+}
+/** @} */
+
 /**
  * @name Quaternion Math
  * @{
@@ -787,5 +960,32 @@ C3D_FQuat Quat_LookAt(C3D_FVec source, C3D_FVec target, C3D_FVec forwardVector,
  * @return Quaternion rotation based on the axis and angle. Axis doesn't have to be orthogonal.
  */
 C3D_FQuat Quat_FromAxisAngle(C3D_FVec axis, float angle);
+
+/**
+ * @brief Normalized linear interpolation between two Quaternions
+ * @note Takes the shorter arc. Cheaper than Quat_Slerp, but the angular velocity is not constant;
+ *       the difference is negligible for the small steps between animation keyframes.
+ * @param[in] lhs Quaternion at t = 0
+ * @param[in] rhs Quaternion at t = 1
+ * @param[in] t   Interpolation factor
+ * @return Normalized interpolated Quaternion
+ */
+static inline C3D_FQuat Quat_Nlerp(C3D_FQuat lhs, C3D_FQuat rhs, float t)
+{
+	if (Quat_Dot(lhs, rhs) < 0.0f)
+		t = -t;
+	float s = 1.0f - fabsf(t);
+	return Quat_Normalize(Quat_New(lhs.i*s + rhs.i*t, lhs.j*s + rhs.j*t, lhs.k*s + rhs.k*t, lhs.r*s + rhs.r*t));
+}
+
+/**
+ * @brief Spherical linear interpolation between two Quaternions
+ * @note Takes the shorter arc, falls back to Quat_Nlerp when the Quaternions are nearly parallel.
+ * @param[in] lhs Unit Quaternion at t = 0
+ * @param[in] rhs Unit Quaternion at t = 1
+ * @param[in] t   Interpolation factor
+ * @return Interpolated Quaternion
+ */
+C3D_FQuat Quat_Slerp(C3D_FQuat lhs, C3D_FQuat rhs, float t);
 /** @} */
 /** @} */
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdio.h>
+#include "attribs.h"
+#include "buffers.h"
+
+// Pre-baked mesh file, little endian:
+//   C3D_MeshFileHeader
+//   C3D_MeshFileBuf[numBufs]
+//   padding up to payloadOffset
+//   payload: a decompress() stream holding vertexSize bytes of vertices, then the indices
+// The attribute and buffer words are the register values C3D_AttrInfo and C3D_BufInfo hold,
+// buffer offsets are relative to the start of the vertices. vertexSize is a multiple of 16.
+// Primitives are stored shifted right by 8 bits, so that they fit in a byte.
+// For C3D_MeshMap the payload is stored uncompressed and its data starts 16-byte aligned.
+#define C3D_MESH_MAGIC   0x4D443343 // "C3DM"
+#define C3D_MESH_VERSION 1
+
+typedef struct __attribute__((packed))
+{
+	u32 magic;
+	u8  version;
+	u8  primitive; // GPU_Primitive_t >> 8: 0 triangles, 1 strip, 2 fan, 3 geometry primitive
+	u8  indexType; // C3D_UNSIGNED_BYTE or C3D_UNSIGNED_SHORT
+	u8  numBufs;
+	u32 numIndices;
+	u32 vertexSize;
+	u32 indexSize;
+	u32 payloadOffset; // From the start of the file
+	u32 attrFlags[2];
+	u32 attrPermutation[2];
+	u32 attrCount;
+} C3D_MeshFileHeader;
+
+typedef struct __attribute__((packed))
+{
+	u32 offset;
+	u32 flags[2];
+} C3D_MeshFileBuf;
+
+typedef struct
+{
+	void* vertices;
+	void* indices;
+	u32 numIndices;
+	GPU_Primitive_t primitive;
+	int indexType;
+	C3D_AttrInfo attrInfo;
+	C3D_BufInfo bufInfo;
+	bool ownsBuf; // vertices is a linear allocation made by the loader
+} C3D_Mesh;
+
+// The loaders make one linear allocation and decompress the payload straight into it
+bool C3D_MeshImport(C3D_Mesh* mesh, const void* input, size_t insize);
+bool C3D_MeshImportCallback(C3D_Mesh* mesh, decompressCallback callback, void* userdata);
+bool C3D_MeshImportFD(C3D_Mesh* mesh, int fd);
+bool C3D_MeshImportStdio(C3D_Mesh* mesh, FILE* fp);
+
+// Uses a file that is already in linear memory in place, without allocating or copying.
+// Fails if the payload is compressed or misaligned. input has to outlive the mesh. The payload
+// is flushed from the CPU cache here, so it has to be written before the call.
+bool C3D_MeshMap(C3D_Mesh* mesh, const void* input, size_t insize);
+
+void C3D_MeshFree(C3D_Mesh* mesh);
+
+static inline void C3D_MeshBind(C3D_Mesh* mesh)
+{
+	C3D_SetAttrInfo(&mesh->attrInfo);
+	C3D_SetBufInfo(&mesh->bufInfo);
+}
+
+// Binds the mesh buffers and draws all of its indices
+void C3D_MeshDraw(C3D_Mesh* mesh);
@@ -0,0 +1,29 @@
+#pragma once
+#include <stddef.h>
+#include "types.h"
+
+// Index and vertex buffer optimisation for C3D_DrawElements. Only depends on the C library, so
+// the same functions can be run by asset tools on the host or on the console at load time.
+
+// Post-transform cache size the optimiser assumes when none is given. Optimising for a cache that
+// is smaller than the real one costs little, while a larger guess can do worse than no ordering.
+#define C3D_VTXCACHE_SIZE 16
+
+// Reorders the triangles of a list for the post-transform cache (Tipsify). The triangles keep
+// their winding. dst may be src. Returns false if the scratch memory could not be allocated.
+bool C3D_IndexOptimizeCache(u16* dst, const u16* src, size_t numIndices, size_t numVerts, u32 cacheSize);
+
+// Average number of vertex shader runs per triangle with a FIFO cache of cacheSize entries
+float C3D_IndexACMR(const u16* indices, size_t numIndices, u32 cacheSize);
+
+// Stores the vertices in the order the indices first use them, so that the vertex loader reads
+// the buffer linearly. The indices are rewritten in place and dstVerts (numVerts*stride bytes,
+// not overlapping srcVerts) receives the vertices. Returns the number of vertices in use.
+size_t C3D_VertexFetchOptimize(void* dstVerts, u16* indices, size_t numIndices, const void* srcVerts, size_t numVerts, size_t stride);
+
+// Converts a triangle list into one GPU_TRIANGLE_STRIP, joining the strips with degenerate
+// triangles. Triangles are taken in list order, looking a few triangles ahead for one that
+// continues the strip, so the cache order of the list is mostly kept. Fan-like orders such as the
+// ones from C3D_IndexOptimizeCache can come out longer than the list, so compare the lengths.
+// dst must have room for 2*numIndices entries. Returns the number of indices written.
+size_t C3D_IndexToStrip(u16* dst, const u16* src, size_t numIndices);
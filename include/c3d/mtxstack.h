@@ -22,3 +22,45 @@ void MtxStack_Bind(C3D_MtxStack* stk, GPU_SHADER_TYPE unifType, int unifPos, int
 C3D_Mtx* MtxStack_Push(C3D_MtxStack* stk);
 C3D_Mtx* MtxStack_Pop(C3D_MtxStack* stk);
 void MtxStack_Update(C3D_MtxStack* stk);
+
+// Extended matrix stack with a configurable depth. Every level also caches prefix*m, the product
+// that is actually uploaded (usually projection*view*model with the prefix set to projection*view).
+// The product is recomputed lazily, and uploads only dirty the rows that changed.
+typedef struct
+{
+	C3D_Mtx m;
+	C3D_Mtx combined;
+	u32 combinedGen; // Matches the stack's generation while combined is up to date
+} C3D_MtxStackLevel;
+
+typedef struct
+{
+	C3D_MtxStackLevel* levels;
+	C3D_Mtx prefix;
+	int depth, pos;
+	u32 gen;
+	u8 unifType, unifPos, unifLen;
+	bool isDirty;
+	bool ownsBuf;
+} C3D_MtxStackEx;
+
+static inline C3D_Mtx* MtxStackEx_Cur(C3D_MtxStackEx* stk)
+{
+	C3D_MtxStackLevel* lvl = &stk->levels[stk->pos];
+	lvl->combinedGen = stk->gen-1;
+	stk->isDirty = true;
+	return &lvl->m;
+}
+
+bool MtxStackEx_Init(C3D_MtxStackEx* stk, int depth);
+void MtxStackEx_InitWithBuffer(C3D_MtxStackEx* stk, C3D_MtxStackLevel* levels, int depth);
+void MtxStackEx_Free(C3D_MtxStackEx* stk);
+void MtxStackEx_Bind(C3D_MtxStackEx* stk, GPU_SHADER_TYPE unifType, int unifPos, int unifLen);
+// Sets the matrix applied in front of every level, NULL for identity
+void MtxStackEx_SetPrefix(C3D_MtxStackEx* stk, const C3D_Mtx* prefix);
+C3D_Mtx* MtxStackEx_Push(C3D_MtxStackEx* stk);
+// Unlike MtxStack_Pop the result is read-only, so that the cached product of the level survives
+const C3D_Mtx* MtxStackEx_Pop(C3D_MtxStackEx* stk);
+// Returns prefix*m of the current level, only recomputed if either of them changed
+const C3D_Mtx* MtxStackEx_Combined(C3D_MtxStackEx* stk);
+void MtxStackEx_Update(C3D_MtxStackEx* stk);
@@ -0,0 +1,73 @@
+#pragma once
+#include "texture.h"
+#include "streambuf.h"
+#include "uniforms.h"
+
+typedef struct
+{
+	float pos[3];
+	float vel[3];
+	float age, life;   // Seconds, the particle dies once age reaches life
+	float size[2];     // Half extent at birth and at death
+	float angle, spin; // Radians, and radians per second
+	u32 color[2];      // 0xAABBGGRR at birth and at death
+} C3D_Particle;
+
+// Vertex layout uploaded per particle: position (float x3) in register 0, size*(cos, sin)
+// of the angle (float x2) in register 1 and the color (unsigned byte x4) in register 2.
+// The bundled geometry shader expands each vertex into a camera facing quad.
+typedef struct
+{
+	float pos[3];
+	float axis[2];
+	u32 color;
+} C3D_ParticleVertex;
+
+// Particles live in a ring in the order they were emitted, once it is full new ones replace
+// the oldest. Their vertices go through the stream buffer, one per live particle.
+typedef struct
+{
+	C3D_Tex* tex;
+	C3D_Particle* particles;
+	u32 first, count, capacity;
+	float gravity[3]; // Added to the velocity every second
+	float scale, angle; // Applied to all particles by the shader, see C3D_ParticleEmitterDraw
+	C3D_ParticleVertex* verts; // Written by the first draw after an update
+	u32 numVerts;
+	C3D_StreamBuf* vertsStream; // Stream buffer and frame the vertices were written in
+	u32 vertsFrame;
+	bool ownsBuf;
+} C3D_ParticleEmitter;
+
+bool C3D_ParticleEmitterInit(C3D_ParticleEmitter* e, C3D_Tex* tex, u32 capacity); // capacity must be at least 1
+bool C3D_ParticleEmitterInitWithBuffer(C3D_ParticleEmitter* e, C3D_Tex* tex, C3D_Particle* particles, u32 capacity);
+void C3D_ParticleEmitterDelete(C3D_ParticleEmitter* e);
+
+// Returns a cleared particle to fill in
+C3D_Particle* C3D_ParticleEmit(C3D_ParticleEmitter* e);
+
+// Moves the particles on by dt seconds and drops the ones that died from the oldest end
+void C3D_ParticleEmitterUpdate(C3D_ParticleEmitter* e, float dt);
+
+// Program built from the bundled vertex and geometry shaders
+typedef struct
+{
+	DVLB_s* dvlb;
+	shaderProgram_s program;
+	C3D_StreamBuf* stream;
+	s8 modelViewLoc, spinLoc, projectionLoc;
+} C3D_ParticleRenderer;
+
+bool C3D_ParticleRendererInit(C3D_ParticleRenderer* r, C3D_StreamBuf* stream);
+void C3D_ParticleRendererDelete(C3D_ParticleRenderer* r);
+
+// Binds the program, the vertex layout and the matrices. Blending, depth writes and the
+// TexEnv (texture 0 times the primary color, usually) are left to the caller.
+void C3D_ParticleRendererBegin(C3D_ParticleRenderer* r, const C3D_Mtx* projection, const C3D_Mtx* modelView);
+
+// Draws all live particles of the emitter with its texture in one C3D_DrawArrays. The
+// vertices are written on the first draw after an update, so drawing both eyes of a stereo
+// frame only uploads them once. They only last until the end of the frame, a later frame
+// writes them again.
+// Returns false if the stream buffer is out of space.
+bool C3D_ParticleEmitterDraw(C3D_ParticleRenderer* r, C3D_ParticleEmitter* e);
@@ -0,0 +1,44 @@
+#pragma once
+#include "renderqueue.h"
+
+#define C3D_PASSGRAPH_MAX_PASSES 32
+#define C3D_PASSGRAPH_MAX_READS  4
+
+typedef struct
+{
+	C3D_RenderTarget* target;
+	void (* draw)(void* param);
+	void* param;
+	C3D_ClearBits clearBits;
+	u32 clearColor, clearDepth;
+	u32 deps; // Passes that have to run before this one, one bit per pass id
+	C3D_Tex* reads[C3D_PASSGRAPH_MAX_READS];
+	u8 numReads;
+} C3D_RenderPass;
+
+// Passes declared for a frame. Execution order only follows the dependencies, passes that
+// draw on the same target are kept together so that the framebuffer is bound and flushed
+// once, and clears are batched at the start of each command list segment. The frame is
+// only split where a clear would otherwise run after draws on the same target.
+typedef struct
+{
+	C3D_RenderPass passes[C3D_PASSGRAPH_MAX_PASSES];
+	u8 order[C3D_PASSGRAPH_MAX_PASSES];
+	u8 numPasses;
+} C3D_PassGraph;
+
+void C3D_PassGraphInit(C3D_PassGraph* g);
+
+// Returns the pass id, or -1 if the graph is full
+int C3D_PassGraphAdd(C3D_PassGraph* g, C3D_RenderTarget* target, void (* draw)(void* param), void* param);
+void C3D_PassGraphClear(C3D_PassGraph* g, int pass, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth);
+void C3D_PassGraphDepends(C3D_PassGraph* g, int pass, int before);
+
+// Declares that the pass samples tex. It then depends on every pass declared before it
+// that renders into tex.
+bool C3D_PassGraphReads(C3D_PassGraph* g, int pass, C3D_Tex* tex);
+
+// Runs the passes between C3D_FrameBegin and C3D_FrameEnd, display transfers of linked
+// targets then happen at C3D_FrameEnd as usual. Returns false if the dependencies form a
+// cycle, in which case nothing is drawn.
+bool C3D_PassGraphExecute(C3D_PassGraph* g);
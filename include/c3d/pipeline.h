@@ -0,0 +1,12 @@
+#pragma once
+#include "types.h"
+
+// Immutable snapshot of the bound program, attribute layout, effect and TexEnv state.
+// The register writes are encoded once when the object is created; binding it only
+// copies them into the command buffer.
+typedef struct C3D_PipelineState C3D_PipelineState;
+
+// Returns NULL outside of C3D_Init, without a bound program or if the state does not fit its buffer
+C3D_PipelineState* C3D_PipelineStateCreate(void);
+void C3D_PipelineStateDelete(C3D_PipelineState* ps);
+void C3D_PipelineStateBind(const C3D_PipelineState* ps);
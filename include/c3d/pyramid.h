@@ -0,0 +1,28 @@
+#pragma once
+#include "renderqueue.h"
+
+#define C3D_PYRAMID_MAX_LEVELS 6
+
+// Chain of successively halved copies of a render target for post-processing (bloom, blur,
+// depth of field), filled by the display transfer engine instead of extra draws
+typedef struct
+{
+	C3D_Tex tex; // All levels as the mipmaps of one VRAM texture, level 0 is half the source size
+	C3D_Tex levels[C3D_PYRAMID_MAX_LEVELS]; // Each level as a texture of its own
+	int numLevels;
+} C3D_Pyramid;
+
+// width and height are those of the source targets and have to be powers of two, as for
+// targets created with C3D_RenderTargetCreateFromTex. Levels stop before either side drops
+// below 64. Returns false if no level fits or the format can't be scaled by the transfer engine.
+bool C3D_PyramidInit(C3D_Pyramid* p, u16 width, u16 height, GPU_TEXCOLOR fmt, int numLevels);
+void C3D_PyramidDelete(C3D_Pyramid* p);
+
+// Downsamples the colour buffer of src into every level. Inside a frame the transfers are
+// queued behind everything drawn so far, so the levels can be sampled by the draws that follow.
+bool C3D_PyramidBuild(C3D_Pyramid* p, C3D_RenderTarget* src);
+
+static inline C3D_Tex* C3D_PyramidLevel(C3D_Pyramid* p, int level)
+{
+	return &p->levels[level];
+}
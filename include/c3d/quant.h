@@ -0,0 +1,60 @@
+#pragma once
+#include "attribs.h"
+#include "buffers.h"
+#include "uniforms.h"
+
+#define C3D_QUANT_MAX_ATTRIBS 12
+
+// A stored component v is dequantised by the shader as v*scale + bias (e.g. with a single mad).
+// Components the attribute does not have get scale 1 and bias 0, which keeps the (0,0,0,1) the
+// GPU fills in for them.
+typedef struct
+{
+	GPU_FORMATS format;
+	u8 count;   // Components, 1-4
+	u8 offset;  // Byte offset inside the vertex
+	C3D_FVec scale;
+	C3D_FVec bias;
+} C3D_QuantAttrib;
+
+// Interleaved vertex layout made of quantised attributes
+typedef struct
+{
+	C3D_QuantAttrib attribs[C3D_QUANT_MAX_ATTRIBS];
+	int numAttribs;
+	u32 stride;
+} C3D_QuantLayout;
+
+void C3D_QuantLayoutInit(C3D_QuantLayout* layout);
+
+// Appends an attribute with the given storage format (GPU_BYTE, GPU_UNSIGNED_BYTE, GPU_SHORT or
+// GPU_FLOAT). Returns its index, or -1 if the layout is full.
+int C3D_QuantLayoutAdd(C3D_QuantLayout* layout, GPU_FORMATS format, int count);
+
+// Quantises count float vectors (src, srcStride bytes apart, with the attribute's number of
+// components) into attribute attrib of the interleaved buffer vertices. The range of every
+// component is measured over the stream, mapped onto the full range of the format, and the
+// resulting scale and bias are stored in the attribute.
+void C3D_QuantLayoutWrite(C3D_QuantLayout* layout, int attrib, void* vertices, const float* src, size_t srcStride, int count);
+
+// Same, for data whose range is known up front (e.g. [-1,1] for normals, [0,1] for texcoords),
+// so that the constants do not depend on the mesh. Values outside of it are clamped.
+void C3D_QuantLayoutWriteRange(C3D_QuantLayout* layout, int attrib, void* vertices, const float* src, size_t srcStride, int count, float min, float max);
+
+static inline size_t C3D_QuantLayoutSize(const C3D_QuantLayout* layout, int count)
+{
+	return (size_t)layout->stride * count;
+}
+
+// Appends one loader per attribute to attrInfo (input registers from regIds, or in order if NULL)
+// and the interleaved buffer to bufInfo
+bool C3D_QuantLayoutBind(const C3D_QuantLayout* layout, C3D_AttrInfo* attrInfo, C3D_BufInfo* bufInfo, const void* vertices, const int* regIds);
+
+// Writes the dequantisation constants of an attribute, scale to scaleId and bias to biasId
+static inline void C3D_QuantAttribSetUniforms(const C3D_QuantAttrib* attrib, GPU_SHADER_TYPE type, int scaleId, int biasId)
+{
+	const C3D_FVec* s = &attrib->scale;
+	const C3D_FVec* b = &attrib->bias;
+	C3D_FVUnifSet(type, scaleId, s->x, s->y, s->z, s->w);
+	C3D_FVUnifSet(type, biasId,  b->x, b->y, b->z, b->w);
+}
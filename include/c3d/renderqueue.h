@@ -15,6 +15,14 @@ struct C3D_RenderTarget_tag
 	gfxScreen_t screen;
 	gfx3dSide_t side;
 	u32 transferFlags;
+	u16 bandTop, bandBottom;   // Rows drawn on in the current frame, see C3D_FrameDrawOnBand
+	u16 staleTop, staleBottom; // Rows the display buffer presented next is missing
+
+	u32 cmdWords; // Command words recorded while drawing on this target in the current or last frame
+
+	bool pooled, poolBusy; // Owned by the transient pool, acquired during the current frame
+	u32 poolFrame; // Frame in which the target was last acquired
+	u64 poolFence; // Work queue position after which the GPU no longer uses the target
 };
 
 // Flags for C3D_FrameBegin
@@ -28,13 +36,44 @@ float C3D_FrameRate(float fps);
 void C3D_FrameSync(void);
 u32 C3D_FrameCounter(int id);
 
+// Adaptive pacing switches between 60, 30 and 20 fps based on recent CPU and GPU frame times.
+// It drives C3D_FrameRate, so frames have to be started with C3D_FRAME_SYNCDRAW for it to take effect.
+#define C3D_PACING_HISTORY 32
+void C3D_FramePacingEnable(bool enable);
+float C3D_FrameBudget(void); // Time available to a frame at the current rate, in ms
+
 bool C3D_FrameBegin(u8 flags);
 bool C3D_FrameDrawOn(C3D_RenderTarget* target);
+// Linked targets keep their contents and their screen keeps its image through frames in which
+// they are not drawn on, no transfer or swap happens for them. When only some rows of the image
+// change, this draws on the rows [top, bottom) alone with the scissor set to them, and C3D_FrameEnd
+// only transfers those rows along with the ones changed in the target's previous presented frame,
+// which the other display buffer still lacks. The rest of the target must not be cleared.
+// Rows are rounded out to multiples of 8; transfers with scaling always send the whole target.
+// The next C3D_FrameDrawOn puts back the scissor that was set before, unless it was changed meanwhile.
+bool C3D_FrameDrawOnBand(C3D_RenderTarget* target, u32 top, u32 bottom);
 void C3D_FrameSplit(u8 flags);
 void C3D_FrameEnd(u8 flags);
 
 void C3D_FrameEndHook(void (* hook)(void*), void* param);
 
+// With flush tracking on, only the linear memory ranges marked during the frame are flushed instead
+// of the whole linear heap. Vertex and index data written by the CPU must then be marked as well.
+// A frame that runs out of command buffer space is split and run early. That flushes only the
+// commands and, with tracking on, the marked ranges, so without tracking the CPU data read by
+// the draws up to that point must already be flushed, as for C3D_FrameSplit with GX_CMDLIST_FLUSH.
+#define C3D_FLUSH_RANGES 32
+void C3D_FlushTrackingEnable(bool enable);
+void C3D_FlushMarkRange(const void* addr, size_t size);
+
+// Fences mark a point in the GPU work queue; they are signaled once everything
+// queued before them has completed. Inserting a fence splits the frame.
+typedef u64 C3D_Fence;
+
+C3D_Fence C3D_FenceInsert(void);
+bool C3D_FenceIsSignaled(C3D_Fence fence);
+bool C3D_FenceWait(C3D_Fence fence, s64 timeout); // timeout in ns, negative waits forever
+
 float C3D_GetDrawingTime(void);
 float C3D_GetProcessingTime(void);
 
@@ -64,6 +103,11 @@ C3D_RenderTarget* C3D_RenderTargetCreateFromTex(C3D_Tex* tex, GPU_TEXFACE face,
 void C3D_RenderTargetDelete(C3D_RenderTarget* target);
 void C3D_RenderTargetSetOutput(C3D_RenderTarget* target, gfxScreen_t screen, gfx3dSide_t side, u32 transferFlags);
 
+// Transient targets are only valid until C3D_FrameEnd and are reused once the GPU is done with them.
+// Their contents are undefined on acquisition. They must not be deleted or linked to a screen.
+C3D_RenderTarget* C3D_RenderTargetAcquire(int width, int height, GPU_COLORBUF colorFmt, C3D_DEPTHTYPE depthFmt);
+void C3D_RenderTargetPoolTrim(u32 maxIdleFrames); // Frees pooled targets unused for more than this many frames
+
 static inline void C3D_RenderTargetDetachOutput(C3D_RenderTarget* target)
 {
 	C3D_RenderTargetSetOutput(NULL, target->screen, target->side, 0);
@@ -74,6 +118,17 @@ static inline void C3D_RenderTargetClear(C3D_RenderTarget* target, C3D_ClearBits
 	C3D_FrameBufClear(&target->frameBuf, clearBits, clearColor, clearDepth);
 }
 
+typedef struct
+{
+	C3D_RenderTarget* target;
+	C3D_ClearBits clearBits;
+	u32 clearColor;
+	u32 clearDepth;
+} C3D_RenderTargetClearOp;
+
+// Clears several targets at once, packing the buffer fills two per memory fill command
+void C3D_RenderTargetClearMany(const C3D_RenderTargetClearOp* ops, int count);
+
 void C3D_SyncDisplayTransfer(u32* inadr, u32 indim, u32* outadr, u32 outdim, u32 flags);
 void C3D_SyncTextureCopy(u32* inadr, u32 indim, u32* outadr, u32 outdim, u32 size, u32 flags);
 void C3D_SyncMemoryFill(u32* buf0a, u32 buf0v, u32* buf0e, u16 control0, u32* buf1a, u32 buf1v, u32* buf1e, u16 control1);
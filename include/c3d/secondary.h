@@ -0,0 +1,43 @@
+#pragma once
+#include "cmdlist.h"
+#include "buffers.h"
+
+// Groups of primary state a secondary list may change
+enum
+{
+	C3D_SECONDARY_RAW      = BIT(0),
+	C3D_SECONDARY_VSHUNIF  = BIT(1),
+	C3D_SECONDARY_GSHUNIF  = BIT(2),
+	C3D_SECONDARY_BUFINFO  = BIT(3),
+	C3D_SECONDARY_DRAW     = BIT(4),
+};
+
+// Secondary lists are recorded without touching the global context or the GPUCMD buffer,
+// so each one can be filled by a different thread. On C3D_SecondaryCall they inherit all
+// state that is current in the primary, and whatever they changed is re-sent afterwards.
+typedef struct
+{
+	C3D_CmdList list;
+	u32 touched; // C3D_SECONDARY_* groups changed by the recording
+	u32 bufBase; // Attribute buffer base set by the recording, 0 if none
+	u32 draws;
+	bool overflow;
+	bool invalid; // An indexed draw was recorded without a C3D_SecondaryBufInfo covering its indices
+} C3D_SecondaryList;
+
+bool C3D_SecondaryInit(C3D_SecondaryList* sl, size_t size);
+void C3D_SecondaryDelete(C3D_SecondaryList* sl);
+void C3D_SecondaryReset(C3D_SecondaryList* sl);
+
+void C3D_SecondaryWrite(C3D_SecondaryList* sl, u32 reg, u32 mask, u32 val); // Must not upload shader code
+void C3D_SecondaryUniforms(C3D_SecondaryList* sl, GPU_SHADER_TYPE type, int id, const C3D_FVec* data, int num);
+void C3D_SecondaryBufInfo(C3D_SecondaryList* sl, const C3D_BufInfo* info);
+void C3D_SecondaryDrawArrays(C3D_SecondaryList* sl, GPU_Primitive_t primitive, int first, int size);
+void C3D_SecondaryDrawElements(C3D_SecondaryList* sl, GPU_Primitive_t primitive, int count, int type, const void* indices);
+
+bool C3D_SecondaryCall(C3D_SecondaryList* sl); // Main thread only, fails if the recording overflowed or is invalid
+
+static inline void C3D_SecondaryUniformMtx4x4(C3D_SecondaryList* sl, GPU_SHADER_TYPE type, int id, const C3D_Mtx* mtx)
+{
+	C3D_SecondaryUniforms(sl, type, id, mtx->r, 4);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "texture.h"
+#include "renderqueue.h"
+#include "cmdlist.h"
+#include "pipeline.h"
+
+// Renders casters into a shadow texture (GPU_TEX_SHADOW_2D or GPU_TEX_SHADOW_CUBE) and
+// draws receivers with it, switching between two pipeline states baked up front
+typedef struct
+{
+	C3D_Tex* tex;
+	C3D_RenderTarget* targets[6];
+	int numFaces;
+	C3D_PipelineState* caster;
+	C3D_PipelineState* receiver;
+	u32 texShadow; // GPUREG_TEXUNIT0_SHADOW value for the receivers
+	C3D_CmdList casterList;
+	bool recording;
+} C3D_ShadowPass;
+
+// tex must already be initialised with C3D_TexInitShadow or C3D_TexInitShadowCube
+bool C3D_ShadowPassInit(C3D_ShadowPass* pass, C3D_Tex* tex, C3D_DEPTHTYPE depthFmt);
+void C3D_ShadowPassDelete(C3D_ShadowPass* pass);
+
+// Bake the currently bound program, attributes, effect and combiners. For the caster state
+// the fragment operations are switched to shadow mode with the given scale and bias.
+bool C3D_ShadowPassBakeCaster(C3D_ShadowPass* pass, float scale, float bias);
+bool C3D_ShadowPassBakeReceiver(C3D_ShadowPass* pass, bool perspective, float bias);
+
+// Draw on a face of the shadow texture (0 for 2D) with the caster state
+bool C3D_ShadowPassBeginCaster(C3D_ShadowPass* pass, int face);
+
+// Draw on target with the receiver state and the shadow texture on unit 0
+bool C3D_ShadowPassBeginReceiver(C3D_ShadowPass* pass, C3D_RenderTarget* target);
+
+// Casters drawn between these calls are recorded once with the 4x4 vertex uniform at
+// viewProjUniform left out, then C3D_ShadowPassRenderCube replays them on every face
+bool C3D_ShadowPassRecordBegin(C3D_ShadowPass* pass, size_t size, int viewProjUniform);
+bool C3D_ShadowPassRecordEnd(C3D_ShadowPass* pass);
+void C3D_ShadowPassRenderCube(C3D_ShadowPass* pass, const C3D_Mtx viewProj[6]);
@@ -0,0 +1,53 @@
+#pragma once
+#include "uniforms.h"
+
+// Local transform of a bone relative to its parent: scale, then rotation, then translation
+typedef struct
+{
+	C3D_FQuat rot;
+	C3D_FVec  pos;   // xyz
+	C3D_FVec  scale; // xyz
+} C3D_BonePose;
+
+// Keyframes of one bone, times in ascending order
+typedef struct
+{
+	u16 bone;
+	u16 numKeys;
+	const float* times;
+	const C3D_BonePose* keys;
+} C3D_AnimTrack;
+
+typedef struct
+{
+	float duration;
+	u16 numTracks;
+	const C3D_AnimTrack* tracks;
+} C3D_AnimClip;
+
+typedef struct
+{
+	u16 numBones;
+	const s16* parents;     // -1 for roots, parents must come before their children
+	const C3D_Mtx* invBind; // Inverse bind pose per bone, NULL if the mesh is already in bone space
+} C3D_Skeleton;
+
+// Samples every track of the clip at the given time (wrapped around the duration if loop is set)
+// into pose, which has one entry per bone of the skeleton. Keys are blended with Quat_Nlerp.
+// Bones without a track are left untouched, so pose is usually initialised with the bind pose.
+// cursors, if not NULL, holds one u16 per track (zeroed before the first call) and caches the
+// last key found so that playing forward does not search the key times again.
+void C3D_AnimSample(const C3D_AnimClip* clip, float time, bool loop, C3D_BonePose* pose, u16* cursors);
+
+// Blends count bone poses, t = 0 selects a and t = 1 selects b. out may be a or b.
+void C3D_PoseBlend(C3D_BonePose* out, const C3D_BonePose* a, const C3D_BonePose* b, float t, int count);
+
+// Computes the model space matrix of every bone into world (numBones entries)
+void C3D_SkeletonWorld(const C3D_Skeleton* skel, const C3D_BonePose* pose, C3D_Mtx* world);
+
+// Builds the skinning palette (world * invBind) and writes it as 3x4 rows, three uniforms per
+// bone, starting at uniform id. Only the range between the first and the last changed row is
+// marked dirty, so bones that did not move are not uploaded again.
+// world is scratch space for numBones matrices and is left holding the model space matrices.
+// Returns false if the palette does not fit in the uniform space.
+bool C3D_SkeletonUpload(GPU_SHADER_TYPE type, int id, const C3D_Skeleton* skel, const C3D_BonePose* pose, C3D_Mtx* world);
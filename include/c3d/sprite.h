@@ -0,0 +1,73 @@
+#pragma once
+#include "texture.h"
+#include "streambuf.h"
+
+struct Tex3DS_SubTexture;
+
+// Flags for C3D_Sprite
+enum
+{
+	C3D_SPRITE_ROTATE  = BIT(0), // Rotate by angle around the pivot
+	C3D_SPRITE_FLIP_X  = BIT(1),
+	C3D_SPRITE_FLIP_Y  = BIT(2),
+	C3D_SPRITE_UV_SWAP = BIT(3), // The image is stored rotated in the texture (rotated Tex3DS sub-textures)
+};
+
+typedef struct
+{
+	C3D_Tex* tex;
+	float x, y, z;        // Position of the pivot
+	float width, height;
+	float pivotX, pivotY; // Pivot within the quad, 0 is the left/top edge and 1 the right/bottom one
+	float angle;          // Radians, only used with C3D_SPRITE_ROTATE
+	float depth;          // Stereo parallax, scaled by the value passed to C3D_SpriteBatchDraw
+	float left, top, right, bottom; // Texture coordinates
+	u32 color;            // Vertex color, 0xAABBGGRR
+	u32 flags;
+} C3D_Sprite;
+
+// Vertex layout written by the batch: position (float x3) in register 0, texture coordinates
+// (float x2) in register 1 and the color (unsigned byte x4) in register 2
+typedef struct
+{
+	float pos[3];
+	float uv[2];
+	u32 color;
+} C3D_SpriteVertex;
+
+typedef enum
+{
+	C3D_SPRITESORT_NONE,    // Keep the submission order, only neighbouring sprites are merged
+	C3D_SPRITESORT_TEXTURE, // Group by texture; for depth tested or non-overlapping sprites
+} C3D_SpriteSort;
+
+typedef struct
+{
+	C3D_StreamBuf* stream;
+	C3D_Sprite* sprites;
+	u16* order; // 2*capacity entries
+	u32 count, capacity;
+	C3D_SpriteSort sort;
+	bool ownsBuf;
+} C3D_SpriteBatch;
+
+bool C3D_SpriteBatchInit(C3D_SpriteBatch* sb, C3D_StreamBuf* stream, u32 capacity); // capacity must be between 1 and 65535
+void C3D_SpriteBatchInitWithBuffer(C3D_SpriteBatch* sb, C3D_StreamBuf* stream, C3D_Sprite* sprites, u16* order, u32 capacity);
+void C3D_SpriteBatchDelete(C3D_SpriteBatch* sb);
+
+static inline void C3D_SpriteBatchClear(C3D_SpriteBatch* sb)
+{
+	sb->count = 0;
+}
+
+// Returns a sprite with default settings to fill in, or NULL if the batch is full
+C3D_Sprite* C3D_SpriteBatchAdd(C3D_SpriteBatch* sb, C3D_Tex* tex);
+
+// Sets the texture coordinates and size from a Tex3DS sub-texture
+void C3D_SpriteSetSubTex(C3D_Sprite* s, const struct Tex3DS_SubTexture* subtex);
+
+// Writes the vertices into the stream buffer and draws them with one C3D_DrawArrays per
+// texture run. The program, its uniforms and the TexEnv are left to the caller; the attribute
+// and buffer configuration are replaced. The batch is kept, so it can be drawn once per eye
+// with parallax set to the eye offset. Returns false if the stream buffer is out of space.
+bool C3D_SpriteBatchDraw(C3D_SpriteBatch* sb, float parallax);
@@ -0,0 +1,30 @@
+#pragma once
+#include "types.h"
+
+#define C3D_STATE_STACK_DEPTH 4
+
+// Groups of context state that C3D_StatePush saves
+enum
+{
+	C3D_STATE_PROGRAM  = BIT(0), // Bound shader program
+	C3D_STATE_ATTRIB   = BIT(1),
+	C3D_STATE_BUFFER   = BIT(2),
+	C3D_STATE_EFFECT   = BIT(3),
+	C3D_STATE_TEXENV   = BIT(4), // Combiner stages, buffer update masks and buffer colour
+	C3D_STATE_TEX      = BIT(5), // Bound textures and texture unit config
+	C3D_STATE_VIEWPORT = BIT(6), // Viewport and scissor
+	C3D_STATE_LIGHTENV = BIT(7),
+	C3D_STATE_FOG      = BIT(8), // Fog/gas mode, fog colour and fog LUT
+	C3D_STATE_ALL      = 0x1FF,
+};
+
+// Saves the given groups of the current state, so that code sharing the context (for example
+// UI middleware drawing in between the 3D renderer) can change them freely and put them back
+// with C3D_StatePop. Returns false if C3D_STATE_STACK_DEPTH views are already saved.
+bool C3D_StatePush(u32 groups);
+
+// Restores the state saved by the matching C3D_StatePush. Only the parts that differ from the
+// saved state are marked dirty, so a middleware block that changed a single effect setting
+// costs the registers holding that setting and nothing else.
+// Uniforms belong to the shader program and are not part of any group.
+void C3D_StatePop(void);
@@ -0,0 +1,53 @@
+#pragma once
+#include "types.h"
+
+#define C3D_STATS_MAX_SPLITS 16
+
+// State groups counted in C3D_FrameStats::stateBinds
+enum
+{
+	C3D_STAT_FRAMEBUF,
+	C3D_STAT_VIEWPORT,
+	C3D_STAT_SCISSOR,
+	C3D_STAT_PROGRAM,
+	C3D_STAT_SHADERCODE,
+	C3D_STAT_ATTRINFO,
+	C3D_STAT_BUFINFO,
+	C3D_STAT_EFFECT,
+	C3D_STAT_TEXUNITS,
+	C3D_STAT_TEXSTATUS,
+	C3D_STAT_PROCTEX,
+	C3D_STAT_TEXENVBUF,
+	C3D_STAT_FOGLUT,
+	C3D_STAT_GAS,
+	C3D_STAT_TEXENV,
+	C3D_STAT_LIGHTENV,
+
+	C3D_STAT_COUNT,
+};
+
+typedef struct
+{
+	u32 draws;
+	u32 immVertices;
+	u32 uniformWords;
+	u32 stateBinds[C3D_STAT_COUNT];
+	u32 texBinds;
+	u32 lutUploads;
+	u32 cmdWords;
+	u32 queuePeak; // Most gx command queue entries in use at once
+	u32 queueSize; // Entries the queue had at the end of the frame
+
+	// One entry per command list submitted by C3D_FrameSplit (or automatically),
+	// while stats are enabled each C3D_FrameDrawOn target gets its own split
+	u32 numSplits;
+	struct
+	{
+		struct C3D_RenderTarget_tag* target;
+		u32 cmdWords;
+		float gpuTime; // in milliseconds
+	} splits[C3D_STATS_MAX_SPLITS];
+} C3D_FrameStats;
+
+void C3D_StatsEnable(bool enable);
+bool C3D_StatsGetLast(C3D_FrameStats* out); // Last frame whose GPU work has completed
@@ -0,0 +1,45 @@
+#pragma once
+#include <string.h>
+#include "renderqueue.h"
+
+#define C3D_STREAMBUF_FRAMES 4
+
+// Ring of linear memory for transient vertex and index data. Space handed out during a frame is
+// reclaimed once the GPU has finished that frame, so the data only has to stay valid until then.
+typedef struct C3D_StreamBuf_tag
+{
+	struct C3D_StreamBuf_tag *next, *prev;
+	u8* buf;
+	u32 size;
+	u32 head, tail; // Space in use runs from tail up to head, wrapping around
+	u32 frameStart; // head when the current frame started using the ring
+	struct
+	{
+		u32 end;
+		C3D_Fence fence;
+	} frames[C3D_STREAMBUF_FRAMES]; // Frames in flight, oldest first
+	u32 numFrames;
+	u32 frameId; // Counts the frames that used the ring, space from an earlier id may be gone
+	bool ownsBuf;
+} C3D_StreamBuf;
+
+bool C3D_StreamBufInit(C3D_StreamBuf* sb, size_t size);
+void C3D_StreamBufInitWithBuffer(C3D_StreamBuf* sb, void* buf, size_t size);
+void C3D_StreamBufDelete(C3D_StreamBuf* sb);
+
+// Returns size bytes aligned to align (a power of two), valid until the end of the current frame,
+// or NULL if the frames still in flight leave no room even after waiting for them.
+// The span is marked for flushing, it can be passed to BufInfo_Add and C3D_DrawElements as is.
+void* C3D_StreamBufAlloc(C3D_StreamBuf* sb, size_t size, size_t align);
+
+// Copies data into a new span
+static inline void* C3D_StreamBufPush(C3D_StreamBuf* sb, const void* data, size_t size, size_t align)
+{
+	void* p = C3D_StreamBufAlloc(sb, size, align);
+	if (p)
+		memcpy(p, data, size);
+	return p;
+}
+
+// Bytes available without waiting for the GPU (the largest span may be smaller)
+size_t C3D_StreamBufAvailable(C3D_StreamBuf* sb);
@@ -96,3 +96,19 @@ static inline void C3D_TexEnvScale(C3D_TexEnv* env, int mode, GPU_TEVSCALE param
 }
 
 #undef _C3D_DEFAULT
+
+// Whether a stage only forwards the output of the previous one
+static inline bool C3D_TexEnvIsPassThrough(const C3D_TexEnv* env)
+{
+	return (env->srcRgb & 0xF) == GPU_PREVIOUS && (env->srcAlpha & 0xF) == GPU_PREVIOUS
+		&& env->funcRgb == GPU_REPLACE && env->funcAlpha == GPU_REPLACE
+		&& (env->opRgb & 0xF) == 0 && (env->opAlpha & 0xF) == 0
+		&& env->scaleRgb == GPU_TEVSCALE_1 && env->scaleAlpha == GPU_TEVSCALE_1;
+}
+
+// Returns the number of stages left once trailing pass-through stages are dropped
+int C3D_TexEnvCompile(const C3D_TexEnv* envs, int count);
+
+// Sets the first count stages from envs and resets the others to pass-through.
+// Stages that end up identical to what the GPU holds are not written again.
+void C3D_TexEnvApply(const C3D_TexEnv* envs, int count);
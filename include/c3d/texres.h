@@ -0,0 +1,14 @@
+#pragma once
+#include "texture.h"
+
+// Moves managed 2D textures between VRAM and linear memory based on use. Textures bound in the
+// previous frame are promoted to VRAM; when the budget is exceeded, the least recently used VRAM
+// textures are demoted to linear memory. Moves are DMA copies started in C3D_FrameBegin, and the
+// old memory is only released after the GPU is done with it. Managed textures must not be written
+// to while they are being moved.
+bool C3D_TexResidencyInit(size_t vramBudget, size_t bytesPerFrame);
+void C3D_TexResidencyExit(void);
+
+bool C3D_TexResidencyManage(C3D_Tex* tex);
+void C3D_TexResidencyUnmanage(C3D_Tex* tex);
+size_t C3D_TexResidencyVramUsage(void);
@@ -53,13 +53,39 @@ typedef struct ALIGN(8)
 
 bool C3D_TexInitWithParams(C3D_Tex* tex, C3D_TexCube* cube, C3D_TexInitParams p);
 void C3D_TexLoadImage(C3D_Tex* tex, const void* data, GPU_TEXFACE face, int level);
-void C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face);
+
+// Replaces a w by h area of a level with a linear image, top row first, in the texture format (see C3D_TexTileRect).
+// Only the 8x8 tiles covered by the area are written. VRAM textures are updated with one strided transfer,
+// inside a frame it is queued like C3D_TexLoadImageAsync and the area must then be aligned to 8 texels.
+bool C3D_TexUpdateRegion(C3D_Tex* tex, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h, const void* data);
+// Fills the levels below the first on the CPU. Fails for formats without a kernel and, as VRAM
+// textures are staged through transfers, for VRAM textures inside a frame.
+bool C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face);
+// Binding a texture that a unit already holds unchanged emits nothing. The texture cache is cleared at
+// the start of a frame, after splits and framebuffer changes, and when c3d writes to a texture.
+// Texture memory modified by other means during a frame needs a C3D_TexFlush before it is sampled.
 void C3D_TexBind(int unitId, C3D_Tex* tex);
 void C3D_TexFlush(C3D_Tex* tex);
 void C3D_TexDelete(C3D_Tex* tex);
 
 void C3D_TexShadowParams(bool perspective, float bias);
 
+// Conversion between linear images and the tiled (Morton) order of the PICA, for textures in linear memory.
+// Row 0 of a linear image is the top of the texture and rows are stride bytes apart. Texels keep the
+// encoding of the texture format. 4-bit formats need an even x and width, ETC1 formats are not supported.
+// Tiling marks the written rows for flushing (see C3D_FlushMarkRange), otherwise use C3D_TexFlush.
+bool C3D_TexTileRect(C3D_Tex* tex, const void* src, u32 stride, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h);
+bool C3D_TexUntileRect(C3D_Tex* tex, void* dst, u32 stride, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h);
+
+// Asynchronous uploads to VRAM textures. The source data must stay valid until the callback runs.
+// Inside a frame an upload is queued at the next split and only affects draws recorded after it.
+// Callbacks run from C3D_TexUploadPoll, which C3D_FrameBegin also calls.
+#define C3D_TEXUPLOAD_MAX 32
+typedef void (* C3D_TexUploadCallback)(C3D_Tex* tex, void* param);
+bool C3D_TexLoadImageAsync(C3D_Tex* tex, const void* data, GPU_TEXFACE face, int level, C3D_TexUploadCallback callback, void* param);
+u32 C3D_TexUploadPoll(void); // Returns the number of uploads that have not completed yet
+void C3D_TexUploadFinish(void); // Waits for all uploads, must be called outside a frame
+
 static inline int C3D_TexCalcMaxLevel(u32 width, u32 height)
 {
 	return (31-__builtin_clz(width < height ? width : height)) - 3; // avoid sizes smaller than 8
@@ -154,6 +180,16 @@ static inline void C3D_TexUpload(C3D_Tex* tex, const void* data)
 	C3D_TexLoadImage(tex, data, GPU_TEXFACE_2D, 0);
 }
 
+static inline bool C3D_TexTile(C3D_Tex* tex, const void* src, u32 stride, GPU_TEXFACE face, int level)
+{
+	return C3D_TexTileRect(tex, src, stride, face, level, 0, 0, tex->width >> level, tex->height >> level);
+}
+
+static inline bool C3D_TexUntile(C3D_Tex* tex, void* dst, u32 stride, GPU_TEXFACE face, int level)
+{
+	return C3D_TexUntileRect(tex, dst, stride, face, level, 0, 0, tex->width >> level, tex->height >> level);
+}
+
 static inline void C3D_TexSetFilter(C3D_Tex* tex, GPU_TEXTURE_FILTER_PARAM magFilter, GPU_TEXTURE_FILTER_PARAM minFilter)
 {
 	tex->param &= ~(GPU_TEXTURE_MAG_FILTER(GPU_LINEAR) | GPU_TEXTURE_MIN_FILTER(GPU_LINEAR));
@@ -3,20 +3,21 @@
 
 #define C3D_FVUNIF_COUNT 96
 #define C3D_IVUNIF_COUNT 4
+#define C3D_FVUNIF_MASKWORDS ((C3D_FVUNIF_COUNT+31)/32)
 
 extern C3D_FVec C3D_FVUnif[2][C3D_FVUNIF_COUNT];
 extern C3D_IVec C3D_IVUnif[2][C3D_IVUNIF_COUNT];
 extern u16      C3D_BoolUnifs[2];
 
-extern bool C3D_FVUnifDirty[2][C3D_FVUNIF_COUNT];
+extern u32  C3D_FVUnifDirty[2][C3D_FVUNIF_MASKWORDS]; // Bitmask, one bit per uniform
 extern bool C3D_IVUnifDirty[2][C3D_IVUNIF_COUNT];
 extern bool C3D_BoolUnifsDirty[2];
 
 static inline C3D_FVec* C3D_FVUnifWritePtr(GPU_SHADER_TYPE type, int id, int size)
 {
 	int i;
-	for (i = 0; i < size; i ++)
-		C3D_FVUnifDirty[type][id+i] = true;
+	for (i = id; i < id+size; i ++)
+		C3D_FVUnifDirty[type][i/32] |= BIT(i%32);
 	return &C3D_FVUnif[type][id];
 }
 
@@ -35,6 +36,10 @@ static inline void C3D_FVUnifMtxNx4(GPU_SHADER_TYPE type, int id, const C3D_Mtx*
 		ptr[i] = mtx->r[i]; // Struct copy.
 }
 
+// Like C3D_FVUnifMtxNx4, but only rows that differ from what is already in place are written and
+// marked dirty. Returns the number of changed rows.
+int C3D_FVUnifMtxNx4Update(GPU_SHADER_TYPE type, int id, const C3D_Mtx* mtx, int num);
+
 static inline void C3D_FVUnifMtx4x4(GPU_SHADER_TYPE type, int id, const C3D_Mtx* mtx)
 {
 	C3D_FVUnifMtxNx4(type, id, mtx, 4);
@@ -76,3 +81,6 @@ static inline void C3D_BoolUnifSet(GPU_SHADER_TYPE type, int id, bool value)
 }
 
 void C3D_UpdateUniforms(GPU_SHADER_TYPE type);
+
+// Opt-in: keep a copy of the uploaded uniforms and skip uploading unchanged values
+void C3D_UnifCompareEnable(bool enable);
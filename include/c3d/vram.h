@@ -0,0 +1,31 @@
+#pragma once
+#include "texture.h"
+
+// What an allocation is used for, so that traffic can be spread across the two VRAM banks
+typedef enum
+{
+	C3D_VRAM_COLOR   = 0, // Colour buffers (written by the framebuffer)
+	C3D_VRAM_DEPTH   = 1, // Depth/stencil buffers (read and written by the framebuffer)
+	C3D_VRAM_TEXTURE = 2, // Textures sampled while rendering
+	C3D_VRAM_VERTEX  = 3, // Static vertex and index data
+
+	C3D_VRAM_CLASS_COUNT,
+} C3D_VramClass;
+
+// Places framebuffers on the bank holding fewer framebuffer bytes and textures away from them.
+// With a partner the opposite bank of the partner is preferred, e.g. a depth buffer next to its colour buffer.
+void* C3D_VramAlloc(size_t size, C3D_VramClass cls, const void* partner);
+void C3D_VramFree(void* addr);
+void C3D_VramGetUsage(C3D_VramClass cls, size_t* bankA, size_t* bankB);
+
+// Re-packs the buffers of all render targets owned by citro3d and the given 2D VRAM textures.
+// Texture contents are preserved, render target contents are not. Must be called outside a frame.
+// Returns false if the packed layout does not fit, every buffer is then valid but may have moved.
+bool C3D_VramCompact(C3D_Tex* const* texs, int numTex);
+
+// Copies static vertex or index data into a new VRAM allocation with a DMA transfer and returns
+// it, or NULL if VRAM is full. The allocation is rounded up to 16 bytes. Free it with C3D_VramFree.
+// The data must be in linear memory. Outside a frame the copy has finished on return. Inside a
+// frame it is queued, so size must be a multiple of 16 and the data must stay unchanged until
+// the frame has run on the GPU, e.g. until a fence inserted after C3D_FrameEnd is signaled.
+void* C3D_VramUploadBuffer(const void* data, size_t size);
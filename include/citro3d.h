@@ -12,22 +12,48 @@ extern "C" {
 
 #include "c3d/maths.h"
 #include "c3d/mtxstack.h"
+#include "c3d/skeleton.h"
+#include "c3d/jobs.h"
 
 #include "c3d/uniforms.h"
 #include "c3d/attribs.h"
+#include "c3d/quant.h"
+#include "c3d/meshopt.h"
+#include "c3d/mesh.h"
 #include "c3d/buffers.h"
+#include "c3d/streambuf.h"
 #include "c3d/base.h"
 
 #include "c3d/texenv.h"
 #include "c3d/effect.h"
 #include "c3d/texture.h"
+#include "c3d/etc1.h"
+#include "c3d/vram.h"
+#include "c3d/texres.h"
 #include "c3d/proctex.h"
 #include "c3d/light.h"
+#include "c3d/lightmgr.h"
 #include "c3d/lightlut.h"
 #include "c3d/fog.h"
+#include "c3d/lutcache.h"
+#include "c3d/gasrender.h"
+#include "c3d/sprite.h"
+#include "c3d/particle.h"
 
 #include "c3d/framebuffer.h"
 #include "c3d/renderqueue.h"
+#include "c3d/cmdlist.h"
+#include "c3d/secondary.h"
+#include "c3d/shadow.h"
+#include "c3d/passgraph.h"
+#include "c3d/pipeline.h"
+#include "c3d/pyramid.h"
+#include "c3d/stateview.h"
+#include "c3d/drawqueue.h"
+#include "c3d/lod.h"
+#include "c3d/stats.h"
+#include "c3d/cmddecode.h"
+#include "c3d/capture.h"
 
 #ifdef __cplusplus
 }
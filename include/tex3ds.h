@@ -106,6 +106,78 @@ Tex3DS_Texture Tex3DS_TextureImportFD(int fd, C3D_Tex* tex, C3D_TexCube* texcube
  */
 Tex3DS_Texture Tex3DS_TextureImportStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vram);
 
+/** @brief Asynchronous Tex3DS import */
+typedef struct Tex3DS_AsyncImport_s* Tex3DS_AsyncImport;
+
+/** @brief Asynchronous import status */
+typedef enum
+{
+	TEX3DS_ASYNC_PENDING, ///< Still loading
+	TEX3DS_ASYNC_DONE,    ///< Texture is ready
+	TEX3DS_ASYNC_FAILED,  ///< Import failed
+} Tex3DS_AsyncStatus;
+
+/** @brief Core value that runs an asynchronous import on the citro3d job system
+ *  (see C3D_JobsInit) instead of a thread of its own. The import must then be
+ *  started and polled from the thread owning the job system.
+ */
+#define TEX3DS_ASYNC_JOBS (-3)
+
+/** @brief Import Tex3DS texture asynchronously
+ *
+ *  @description
+ *  Reading and decompression run on a worker thread, which must not use the
+ *  callback's data from elsewhere until the import is finished. Texture memory
+ *  is allocated and VRAM uploads are queued from Tex3DS_AsyncPoll, which must
+ *  be called from the rendering thread, inside or outside a frame.
+ *
+ *  @param[out] tex      citro3d texture
+ *  @param[out] texcube  citro3d texcube
+ *  @param[in]  vram     Whether to store textures in VRAM
+ *  @param[in]  callback Data callback
+ *  @param[in]  userdata User data passed to callback
+ *  @param[in]  core     CPU core for the worker thread (see threadCreate), or TEX3DS_ASYNC_JOBS
+ *  @returns Import handle
+ */
+Tex3DS_AsyncImport Tex3DS_TextureImportAsyncCallback(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCallback callback, void* userdata, int core);
+
+/** @brief Import Tex3DS texture asynchronously from a file descriptor
+ *  @param[in]  fd       Open file descriptor
+ *  @param[out] tex      citro3d texture
+ *  @param[out] texcube  citro3d texcube
+ *  @param[in]  vram     Whether to store textures in VRAM
+ *  @param[in]  core     CPU core for the worker thread
+ *  @returns Import handle
+ */
+Tex3DS_AsyncImport Tex3DS_TextureImportAsyncFD(int fd, C3D_Tex* tex, C3D_TexCube* texcube, bool vram, int core);
+
+/** @brief Import Tex3DS texture asynchronously from a file stream
+ *  @param[in]  fp       Open file stream
+ *  @param[out] tex      citro3d texture
+ *  @param[out] texcube  citro3d texcube
+ *  @param[in]  vram     Whether to store textures in VRAM
+ *  @param[in]  core     CPU core for the worker thread
+ *  @returns Import handle
+ */
+Tex3DS_AsyncImport Tex3DS_TextureImportAsyncStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vram, int core);
+
+/** @brief Advance an asynchronous import
+ *  @param[in] imp Import handle
+ *  @returns Import status
+ */
+Tex3DS_AsyncStatus Tex3DS_AsyncPoll(Tex3DS_AsyncImport imp);
+
+/** @brief Finish an asynchronous import and free its handle
+ *
+ *  @description
+ *  Waits for the import unless Tex3DS_AsyncPoll has already reported it as
+ *  done or failed, in which case it may also be called inside a frame.
+ *
+ *  @param[in] imp Import handle
+ *  @returns Tex3DS texture, or NULL if the import failed
+ */
+Tex3DS_Texture Tex3DS_AsyncFinish(Tex3DS_AsyncImport imp);
+
 /** @brief Get number of subtextures
  *  @param[in] texture Tex3DS texture
  *  @returns Number of subtextures
@@ -210,6 +282,68 @@ Tex3DS_SubTextureTopRight(const Tex3DS_SubTexture* subtex, float* u, float* v)
  */
 void Tex3DS_TextureFree(Tex3DS_Texture texture);
 
+/** @brief Runtime texture atlas
+ *
+ *  @description
+ *  Packs images into shared pages (skyline, bottom-left) so that they can be
+ *  drawn under a single texture bind. Each page is described by a Tex3DS
+ *  texture, so its subtextures are read with Tex3DS_GetSubTexture.
+ */
+typedef struct Tex3DS_Atlas_s* Tex3DS_Atlas;
+
+/** @brief Create a texture atlas
+ *  @param[in] width   Page width
+ *  @param[in] height  Page height
+ *  @param[in] format  Page format, ETC1 formats are not supported
+ *  @param[in] padding Gap kept to the right of and below each image, rounded up to an even
+ *                     value for GPU_L4 and GPU_A4 since their images start on even columns
+ *  @returns Texture atlas
+ */
+Tex3DS_Atlas Tex3DS_AtlasCreate(u16 width, u16 height, GPU_TEXCOLOR format, u16 padding);
+
+/** @brief Add an image to a texture atlas
+ *
+ *  @description
+ *  The image is linear, with its top row first, and is tiled into the page
+ *  (see C3D_TexTileRect). A new page is created when none has room. Adding
+ *  may move the page's Tex3DS texture and subtextures in memory.
+ *
+ *  @param[in]  atlas     Texture atlas
+ *  @param[in]  image     Image data in the page format, or NULL to only reserve space
+ *  @param[in]  stride    Distance between image rows in bytes
+ *  @param[in]  width     Image width, even for GPU_L4 and GPU_A4 pages unless image is NULL
+ *  @param[in]  height    Image height
+ *  @param[out] pageIndex Page holding the image
+ *  @param[out] index     Subtexture index within the page
+ *  @returns Whether the image was added
+ */
+bool Tex3DS_AtlasAdd(Tex3DS_Atlas atlas, const void* image, u32 stride, u16 width, u16 height, size_t* pageIndex, size_t* index);
+
+/** @brief Get number of atlas pages
+ *  @param[in] atlas Texture atlas
+ *  @returns Number of pages
+ */
+size_t Tex3DS_AtlasGetNumPages(const Tex3DS_Atlas atlas);
+
+/** @brief Get atlas page texture
+ *  @param[in] atlas Texture atlas
+ *  @param[in] page  Page index
+ *  @returns citro3d texture of the page
+ */
+C3D_Tex* Tex3DS_AtlasGetPage(Tex3DS_Atlas atlas, size_t page);
+
+/** @brief Get the Tex3DS texture describing an atlas page
+ *  @param[in] atlas Texture atlas
+ *  @param[in] page  Page index
+ *  @returns Tex3DS texture, owned by the atlas
+ */
+Tex3DS_Texture Tex3DS_AtlasGetTexture(const Tex3DS_Atlas atlas, size_t page);
+
+/** @brief Free texture atlas and its pages
+ *  @param[in] atlas Texture atlas to free
+ */
+void Tex3DS_AtlasFree(Tex3DS_Atlas atlas);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,6 +3,7 @@
 #include <c3d/base.h>
 #include <c3d/effect.h>
 #include <c3d/uniforms.h>
+#include <c3d/texres.h>
 
 C3D_Context __C3D_Context;
 
@@ -33,6 +34,48 @@ __attribute__((weak)) void C3Di_GasUpdate(C3D_Context* ctx)
 	(void)ctx;
 }
 
+// Marks the state that does not go through the register cache as not resident
+static void C3Di_DirtyUncachedState(C3D_Context* ctx, bool shaderCode)
+{
+	ctx->flags |= C3DiF_AttrInfo | C3DiF_BufInfo | C3DiF_Program
+		| C3DiF_TexAll | C3DiF_LightEnv | C3DiF_Gas;
+	if (shaderCode)
+		ctx->flags |= C3DiF_VshCode | C3DiF_GshCode;
+
+	C3Di_DirtyUniforms(GPU_VERTEX_SHADER);
+	C3Di_DirtyUniforms(GPU_GEOMETRY_SHADER);
+	memset(ctx->texUnit, 0, sizeof(ctx->texUnit));
+	memset(ctx->lightLuts, 0, sizeof(ctx->lightLuts));
+	ctx->lightResident = 0;
+	ctx->fogLutResident = NULL;
+	ctx->procTexResident = 0;
+
+	ctx->fixedAttribDirty |= ctx->fixedAttribEverDirty;
+	ctx->gasFlags |= C3DiG_BeginAcc | C3DiG_AccStage | C3DiG_RenderStage;
+
+	C3D_LightEnv* env = ctx->lightEnv;
+	if (ctx->fogLut)
+		ctx->flags |= C3DiF_FogLut;
+	if (ctx->gasLut)
+		ctx->flags |= C3DiF_GasLut;
+	if (env)
+		C3Di_LightEnvDirty(env);
+	C3Di_ProcTexDirty(ctx);
+}
+
+void C3Di_DirtyState(C3D_Context* ctx, bool shaderCode)
+{
+	C3Di_DirtyUncachedState(ctx, shaderCode);
+
+	ctx->flags |= C3DiF_Effect | C3DiF_Viewport | C3DiF_Scissor | C3DiF_TexEnvBuf | C3DiF_TexEnvAll;
+	ctx->texEnvBufFlags = C3DiB_All;
+	ctx->effectFlags = C3DiE_All;
+	ctx->texEnvResidentMask = 0;
+
+	// The register shadow no longer reflects what the GPU holds
+	C3Di_RegCacheInvalidate();
+}
+
 static void C3Di_AptEventHook(APT_HookType hookType, C3D_UNUSED void* param)
 {
 	C3D_Context* ctx = C3Di_GetContext();
@@ -43,29 +86,22 @@ static void C3Di_AptEventHook(APT_HookType hookType, C3D_UNUSED void* param)
 		{
 			C3Di_RenderQueueWaitDone();
 			C3Di_RenderQueueDisableVBlank();
+			C3Di_RegCacheSnapshot();
 			break;
 		}
 		case APTHOOK_ONRESTORE:
 		{
 			C3Di_RenderQueueEnableVBlank();
-			ctx->flags |= C3DiF_AttrInfo | C3DiF_BufInfo | C3DiF_Effect | C3DiF_FrameBuf
-				| C3DiF_Viewport | C3DiF_Scissor | C3DiF_Program | C3DiF_VshCode | C3DiF_GshCode
-				| C3DiF_TexAll | C3DiF_TexEnvBuf | C3DiF_TexEnvAll | C3DiF_LightEnv | C3DiF_Gas;
-
-			C3Di_DirtyUniforms(GPU_VERTEX_SHADER);
-			C3Di_DirtyUniforms(GPU_GEOMETRY_SHADER);
-
-			ctx->fixedAttribDirty |= ctx->fixedAttribEverDirty;
-			ctx->gasFlags |= C3DiG_BeginAcc | C3DiG_AccStage | C3DiG_RenderStage;
-
-			C3D_LightEnv* env = ctx->lightEnv;
-			if (ctx->fogLut)
-				ctx->flags |= C3DiF_FogLut;
-			if (ctx->gasLut)
-				ctx->flags |= C3DiF_GasLut;
-			if (env)
-				C3Di_LightEnvDirty(env);
-			C3Di_ProcTexDirty(ctx);
+			ctx->flags |= C3DiF_FrameBuf;
+
+			// Everything the register cache knows about is sent back as one block before the
+			// next draw, only LUTs, uniforms, shader code and the unbuffered state are rebuilt
+			if (C3Di_RegCacheHasSnapshot())
+			{
+				C3Di_DirtyUncachedState(ctx, true);
+				ctx->flags |= C3DiF_RegRestore;
+			} else
+				C3Di_DirtyState(ctx, true);
 			break;
 		}
 		default:
@@ -74,21 +110,38 @@ static void C3Di_AptEventHook(APT_HookType hookType, C3D_UNUSED void* param)
 }
 
 bool C3D_Init(size_t cmdBufSize)
+{
+	C3D_InitParams params =
+	{
+		.cmdBufSize = cmdBufSize,
+		.cmdBufCount = 1,
+	};
+	return C3D_InitWithParams(&params);
+}
+
+bool C3D_InitWithParams(const C3D_InitParams* params)
 {
 	int i;
 	C3D_Context* ctx = C3Di_GetContext();
 
 	if (ctx->flags & C3DiF_Active)
 		return false;
+	if (params->cmdBufCount < 1 || params->cmdBufCount > C3D_MAX_CMDBUFS)
+		return false;
 
-	cmdBufSize = (cmdBufSize + 0xF) &~ 0xF; // 0x10-byte align
+	size_t cmdBufSize = (params->cmdBufSize + 0xF) &~ 0xF; // 0x10-byte align
 	ctx->cmdBufSize = cmdBufSize/4;
-	ctx->cmdBuf = (u32*)linearAlloc(cmdBufSize);
+	ctx->cmdBufCount = params->cmdBufCount;
+	ctx->cmdBufCur = 0;
+	ctx->cmdBuf = (u32*)linearAlloc(cmdBufSize*ctx->cmdBufCount);
 	ctx->cmdBufUsage = 0;
 	if (!ctx->cmdBuf)
 		return false;
 
-	ctx->gxQueue.maxEntries = 32;
+	// Frames in flight share the queue, so give each of them room
+	ctx->gxQueue.maxEntries = params->gxQueueSize ? params->gxQueueSize : 32*ctx->cmdBufCount;
+	ctx->gxQueueLimit = params->gxQueueLimit > ctx->gxQueue.maxEntries ? params->gxQueueLimit : ctx->gxQueue.maxEntries;
+	ctx->gxQueueMerge = params->gxQueueMerge;
 	ctx->gxQueue.entries = (gxCmdEntry_s*)malloc(ctx->gxQueue.maxEntries*sizeof(gxCmdEntry_s));
 	if (!ctx->gxQueue.entries)
 	{
@@ -117,6 +170,13 @@ bool C3D_Init(size_t cmdBufSize)
 	ctx->texEnvBufClr = 0xFFFFFFFF;
 	ctx->fogClr = 0;
 	ctx->fogLut = NULL;
+	ctx->fogLutResident = NULL;
+	ctx->procTexResident = 0;
+	ctx->texEnvBufFlags = C3DiB_All;
+	ctx->effectFlags = C3DiE_All;
+	ctx->texEnvResidentMask = 0;
+	memset(ctx->lightLuts, 0, sizeof(ctx->lightLuts));
+	ctx->lightResident = 0;
 
 	for (i = 0; i < 3; i ++)
 		ctx->tex[i] = NULL;
@@ -127,6 +187,11 @@ bool C3D_Init(size_t cmdBufSize)
 	ctx->fixedAttribDirty = 0;
 	ctx->fixedAttribEverDirty = 0;
 
+	ctx->program = NULL;
+	ctx->residentVsh = NULL;
+	ctx->residentGsh = NULL;
+	ctx->residentGshPartial = false;
+
 	C3Di_RenderQueueInit();
 	aptHook(&hookCookie, C3Di_AptEventHook, NULL);
 
@@ -155,11 +220,8 @@ void C3D_SetScissor(GPU_SCISSORMODE mode, u32 left, u32 top, u32 right, u32 bott
 	ctx->scissor[2] = ((bottom-1) << 16) | ((right-1) & 0xFFFF);
 }
 
-void C3Di_UpdateContext(void)
+void C3Di_FrameBufUpdate(C3D_Context* ctx)
 {
-	int i;
-	C3D_Context* ctx = C3Di_GetContext();
-
 	if (ctx->flags & C3DiF_FrameBuf)
 	{
 		ctx->flags &= ~C3DiF_FrameBuf;
@@ -170,25 +232,65 @@ void C3Di_UpdateContext(void)
 			GPUCMD_AddWrite(GPUREG_EARLYDEPTH_CLEAR, 1);
 		}
 		C3Di_FrameBufBind(&ctx->fb);
+
+		// A new target brings its own depth, and with it a new early depth reference
+		if (ctx->effect.earlyDepthAuto)
+		{
+			ctx->flags |= C3DiF_Effect;
+			ctx->effectFlags |= C3DiE_EarlyDepth;
+			ctx->earlyDepthClear = true;
+		}
+	}
+}
+
+void C3Di_UpdateContext(void)
+{
+	int i;
+	C3D_Context* ctx = C3Di_GetContext();
+
+	C3Di_CmdBufEnsureSpace(C3Di_CmdBufHeadroom(ctx));
+	if (ctx->flags & C3DiF_RegRestore)
+	{
+		ctx->flags &= ~C3DiF_RegRestore;
+		// The shadow copy was dropped in the meantime, fall back to sending everything
+		if (!C3Di_RegCacheReplay())
+			C3Di_DirtyState(ctx, false);
 	}
+	if (C3Di_StatsFrame)
+		C3Di_StatsState(ctx->flags);
+	C3Di_FrameBufUpdate(ctx);
 
 	if (ctx->flags & C3DiF_Viewport)
 	{
 		ctx->flags &= ~C3DiF_Viewport;
-		GPUCMD_AddIncrementalWrites(GPUREG_VIEWPORT_WIDTH, ctx->viewport, 4);
-		GPUCMD_AddWrite(GPUREG_VIEWPORT_XY, ctx->viewport[4]);
+		C3Di_RegIncrementalWrites(GPUREG_VIEWPORT_WIDTH, ctx->viewport, 4);
+		C3Di_RegWrite(GPUREG_VIEWPORT_XY, ctx->viewport[4]);
 	}
 
 	if (ctx->flags & C3DiF_Scissor)
 	{
 		ctx->flags &= ~C3DiF_Scissor;
-		GPUCMD_AddIncrementalWrites(GPUREG_SCISSORTEST_MODE, ctx->scissor, 3);
+		C3Di_RegIncrementalWrites(GPUREG_SCISSORTEST_MODE, ctx->scissor, 3);
 	}
 
 	if (ctx->flags & C3DiF_Program)
 	{
-		shaderProgramConfigure(ctx->program, (ctx->flags & C3DiF_VshCode) != 0, (ctx->flags & C3DiF_GshCode) != 0);
+		bool sendVsh, sendGsh;
+		C3Di_ProgramCodeNeeded(ctx, &sendVsh, &sendGsh);
+		shaderProgramConfigure(ctx->program, sendVsh, sendGsh);
 		ctx->flags &= ~(C3DiF_Program | C3DiF_VshCode | C3DiF_GshCode);
+
+		// Without a geometry shader the code is broadcast to the geometry unit as well,
+		// but only the part that fits into vertex shader memory
+		DVLP_s* progV = ctx->program->vertexShader->dvle->dvlp;
+		shaderInstance_s* gsh = ctx->program->geometryShader;
+		if (sendVsh)
+			ctx->residentVsh = progV;
+		if (sendGsh || (sendVsh && !gsh))
+		{
+			ctx->residentGsh = gsh ? gsh->dvle->dvlp : progV;
+			ctx->residentGshPartial = !gsh && progV->codeSize >= 512;
+		}
 	}
 
 	if (ctx->flags & C3DiF_AttrInfo)
@@ -206,7 +308,15 @@ void C3Di_UpdateContext(void)
 	if (ctx->flags & C3DiF_Effect)
 	{
 		ctx->flags &= ~C3DiF_Effect;
-		C3Di_EffectBind(&ctx->effect);
+		C3Di_EffectBindParts(&ctx->effect, ctx->effectFlags);
+		ctx->effectFlags = 0;
+	}
+
+	// The clear takes the reference written above
+	if (ctx->earlyDepthClear)
+	{
+		ctx->earlyDepthClear = false;
+		GPUCMD_AddWrite(GPUREG_EARLYDEPTH_CLEAR, 1);
 	}
 
 	if (ctx->flags & C3DiF_TexAll)
@@ -222,11 +332,14 @@ void C3Di_UpdateContext(void)
 			}
 		}
 
-		// Enable texture units and clear texture cache
-		ctx->texConfig &= ~7;
-		ctx->texConfig |= units | BIT(16);
+		// Enable texture units, the cache is only cleared once texture contents change
+		if ((ctx->texConfig & 7) != units)
+		{
+			ctx->texConfig &= ~7;
+			ctx->texConfig |= units;
+			ctx->flags |= C3DiF_TexStatus;
+		}
 		ctx->flags &= ~C3DiF_TexAll;
-		ctx->flags |= C3DiF_TexStatus;
 	}
 
 	if (ctx->flags & C3DiF_TexStatus)
@@ -247,19 +360,31 @@ void C3Di_UpdateContext(void)
 
 	if (ctx->flags & C3DiF_TexEnvBuf)
 	{
+		u8 parts = ctx->texEnvBufFlags;
 		ctx->flags &= ~C3DiF_TexEnvBuf;
-		GPUCMD_AddMaskedWrite(GPUREG_TEXENV_UPDATE_BUFFER, 0x7, ctx->texEnvBuf);
-		GPUCMD_AddWrite(GPUREG_TEXENV_BUFFER_COLOR, ctx->texEnvBufClr);
-		GPUCMD_AddWrite(GPUREG_FOG_COLOR, ctx->fogClr);
+		ctx->texEnvBufFlags = 0;
+
+		// The modes live in bytes 0 and 2 of the register, the update masks in byte 1
+		u32 mask = ((parts & C3DiB_Mode) ? 0x5 : 0) | ((parts & C3DiB_Update) ? 0x2 : 0);
+		if (mask)
+			C3Di_RegMaskedWrite(GPUREG_TEXENV_UPDATE_BUFFER, mask, ctx->texEnvBuf);
+		if (parts & C3DiB_Color)
+			C3Di_RegWrite(GPUREG_TEXENV_BUFFER_COLOR, ctx->texEnvBufClr);
+		if (parts & C3DiB_FogColor)
+			C3Di_RegWrite(GPUREG_FOG_COLOR, ctx->fogClr);
 	}
 
 	if ((ctx->flags & C3DiF_FogLut) && (ctx->texEnvBuf&7) != GPU_NO_FOG)
 	{
 		ctx->flags &= ~C3DiF_FogLut;
-		if (ctx->fogLut)
+		C3D_FogLut* lut = ctx->fogLut;
+		if (lut && (!lut->gen || ctx->fogLutResident != lut || ctx->fogLutResidentGen != lut->gen))
 		{
+			ctx->fogLutResident = lut;
+			ctx->fogLutResidentGen = lut->gen;
 			GPUCMD_AddWrite(GPUREG_FOG_LUT_INDEX, 0);
 			GPUCMD_AddWrites(GPUREG_FOG_LUT_DATA0, ctx->fogLut->data, 128);
+			C3Di_STAT_ADD(lutUploads, 1);
 		}
 	}
 
@@ -271,7 +396,13 @@ void C3Di_UpdateContext(void)
 		for (i = 0; i < 6; i ++)
 		{
 			if (!(ctx->flags & C3DiF_TexEnv(i))) continue;
+
+			// Taking a stage pointer marks it dirty whether or not it is then changed
+			if ((ctx->texEnvResidentMask & BIT(i)) && memcmp(&ctx->texEnv[i], &ctx->texEnvResident[i], sizeof(C3D_TexEnv)) == 0)
+				continue;
 			C3Di_TexEnvBind(i, &ctx->texEnv[i]);
+			ctx->texEnvResident[i] = ctx->texEnv[i];
+			ctx->texEnvResidentMask |= BIT(i);
 		}
 		ctx->flags &= ~C3DiF_TexEnvAll;
 	}
@@ -281,8 +412,8 @@ void C3Di_UpdateContext(void)
 	if (ctx->flags & C3DiF_LightEnv)
 	{
 		u32 enable = env != NULL;
-		GPUCMD_AddWrite(GPUREG_LIGHTING_ENABLE0, enable);
-		GPUCMD_AddWrite(GPUREG_LIGHTING_ENABLE1, !enable);
+		C3Di_RegWrite(GPUREG_LIGHTING_ENABLE0, enable);
+		C3Di_RegWrite(GPUREG_LIGHTING_ENABLE1, !enable);
 		ctx->flags &= ~C3DiF_LightEnv;
 	}
 
@@ -321,12 +452,35 @@ bool C3Di_SplitFrame(u32** pBuf, u32* pSize)
 		GPUCMD_AddWrite(GPUREG_EARLYDEPTH_CLEAR, 1);
 	}
 
+	u32 *buf, offset;
+	GPUCMD_GetBuffer(&buf, NULL, &offset);
+	ctx->splitFinalize = buf + offset;
 	GPUCMD_Split(pBuf, pSize);
-	u32 totalCmdBufSize = *pBuf + *pSize - ctx->cmdBuf;
+	C3Di_StatsSplit(*pSize);
+
+	// Transfers queued between command lists may write to textures
+	C3Di_TexCacheInvalidate();
+	u32 totalCmdBufSize = *pBuf + *pSize - C3Di_CurCmdBuf(ctx);
 	ctx->cmdBufUsage = (float)totalCmdBufSize / ctx->cmdBufSize;
 	return true;
 }
 
+u32* C3D_CmdReserve(u32 words)
+{
+	u32 *buf, size, offset;
+	words = (words+1) &~ 1;
+	GPUCMD_GetBuffer(&buf, &size, &offset);
+	if (size - offset < words)
+	{
+		C3Di_CmdBufEnsureSpace(words);
+		GPUCMD_GetBuffer(&buf, &size, &offset);
+		if (!buf || size - offset < words)
+			return NULL;
+	}
+	GPUCMD_SetBufOffset(offset + words);
+	return buf + offset;
+}
+
 float C3D_GetCmdBufUsage(void)
 {
 	return C3Di_GetContext()->cmdBufUsage;
@@ -340,12 +494,31 @@ void C3D_Fini(void)
 		return;
 
 	aptUnhook(&hookCookie);
+	C3D_TexResidencyExit();
 	C3Di_RenderQueueExit();
 	free(ctx->gxQueue.entries);
 	linearFree(ctx->cmdBuf);
+	C3D_RegCacheEnable(false);
 	ctx->flags = 0;
 }
 
+bool C3Di_ProgramCodeNeeded(C3D_Context* ctx, bool* sendVsh, bool* sendGsh)
+{
+	shaderInstance_s* gsh = ctx->program->geometryShader;
+	DVLP_s* progV = ctx->program->vertexShader->dvle->dvlp;
+	DVLP_s* progG = gsh ? gsh->dvle->dvlp : progV;
+
+	// C3DiF_VshCode/C3DiF_GshCode force an upload, e.g. after the GPU state was lost
+	DVLP_s* curV = (ctx->flags & C3DiF_VshCode) ? NULL : ctx->residentVsh;
+	DVLP_s* curG = (ctx->flags & C3DiF_GshCode) ? NULL : ctx->residentGsh;
+
+	bool v = curV != progV || (!gsh && curG != progG);
+	bool g = curG != progG || (gsh && ctx->residentGshPartial);
+	if (sendVsh) *sendVsh = v;
+	if (sendGsh) *sendGsh = g;
+	return v || g;
+}
+
 void C3D_BindProgram(shaderProgram_s* program)
 {
 	C3D_Context* ctx = C3Di_GetContext();
@@ -357,26 +530,9 @@ void C3D_BindProgram(shaderProgram_s* program)
 	shaderInstance_s* newGsh = program->geometryShader;
 	if (oldProg != program)
 	{
+		// Shader code is only uploaded if it is not already resident, see C3Di_ProgramCodeNeeded
 		ctx->program = program;
 		ctx->flags |= C3DiF_Program | C3DiF_AttrInfo;
-
-		if (!oldProg)
-			ctx->flags |= C3DiF_VshCode | C3DiF_GshCode;
-		else
-		{
-			shaderInstance_s* oldGsh = oldProg->geometryShader;
-
-			DVLP_s* oldProgV = oldProg->vertexShader->dvle->dvlp;
-			DVLP_s* oldProgG = oldGsh ? oldGsh->dvle->dvlp : oldProgV;
-
-			DVLP_s* newProgV = program->vertexShader->dvle->dvlp;
-			DVLP_s* newProgG = newGsh ? newGsh->dvle->dvlp : newProgV;
-
-			if (oldProgV != newProgV || (!newGsh && oldProgG != newProgG))
-				ctx->flags |= C3DiF_VshCode;
-			if (oldProgG != newProgG || (newProgG==oldProgV && newProgG->codeSize >= 512))
-				ctx->flags |= C3DiF_GshCode;
-		}
 	}
 
 	C3Di_LoadShaderUniforms(program->vertexShader);
@@ -8,14 +8,41 @@ void BufInfo_Init(C3D_BufInfo* info)
 	info->base_paddr = BUFFER_BASE_PADDR;
 }
 
+// Offsets from the base are 28 bits wide, both for the attribute buffers and the index buffer
+#define BUFFER_MAX_OFFSET 0x0FFFFFFF
+
+int C3Di_BufInfoFit(C3D_BufInfo* info, u32 lo, u32 hi)
+{
+	int i;
+	u32 base = info->base_paddr;
+	if (lo >= base && hi - base <= BUFFER_MAX_OFFSET)
+		return 0;
+
+	// Lower the base to cover everything, or raise it if the buffers are all above it
+	for (i = 0; i < info->bufCount; i ++)
+	{
+		u32 pa = base + info->buffers[i].offset;
+		if (pa < lo) lo = pa;
+		if (pa > hi) hi = pa;
+	}
+	u32 newBase = lo &~ 7;
+	if (hi - newBase > BUFFER_MAX_OFFSET)
+		return -1;
+
+	for (i = 0; i < info->bufCount; i ++)
+		info->buffers[i].offset += base - newBase;
+	info->base_paddr = newBase;
+	return 1;
+}
+
 int BufInfo_Add(C3D_BufInfo* info, const void* data, ptrdiff_t stride, int attribCount, u64 permutation)
 {
 	if (info->bufCount == 12) return -1;
-	int id = info->bufCount++;
 
 	u32 pa = osConvertVirtToPhys(data);
-	if (pa < info->base_paddr) return -2;
+	if (!pa || C3Di_BufInfoFit(info, pa, pa) < 0) return -2;
 
+	int id = info->bufCount++;
 	C3D_BufCfg* buf = &info->buffers[id];
 	buf->offset = pa - info->base_paddr;
 	buf->flags[0] = permutation & 0xFFFFFFFF;
@@ -49,5 +76,5 @@ void C3D_SetBufInfo(C3D_BufInfo* info)
 void C3Di_BufInfoBind(C3D_BufInfo* info)
 {
 	GPUCMD_AddWrite(GPUREG_ATTRIBBUFFERS_LOC, info->base_paddr >> 3);
-	GPUCMD_AddIncrementalWrites(GPUREG_ATTRIBBUFFER0_OFFSET, (u32*)info->buffers, sizeof(info->buffers)/sizeof(u32));
+	GPUCMD_AddIncrementalWrites(GPUREG_ATTRIBBUFFER0_OFFSET, (u32*)info->buffers, sizeof(info->buffers)/4);
 }
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <c3d/capture.h>
+#include <c3d/cmddecode.h>
+
+typedef struct
+{
+	FILE* out;
+	bool listWrites;
+	u32 words[C3D_REGGROUP_COUNT];
+} DumpState;
+
+static const char* const gxCmdNames[] =
+{
+	"dma", "cmdlist", "memfill", "displaytransfer", "texturecopy", "flushcache",
+};
+
+static void dumpWrite(void* param, u32 reg, u32 mask, u32 value)
+{
+	DumpState* s = (DumpState*)param;
+	C3D_RegGroup group = C3D_RegGroupOf(reg);
+	s->words[group]++;
+	if (s->listWrites)
+		fprintf(s->out, "    %03x %-8s %08x mask %x\n", (unsigned)reg, C3D_RegGroupName(group), (unsigned)value, (unsigned)mask);
+}
+
+static void dumpCmdList(DumpState* s, const u32* words, u32 numWords)
+{
+	int i;
+	for (i = 0; i < C3D_REGGROUP_COUNT; i ++)
+		s->words[i] = 0;
+
+	int writes = C3D_CmdDecode(words, numWords, dumpWrite, s);
+	if (writes < 0)
+		fprintf(s->out, "    malformed command list\n");
+
+	fprintf(s->out, "    %u words, %d writes:", (unsigned)numWords, writes);
+	for (i = 0; i < C3D_REGGROUP_COUNT; i ++)
+		if (s->words[i])
+			fprintf(s->out, " %s %u", C3D_RegGroupName((C3D_RegGroup)i), (unsigned)s->words[i]);
+	fprintf(s->out, "\n");
+}
+
+bool C3D_CaptureDump(const char* path, FILE* out, bool listWrites)
+{
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+
+	C3D_CaptureHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != C3D_CAPTURE_MAGIC || hdr.version != C3D_CAPTURE_VERSION)
+	{
+		fclose(f);
+		return false;
+	}
+
+	fprintf(out, "%u chunks%s\n", (unsigned)hdr.numChunks, (hdr.flags & C3D_CAPTURE_TRUNCATED) ? ", truncated" : "");
+
+	DumpState s;
+	s.out = out;
+	s.listWrites = listWrites;
+
+	bool ok = true;
+	u32 i, numGx = 0, memBytes = 0;
+	for (i = 0; i < hdr.numChunks && ok; i ++)
+	{
+		C3D_CaptureChunk chunk;
+		if (fread(&chunk, sizeof(chunk), 1, f) != 1 || (chunk.size & 3))
+		{
+			ok = false;
+			break;
+		}
+
+		u32* data = (u32*)malloc(chunk.size ? chunk.size : 4);
+		if (!data || fread(data, 1, chunk.size, f) != chunk.size)
+		{
+			free(data);
+			ok = false;
+			break;
+		}
+
+		switch (chunk.type)
+		{
+			case C3D_CAPCHUNK_GXCMD:
+			{
+				u32 id = chunk.size >= 4 ? data[0] & 0xFF : ~0U;
+				const char* name = id < sizeof(gxCmdNames)/sizeof(gxCmdNames[0]) ? gxCmdNames[id] : "?";
+				fprintf(out, "gx %u: %s", (unsigned)numGx++, name);
+				if (chunk.size >= 32)
+					fprintf(out, " %08x %08x %08x", (unsigned)data[1], (unsigned)data[2], (unsigned)data[3]);
+				fprintf(out, "\n");
+				break;
+			}
+			case C3D_CAPCHUNK_CMDLIST:
+				dumpCmdList(&s, data, chunk.size/4);
+				break;
+			case C3D_CAPCHUNK_MEMORY:
+				if (chunk.size >= 4)
+				{
+					fprintf(out, "memory %08x, %u bytes\n", (unsigned)data[0], (unsigned)(chunk.size-4));
+					memBytes += chunk.size-4;
+				}
+				break;
+			default:
+				fprintf(out, "unknown chunk %u, %u bytes\n", (unsigned)chunk.type, (unsigned)chunk.size);
+				break;
+		}
+		free(data);
+	}
+
+	if (ok)
+		fprintf(out, "%u queue entries, %u bytes of memory\n", (unsigned)numGx, (unsigned)memBytes);
+	fclose(f);
+	return ok;
+}
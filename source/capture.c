@@ -0,0 +1,492 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/capture.h>
+#include <c3d/cmddecode.h>
+#include <c3d/renderqueue.h>
+
+#define CAPTURE_DEFAULT_SIZE (512*1024)
+#define CAPTURE_MAX_RANGES   256
+
+enum
+{
+	CAP_OFF,
+	CAP_ARMED,
+	CAP_RECORDING,
+	CAP_ENDED,
+	CAP_COMPLETE,
+};
+
+typedef struct
+{
+	u32 paddr, size;
+} C3Di_CaptureRange;
+
+// The gx queue callback appends to the buffer while phase is CAP_RECORDING or CAP_ENDED, the
+// application thread reads it once phase is CAP_COMPLETE. phase, next and end go through atomics
+// so that each side sees what the other wrote before changing phase.
+static struct
+{
+	int phase;
+	char* path;
+	u8* buf;
+	size_t size, used;
+	u32 numChunks;
+	u16 flags;
+	u64 next, end;
+} cap;
+
+// Bits per texel of each GPU_TEXCOLOR
+static const u8 texBits[16] = { 32, 24, 16, 16, 16, 16, 16, 8, 8, 8, 4, 4, 4, 8, 0, 0 };
+
+static inline int C3Di_CapturePhase(void)
+{
+	return __atomic_load_n(&cap.phase, __ATOMIC_ACQUIRE);
+}
+
+// Either side may see the last entry the other side needs, only one of them finishes the capture
+static void C3Di_CaptureTryComplete(void)
+{
+	int phase = CAP_ENDED;
+	if (__atomic_load_n(&cap.next, __ATOMIC_SEQ_CST) >= __atomic_load_n(&cap.end, __ATOMIC_SEQ_CST))
+		__atomic_compare_exchange_n(&cap.phase, &phase, CAP_COMPLETE, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+bool C3D_CaptureFrame(const char* path, size_t bufSize)
+{
+	if (C3Di_CapturePhase() != CAP_OFF)
+		return false;
+
+	if (!bufSize)
+		bufSize = CAPTURE_DEFAULT_SIZE;
+	cap.buf = (u8*)malloc(bufSize);
+	cap.path = strdup(path);
+	if (!cap.buf || !cap.path)
+	{
+		free(cap.buf);
+		free(cap.path);
+		return false;
+	}
+
+	cap.size = bufSize;
+	cap.used = 0;
+	cap.numChunks = 0;
+	cap.flags = 0;
+	__atomic_store_n(&cap.phase, CAP_ARMED, __ATOMIC_RELEASE);
+	return true;
+}
+
+bool C3D_CaptureBusy(void)
+{
+	return C3Di_CapturePhase() != CAP_OFF;
+}
+
+static bool C3Di_CaptureChunk(u32 type, const void* data, u32 size)
+{
+	if (cap.used + sizeof(C3D_CaptureChunk) + size > cap.size)
+	{
+		cap.flags |= C3D_CAPTURE_TRUNCATED;
+		return false;
+	}
+
+	C3D_CaptureChunk* chunk = (C3D_CaptureChunk*)&cap.buf[cap.used];
+	chunk->type = type;
+	chunk->size = size;
+	memcpy(chunk+1, data, size);
+	cap.used += sizeof(C3D_CaptureChunk) + size;
+	cap.numChunks++;
+	return true;
+}
+
+void C3Di_CaptureQueue(gxCmdQueue_s* queue, u64 base)
+{
+	int phase = C3Di_CapturePhase();
+	if (phase != CAP_RECORDING && phase != CAP_ENDED)
+		return;
+
+	u64 next = __atomic_load_n(&cap.next, __ATOMIC_RELAXED);
+	u32 i = next > base ? (u32)(next - base) : 0;
+	for (; i < queue->numEntries && base+i < __atomic_load_n(&cap.end, __ATOMIC_SEQ_CST); i ++)
+	{
+		const gxCmdEntry_s* entry = &queue->entries[i];
+		__atomic_store_n(&cap.next, base+i+1, __ATOMIC_SEQ_CST);
+		if (cap.flags & C3D_CAPTURE_TRUNCATED)
+			continue;
+
+		// The command list has to be copied now, its buffer is reused once the queue is cleared
+		size_t needed = sizeof(C3D_CaptureChunk) + sizeof(entry->d);
+		bool isList = (entry->d[0] & 0xFF) == 0x01;
+		if (isList)
+			needed += sizeof(C3D_CaptureChunk) + (entry->d[2] &~ 3);
+		if (cap.used + needed > cap.size)
+		{
+			cap.flags |= C3D_CAPTURE_TRUNCATED;
+			continue;
+		}
+
+		C3Di_CaptureChunk(C3D_CAPCHUNK_GXCMD, entry->d, sizeof(entry->d));
+		if (isList)
+			C3Di_CaptureChunk(C3D_CAPCHUNK_CMDLIST, (const void*)entry->d[1], entry->d[2] &~ 3);
+	}
+
+	C3Di_CaptureTryComplete();
+}
+
+typedef struct
+{
+	u32 regs[0x300];
+	C3Di_CaptureRange ranges[CAPTURE_MAX_RANGES];
+	u32 numRanges;
+	bool full;
+} C3Di_CaptureTracker;
+
+static void C3Di_CaptureAddRange(C3Di_CaptureTracker* t, u32 paddr, u32 size)
+{
+	if (!size || !paddr)
+		return;
+
+	u32 i, end = paddr + size;
+	for (i = 0; i < t->numRanges; i ++)
+	{
+		C3Di_CaptureRange* r = &t->ranges[i];
+		u32 rEnd = r->paddr + r->size;
+		if (paddr > rEnd || end < r->paddr)
+			continue;
+
+		// Overlaps or touches an existing range, neighbours merged this way are not joined again
+		if (paddr < r->paddr)
+			r->paddr = paddr;
+		if (end > rEnd)
+			rEnd = end;
+		r->size = rEnd - r->paddr;
+		return;
+	}
+
+	if (t->numRanges == CAPTURE_MAX_RANGES)
+	{
+		t->full = true;
+		return;
+	}
+	t->ranges[t->numRanges].paddr = paddr;
+	t->ranges[t->numRanges].size = size;
+	t->numRanges++;
+}
+
+static u32 C3Di_CaptureTexSize(u32 dim, u32 lod, u32 type)
+{
+	u32 w = dim >> 16, h = dim & 0x7FF;
+	u32 bits = texBits[type & 0xF];
+	u32 level, maxLevel = (lod >> 16) & 0xF;
+	u32 size = 0;
+	for (level = 0; level <= maxLevel && w >= 8 && h >= 8; level ++)
+	{
+		size += w*h*bits/8;
+		w >>= 1;
+		h >>= 1;
+	}
+	return size;
+}
+
+static void C3Di_CaptureDraw(C3Di_CaptureTracker* t, bool elements)
+{
+	const u32* regs = t->regs;
+	u32 base = (regs[GPUREG_ATTRIBBUFFERS_LOC] & 0x1FFFFFFF) << 3;
+	u32 count = regs[GPUREG_NUMVERTICES];
+	u32 numVerts = regs[GPUREG_VERTEX_OFFSET] + count;
+	int i;
+
+	if (elements)
+	{
+		u32 config = regs[GPUREG_INDEXBUFFER_CONFIG];
+		u32 paddr = base + (config & 0x0FFFFFFF);
+		bool isShort = (config >> 31) != 0;
+		C3Di_CaptureAddRange(t, paddr, count << isShort);
+
+		const void* indices = osConvertPhysToVirt(paddr);
+		u32 maxIndex = 0;
+		if (indices)
+			for (i = 0; i < (int)count; i ++)
+			{
+				u32 index = isShort ? ((const u16*)indices)[i] : ((const u8*)indices)[i];
+				if (index > maxIndex)
+					maxIndex = index;
+			}
+		numVerts = maxIndex+1;
+	}
+
+	for (i = 0; i < 12; i ++)
+	{
+		u32 offset = regs[GPUREG_ATTRIBBUFFER0_OFFSET + i*3];
+		u32 config2 = regs[GPUREG_ATTRIBBUFFER0_CONFIG2 + i*3];
+		u32 stride = (config2 >> 16) & 0xFF;
+		if (!(config2 >> 28) || !stride)
+			continue;
+		C3Di_CaptureAddRange(t, base + (offset & 0x0FFFFFFF), numVerts*stride);
+	}
+
+	static const u16 unitRegs[3] = { GPUREG_TEXUNIT0_DIM, GPUREG_TEXUNIT1_DIM, GPUREG_TEXUNIT2_DIM };
+	static const u16 typeRegs[3] = { GPUREG_TEXUNIT0_TYPE, GPUREG_TEXUNIT1_TYPE, GPUREG_TEXUNIT2_TYPE };
+	for (i = 0; i < 3; i ++)
+	{
+		if (!(regs[GPUREG_TEXUNIT_CONFIG] & BIT(i)))
+			continue;
+
+		// DIM, PARAM, LOD and ADDR are consecutive on every unit
+		const u32* unit = &regs[unitRegs[i]];
+		u32 size = C3Di_CaptureTexSize(unit[0], unit[2], regs[typeRegs[i]]);
+		u32 mode = (unit[1] >> 28) & 7;
+		C3Di_CaptureAddRange(t, unit[3] << 3, size);
+
+		if (i == 0 && (mode == GPU_TEX_CUBE_MAP || mode == GPU_TEX_SHADOW_CUBE))
+		{
+			int face;
+			for (face = 0; face < 5; face ++)
+				C3Di_CaptureAddRange(t, ((unit[3] &~ 0x3FFFFF) | (unit[4+face] & 0x3FFFFF)) << 3, size);
+		}
+	}
+}
+
+static void C3Di_CaptureTrack(void* param, u32 reg, u32 mask, u32 value)
+{
+	C3Di_CaptureTracker* t = (C3Di_CaptureTracker*)param;
+	if (reg >= sizeof(t->regs)/sizeof(u32))
+		return;
+
+	if (reg == GPUREG_DRAWARRAYS || reg == GPUREG_DRAWELEMENTS)
+	{
+		C3Di_CaptureDraw(t, reg == GPUREG_DRAWELEMENTS);
+		return;
+	}
+
+	u32 bytes = 0;
+	int i;
+	for (i = 0; i < 4; i ++)
+		if (mask & BIT(i))
+			bytes |= 0xFF << (i*8);
+	t->regs[reg] = (t->regs[reg] &~ bytes) | (value & bytes);
+}
+
+static void C3Di_CaptureWrite(void)
+{
+	FILE* f = fopen(cap.path, "wb");
+	if (!f)
+		return;
+
+	C3Di_CaptureTracker* t = (C3Di_CaptureTracker*)calloc(1, sizeof(C3Di_CaptureTracker));
+	if (t)
+	{
+		// Register state carries over from one command list to the next
+		size_t pos = 0;
+		while (pos < cap.used)
+		{
+			const C3D_CaptureChunk* chunk = (const C3D_CaptureChunk*)&cap.buf[pos];
+			if (chunk->type == C3D_CAPCHUNK_CMDLIST)
+				C3D_CmdDecode((const u32*)(chunk+1), chunk->size/4, C3Di_CaptureTrack, t);
+			pos += sizeof(C3D_CaptureChunk) + chunk->size;
+		}
+		if (t->full)
+			cap.flags |= C3D_CAPTURE_TRUNCATED;
+	} else
+		cap.flags |= C3D_CAPTURE_TRUNCATED;
+
+	C3D_CaptureHeader hdr;
+	hdr.magic = C3D_CAPTURE_MAGIC;
+	hdr.version = C3D_CAPTURE_VERSION;
+	hdr.flags = cap.flags;
+	hdr.numChunks = cap.numChunks;
+
+	u32 i;
+	for (i = 0; t && i < t->numRanges; i ++)
+		if (osConvertPhysToVirt(t->ranges[i].paddr))
+			hdr.numChunks++;
+
+	fwrite(&hdr, sizeof(hdr), 1, f);
+	fwrite(cap.buf, 1, cap.used, f);
+
+	for (i = 0; t && i < t->numRanges; i ++)
+	{
+		const C3Di_CaptureRange* r = &t->ranges[i];
+		const void* data = osConvertPhysToVirt(r->paddr);
+		if (!data)
+			continue;
+
+		// Ranges are padded to whole words
+		C3D_CaptureChunk chunk;
+		u32 size = (r->size + 3) &~ 3;
+		chunk.type = C3D_CAPCHUNK_MEMORY;
+		chunk.size = 4 + size;
+		GSPGPU_InvalidateDataCache(data, size);
+		fwrite(&chunk, sizeof(chunk), 1, f);
+		fwrite(&r->paddr, 4, 1, f);
+		fwrite(data, 1, size, f);
+	}
+
+	fclose(f);
+	free(t);
+}
+
+void C3Di_CaptureFrameBegin(u64 fence)
+{
+	int phase = C3Di_CapturePhase();
+	if (phase == CAP_COMPLETE)
+	{
+		C3Di_CaptureWrite();
+		free(cap.buf);
+		free(cap.path);
+		cap.buf = NULL;
+		cap.path = NULL;
+		__atomic_store_n(&cap.phase, CAP_OFF, __ATOMIC_RELEASE);
+	}
+	else if (phase == CAP_ARMED)
+	{
+		__atomic_store_n(&cap.next, fence, __ATOMIC_RELAXED);
+		__atomic_store_n(&cap.end, ~0ULL, __ATOMIC_RELAXED);
+		__atomic_store_n(&cap.phase, CAP_RECORDING, __ATOMIC_RELEASE);
+	}
+}
+
+void C3Di_CaptureFrameEnd(u64 fence)
+{
+	if (C3Di_CapturePhase() != CAP_RECORDING)
+		return;
+	__atomic_store_n(&cap.end, fence, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&cap.phase, CAP_ENDED, __ATOMIC_SEQ_CST);
+	C3Di_CaptureTryComplete();
+}
+
+static float C3Di_CaptureRun(gxCmdQueue_s* queue, const gxCmdEntry_s* entry)
+{
+	gxCmdQueueClear(queue);
+	gxCmdQueueAdd(queue, entry);
+	u64 start = svcGetSystemTick();
+	gxCmdQueueRun(queue);
+	gxCmdQueueWait(queue, -1);
+	gxCmdQueueStop(queue);
+	return (svcGetSystemTick() - start) / CPU_TICKS_PER_MSEC;
+}
+
+bool C3D_CaptureReplay(const char* path, C3D_CaptureStats* stats, bool restoreMemory)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	if (!(ctx->flags & C3DiF_Active))
+		return false;
+
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+
+	C3D_CaptureHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != C3D_CAPTURE_MAGIC || hdr.version != C3D_CAPTURE_VERSION)
+	{
+		fclose(f);
+		return false;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+
+	// Memory chunks come last, restoring them means finding them first
+	long chunksStart = ftell(f);
+	bool ok = true;
+	u32 i;
+	if (restoreMemory)
+	{
+		for (i = 0; i < hdr.numChunks && ok; i ++)
+		{
+			C3D_CaptureChunk chunk;
+			u32 paddr;
+			if (fread(&chunk, sizeof(chunk), 1, f) != 1)
+				ok = false;
+			else if (chunk.type != C3D_CAPCHUNK_MEMORY || chunk.size < 4)
+				ok = fseek(f, chunk.size, SEEK_CUR) == 0;
+			else if (fread(&paddr, 4, 1, f) != 1)
+				ok = false;
+			else
+			{
+				void* data = osConvertPhysToVirt(paddr);
+				u32 size = chunk.size-4;
+				if (data && fread(data, 1, size, f) == size)
+					GSPGPU_FlushDataCache(data, size);
+				else
+					ok = !data && fseek(f, size, SEEK_CUR) == 0;
+			}
+		}
+		fseek(f, chunksStart, SEEK_SET);
+	}
+
+	// Everything queued by the application has to finish before the queue is borrowed
+	C3D_FenceWait(C3D_FenceInsert(), -1);
+
+	gxCmdEntry_s entryBuf;
+	gxCmdQueue_s queue;
+	memset(&queue, 0, sizeof(queue));
+	queue.entries = &entryBuf;
+	queue.maxEntries = 1;
+	GX_BindQueue(&queue);
+
+	gxCmdEntry_s pending;
+	bool hasPending = false;
+	for (i = 0; i < hdr.numChunks && ok; i ++)
+	{
+		C3D_CaptureChunk chunk;
+		if (fread(&chunk, sizeof(chunk), 1, f) != 1)
+		{
+			ok = false;
+			break;
+		}
+
+		if (chunk.type == C3D_CAPCHUNK_CMDLIST && hasPending)
+		{
+			u32* cmds = (u32*)linearAlloc(chunk.size ? chunk.size : 8);
+			if (!cmds || fread(cmds, 1, chunk.size, f) != chunk.size)
+			{
+				linearFree(cmds);
+				ok = false;
+				break;
+			}
+
+			GSPGPU_FlushDataCache(cmds, chunk.size);
+			pending.d[1] = (u32)cmds;
+			pending.d[2] = chunk.size;
+			float time = C3Di_CaptureRun(&queue, &pending);
+			if (stats->numCmdLists < C3D_CAPTURE_MAX_TIMES)
+				stats->cmdListTime[stats->numCmdLists] = time;
+			stats->numCmdLists++;
+			stats->cmdListWords += chunk.size/4;
+			stats->totalTime += time;
+			hasPending = false;
+			linearFree(cmds);
+			continue;
+		}
+
+		// A command list entry without its words has nothing to resubmit
+		hasPending = false;
+		if (chunk.type != C3D_CAPCHUNK_GXCMD || chunk.size != sizeof(pending.d))
+		{
+			ok = fseek(f, chunk.size, SEEK_CUR) == 0;
+			continue;
+		}
+
+		if (fread(pending.d, sizeof(pending.d), 1, f) != 1)
+		{
+			ok = false;
+			break;
+		}
+
+		stats->numGxCmds++;
+		if ((pending.d[0] & 0xFF) == 0x01)
+		{
+			hasPending = true;
+			continue;
+		}
+
+		// GX_RequestDma sources may point at memory that is gone by now
+		if ((pending.d[0] & 0xFF) == 0x00)
+			continue;
+
+		float time = C3Di_CaptureRun(&queue, &pending);
+		stats->transferTime += time;
+		stats->totalTime += time;
+	}
+
+	GX_BindQueue(&ctx->gxQueue);
+	fclose(f);
+	return ok;
+}
@@ -0,0 +1,196 @@
+#include <stddef.h>
+#include <string.h>
+#include <c3d/cmddecode.h>
+
+static const char* const groupNames[C3D_REGGROUP_COUNT] =
+{
+	"misc", "viewport", "tex", "proctex", "texenv", "fog", "effect", "framebuf",
+	"gas", "light", "attrib", "draw", "program", "uniform", "shader",
+};
+
+static C3D_RegGroup shaderGroup(u32 reg)
+{
+	// Same layout for the geometry (0x280) and the vertex (0x2B0) shader unit
+	if (reg <= 0x04 || (reg >= 0x10 && reg <= 0x18))
+		return C3D_REGGROUP_UNIFORM;
+	if (reg >= 0x1B && reg <= 0x2E)
+		return C3D_REGGROUP_SHADER;
+	return C3D_REGGROUP_PROGRAM;
+}
+
+C3D_RegGroup C3D_RegGroupOf(u32 reg)
+{
+	reg &= 0x3FF;
+	if (reg < 0x040) return C3D_REGGROUP_MISC;
+	if (reg < 0x080) return C3D_REGGROUP_VIEWPORT;
+	if (reg < 0x0A8) return C3D_REGGROUP_TEX;
+	if (reg < 0x0C0) return C3D_REGGROUP_PROCTEX;
+	if (reg < 0x0E0) return C3D_REGGROUP_TEXENV;
+	if (reg < 0x0F0) return C3D_REGGROUP_FOG;
+	if (reg < 0x100) return reg == 0x0FD ? C3D_REGGROUP_FOG : C3D_REGGROUP_TEXENV;
+	if (reg < 0x110) return C3D_REGGROUP_EFFECT;
+	if (reg < 0x120) return C3D_REGGROUP_FRAMEBUF;
+	// The top byte of the gas depth register is the depth function used by the effect
+	if (reg < 0x140) return reg == 0x126 ? C3D_REGGROUP_EFFECT : C3D_REGGROUP_GAS;
+	if (reg < 0x200) return C3D_REGGROUP_LIGHT;
+	if (reg < 0x227) return C3D_REGGROUP_ATTRIB;
+	if (reg < 0x240) return C3D_REGGROUP_DRAW;
+	if (reg == 0x245 || reg == 0x253 || reg == 0x25E || reg == 0x25F) return C3D_REGGROUP_DRAW;
+	if (reg < 0x280) return C3D_REGGROUP_PROGRAM;
+	if (reg < 0x2B0) return shaderGroup(reg - 0x280);
+	if (reg < 0x2E0) return shaderGroup(reg - 0x2B0);
+	return C3D_REGGROUP_MISC;
+}
+
+const char* C3D_RegGroupName(C3D_RegGroup group)
+{
+	return (unsigned)group < C3D_REGGROUP_COUNT ? groupNames[group] : "?";
+}
+
+int C3D_CmdDecode(const u32* cmds, u32 numWords, C3D_CmdDecodeFunc func, void* param)
+{
+	int writes = 0;
+	u32 pos = 0;
+	while (pos + 2 <= numWords)
+	{
+		u32 header = cmds[pos+1];
+		u32 reg    = header & 0x3FF;
+		u32 mask   = (header >> 16) & 0xF;
+		u32 extra  = (header >> 20) & 0xFF;
+		u32 incr   = header >> 31;
+
+		// The first parameter comes before the header, the others follow it
+		u32 size = (2 + extra + 1) &~ 1;
+		if (pos + 2 + extra > numWords)
+			return -1;
+
+		u32 i;
+		for (i = 0; i <= extra; i ++)
+		{
+			u32 value = i ? cmds[pos+1+i] : cmds[pos];
+			if (func)
+				func(param, incr ? ((reg + i) & 0x3FF) : reg, mask, value);
+		}
+		writes += extra + 1;
+		pos += size;
+	}
+	return writes;
+}
+
+// Extra cycles per write on top of fetching its words. Framebuffer flushes and shader
+// unit reconfiguration wait for the pipeline to drain, texture unit changes flush the
+// texture cache.
+static const u8 writeCost[C3D_REGGROUP_COUNT] =
+{
+	1, 1, 4, 1, 1, 1, 1, 32, 1, 1, 2, 1, 16, 1, 1,
+};
+
+#define DRAW_COST 64
+
+static bool isDataPort(u32 reg)
+{
+	switch (reg)
+	{
+		case 0x010:         // Finalize
+		case 0x110: case 0x111: // Framebuffer invalidate/flush
+		case 0x0AF:         // Procedural texture LUT index, data follows
+		case 0x0E6:         // Fog LUT index
+		case 0x123:         // Gas LUT index
+		case 0x124:         // Gas LUT data
+		case 0x1C5:         // Light LUT index
+		case 0x22E: case 0x22F: // Draw triggers
+		case 0x232:         // Fixed attribute index, data follows
+		case 0x238: case 0x239: case 0x23C: case 0x23D: // Command buffer jumps
+		case 0x25F:         // Restart primitive
+			return true;
+	}
+
+	if ((reg >= 0x0B0 && reg <= 0x0B7) || (reg >= 0x0E8 && reg <= 0x0EF) || (reg >= 0x1C8 && reg <= 0x1CF) || (reg >= 0x233 && reg <= 0x235))
+		return true;
+
+	// Float uniform, code and operand descriptor ports of both shader units
+	if (reg >= 0x280 && reg < 0x2E0)
+	{
+		u32 r = (reg - 0x280) % 0x30;
+		return (r >= 0x0F && r <= 0x18) || r >= 0x1B;
+	}
+	return false;
+}
+
+void C3D_CmdStatsInit(C3D_CmdStats* stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+
+int C3D_CmdStatsAdd(C3D_CmdStats* stats, const u32* cmds, u32 numWords)
+{
+	int writes = 0;
+	u32 pos = 0;
+	while (pos + 2 <= numWords)
+	{
+		u32 header = cmds[pos+1];
+		u32 reg    = header & 0x3FF;
+		u32 mask   = (header >> 16) & 0xF;
+		u32 extra  = (header >> 20) & 0xFF;
+		u32 incr   = header >> 31;
+
+		u32 size = (2 + extra + 1) &~ 1;
+		if (pos + 2 + extra > numWords)
+			return -1;
+
+		// Headers and padding are charged to the first register
+		C3D_RegGroup first = C3D_RegGroupOf(reg);
+		stats->words[first] += size - (extra + 1);
+		stats->cycles += size;
+
+		u32 bytes = 0, i;
+		for (i = 0; i < 4; i ++)
+			if (mask & (1U << i))
+				bytes |= 0xFFU << (i*8);
+
+		for (i = 0; i <= extra; i ++)
+		{
+			u32 value = i ? cmds[pos+1+i] : cmds[pos];
+			u32 r = incr ? ((reg + i) & 0x3FF) : reg;
+			C3D_RegGroup group = C3D_RegGroupOf(r);
+			stats->words[group]++;
+			stats->writes[group]++;
+			stats->cycles += writeCost[group];
+
+			if (r == 0x22E || r == 0x22F)
+			{
+				stats->draws++;
+				stats->cycles += DRAW_COST;
+			}
+
+			if (r >= sizeof(stats->regs)/sizeof(u32) || isDataPort(r))
+				continue;
+
+			u32 old = stats->regs[r];
+			u32 bit = 1U << (r & 31);
+			u32 merged = (old &~ bytes) | (value & bytes);
+			if ((stats->known[r/32] & bit) && merged == old)
+				stats->redundant[group]++;
+
+			// Partially masked writes leave the other bytes unknown until a full write
+			stats->regs[r] = merged;
+			if (bytes == 0xFFFFFFFF)
+				stats->known[r/32] |= bit;
+		}
+		writes += extra + 1;
+		pos += size;
+	}
+	return writes;
+}
+
+float C3D_CmdStatsRedundancy(const C3D_CmdStats* stats)
+{
+	u32 writes = 0, redundant = 0;
+	int i;
+	for (i = 0; i < C3D_REGGROUP_COUNT; i ++)
+	{
+		writes += stats->writes[i];
+		redundant += stats->redundant[i];
+	}
+	return writes ? (float)redundant / writes : 0.0f;
+}
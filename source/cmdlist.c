@@ -0,0 +1,144 @@
+#include "internal.h"
+#include <c3d/cmdlist.h>
+#include <c3d/uniforms.h>
+
+static C3D_CmdList* recList;
+static u32* savedBuf;
+static u32 savedSize, savedOffset, savedFlags;
+static DVLP_s *savedVsh, *savedGsh;
+static bool savedGshPartial;
+
+bool C3D_CmdListInit(C3D_CmdList* list, size_t size)
+{
+	size = (size + 0xF) &~ 0xF; // 0x10-byte align
+	u32* buf = (u32*)linearAlloc(size);
+	if (!buf)
+		return false;
+
+	C3D_CmdListInitWithBuffer(list, buf, size);
+	list->ownsBuf = true;
+	return true;
+}
+
+void C3D_CmdListInitWithBuffer(C3D_CmdList* list, u32* buf, size_t size)
+{
+	list->buf = buf;
+	list->size = size/4;
+	list->used = 0;
+	list->residentVsh = NULL;
+	list->residentGsh = NULL;
+	list->residentGshPartial = false;
+	list->ownsBuf = false;
+	list->stereoProj = -1;
+}
+
+void C3D_CmdListDelete(C3D_CmdList* list)
+{
+	if (recList == list)
+		C3D_CmdListEnd(list);
+	if (list->ownsBuf)
+		linearFree(list->buf);
+	list->buf = NULL;
+	list->size = 0;
+	list->used = 0;
+}
+
+bool C3D_CmdListBegin(C3D_CmdList* list)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || recList || !list->buf)
+		return false;
+
+	// The framebuffer belongs to the frame, not to the list
+	savedFlags = ctx->flags & (C3DiF_FrameBuf | C3DiF_DrawUsed);
+	ctx->flags &= ~(C3DiF_FrameBuf | C3DiF_DrawUsed);
+
+	GPUCMD_GetBuffer(&savedBuf, &savedSize, &savedOffset);
+	GPUCMD_SetBuffer(list->buf, list->size, 0);
+	recList = list;
+	list->stereoProj = -1;
+
+	savedVsh = ctx->residentVsh;
+	savedGsh = ctx->residentGsh;
+	savedGshPartial = ctx->residentGshPartial;
+
+	// Make the recording independent of whatever the GPU has been told so far
+	C3Di_DirtyState(ctx, true);
+	return true;
+}
+
+bool C3D_CmdListEnd(C3D_CmdList* list)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (recList != list)
+		return false;
+
+	list->used = gpuCmdBufOffset;
+	list->residentVsh = (ctx->flags & C3DiF_VshCode) ? NULL : ctx->residentVsh;
+	list->residentGsh = (ctx->flags & C3DiF_GshCode) ? NULL : ctx->residentGsh;
+	list->residentGshPartial = ctx->residentGshPartial;
+
+	GPUCMD_SetBuffer(savedBuf, savedSize, savedOffset);
+	recList = NULL;
+	if (list->stereoProj >= 0)
+		C3Di_FVUnifHold(GPU_VERTEX_SHADER, list->stereoProj, 4, false);
+
+	ctx->flags &= ~(C3DiF_FrameBuf | C3DiF_DrawUsed);
+	ctx->flags |= savedFlags;
+
+	// Nothing that was recorded has reached the GPU yet
+	ctx->residentVsh = savedVsh;
+	ctx->residentGsh = savedGsh;
+	ctx->residentGshPartial = savedGshPartial;
+	C3Di_DirtyState(ctx, false);
+	return true;
+}
+
+void C3D_CmdListCall(C3D_CmdList* list)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || recList || !list->used)
+		return;
+
+	C3Di_CmdBufEnsureSpace(list->used + C3Di_CmdBufHeadroom(ctx));
+	C3Di_FrameBufUpdate(ctx);
+	GPUCMD_AddRawCommands(list->buf, list->used);
+	ctx->flags |= C3DiF_DrawUsed;
+
+	// The GPU now holds the state left behind by the list, including its shader code
+	ctx->residentVsh = list->residentVsh;
+	ctx->residentGsh = list->residentGsh;
+	ctx->residentGshPartial = list->residentGshPartial;
+	C3Di_DirtyState(ctx, false);
+}
+
+bool C3D_CmdListBeginStereo(C3D_CmdList* list, int projUniform)
+{
+	if (projUniform < 0 || projUniform+4 > C3D_FVUNIF_COUNT || !C3D_CmdListBegin(list))
+		return false;
+
+	list->stereoProj = projUniform;
+	C3Di_FVUnifHold(GPU_VERTEX_SHADER, projUniform, 4, true);
+	return true;
+}
+
+void C3D_CmdListCallProj(C3D_CmdList* list, C3D_RenderTarget* target, const C3D_Mtx* proj)
+{
+	if (list->stereoProj < 0 || recList || !target || !C3D_FrameDrawOn(target))
+		return;
+
+	// Only the left out matrix differs between replays
+	C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, list->stereoProj, proj);
+	C3Di_CmdBufEnsureSpace(C3Di_CmdBufHeadroom(C3Di_GetContext()));
+	C3D_UpdateUniforms(GPU_VERTEX_SHADER);
+	C3D_CmdListCall(list);
+}
+
+void C3D_CmdListCallStereo(C3D_CmdList* list, C3D_RenderTarget* left, const C3D_Mtx* projLeft, C3D_RenderTarget* right, const C3D_Mtx* projRight)
+{
+	C3D_CmdListCallProj(list, left, projLeft);
+	C3D_CmdListCallProj(list, right, projRight);
+}
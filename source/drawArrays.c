@@ -1,31 +1,93 @@
 #include "internal.h"
+#include <c3d/base.h>
 
-void C3D_DrawArrays(GPU_Primitive_t primitive, int first, int size)
+static const u32 drawArraysCmds[] =
 {
-	C3Di_UpdateContext();
-
 	// Set primitive type
-	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 2, primitive);
+	C3D_CMD(GPUREG_PRIMITIVE_CONFIG, 2, 0),
 	// Start a new primitive (breaks off a triangle strip/fan)
-	GPUCMD_AddWrite(GPUREG_RESTART_PRIMITIVE, 1);
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
 	// The index buffer is not used, but this command is still required
-	GPUCMD_AddWrite(GPUREG_INDEXBUFFER_CONFIG, 0x80000000);
+	C3D_CMD(GPUREG_INDEXBUFFER_CONFIG, 0xF, 0x80000000),
 	// Number of vertices
-	GPUCMD_AddWrite(GPUREG_NUMVERTICES, size);
+	C3D_CMD(GPUREG_NUMVERTICES, 0xF, 0),
 	// First vertex
-	GPUCMD_AddWrite(GPUREG_VERTEX_OFFSET, first);
+	C3D_CMD(GPUREG_VERTEX_OFFSET, 0xF, 0),
 	// Enable array drawing mode
-	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 1, 1);
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG2, 1, 1),
 	// Enable drawing mode
-	GPUCMD_AddMaskedWrite(GPUREG_START_DRAW_FUNC0, 1, 0);
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
 	// Trigger array drawing
-	GPUCMD_AddWrite(GPUREG_DRAWARRAYS, 1);
+	C3D_CMD(GPUREG_DRAWARRAYS, 0xF, 1),
 	// Go back to configuration mode
-	GPUCMD_AddMaskedWrite(GPUREG_START_DRAW_FUNC0, 1, 1);
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 1),
 	// Disable array drawing mode
-	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 1, 0);
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG2, 1, 0),
 	// Clear the post-vertex cache
+	C3D_CMD(GPUREG_VTX_FUNC, 0xF, 1),
+};
+
+// Per draw part of C3D_MultiDrawArrays, the primitive is restarted in configuration mode
+static const u32 drawArraysStepCmds[] =
+{
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
+	C3D_CMD(GPUREG_NUMVERTICES, 0xF, 0),
+	C3D_CMD(GPUREG_VERTEX_OFFSET, 0xF, 0),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
+	C3D_CMD(GPUREG_DRAWARRAYS, 0xF, 1),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 1),
+};
+
+void C3D_DrawArrays(GPU_Primitive_t primitive, int first, int size)
+{
+	C3Di_UpdateContext();
+
+	// Only the values that change between draws are patched into the template
+	u32* cmd = C3D_CmdReserve(sizeof(drawArraysCmds)/sizeof(u32));
+	if (!cmd) return;
+	memcpy(cmd, drawArraysCmds, sizeof(drawArraysCmds));
+	cmd[0] = primitive;
+	cmd[6] = size;
+	cmd[8] = first;
+
+	C3Di_GetContext()->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, 1);
+}
+
+void C3D_MultiDrawArrays(GPU_Primitive_t primitive, const int* first, const int* count, int drawcount)
+{
+	int i;
+	if (drawcount <= 0) return;
+
+	C3Di_UpdateContext();
+
+	// Set primitive type
+	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 2, primitive);
+	// The index buffer is not used, but this command is still required
+	GPUCMD_AddWrite(GPUREG_INDEXBUFFER_CONFIG, 0x80000000);
+	// Enable array drawing mode
+	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 1, 1);
+
+	for (i = 0; i < drawcount; i ++)
+	{
+		if (count[i] <= 0) continue;
+		// Restart the primitive, set the vertex range and trigger array drawing in drawing mode
+		u32* cmd = C3D_CmdReserve(sizeof(drawArraysStepCmds)/sizeof(u32));
+		if (!cmd) break;
+		memcpy(cmd, drawArraysStepCmds, sizeof(drawArraysStepCmds));
+		cmd[2] = count[i];
+		cmd[4] = first[i];
+
+		// Leave enough room for the next batch of draws
+		if ((i & 0xFF) == 0xFF && i+1 < drawcount)
+			C3Di_CmdBufEnsureSpace(C3Di_CmdBufHeadroom(C3Di_GetContext()));
+	}
+
+	// Disable array drawing mode
+	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 1, 0);
+	// Clear the post-vertex cache (the vertex buffers did not change between the draws)
 	GPUCMD_AddWrite(GPUREG_VTX_FUNC, 1);
 
 	C3Di_GetContext()->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, drawcount);
 }
@@ -1,18 +1,178 @@
 #include "internal.h"
+#include <c3d/base.h>
+#include <c3d/uniforms.h>
+
+static const u32 drawElementsCmds[] =
+{
+	// Set primitive type
+	C3D_CMD(GPUREG_PRIMITIVE_CONFIG, 2, 0),
+	// Start a new primitive (breaks off a triangle strip/fan)
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
+	// Configure the index buffer
+	C3D_CMD(GPUREG_INDEXBUFFER_CONFIG, 0xF, 0),
+	// Number of vertices
+	C3D_CMD(GPUREG_NUMVERTICES, 0xF, 0),
+	// First vertex
+	C3D_CMD(GPUREG_VERTEX_OFFSET, 0xF, 0),
+	// Enable triangle element drawing mode (only kept for GPU_TRIANGLES)
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG, 2, 0x100),
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG2, 2, 0x100),
+	// Enable drawing mode
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
+	// Trigger element drawing
+	C3D_CMD(GPUREG_DRAWELEMENTS, 0xF, 1),
+	// Go back to configuration mode
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 1),
+	// Disable triangle element drawing mode (only kept for GPU_TRIANGLES)
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG, 2, 0),
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG2, 2, 0),
+	// Clear the post-vertex cache
+	C3D_CMD(GPUREG_VTX_FUNC, 0xF, 1),
+	C3D_CMD(GPUREG_PRIMITIVE_CONFIG, 0x8, 0),
+	C3D_CMD(GPUREG_PRIMITIVE_CONFIG, 0x8, 0),
+};
+
+// Per draw part of C3D_MultiDrawElements, the primitive is restarted in configuration mode
+static const u32 drawElementsStepCmds[] =
+{
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
+	C3D_CMD(GPUREG_INDEXBUFFER_CONFIG, 0xF, 0),
+	C3D_CMD(GPUREG_NUMVERTICES, 0xF, 0),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
+	C3D_CMD(GPUREG_DRAWELEMENTS, 0xF, 1),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 1),
+};
+
+// Makes sure the index data can be reached from the buffer base, moving the base if needed
+static bool C3Di_IndicesFit(C3D_Context* ctx, u32 lo, u32 hi)
+{
+	int fit = C3Di_BufInfoFit(&ctx->bufInfo, lo, hi);
+	if (fit > 0)
+		ctx->flags |= C3DiF_BufInfo;
+	return fit >= 0;
+}
 
 void C3D_DrawElements(GPU_Primitive_t primitive, int count, int type, const void* indices)
 {
 	C3D_Context* ctx = C3Di_GetContext();
 	u32 pa = osConvertVirtToPhys(indices);
+	if (!pa || count <= 0 || !C3Di_IndicesFit(ctx, pa, pa + (count << type) - 1)) return;
+	u32 base = ctx->bufInfo.base_paddr;
+
+	C3Di_UpdateContext();
+
+	// Only the values that change between draws are patched into the template,
+	// the geometry stage writes are dropped for anything but GPU_TRIANGLES
+	bool tris = primitive == GPU_TRIANGLES;
+	u32 words = sizeof(drawElementsCmds)/sizeof(u32) - (tris ? 0 : 8);
+	u32* cmd = C3D_CmdReserve(words);
+	if (!cmd) return;
+	if (tris)
+		memcpy(cmd, drawElementsCmds, sizeof(drawElementsCmds));
+	else
+	{
+		memcpy(cmd,      &drawElementsCmds[0],  10*sizeof(u32));
+		memcpy(cmd + 10, &drawElementsCmds[14], 6*sizeof(u32));
+		memcpy(cmd + 16, &drawElementsCmds[24], 6*sizeof(u32));
+	}
+	cmd[0] = tris ? GPU_GEOMETRY_PRIM : primitive;
+	cmd[4] = (pa - base) | (type << 31);
+	cmd[6] = count;
+
+	C3Di_GetContext()->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, 1);
+}
+
+void C3D_MultiDrawElements(GPU_Primitive_t primitive, const int* count, int type, const void* const* indices, int drawcount)
+{
+	int i;
+	C3D_Context* ctx = C3Di_GetContext();
+	if (drawcount <= 0) return;
+
+	// One base has to cover the indices of every draw
+	u32 lo = ~0U, hi = 0;
+	for (i = 0; i < drawcount; i ++)
+	{
+		u32 pa = osConvertVirtToPhys(indices[i]);
+		if (!pa || count[i] <= 0) continue;
+		if (pa < lo) lo = pa;
+		if (pa + (count[i] << type) - 1 > hi) hi = pa + (count[i] << type) - 1;
+	}
+	if (lo > hi || !C3Di_IndicesFit(ctx, lo, hi)) return;
+
+	C3Di_UpdateContext();
+
+	u32 base = ctx->bufInfo.base_paddr;
+
+	// Set primitive type
+	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 2, primitive != GPU_TRIANGLES ? primitive : GPU_GEOMETRY_PRIM);
+	// First vertex
+	GPUCMD_AddWrite(GPUREG_VERTEX_OFFSET, 0);
+	// Enable triangle element drawing mode if necessary
+	if (primitive == GPU_TRIANGLES)
+	{
+		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG, 2, 0x100);
+		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 2, 0x100);
+	}
+
+	for (i = 0; i < drawcount; i ++)
+	{
+		u32 pa = osConvertVirtToPhys(indices[i]);
+		if (!pa || count[i] <= 0) continue;
+		// Restart the primitive, point at the indices and trigger element drawing in drawing mode
+		u32* cmd = C3D_CmdReserve(sizeof(drawElementsStepCmds)/sizeof(u32));
+		if (!cmd) break;
+		memcpy(cmd, drawElementsStepCmds, sizeof(drawElementsStepCmds));
+		cmd[2] = (pa - base) | (type << 31);
+		cmd[4] = count[i];
+
+		// Leave enough room for the next batch of draws
+		if ((i & 0xFF) == 0xFF && i+1 < drawcount)
+			C3Di_CmdBufEnsureSpace(C3Di_CmdBufHeadroom(ctx));
+	}
+
+	// Disable triangle element drawing mode if necessary
+	if (primitive == GPU_TRIANGLES)
+	{
+		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG, 2, 0);
+		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 2, 0);
+	}
+	// Clear the post-vertex cache (the vertex buffers did not change between the draws)
+	GPUCMD_AddWrite(GPUREG_VTX_FUNC, 1);
+	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
+	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
+
+	ctx->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, drawcount);
+}
+
+// Per instance part of C3D_DrawElementsInstanced, following the uniform writes
+static const u32 drawInstanceCmds[] =
+{
+	// Clear the post-vertex cache, it would otherwise return the previous instance's vertices
+	C3D_CMD(GPUREG_VTX_FUNC, 0xF, 1),
+	// Restart the primitive while still in configuration mode
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
+	C3D_CMD(GPUREG_DRAWELEMENTS, 0xF, 1),
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 1),
+};
+
+void C3D_DrawElementsInstanced(GPU_Primitive_t primitive, int count, int type, const void* indices,
+	int instanceCount, int uniformBase, const void* perInstanceData, size_t stride)
+{
+	int i, rows = stride / sizeof(C3D_FVec);
+	C3D_Context* ctx = C3Di_GetContext();
+	u32 pa = osConvertVirtToPhys(indices);
+	if (!pa || instanceCount <= 0 || count <= 0) return;
+	if (uniformBase < 0 || rows < 1 || uniformBase+rows > C3D_FVUNIF_COUNT) return;
+	if (!C3Di_IndicesFit(ctx, pa, pa + (count << type) - 1)) return;
 	u32 base = ctx->bufInfo.base_paddr;
-	if (pa < base) return;
 
 	C3Di_UpdateContext();
 
 	// Set primitive type
 	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 2, primitive != GPU_TRIANGLES ? primitive : GPU_GEOMETRY_PRIM);
-	// Start a new primitive (breaks off a triangle strip/fan)
-	GPUCMD_AddWrite(GPUREG_RESTART_PRIMITIVE, 1);
 	// Configure the index buffer
 	GPUCMD_AddWrite(GPUREG_INDEXBUFFER_CONFIG, (pa - base) | (type << 31));
 	// Number of vertices
@@ -25,12 +185,36 @@ void C3D_DrawElements(GPU_Primitive_t primitive, int count, int type, const void
 		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG, 2, 0x100);
 		GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 2, 0x100);
 	}
-	// Enable drawing mode
-	GPUCMD_AddMaskedWrite(GPUREG_START_DRAW_FUNC0, 1, 0);
-	// Trigger element drawing
-	GPUCMD_AddWrite(GPUREG_DRAWELEMENTS, 1);
-	// Go back to configuration mode
-	GPUCMD_AddMaskedWrite(GPUREG_START_DRAW_FUNC0, 1, 1);
+
+	const C3D_FVec* prev = NULL;
+	for (i = 0; i < instanceCount; i ++)
+	{
+		const C3D_FVec* cur = (const C3D_FVec*)((const u8*)perInstanceData + i*stride);
+
+		// Uniforms are written in configuration mode, limited to the changed rows
+		int first = 0, last = rows-1;
+		if (prev)
+		{
+			while (first <= last && memcmp(&cur[first], &prev[first], sizeof(C3D_FVec)) == 0)
+				first ++;
+			while (last > first && memcmp(&cur[last], &prev[last], sizeof(C3D_FVec)) == 0)
+				last --;
+		}
+
+		C3Di_CmdBufEnsureSpace((last-first+1)*4 + 0x20);
+		if (first <= last)
+		{
+			GPUCMD_AddWrite(GPUREG_VSH_FLOATUNIFORM_CONFIG, 0x80000000|(uniformBase+first));
+			GPUCMD_AddWrites(GPUREG_VSH_FLOATUNIFORM_DATA, (u32*)&cur[first], (last-first+1)*4);
+			C3Di_STAT_ADD(uniformWords, (last-first+1)*4);
+		}
+
+		u32* cmd = C3D_CmdReserve(sizeof(drawInstanceCmds)/sizeof(u32));
+		if (!cmd) break;
+		memcpy(cmd, drawInstanceCmds, sizeof(drawInstanceCmds));
+		prev = cur;
+	}
+
 	// Disable triangle element drawing mode if necessary
 	if (primitive == GPU_TRIANGLES)
 	{
@@ -42,5 +226,13 @@ void C3D_DrawElements(GPU_Primitive_t primitive, int count, int type, const void
 	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
 	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
 
-	C3Di_GetContext()->flags |= C3DiF_DrawUsed;
+	// Keep the CPU copy in line with the GPU, the next update writes the rows again
+	if (prev)
+	{
+		memcpy(C3D_FVUnifWritePtr(GPU_VERTEX_SHADER, uniformBase, rows), prev, rows*sizeof(C3D_FVec));
+		C3Di_FVUnifForget(GPU_VERTEX_SHADER, uniformBase, rows);
+	}
+
+	ctx->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, i);
 }
@@ -0,0 +1,132 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/base.h>
+#include <c3d/drawqueue.h>
+
+bool C3D_DrawQueueInit(C3D_DrawQueue* q, u32 capacity)
+{
+	if (capacity < 1 || capacity > 0xFFFF)
+		return false;
+
+	C3D_DrawItem* items = (C3D_DrawItem*)malloc(capacity*sizeof(C3D_DrawItem));
+	u16* order = (u16*)malloc(capacity*2*sizeof(u16));
+	if (!items || !order)
+	{
+		free(items);
+		free(order);
+		return false;
+	}
+	C3D_DrawQueueInitWithBuffer(q, items, order, capacity);
+	q->ownsBuf = true;
+	return true;
+}
+
+void C3D_DrawQueueInitWithBuffer(C3D_DrawQueue* q, C3D_DrawItem* items, u16* order, u32 capacity)
+{
+	q->items = items;
+	q->order = order;
+	q->count = 0;
+	q->capacity = capacity;
+	q->ownsBuf = false;
+}
+
+void C3D_DrawQueueDelete(C3D_DrawQueue* q)
+{
+	if (q->ownsBuf)
+	{
+		free(q->items);
+		free(q->order);
+	}
+	memset(q, 0, sizeof(*q));
+}
+
+C3D_DrawItem* C3D_DrawQueuePush(C3D_DrawQueue* q, u32 key)
+{
+	if (q->count == q->capacity)
+		return NULL;
+
+	C3D_DrawItem* it = &q->items[q->count++];
+	memset(it, 0, sizeof(*it));
+	it->key = key;
+	return it;
+}
+
+// LSD radix sort, one byte per pass. Passes where every key has the same byte are skipped,
+// which is common since keys rarely use all their bits.
+const u16* C3Di_RadixSort(const void* keys, size_t stride, u32 n, u16* order, u16* tmp)
+{
+	u16* src = order;
+	u16* dst = tmp;
+	u32 i, shift;
+
+	#define KEY(i) (*(const u32*)((const u8*)keys + (i)*stride))
+
+	for (i = 0; i < n; i ++)
+		src[i] = i;
+	if (!n)
+		return src;
+
+	for (shift = 0; shift < 32; shift += 8)
+	{
+		u32 hist[256];
+		memset(hist, 0, sizeof(hist));
+		for (i = 0; i < n; i ++)
+			hist[(KEY(i) >> shift) & 0xFF] ++;
+		if (hist[(KEY(0) >> shift) & 0xFF] == n)
+			continue;
+
+		u32 sum = 0;
+		for (i = 0; i < 256; i ++)
+		{
+			u32 c = hist[i];
+			hist[i] = sum;
+			sum += c;
+		}
+		for (i = 0; i < n; i ++)
+			dst[hist[(KEY(src[i]) >> shift) & 0xFF]++] = src[i];
+
+		u16* t = src;
+		src = dst;
+		dst = t;
+	}
+
+	#undef KEY
+	return src;
+}
+
+void C3D_DrawQueueFlush(C3D_DrawQueue* q)
+{
+	const C3D_PipelineState* state = NULL;
+	C3D_Tex* tex[3] = { NULL, NULL, NULL };
+	C3D_LightEnv* lightEnv = NULL;
+	C3D_BufInfo* bufInfo = NULL;
+	u32 i, j;
+
+	if (!q->count)
+		return;
+
+	const u16* order = C3Di_RadixSort(&q->items[0].key, sizeof(C3D_DrawItem), q->count, q->order, q->order + q->capacity);
+	for (i = 0; i < q->count; i ++)
+	{
+		const C3D_DrawItem* it = &q->items[order[i]];
+
+		if (it->state && it->state != state)
+			C3D_PipelineStateBind(state = it->state);
+		for (j = 0; j < 3; j ++)
+			if (it->tex[j] && it->tex[j] != tex[j])
+				C3D_TexBind(j, tex[j] = it->tex[j]);
+		if (it->lightEnv && it->lightEnv != lightEnv)
+			C3D_LightEnvBind(lightEnv = it->lightEnv);
+		if (it->bufInfo && it->bufInfo != bufInfo)
+			C3D_SetBufInfo(bufInfo = it->bufInfo);
+
+		if (it->setup)
+			it->setup(it->param);
+
+		if (it->indices)
+			C3D_DrawElements((GPU_Primitive_t)it->primitive, it->count, it->indexType, it->indices);
+		else
+			C3D_DrawArrays((GPU_Primitive_t)it->primitive, it->first, it->count);
+	}
+	q->count = 0;
+}
@@ -1,15 +1,16 @@
 #include "internal.h"
 
-static inline C3D_Effect* getEffect()
+static inline C3D_Effect* getEffect(u32 part)
 {
 	C3D_Context* ctx = C3Di_GetContext();
 	ctx->flags |= C3DiF_Effect;
+	ctx->effectFlags |= part;
 	return &ctx->effect;
 }
 
 void C3D_DepthMap(bool bIsZBuffer, float zScale, float zOffset)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_DepthMap);
 	e->zBuffer = bIsZBuffer;
 	e->zScale  = f32tof24(zScale);
 	e->zOffset = f32tof24(zOffset);
@@ -17,51 +18,60 @@ void C3D_DepthMap(bool bIsZBuffer, float zScale, float zOffset)
 
 void C3D_CullFace(GPU_CULLMODE mode)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_Cull);
 	e->cullMode = mode;
 }
 
 void C3D_StencilTest(bool enable, GPU_TESTFUNC function, int ref, int inputMask, int writeMask)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_Stencil);
 	e->stencilMode = (!!enable) | ((function & 7) << 4) | (writeMask << 8) | (ref << 16) | (inputMask << 24);
 }
 
 void C3D_StencilOp(GPU_STENCILOP sfail, GPU_STENCILOP dfail, GPU_STENCILOP pass)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_Stencil);
 	e->stencilOp = sfail | (dfail << 4) | (pass << 8);
 }
 
 void C3D_BlendingColor(u32 color)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_BlendColor);
 	e->blendClr = color;
 }
 
 void C3D_EarlyDepthTest(bool enable, GPU_EARLYDEPTHFUNC function, u32 ref)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_EarlyDepth);
+	e->earlyDepthAuto = false;
 	e->earlyDepth = enable;
 	e->earlyDepthFunc = function;
 	e->earlyDepthRef = ref;
 }
 
+void C3D_EarlyDepthAuto(bool enable)
+{
+	C3D_Effect* e = getEffect(C3DiE_EarlyDepth);
+	e->earlyDepthAuto = enable;
+	if (enable)
+		C3Di_GetContext()->earlyDepthClear = true;
+}
+
 void C3D_DepthTest(bool enable, GPU_TESTFUNC function, GPU_WRITEMASK writemask)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_DepthTest);
 	e->depthTest = (!!enable) | ((function & 7) << 4) | (writemask << 8);
 }
 
 void C3D_AlphaTest(bool enable, GPU_TESTFUNC function, int ref)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_AlphaTest);
 	e->alphaTest = (!!enable) | ((function & 7) << 4) | (ref << 8);
 }
 
 void C3D_AlphaBlend(GPU_BLENDEQUATION colorEq, GPU_BLENDEQUATION alphaEq, GPU_BLENDFACTOR srcClr, GPU_BLENDFACTOR dstClr, GPU_BLENDFACTOR srcAlpha, GPU_BLENDFACTOR dstAlpha)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_Blend);
 	e->alphaBlend = colorEq | (alphaEq << 8) | (srcClr << 16) | (dstClr << 20) | (srcAlpha << 24) | (dstAlpha << 28);
 	e->fragOpMode &= ~0xFF00;
 	e->fragOpMode |= 0x0100;
@@ -69,38 +79,104 @@ void C3D_AlphaBlend(GPU_BLENDEQUATION colorEq, GPU_BLENDEQUATION alphaEq, GPU_BL
 
 void C3D_ColorLogicOp(GPU_LOGICOP op)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_LogicOp);
 	e->fragOpMode &= ~0xFF00;
 	e->clrLogicOp = op;
 }
 
 void C3D_FragOpMode(GPU_FRAGOPMODE mode)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_FragOp);
 	e->fragOpMode &= ~0xFF00FF;
 	e->fragOpMode |= 0xE40000 | mode;
 }
 
 void C3D_FragOpShadow(float scale, float bias)
 {
-	C3D_Effect* e = getEffect();
+	C3D_Effect* e = getEffect(C3DiE_FragOp);
 	e->fragOpShadow = f32tof16(scale+bias) | (f32tof16(-scale)<<16);
 }
 
+// Early rejection is only safe when the depth test is the only thing that discards fragments
+// and the ones passing it write their depth
+static bool earlyDepthFunc(const C3D_Effect* e, GPU_EARLYDEPTHFUNC* func)
+{
+	if (!(e->depthTest & 1) || !(e->depthTest & (GPU_WRITE_DEPTH << 8)))
+		return false;
+	if ((e->alphaTest & 1) || (e->stencilMode & 1) || (e->fragOpMode & 3) != GPU_FRAGOPMODE_GL)
+		return false;
+
+	switch ((e->depthTest >> 4) & 7)
+	{
+		case GPU_GEQUAL:  *func = GPU_EARLYDEPTH_GEQUAL;  return true;
+		case GPU_GREATER: *func = GPU_EARLYDEPTH_GREATER; return true;
+		case GPU_LEQUAL:  *func = GPU_EARLYDEPTH_LEQUAL;  return true;
+		case GPU_LESS:    *func = GPU_EARLYDEPTH_LESS;    return true;
+		default:          return false;
+	}
+}
+
 void C3Di_EffectBind(C3D_Effect* e)
 {
-	GPUCMD_AddWrite(GPUREG_DEPTHMAP_ENABLE, e->zBuffer ? 1 : 0);
-	GPUCMD_AddWrite(GPUREG_FACECULLING_CONFIG, e->cullMode & 0x3);
-	GPUCMD_AddIncrementalWrites(GPUREG_DEPTHMAP_SCALE, (u32*)&e->zScale, 2);
-	GPUCMD_AddIncrementalWrites(GPUREG_FRAGOP_ALPHA_TEST, (u32*)&e->alphaTest, 4);
-	GPUCMD_AddMaskedWrite(GPUREG_GAS_DELTAZ_DEPTH, 0x8, (u32)GPU_MAKEGASDEPTHFUNC((e->depthTest>>4)&7) << 24);
-	GPUCMD_AddWrite(GPUREG_BLEND_COLOR, e->blendClr);
-	GPUCMD_AddWrite(GPUREG_BLEND_FUNC, e->alphaBlend);
-	GPUCMD_AddWrite(GPUREG_LOGIC_OP, e->clrLogicOp);
-	GPUCMD_AddMaskedWrite(GPUREG_COLOR_OPERATION, 7, e->fragOpMode);
-	GPUCMD_AddWrite(GPUREG_FRAGOP_SHADOW, e->fragOpShadow);
-	GPUCMD_AddMaskedWrite(GPUREG_EARLYDEPTH_TEST1, 1, e->earlyDepth ? 1 : 0);
-	GPUCMD_AddWrite(GPUREG_EARLYDEPTH_TEST2, e->earlyDepth ? 1 : 0);
-	GPUCMD_AddMaskedWrite(GPUREG_EARLYDEPTH_FUNC, 1, e->earlyDepthFunc);
-	GPUCMD_AddMaskedWrite(GPUREG_EARLYDEPTH_DATA, 0x7, e->earlyDepthRef);
+	C3Di_EffectBindParts(e, C3DiE_All);
+}
+
+void C3Di_EffectBindParts(C3D_Effect* e, u32 parts)
+{
+	if (e->earlyDepthAuto && (parts & (C3DiE_DepthTest|C3DiE_AlphaTest|C3DiE_Stencil|C3DiE_FragOp)))
+		parts |= C3DiE_EarlyDepth;
+
+	if (parts & C3DiE_DepthMap)
+	{
+		C3Di_RegWrite(GPUREG_DEPTHMAP_ENABLE, e->zBuffer ? 1 : 0);
+		C3Di_RegIncrementalWrites(GPUREG_DEPTHMAP_SCALE, (u32*)&e->zScale, 2);
+	}
+	if (parts & C3DiE_Cull)
+		C3Di_RegWrite(GPUREG_FACECULLING_CONFIG, e->cullMode & 0x3);
+
+	// Alpha test, stencil test, stencil op and depth test are consecutive registers
+	if ((parts & (C3DiE_AlphaTest|C3DiE_Stencil|C3DiE_DepthTest)) == (C3DiE_AlphaTest|C3DiE_Stencil|C3DiE_DepthTest))
+		C3Di_RegIncrementalWrites(GPUREG_FRAGOP_ALPHA_TEST, (u32*)&e->alphaTest, 4);
+	else
+	{
+		if (parts & C3DiE_AlphaTest)
+			C3Di_RegWrite(GPUREG_FRAGOP_ALPHA_TEST, e->alphaTest);
+		if (parts & C3DiE_Stencil)
+			C3Di_RegIncrementalWrites(GPUREG_STENCIL_TEST, &e->stencilMode, 2);
+		if (parts & C3DiE_DepthTest)
+			C3Di_RegWrite(GPUREG_DEPTH_COLOR_MASK, e->depthTest);
+	}
+	if (parts & C3DiE_DepthTest)
+		C3Di_RegMaskedWrite(GPUREG_GAS_DELTAZ_DEPTH, 0x8, (u32)GPU_MAKEGASDEPTHFUNC((e->depthTest>>4)&7) << 24);
+
+	if (parts & C3DiE_BlendColor)
+		C3Di_RegWrite(GPUREG_BLEND_COLOR, e->blendClr);
+	if (parts & C3DiE_Blend)
+		C3Di_RegWrite(GPUREG_BLEND_FUNC, e->alphaBlend);
+	if (parts & C3DiE_LogicOp)
+		C3Di_RegWrite(GPUREG_LOGIC_OP, e->clrLogicOp);
+
+	// Byte 1 selects between blending and logic ops, bytes 0 and 2 hold the mode
+	u32 opMask = ((parts & C3DiE_FragOp) ? 0x5 : 0) | ((parts & (C3DiE_Blend|C3DiE_LogicOp)) ? 0x2 : 0);
+	if (opMask)
+		C3Di_RegMaskedWrite(GPUREG_COLOR_OPERATION, opMask, e->fragOpMode);
+	if (parts & C3DiE_FragOp)
+		C3Di_RegWrite(GPUREG_FRAGOP_SHADOW, e->fragOpShadow);
+
+	if (parts & C3DiE_EarlyDepth)
+	{
+		bool enable = e->earlyDepth;
+		GPU_EARLYDEPTHFUNC func = e->earlyDepthFunc;
+		u32 ref = e->earlyDepthRef;
+		if (e->earlyDepthAuto)
+		{
+			enable = earlyDepthFunc(e, &func);
+			ref = C3Di_GetContext()->fb.depthClear;
+		}
+
+		C3Di_RegMaskedWrite(GPUREG_EARLYDEPTH_TEST1, 1, enable ? 1 : 0);
+		C3Di_RegWrite(GPUREG_EARLYDEPTH_TEST2, enable ? 1 : 0);
+		C3Di_RegMaskedWrite(GPUREG_EARLYDEPTH_FUNC, 1, func);
+		C3Di_RegMaskedWrite(GPUREG_EARLYDEPTH_DATA, 0x7, ref);
+	}
 }
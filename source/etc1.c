@@ -0,0 +1,276 @@
+#include "internal.h"
+#include <c3d/etc1.h>
+#include <c3d/renderqueue.h>
+
+// Modifiers in pixel index order: small and large positive, then small and large negative
+static const int etc1Modifiers[8][4] =
+{
+	{  2,   8,  -2,   -8 },
+	{  5,  17,  -5,  -17 },
+	{  9,  29,  -9,  -29 },
+	{ 13,  42, -13,  -42 },
+	{ 18,  60, -18,  -60 },
+	{ 24,  80, -24,  -80 },
+	{ 33, 106, -33, -106 },
+	{ 47, 183, -47, -183 },
+};
+
+typedef struct
+{
+	u32 error;
+	u8 table;
+	u8 index[8];
+} C3Di_ETC1Fit;
+
+static inline int clamp255(int v)
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static inline int expand4(int c)
+{
+	return (c << 4) | c;
+}
+
+static inline int expand5(int c)
+{
+	return (c << 3) | (c >> 2);
+}
+
+static inline int quantise(int v, int max)
+{
+	return (v*max + 127) / 255;
+}
+
+// Best table and pixel indices for 8 pixels around a base colour
+static void etc1FitSubBlock(C3Di_ETC1Fit* fit, const u8* const px[8], const int base[3], u32 limit)
+{
+	int t, i, m;
+	fit->error = ~0U;
+
+	for (t = 0; t < 8; t ++)
+	{
+		u32 error = 0;
+		u8 index[8];
+
+		for (i = 0; i < 8 && error < fit->error && error < limit; i ++)
+		{
+			u32 best = ~0U;
+			for (m = 0; m < 4; m ++)
+			{
+				int mod = etc1Modifiers[t][m];
+				int dr = clamp255(base[0] + mod) - px[i][0];
+				int dg = clamp255(base[1] + mod) - px[i][1];
+				int db = clamp255(base[2] + mod) - px[i][2];
+				u32 e = dr*dr + dg*dg + db*db;
+				if (e < best)
+				{
+					best = e;
+					index[i] = m;
+				}
+			}
+			error += best;
+		}
+
+		if (i == 8 && error < fit->error)
+		{
+			fit->error = error;
+			fit->table = t;
+			memcpy(fit->index, index, sizeof(index));
+		}
+	}
+}
+
+// Searches the quantised colours within radius of c for the one fitting the sub-block best.
+// With ref the result has to stay within lo..hi of it, the reach of a differential colour.
+static void etc1SearchSubBlock(C3Di_ETC1Fit* fit, int out[3], const u8* const px[8], const int c[3],
+	int bits, int radius, const int* ref, int lo, int hi)
+{
+	int max = (1 << bits) - 1;
+	int center[3], r, g, b, k;
+	fit->error = ~0U;
+
+	for (k = 0; k < 3; k ++)
+	{
+		center[k] = c[k];
+		if (ref && center[k] < ref[k]+lo) center[k] = ref[k]+lo;
+		if (ref && center[k] > ref[k]+hi) center[k] = ref[k]+hi;
+	}
+
+	for (r = center[0]-radius; r <= center[0]+radius; r ++)
+	for (g = center[1]-radius; g <= center[1]+radius; g ++)
+	for (b = center[2]-radius; b <= center[2]+radius; b ++)
+	{
+		int q[3] = { r, g, b }, base[3];
+		bool valid = true;
+		for (k = 0; k < 3; k ++)
+		{
+			if (q[k] < 0 || q[k] > max || (ref && (q[k]-ref[k] < lo || q[k]-ref[k] > hi)))
+				valid = false;
+			base[k] = bits == 4 ? expand4(q[k]) : expand5(q[k]);
+		}
+		if (!valid)
+			continue;
+
+		C3Di_ETC1Fit cur;
+		etc1FitSubBlock(&cur, px, base, fit->error);
+		if (cur.error < fit->error)
+		{
+			*fit = cur;
+			memcpy(out, q, sizeof(q));
+		}
+	}
+}
+
+static inline u64 etc1Pack(bool diff, bool flip, const int c0[3], const int c1[3], const C3Di_ETC1Fit fit[2])
+{
+	u64 block = 0;
+	int k, i;
+
+	for (k = 0; k < 3; k ++)
+	{
+		u32 shift = 56 - 8*k;
+		if (diff)
+			block |= ((u64)c0[k] << (shift+3)) | ((u64)((c1[k]-c0[k]) & 7) << shift);
+		else
+			block |= ((u64)c0[k] << (shift+4)) | ((u64)c1[k] << shift);
+	}
+	block |= (u64)fit[0].table << 37 | (u64)fit[1].table << 34;
+	block |= (u64)diff << 33 | (u64)flip << 32;
+
+	// Pixel indices are stored column by column, the low bits below the high bits
+	for (i = 0; i < 16; i ++)
+	{
+		int x = i >> 2, y = i & 3;
+		int sub = flip ? (y >= 2) : (x >= 2);
+		int pos = flip ? (x + 4*(y&1)) : ((x&1)*4 + y);
+		u32 index = fit[sub].index[pos];
+		block |= (u64)(index & 1) << i;
+		block |= (u64)(index >> 1) << (i+16);
+	}
+	return block;
+}
+
+// px holds the 16 pixels of the block, px[y*4+x]
+static u64 etc1EncodeBlock(const u8* const px[16], int radius)
+{
+	u64 best = 0;
+	u32 bestError = ~0U;
+	int flip, k, i;
+
+	for (flip = 0; flip < 2; flip ++)
+	{
+		// Sub-blocks are the left and right halves, or with flip the lower and upper ones
+		const u8* sub[2][8];
+		int avg[2][3] = { { 0 } };
+		for (i = 0; i < 16; i ++)
+		{
+			int x = i & 3, y = i >> 2;
+			int s = flip ? (y >= 2) : (x >= 2);
+			int pos = flip ? (x + 4*(y&1)) : ((x&1)*4 + y);
+			sub[s][pos] = px[i];
+			for (k = 0; k < 3; k ++)
+				avg[s][k] += px[i][k];
+		}
+		for (i = 0; i < 2; i ++)
+			for (k = 0; k < 3; k ++)
+				avg[i][k] = (avg[i][k] + 4) / 8;
+
+		// Individual mode: two independent 4-bit colours
+		C3Di_ETC1Fit fit[2];
+		int c[2][3], q[3];
+		for (i = 0; i < 2; i ++)
+		{
+			for (k = 0; k < 3; k ++)
+				q[k] = quantise(avg[i][k], 15);
+			etc1SearchSubBlock(&fit[i], c[i], sub[i], q, 4, radius, NULL, 0, 0);
+		}
+		if (fit[0].error + fit[1].error < bestError)
+		{
+			bestError = fit[0].error + fit[1].error;
+			best = etc1Pack(false, flip, c[0], c[1], fit);
+		}
+
+		// Differential mode: 5-bit colours, the second one relative to the first
+		int q5[2][3];
+		for (i = 0; i < 2; i ++)
+			for (k = 0; k < 3; k ++)
+				q5[i][k] = quantise(avg[i][k], 31);
+
+		for (i = 0; i < 2; i ++)
+		{
+			// Fix one sub-block first, then search the other within reach of it.
+			// The second colour is the first plus a delta of -4..3.
+			C3Di_ETC1Fit dfit[2];
+			int dc[2][3];
+			etc1SearchSubBlock(&dfit[i], dc[i], sub[i], q5[i], 5, radius, NULL, 0, 0);
+			etc1SearchSubBlock(&dfit[i^1], dc[i^1], sub[i^1], q5[i^1], 5, radius, dc[i], i ? -3 : -4, i ? 4 : 3);
+
+			u32 error = dfit[0].error + dfit[1].error;
+			if (error < bestError)
+			{
+				bestError = error;
+				best = etc1Pack(true, flip, dc[0], dc[1], dfit);
+			}
+		}
+	}
+	return best;
+}
+
+static inline u64 etc1EncodeAlpha(const u8* const px[16])
+{
+	u64 block = 0;
+	int i;
+	for (i = 0; i < 16; i ++)
+	{
+		int x = i & 3, y = i >> 2;
+		block |= (u64)quantise(px[i][3], 15) << (4*(x*4 + y));
+	}
+	return block;
+}
+
+bool C3D_ETC1Encode(void* dst, const void* src, u32 stride, u32 width, u32 height, bool alpha, C3D_ETC1Quality quality)
+{
+	if (!width || !height || (width|height) & 7)
+		return false;
+
+	u64* out = (u64*)dst;
+	int radius = quality;
+	u32 tx, ty, b, i;
+
+	// Tiles are stored bottom-up, each holding its four blocks in Z order from the lower left
+	for (ty = 0; ty < height/8; ty ++)
+	for (tx = 0; tx < width/8; tx ++)
+	for (b = 0; b < 4; b ++)
+	{
+		u32 bx = tx*8 + (b&1)*4;
+		u32 by = ty*8 + (b>>1)*4;
+		const u8* px[16];
+		for (i = 0; i < 16; i ++)
+		{
+			u32 x = bx + (i&3), y = by + (i>>2);
+			px[i] = (const u8*)src + (height-1-y)*stride + x*4;
+		}
+
+		if (alpha)
+			*out++ = etc1EncodeAlpha(px);
+		*out++ = etc1EncodeBlock(px, radius);
+	}
+	return true;
+}
+
+bool C3D_TexEncodeETC1(C3D_Tex* tex, GPU_TEXFACE face, int level, const void* src, u32 stride, C3D_ETC1Quality quality)
+{
+	void* data = C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face];
+	if ((tex->fmt != GPU_ETC1 && tex->fmt != GPU_ETC1A4) || level < 0 || level > tex->maxLevel || addrIsVRAM(data))
+		return false;
+
+	u32 size;
+	void* out = C3D_TexGetImagePtr(tex, data, level, &size);
+	if (!C3D_ETC1Encode(out, src, stride, tex->width >> level, tex->height >> level, tex->fmt == GPU_ETC1A4, quality))
+		return false;
+
+	C3D_FlushMarkRange(out, size);
+	C3Di_TexCacheInvalidate();
+	return true;
+}
@@ -1,46 +1,70 @@
 #include "internal.h"
 
+static inline u32 C3Di_FogLutEntry(float in, float diff)
+{
+	u32 val = 0;
+	if (in > 0.0f)
+	{
+		in *= 0x800;
+		val = (in < 0x800) ? (u32)in : 0x7FF;
+	}
+
+	u32 val2 = 0;
+	if (diff != 0.0f)
+	{
+		diff *= 0x800;
+		if (diff < -0x1000) diff = -0x1000;
+		else if (diff > 0xFFF) diff = 0xFFF;
+		val2 = (s32)diff & 0x1FFF;
+	}
+
+	return val2 | (val << 13);
+}
+
 void FogLut_FromArray(C3D_FogLut* lut, const float data[256])
 {
 	int i;
 	for (i = 0; i < 128; i ++)
-	{
-		float in = data[i], diff = data[i+128];
-
-		u32 val = 0;
-		if (in > 0.0f)
-		{
-			in *= 0x800;
-			val = (in < 0x800) ? (u32)in : 0x7FF;
-		}
-
-		u32 val2 = 0;
-		if (diff != 0.0f)
-		{
-			diff *= 0x800;
-			if (diff < -0x1000) diff = -0x1000;
-			else if (diff > 0xFFF) diff = 0xFFF;
-			val2 = (s32)diff & 0x1FFF;
-		}
-
-		lut->data[i] = val2 | (val << 13);
-	}
+		lut->data[i] = C3Di_FogLutEntry(data[i], data[i+128]);
+	FogLut_Changed(lut);
+}
+
+void FogLut_Changed(C3D_FogLut* lut)
+{
+	lut->gen = C3Di_LutNextGen();
 }
 
 void FogLut_Exp(C3D_FogLut* lut, float density, float gradient, float near, float far)
 {
 	int i;
-	float data[256];
+	float prev = 0.0f;
 	for (i = 0; i <= 128; i ++)
 	{
 		float x = FogLut_CalcZ(i/128.0f, near, far);
 		float val = expf(-powf(density*x, gradient));
-		if (i < 128)
-			data[i] = val;
 		if (i > 0)
-			data[i+127] = val-data[i-1];
+			lut->data[i-1] = C3Di_FogLutEntry(prev, val-prev);
+		prev = val;
+	}
+	FogLut_Changed(lut);
+}
+
+void FogLut_ExpFast(C3D_FogLut* lut, float density, float gradient, float near, float far)
+{
+	int i;
+	float prev = 0.0f;
+	for (i = 0; i <= 128; i ++)
+	{
+		// exp(-(d*x)^g) as 2^(-log2(e) * 2^(g*log2(d*x)))
+		float dx = density*FogLut_CalcZ(i/128.0f, near, far);
+		float val = 1.0f;
+		if (dx > 0.0f)
+			val = C3Di_FastExp2(-1.44269504f*C3Di_FastExp2(gradient*C3Di_FastLog2(dx)));
+		if (i > 0)
+			lut->data[i-1] = C3Di_FogLutEntry(prev, val-prev);
+		prev = val;
 	}
-	FogLut_FromArray(lut, data);
+	FogLut_Changed(lut);
 }
 
 void C3D_FogGasMode(GPU_FOGMODE fogMode, GPU_GASMODE gasMode, bool zFlip)
@@ -51,6 +75,7 @@ void C3D_FogGasMode(GPU_FOGMODE fogMode, GPU_GASMODE gasMode, bool zFlip)
 		return;
 
 	ctx->flags |= C3DiF_TexEnvBuf;
+	ctx->texEnvBufFlags |= C3DiB_Mode;
 	ctx->texEnvBuf &= ~0x100FF;
 	ctx->texEnvBuf |= (fogMode&7) | ((gasMode&1)<<3) | (zFlip ? BIT(16) : 0);
 }
@@ -63,6 +88,7 @@ void C3D_FogColor(u32 color)
 		return;
 
 	ctx->flags |= C3DiF_TexEnvBuf;
+	ctx->texEnvBufFlags |= C3DiB_FogColor;
 	ctx->fogClr = color;
 }
 
@@ -33,6 +33,9 @@ void C3D_SetFrameBuf(C3D_FrameBuf* fb)
 	if (!(ctx->flags & C3DiF_Active))
 		return;
 
+	// The previous target may be sampled as a texture from now on
+	if (fb->colorBuf != ctx->fb.colorBuf || fb->depthBuf != ctx->fb.depthBuf)
+		C3Di_TexCacheInvalidate();
 	if (fb != &ctx->fb)
 		memcpy(&ctx->fb, fb, sizeof(*fb));
 	ctx->flags |= C3DiF_FrameBuf;
@@ -68,33 +71,74 @@ void C3Di_FrameBufBind(C3D_FrameBuf* fb)
 	GPUCMD_AddIncrementalWrites(GPUREG_COLORBUFFER_READ, param, 4);
 }
 
-void C3D_FrameBufClear(C3D_FrameBuf* frameBuf, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth)
+int C3Di_FrameBufFills(C3D_FrameBuf* frameBuf, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth, C3Di_Fill fills[2])
 {
 	u32 size = (u32)frameBuf->width * frameBuf->height;
 	u32 cfs = colorFmtSizes[frameBuf->colorFmt];
 	u32 dfs = depthFmtSizes[frameBuf->depthFmt];
-	void* colorBufEnd = (u8*)frameBuf->colorBuf + size*(2+cfs);
-	void* depthBufEnd = (u8*)frameBuf->depthBuf + size*(2+dfs);
+	int count = 0;
 
-	if (clearBits & C3D_CLEAR_COLOR)
+	if ((clearBits & C3D_CLEAR_COLOR) && frameBuf->colorBuf)
+		fills[count++] = (C3Di_Fill){ (u32*)frameBuf->colorBuf, clearColor, (u32*)((u8*)frameBuf->colorBuf + size*(2+cfs)), BIT(0) | (cfs << 8) };
+	if ((clearBits & C3D_CLEAR_DEPTH) && frameBuf->depthBuf)
 	{
-		if (clearBits & C3D_CLEAR_DEPTH)
-			GX_MemoryFill(
-				(u32*)frameBuf->colorBuf, clearColor, (u32*)colorBufEnd, BIT(0) | (cfs << 8),
-				(u32*)frameBuf->depthBuf, clearDepth, (u32*)depthBufEnd, BIT(0) | (dfs << 8));
-		else
-			GX_MemoryFill(
-				(u32*)frameBuf->colorBuf, clearColor, (u32*)colorBufEnd, BIT(0) | (cfs << 8),
-				NULL, 0, NULL, 0);
-	} else
+		fills[count++] = (C3Di_Fill){ (u32*)frameBuf->depthBuf, clearDepth, (u32*)((u8*)frameBuf->depthBuf + size*(2+dfs)), BIT(0) | (dfs << 8) };
+
+		// Remembered for the early depth buffer, which has to be cleared to the same depth
+		u32 depth = frameBuf->depthFmt == GPU_RB_DEPTH16 ? ((clearDepth & 0xFFFF) << 8) | ((clearDepth >> 8) & 0xFF) : clearDepth & 0xFFFFFF;
+		C3D_Context* ctx = C3Di_GetContext();
+		frameBuf->depthClear = depth;
+		if (ctx->fb.depthBuf == frameBuf->depthBuf)
+		{
+			ctx->fb.depthClear = depth;
+
+			// Clearing the bound target leaves the early depth buffer behind, send the new reference and clear it too
+			if (ctx->effect.earlyDepthAuto)
+			{
+				ctx->flags |= C3DiF_Effect;
+				ctx->effectFlags |= C3DiE_EarlyDepth;
+				ctx->earlyDepthClear = true;
+			}
+		}
+	}
+	return count;
+}
+
+void C3D_FrameBufClear(C3D_FrameBuf* frameBuf, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth)
+{
+	C3Di_Fill f[2];
+	int count = C3Di_FrameBufFills(frameBuf, clearBits, clearColor, clearDepth, f);
+
+	if (count == 2)
+		GX_MemoryFill(
+			f[0].buf, f[0].value, f[0].end, f[0].control,
+			f[1].buf, f[1].value, f[1].end, f[1].control);
+	else if (count == 1)
 		GX_MemoryFill(
-			(u32*)frameBuf->depthBuf, clearDepth, (u32*)depthBufEnd, BIT(0) | (dfs << 8),
+			f[0].buf, f[0].value, f[0].end, f[0].control,
 			NULL, 0, NULL, 0);
 }
 
 void C3D_FrameBufTransfer(C3D_FrameBuf* frameBuf, gfxScreen_t screen, gfx3dSide_t side, u32 transferFlags)
 {
-	u32* outputFrameBuf = (u32*)gfxGetFramebuffer(screen, side, NULL, NULL);
-	u32 dim = GX_BUFFER_DIM((u32)frameBuf->width, (u32)frameBuf->height);
-	GX_DisplayTransfer((u32*)frameBuf->colorBuf, dim, outputFrameBuf, dim, transferFlags);
+	C3Di_FrameBufTransferBand(frameBuf, screen, side, transferFlags, 0, frameBuf->height);
+}
+
+void C3Di_FrameBufTransferBand(C3D_FrameBuf* frameBuf, gfxScreen_t screen, gfx3dSide_t side, u32 transferFlags, u32 top, u32 bottom)
+{
+	static const u8 transferFmtSizes[] = {4,3,2,2,2,0,0,0};
+	u8* in = (u8*)frameBuf->colorBuf;
+	u8* out = gfxGetFramebuffer(screen, side, NULL, NULL);
+	u32 width = frameBuf->width;
+
+	// Rows of 8x8 tiles are contiguous on the input side, as are rows on the linear output side
+	if (top || bottom < frameBuf->height)
+	{
+		u32 outRow = (transferFlags & GX_TRANSFER_FLIP_VERT(1)) ? frameBuf->height - bottom : top;
+		in  += top*width*(2+colorFmtSizes[frameBuf->colorFmt]);
+		out += outRow*width*transferFmtSizes[(transferFlags >> 12) & 7];
+	}
+
+	u32 dim = GX_BUFFER_DIM(width, bottom-top);
+	GX_DisplayTransfer((u32*)in, dim, (u32*)out, dim, transferFlags);
 }
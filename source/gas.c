@@ -179,6 +179,7 @@ void C3Di_GasUpdate(C3D_Context* ctx)
 		{
 			GPUCMD_AddWrite(GPUREG_GAS_LUT_INDEX, 0);
 			GPUCMD_AddWrites(GPUREG_GAS_LUT_DATA, (u32*)ctx->gasLut, 16);
+			C3Di_STAT_ADD(lutUploads, 1);
 		}
 	}
 }
@@ -0,0 +1,90 @@
+#include "internal.h"
+#include <c3d/base.h>
+#include <c3d/gasrender.h>
+#include <c3d/effect.h>
+#include <c3d/texture.h>
+
+void C3D_GasRendererInit(C3D_GasRenderer* r, C3D_RenderTarget* densityTarget, C3D_Tex* densityTex, const u32 colors[9])
+{
+	memset(r, 0, sizeof(*r));
+	r->densityTarget = densityTarget;
+	r->densityTex = densityTex;
+	r->mode = GPU_PLAIN_DENSITY;
+	r->lutInput = GPU_GAS_DENSITY;
+	r->deltaZ = 10.0f;
+	r->accMax = 1.0f;
+	r->attn = 1.0f;
+	r->lightDir = 1.0f;
+	C3D_GasRendererColors(r, colors);
+}
+
+void C3D_GasRendererDraw(C3D_GasRenderer* r, const C3D_GasVolume* volumes, int count,
+	C3D_RenderTarget* target, C3D_GasShadeFunc shade, void* param)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	int i;
+
+	if (!(ctx->flags & C3DiF_Active) || count < 1)
+		return;
+
+	C3D_Effect savedEffect = ctx->effect;
+	C3D_TexEnv savedEnv[6];
+	memcpy(savedEnv, ctx->texEnv, sizeof(savedEnv));
+	C3D_Tex* savedTex = ctx->tex[0];
+	u32 savedBuf = ctx->texEnvBuf;
+
+	// Accumulation: every volume in a row, density comes from the primary colour
+	C3D_FrameDrawOn(r->densityTarget);
+	C3D_FragOpMode(GPU_FRAGOPMODE_GAS_ACC);
+	C3D_DepthTest(true, GPU_GREATER, GPU_WRITE_COLOR);
+	C3D_FogGasMode(GPU_NO_FOG, r->mode, false);
+	C3D_GasBeginAcc();
+	C3D_GasDeltaZ(r->deltaZ);
+	C3D_GasAccMax(r->accMax);
+
+	C3D_TexEnv* env = C3D_GetTexEnv(0);
+	C3D_TexEnvInit(env);
+	C3D_TexEnvSrc(env, C3D_Both, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR);
+	for (i = 1; i < 6; i ++)
+		C3D_SetTexEnv(i, NULL);
+
+	for (i = 0; i < count; i ++)
+	{
+		const C3D_GasVolume* v = &volumes[i];
+		if (v->indices)
+			C3D_DrawElements(v->primitive, v->count, v->indexType, v->indices);
+		else
+			C3D_DrawArrays(v->primitive, v->first, v->count);
+	}
+
+	// Shading: the fog unit turns the accumulated density into colour through the LUT
+	C3D_FrameDrawOn(target);
+	C3D_FragOpMode(GPU_FRAGOPMODE_GL);
+	C3D_DepthTest(false, GPU_ALWAYS, GPU_WRITE_COLOR);
+	C3D_AlphaBlend(GPU_BLEND_ADD, GPU_BLEND_ADD, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_ZERO, GPU_ONE);
+	C3D_FogGasMode(GPU_GAS, r->mode, false);
+	C3D_GasAttn(r->attn);
+	C3D_GasLightPlanar(r->planar[0], r->planar[1], r->planar[2]);
+	C3D_GasLightView(r->view[0], r->view[1], r->view[2]);
+	C3D_GasLightDirection(r->lightDir);
+	C3D_GasLutInput(r->lutInput);
+	C3D_GasLutBind(&r->lut);
+	C3D_TexBind(0, r->densityTex);
+
+	env = C3D_GetTexEnv(0);
+	C3D_TexEnvInit(env);
+	C3D_TexEnvSrc(env, C3D_Both, GPU_TEXTURE0, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR);
+
+	shade(param);
+
+	// Put back what the caller had, only the state that differs is sent again
+	ctx->effect = savedEffect;
+	ctx->flags |= C3DiF_Effect;
+	ctx->effectFlags = C3DiE_All;
+	for (i = 0; i < 6; i ++)
+		C3D_SetTexEnv(i, &savedEnv[i]);
+	C3D_TexBind(0, savedTex);
+	ctx->texEnvBuf = (ctx->texEnvBuf &~ 0x100FF) | (savedBuf & 0x100FF);
+	ctx->flags |= C3DiF_TexEnvBuf;
+	ctx->texEnvBufFlags |= C3DiB_Mode;
+}
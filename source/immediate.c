@@ -1,21 +1,34 @@
 #include "internal.h"
+#include <c3d/base.h>
 
-void C3D_ImmDrawBegin(GPU_Primitive_t primitive)
-{
-	C3Di_UpdateContext();
+static u32 immAttribs;
 
+static const u32 immDrawBeginCmds[] =
+{
 	// Set primitive type
-	GPUCMD_AddMaskedWrite(GPUREG_PRIMITIVE_CONFIG, 2, primitive);
+	C3D_CMD(GPUREG_PRIMITIVE_CONFIG, 2, 0),
 	// Start a new primitive (breaks off a triangle strip/fan)
-	GPUCMD_AddWrite(GPUREG_RESTART_PRIMITIVE, 1);
+	C3D_CMD(GPUREG_RESTART_PRIMITIVE, 0xF, 1),
 	// Not sure if this command is necessary
-	GPUCMD_AddWrite(GPUREG_INDEXBUFFER_CONFIG, 0x80000000);
+	C3D_CMD(GPUREG_INDEXBUFFER_CONFIG, 0xF, 0x80000000),
 	// Enable vertex submission mode
-	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG2, 1, 1);
+	C3D_CMD(GPUREG_GEOSTAGE_CONFIG2, 1, 1),
 	// Enable drawing mode
-	GPUCMD_AddMaskedWrite(GPUREG_START_DRAW_FUNC0, 1, 0);
+	C3D_CMD(GPUREG_START_DRAW_FUNC0, 1, 0),
 	// Begin immediate-mode vertex submission
-	GPUCMD_AddWrite(GPUREG_FIXEDATTRIB_INDEX, 0xF);
+	C3D_CMD(GPUREG_FIXEDATTRIB_INDEX, 0xF, 0xF),
+};
+
+void C3D_ImmDrawBegin(GPU_Primitive_t primitive)
+{
+	C3Di_UpdateContext();
+
+	u32* cmd = C3D_CmdReserve(sizeof(immDrawBeginCmds)/sizeof(u32));
+	if (!cmd) return;
+	memcpy(cmd, immDrawBeginCmds, sizeof(immDrawBeginCmds));
+	cmd[0] = primitive;
+
+	immAttribs = 0;
 }
 
 static inline void write24(u8* p, u32 val)
@@ -52,6 +65,91 @@ void C3D_ImmSendAttrib(float x, float y, float z, float w)
 
 	// Send the attribute
 	GPUCMD_AddIncrementalWrites(GPUREG_FIXEDATTRIB_DATA0, param.packed, 3);
+	immAttribs++;
+}
+
+// Same result as f32tof24, working on the raw bits so that no float compare or memcpy is involved
+static inline u32 bitsToF24(u32 i)
+{
+	u32 sign = (i >> 8) & 0x800000;
+	s32 exponent = (s32)((i >> 23) & 0xFF) - 64;
+
+	if (!(i << 1))
+		return 0;
+	if (exponent < 0)
+		return sign; // Underflow: flush to zero
+	if (exponent > 0x7F)
+		return sign | 0x7F0000; // Overflow: saturate to infinity
+	return sign | (exponent << 16) | ((i >> 7) & 0xFFFF);
+}
+
+// Packs one attribute into the three words expected by GPUREG_FIXEDATTRIB_DATA0, in the order
+// C3D_ImmSendAttrib produces them
+static inline void packAttrib(u32* out, const u32* v)
+{
+	u32 x = bitsToF24(v[0]), y = bitsToF24(v[1]), z = bitsToF24(v[2]), w = bitsToF24(v[3]);
+	out[0] = (w << 8) | (z >> 16);
+	out[1] = (z << 16) | (y >> 8);
+	out[2] = (y << 24) | x;
+}
+
+// A single command can carry 256 parameters, flush whole attributes only
+#define IMM_BATCH_ATTRIBS 85
+
+static inline void flushAttribs(const u32* packed, int num)
+{
+	// Each attribute is three writes to the same register, the GPU collects them itself
+	GPUCMD_AddWrites(GPUREG_FIXEDATTRIB_DATA0, packed, num*3);
+	immAttribs += num;
+}
+
+void C3D_ImmSendAttribs(const float* data, int count)
+{
+	u32 packed[IMM_BATCH_ATTRIBS*3];
+	const u32* bits = (const u32*)data;
+	int n = 0;
+
+	for (; count > 0; count --, bits += 4)
+	{
+		packAttrib(&packed[n*3], bits);
+		if (++n == IMM_BATCH_ATTRIBS)
+		{
+			flushAttribs(packed, n);
+			n = 0;
+		}
+	}
+
+	if (n)
+		flushAttribs(packed, n);
+}
+
+void C3D_ImmSendVertices(const void* vertices, size_t stride, int count, const u8* sizes, int numAttribs)
+{
+	u32 packed[IMM_BATCH_ATTRIBS*3];
+	const u8* vtx = (const u8*)vertices;
+	int n = 0, i, j;
+
+	for (; count > 0; count --, vtx += stride)
+	{
+		const u32* bits = (const u32*)vtx;
+		for (i = 0; i < numAttribs; i ++)
+		{
+			// Missing components default to (0, 0, 0, 1)
+			u32 v[4] = { 0, 0, 0, 0x3F800000 };
+			for (j = 0; j < sizes[i]; j ++)
+				v[j] = *bits++;
+
+			packAttrib(&packed[n*3], v);
+			if (++n == IMM_BATCH_ATTRIBS)
+			{
+				flushAttribs(packed, n);
+				n = 0;
+			}
+		}
+	}
+
+	if (n)
+		flushAttribs(packed, n);
 }
 
 void C3D_ImmDrawEnd(void)
@@ -63,5 +161,9 @@ void C3D_ImmDrawEnd(void)
 	// Clear the post-vertex cache
 	GPUCMD_AddWrite(GPUREG_VTX_FUNC, 1);
 
-	C3Di_GetContext()->flags |= C3DiF_DrawUsed;
+	C3D_Context* ctx = C3Di_GetContext();
+	ctx->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, 1);
+	if (ctx->attrInfo.attrCount)
+		C3Di_STAT_ADD(immVertices, immAttribs / ctx->attrInfo.attrCount);
 }
@@ -6,9 +6,14 @@
 #include <c3d/framebuffer.h>
 #include <c3d/texenv.h>
 #include <c3d/fog.h>
+#include <c3d/stats.h>
 
 #define C3D_UNUSED __attribute__((unused))
 
+// Free command buffer space (in words) kept available before each draw, at most a quarter
+// of the buffer so that small buffers are not split on every draw
+#define C3Di_CMDBUF_HEADROOM 0x2000
+
 typedef struct
 {
 	u32 fragOpMode;
@@ -18,6 +23,7 @@ typedef struct
 	bool zBuffer, earlyDepth;
 	GPU_EARLYDEPTHFUNC earlyDepthFunc;
 	u32 earlyDepthRef;
+	bool earlyDepthAuto; // Derived from the depth test and the bound framebuffer instead
 
 	u32 alphaTest;
 	u32 stencilMode, stencilOp;
@@ -28,29 +34,69 @@ typedef struct
 	GPU_LOGICOP clrLogicOp;
 } C3D_Effect;
 
+typedef struct
+{
+	C3D_Tex* tex;
+	void* data;
+	u32 border, dim, param, lodParam;
+	GPU_TEXCOLOR fmt;
+} C3Di_TexUnitState; // Texture state last written to a unit
+
+typedef struct
+{
+	C3D_LightLut* lut;
+	u32 gen;
+} C3Di_LutSlot; // Light LUT last uploaded to a hardware slot
+
+enum
+{
+	C3Di_LutSlot_Common = 0, // D0, D1, FR, RB, RG, RR
+	C3Di_LutSlot_SP = 6,     // One per light
+	C3Di_LutSlot_DA = 14,    // One per light
+	C3Di_LutSlot_Count = 22,
+};
+
 typedef struct
 {
 	gxCmdQueue_s gxQueue;
+	u16 gxQueueLimit;
+	bool gxQueueMerge;
+	u32* splitFinalize; // Where the last C3Di_SplitFrame put the finalize command of its list
 	u32* cmdBuf;
 	size_t cmdBufSize;
 	float cmdBufUsage;
+	u8 cmdBufCount, cmdBufCur;
 
 	u32 flags;
 	shaderProgram_s* program;
+	DVLP_s* residentVsh; // Shader code currently held by each unit, one DVLP each as they are not packed
+	DVLP_s* residentGsh;
+	bool residentGshPartial;
 
 	C3D_AttrInfo attrInfo;
 	C3D_BufInfo bufInfo;
 	C3D_Effect effect;
+	u16 effectFlags;
 	C3D_LightEnv* lightEnv;
+	C3Di_LutSlot lightLuts[C3Di_LutSlot_Count];
+	C3D_LightEnvConf lightEnvConf; // Lighting registers currently held by the GPU
+	C3D_LightConf lightConf[8];
+	u16 lightResident; // Which of the above are valid, bit 8 for lightEnvConf
 
 	u32 texConfig;
 	u32 texShadow;
 	C3D_Tex* tex[3];
+	C3Di_TexUnitState texUnit[3];
 	C3D_TexEnv texEnv[6];
+	C3D_TexEnv texEnvResident[6]; // Combiner stages currently held by the GPU
+	u8 texEnvResidentMask;
 
 	u32 texEnvBuf, texEnvBufClr;
 	u32 fogClr;
+	u8 texEnvBufFlags;
 	C3D_FogLut* fogLut;
+	C3D_FogLut* fogLutResident; // Fog LUT currently held by the GPU
+	u32 fogLutResidentGen;
 
 	u16 gasAttn, gasAccMax;
 	u32 gasLightXY, gasLightZ, gasLightZColor;
@@ -61,8 +107,12 @@ typedef struct
 	C3D_ProcTex* procTex;
 	C3D_ProcTexLut* procTexLut[3];
 	C3D_ProcTexColorLut* procTexColorLut;
+	u8 procTexResident; // Bits 0-2 for the LUTs below, bit 3 for the colour LUT
+	C3D_ProcTexLut procTexLutResident[3]; // Proctex LUT contents currently held by the GPU
+	C3D_ProcTexColorLut procTexColorLutResident;
 
 	C3D_FrameBuf fb;
+	bool earlyDepthClear; // The early depth buffer is cleared once the effect is bound
 	u32 viewport[5];
 	u32 scissor[3];
 
@@ -85,6 +135,7 @@ enum
 	C3DiF_LightEnv = BIT(10),
 	C3DiF_VshCode = BIT(11),
 	C3DiF_GshCode = BIT(12),
+	C3DiF_RegRestore = BIT(13),
 	C3DiF_TexStatus = BIT(14),
 	C3DiF_ProcTex = BIT(15),
 	C3DiF_ProcTexColorLut = BIT(16),
@@ -100,6 +151,32 @@ enum
 	C3DiF_TexEnvAll = 0x3F << 26,
 };
 
+// Parts of the state covered by C3DiF_Effect
+enum
+{
+	C3DiE_DepthMap   = BIT(0),
+	C3DiE_Cull       = BIT(1),
+	C3DiE_AlphaTest  = BIT(2),
+	C3DiE_Stencil    = BIT(3),
+	C3DiE_DepthTest  = BIT(4),
+	C3DiE_Blend      = BIT(5),
+	C3DiE_BlendColor = BIT(6),
+	C3DiE_LogicOp    = BIT(7),
+	C3DiE_FragOp     = BIT(8), // Mode and shadow parameters
+	C3DiE_EarlyDepth = BIT(9),
+	C3DiE_All        = 0x3FF,
+};
+
+// Parts of the state covered by C3DiF_TexEnvBuf
+enum
+{
+	C3DiB_Mode     = BIT(0), // Fog/gas mode and z flip
+	C3DiB_Update   = BIT(1), // Combiner buffer update masks
+	C3DiB_Color    = BIT(2),
+	C3DiB_FogColor = BIT(3),
+	C3DiB_All      = 0xF,
+};
+
 enum
 {
 	C3DiG_BeginAcc    = BIT(0),
@@ -114,6 +191,17 @@ static inline C3D_Context* C3Di_GetContext(void)
 	return &__C3D_Context;
 }
 
+static inline u32* C3Di_CurCmdBuf(C3D_Context* ctx)
+{
+	return ctx->cmdBuf + ctx->cmdBufCur*ctx->cmdBufSize;
+}
+
+static inline u32 C3Di_CmdBufHeadroom(C3D_Context* ctx)
+{
+	u32 quarter = ctx->cmdBufSize/4;
+	return quarter < C3Di_CMDBUF_HEADROOM ? quarter : C3Di_CMDBUF_HEADROOM;
+}
+
 static inline bool typeIsCube(GPU_TEXTURE_MODE_PARAM type)
 {
 	return type == GPU_TEX_CUBE_MAP || type == GPU_TEX_SHADOW_CUBE;
@@ -126,33 +214,149 @@ static inline bool C3Di_TexIs2D(C3D_Tex* tex)
 
 static inline bool addrIsVRAM(const void* addr)
 {
-	u32 vaddr = (u32)addr;
+	uintptr_t vaddr = (uintptr_t)addr;
 	return vaddr >= OS_VRAM_VADDR && vaddr < OS_VRAM_VADDR + OS_VRAM_SIZE;
 }
 
 static inline vramAllocPos addrGetVRAMBank(const void* addr)
 {
-	u32 vaddr = (u32)addr;
+	uintptr_t vaddr = (uintptr_t)addr;
 	return vaddr < OS_VRAM_VADDR + OS_VRAM_SIZE/2 ? VRAM_ALLOC_A : VRAM_ALLOC_B;
 }
 
+typedef struct
+{
+	u32* buf;
+	u32 value;
+	u32* end;
+	u16 control;
+} C3Di_Fill;
+
+void C3Di_FrameBufTransferBand(C3D_FrameBuf* fb, gfxScreen_t screen, gfx3dSide_t side, u32 transferFlags, u32 top, u32 bottom);
+int C3Di_FrameBufFills(C3D_FrameBuf* fb, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth, C3Di_Fill fills[2]);
+
 void C3Di_UpdateContext(void);
+void C3Di_FrameBufUpdate(C3D_Context* ctx);
+void C3Di_DirtyState(C3D_Context* ctx, bool shaderCode);
+bool C3Di_ProgramCodeNeeded(C3D_Context* ctx, bool* sendVsh, bool* sendGsh);
 void C3Di_AttrInfoBind(C3D_AttrInfo* info);
 void C3Di_BufInfoBind(C3D_BufInfo* info);
+// Moves the base of the buffers so that [lo, hi] can be reached from it, offsets included.
+// Returns 0 if it already could, 1 if the base changed and -1 if the range is too wide.
+int C3Di_BufInfoFit(C3D_BufInfo* info, u32 lo, u32 hi);
 void C3Di_FrameBufBind(C3D_FrameBuf* fb);
 void C3Di_TexEnvBind(int id, C3D_TexEnv* env);
 void C3Di_SetTex(int unit, C3D_Tex* tex);
+void C3Di_TexCacheInvalidate(void);
+u32 C3Di_TexShadowValue(bool perspective, float bias);
 void C3Di_EffectBind(C3D_Effect* effect);
+void C3Di_EffectBindParts(C3D_Effect* effect, u32 parts);
 void C3Di_GasUpdate(C3D_Context* ctx);
 
+u32 C3Di_LutNextGen(void);
 void C3Di_LightMtlBlend(C3D_Light* light);
+void C3Di_LightMtlConf(C3D_LightMatConf* conf, const C3D_Material* mtl, const C3D_Light* light);
+u32 C3Di_LightEnvMtlAmbient(const C3D_LightEnv* env, const C3D_Material* mtl);
 
 void C3Di_DirtyUniforms(GPU_SHADER_TYPE type);
 void C3Di_LoadShaderUniforms(shaderInstance_s* si);
 void C3Di_ClearShaderUniforms(GPU_SHADER_TYPE type);
+void C3Di_FVUnifHold(GPU_SHADER_TYPE type, int id, int num, bool hold);
+void C3Di_FVUnifForget(GPU_SHADER_TYPE type, int id, int num);
 
 bool C3Di_SplitFrame(u32** pBuf, u32* pSize);
 
+void C3Di_RegCacheInvalidate(void);
+void C3Di_RegMaskedWrite(u32 reg, u32 mask, u32 val);
+void C3Di_RegIncrementalWrites(u32 reg, const u32* vals, u32 num);
+
+// Keeps the shadow copy across a suspend so C3Di_RegCacheReplay can send it back as one block
+bool C3Di_RegCacheSnapshot(void);
+bool C3Di_RegCacheHasSnapshot(void);
+bool C3Di_RegCacheReplay(void);
+
+static inline void C3Di_RegWrite(u32 reg, u32 val)
+{
+	C3Di_RegMaskedWrite(reg, 0xF, val);
+}
+
+void C3Di_CmdBufEnsureSpace(u32 words);
+bool C3Di_FlushDeferred(void);
+bool C3Di_InFrame(void);
+
+// Display transfers only downscale while the output stays at least this large in both directions
+#define C3Di_MIP_HW_MIN 64
+int C3Di_MipTransferFmt(GPU_TEXCOLOR fmt); // -1 if the display transfer engine can't scale it
+
+void C3Di_TexResUpdate(void);
+void C3Di_TexResTouch(C3D_Tex* tex);
+bool C3Di_TexUploadQueueDim(C3D_Tex* tex, const void* src, void* dst, u32 size, u32 dstDim, C3D_TexUploadCallback callback, void* param);
+
+static inline bool C3Di_TexUploadQueue(C3D_Tex* tex, const void* src, void* dst, u32 size, C3D_TexUploadCallback callback, void* param)
+{
+	return C3Di_TexUploadQueueDim(tex, src, dst, size, 0, callback, param);
+}
+bool C3Di_TileRect(void* tiled, void* linear, u32 stride, u32 texWidth, u32 texHeight, GPU_TEXCOLOR fmt,
+	u32 x, u32 y, u32 w, u32 h, bool untile);
+
+// Approximations for LUT builders, accurate to about 1e-7 which is far below the LUT precision
+static inline float C3Di_FastLog2(float x) // x > 0
+{
+	union { float f; u32 i; } u = { x };
+	int e = (int)((u.i >> 23) & 0xFF) - 127;
+	u.i = (u.i & 0x807FFFFF) | (127 << 23);
+	float m = u.f;
+	if (m > 1.41421356f)
+	{
+		m *= 0.5f;
+		e ++;
+	}
+
+	// ln(m) = 2*atanh(t), |t| < 0.172
+	float t = (m-1.0f)/(m+1.0f), t2 = t*t;
+	float s = t*(2.0f + t2*(2.0f/3 + t2*(2.0f/5 + t2*(2.0f/7 + t2*(2.0f/9)))));
+	return e + s*1.44269504f;
+}
+
+static inline float C3Di_FastExp2(float x)
+{
+	if (x < -126.0f)
+		return 0.0f;
+	if (x > 127.0f)
+		x = 127.0f;
+
+	float n = (float)(int)(x < 0.0f ? x-0.5f : x+0.5f);
+	float f = (x-n)*0.69314718f; // |f| <= ln(2)/2
+	float p = 1.0f + f*(1.0f + f*(1.0f/2 + f*(1.0f/6 + f*(1.0f/24 + f*(1.0f/120 + f*(1.0f/720))))));
+	union { float f; u32 i; } u;
+	u.i = (u32)((int)n + 127) << 23;
+	return p*u.f;
+}
+
+// Profiling counters, only collected while C3D_StatsEnable is on and a frame is being recorded
+extern C3D_FrameStats* C3Di_StatsFrame;
+#define C3Di_STAT_ADD(field, n) do { if (C3Di_StatsFrame) C3Di_StatsFrame->field += (n); } while (0)
+
+void C3Di_StatsFrameBegin(void);
+void C3Di_StatsFrameEnd(void);
+void C3Di_StatsDrawOn(struct C3D_RenderTarget_tag* target);
+void C3Di_StatsSplit(u32 words);
+void C3Di_StatsQueueRun(void);
+void C3Di_StatsQueueUsage(u32 entries);
+void C3Di_StatsState(u32 flags);
+
+// Frame capture, the queue hook runs right before entries are cleared, possibly from the gx callback
+void C3Di_CaptureFrameBegin(u64 fence);
+void C3Di_CaptureFrameEnd(u64 fence);
+void C3Di_CaptureQueue(gxCmdQueue_s* queue, u64 base);
+
+struct C3D_RenderTarget_tag* C3Di_RenderTargetFirst(void);
+void C3Di_StreamBufFrameEnd(u64 fence);
+
+// Stable sort of n (up to 65535) u32 keys found every stride bytes, returns the sorted indices
+// which are either in order or in tmp, both n entries
+const u16* C3Di_RadixSort(const void* keys, size_t stride, u32 n, u16* order, u16* tmp);
+
 void C3Di_RenderQueueInit(void);
 void C3Di_RenderQueueExit(void);
 void C3Di_RenderQueueWaitDone(void);
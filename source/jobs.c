@@ -0,0 +1,366 @@
+#include "internal.h"
+#include <c3d/jobs.h>
+
+#define C3DI_JOBS_STACK 0x4000
+#define C3DI_JOBS_SPIN  64 // Rounds of stealing before a worker goes to sleep
+
+typedef struct
+{
+	C3D_JobFunc func;
+	void* param;
+	u32 begin, end;
+	C3D_JobGroup* group;
+} C3Di_Job;
+
+// Chase-Lev deque: the owning thread pushes and takes at the bottom, others steal from the top.
+// Indices only ever grow, their difference is the number of queued jobs.
+typedef struct
+{
+	u32 top;
+	u32 bottom;
+	C3Di_Job jobs[C3D_JOBS_QUEUE_SIZE];
+} C3Di_JobQueue;
+
+static struct
+{
+	bool running;
+	bool quit;
+	int numThreads;
+	u32 sleepers;
+	LightSemaphore wake;
+	Thread threads[C3D_JOBS_MAX_WORKERS];
+	C3Di_JobQueue queues[C3D_JOBS_MAX_WORKERS+1]; // The owner uses the first one
+	C3Di_JobQueue background; // Pushed by the owner, only ever taken by workers
+} jobs;
+
+static __thread int jobsSelf = -1;
+
+static bool queuePush(C3Di_JobQueue* q, const C3Di_Job* job)
+{
+	u32 b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED);
+	u32 t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+	if (b - t >= C3D_JOBS_QUEUE_SIZE)
+		return false;
+
+	q->jobs[b & (C3D_JOBS_QUEUE_SIZE-1)] = *job;
+	__atomic_store_n(&q->bottom, b+1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static bool queueTake(C3Di_JobQueue* q, C3Di_Job* job)
+{
+	u32 b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED) - 1;
+	__atomic_store_n(&q->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	u32 t = __atomic_load_n(&q->top, __ATOMIC_RELAXED);
+
+	if ((s32)(b - t) < 0)
+	{
+		__atomic_store_n(&q->bottom, t, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	*job = q->jobs[b & (C3D_JOBS_QUEUE_SIZE-1)];
+	if (b != t)
+		return true;
+
+	// Last job, race the thieves for it
+	bool won = __atomic_compare_exchange_n(&q->top, &t, t+1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+	__atomic_store_n(&q->bottom, b+1, __ATOMIC_RELAXED);
+	return won;
+}
+
+static bool queueSteal(C3Di_JobQueue* q, C3Di_Job* job)
+{
+	u32 t = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	u32 b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+	if ((s32)(b - t) <= 0)
+		return false;
+
+	// The owner never overwrites this slot before top moves past it
+	*job = q->jobs[t & (C3D_JOBS_QUEUE_SIZE-1)];
+	return __atomic_compare_exchange_n(&q->top, &t, t+1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static bool queuesEmpty(void)
+{
+	int i;
+	for (i = 0; i < jobs.numThreads; i ++)
+	{
+		C3Di_JobQueue* q = &jobs.queues[i];
+		if ((s32)(__atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->top, __ATOMIC_ACQUIRE)) > 0)
+			return false;
+	}
+	C3Di_JobQueue* q = &jobs.background;
+	return (s32)(__atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE) - __atomic_load_n(&q->top, __ATOMIC_ACQUIRE)) <= 0;
+}
+
+static void runJob(const C3Di_Job* job)
+{
+	job->func(job->param, job->begin, job->end);
+	__atomic_sub_fetch(&job->group->pending, 1, __ATOMIC_RELEASE);
+}
+
+static bool findJob(int self, C3Di_Job* job)
+{
+	if (queueTake(&jobs.queues[self], job))
+		return true;
+
+	int i;
+	for (i = 1; i < jobs.numThreads; i ++)
+	{
+		if (queueSteal(&jobs.queues[(self+i) % jobs.numThreads], job))
+			return true;
+	}
+	return self != 0 && queueSteal(&jobs.background, job);
+}
+
+// Takes one sleeper off the count, a wake up is owed to whoever succeeds
+static bool takeSleeper(void)
+{
+	u32 n = __atomic_load_n(&jobs.sleepers, __ATOMIC_SEQ_CST);
+	while (n)
+	{
+		if (__atomic_compare_exchange_n(&jobs.sleepers, &n, n-1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			return true;
+	}
+	return false;
+}
+
+static void jobsWorker(void* arg)
+{
+	int self = (intptr_t)arg;
+	int spin = 0;
+	C3Di_Job job;
+
+	jobsSelf = self;
+	while (!__atomic_load_n(&jobs.quit, __ATOMIC_ACQUIRE))
+	{
+		if (findJob(self, &job))
+		{
+			runJob(&job);
+			spin = 0;
+			continue;
+		}
+
+		if (++spin < C3DI_JOBS_SPIN)
+			continue;
+		spin = 0;
+
+		// Announce the sleep before looking once more, so that a push either sees
+		// the sleeper or the worker sees the job
+		__atomic_add_fetch(&jobs.sleepers, 1, __ATOMIC_SEQ_CST);
+		if ((queuesEmpty() && !__atomic_load_n(&jobs.quit, __ATOMIC_ACQUIRE)) || !takeSleeper())
+			LightSemaphore_Acquire(&jobs.wake, 1);
+	}
+}
+
+bool C3D_JobsInit(u32 coreMask)
+{
+	if (jobs.running)
+		return false;
+
+	memset(&jobs, 0, sizeof(jobs));
+	LightSemaphore_Init(&jobs.wake, 0, 0x7FFF);
+	jobs.numThreads = 1;
+	jobsSelf = 0;
+
+	s32 prio = 0x30;
+	svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+
+	int core;
+	for (core = 0; core < 32 && jobs.numThreads <= C3D_JOBS_MAX_WORKERS; core ++)
+	{
+		if (!(coreMask & BIT(core)))
+			continue;
+
+		Thread t = threadCreate(jobsWorker, (void*)(intptr_t)jobs.numThreads, C3DI_JOBS_STACK, prio, core, false);
+		if (t)
+			jobs.threads[jobs.numThreads++ - 1] = t;
+	}
+
+	jobs.running = true;
+	return jobs.numThreads > 1;
+}
+
+void C3D_JobsExit(void)
+{
+	if (!jobs.running || jobsSelf != 0)
+		return;
+
+	int i, workers = jobs.numThreads-1;
+	__atomic_store_n(&jobs.quit, true, __ATOMIC_RELEASE);
+	LightSemaphore_Release(&jobs.wake, workers);
+	for (i = 0; i < workers; i ++)
+	{
+		threadJoin(jobs.threads[i], U64_MAX);
+		threadFree(jobs.threads[i]);
+	}
+
+	// Whatever is still queued belongs to groups nobody waited for
+	C3Di_Job job;
+	for (i = 0; i <= workers; i ++)
+		while (queueSteal(&jobs.queues[i], &job))
+			runJob(&job);
+	while (queueSteal(&jobs.background, &job))
+		runJob(&job);
+
+	jobs.running = false;
+	jobsSelf = -1;
+}
+
+int C3D_JobsThreads(void)
+{
+	return jobs.running ? jobs.numThreads : 1;
+}
+
+void C3D_JobPush(C3D_JobGroup* group, C3D_JobFunc func, void* param, u32 begin, u32 end)
+{
+	C3Di_Job job = { func, param, begin, end, group };
+	__atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+	if (!jobs.running || jobsSelf < 0 || jobs.quit || !queuePush(&jobs.queues[jobsSelf], &job))
+	{
+		runJob(&job);
+		return;
+	}
+
+	if (takeSleeper())
+		LightSemaphore_Release(&jobs.wake, 1);
+}
+
+void C3D_JobPushBackground(C3D_JobGroup* group, C3D_JobFunc func, void* param, u32 begin, u32 end)
+{
+	C3Di_Job job = { func, param, begin, end, group };
+	__atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+
+	if (!jobs.running || jobs.numThreads < 2 || jobsSelf != 0 || jobs.quit || !queuePush(&jobs.background, &job))
+	{
+		runJob(&job);
+		return;
+	}
+
+	if (takeSleeper())
+		LightSemaphore_Release(&jobs.wake, 1);
+}
+
+void C3D_JobWait(C3D_JobGroup* group)
+{
+	C3Di_Job job;
+	while (!C3D_JobDone(group))
+	{
+		if (jobsSelf >= 0 && jobs.running && findJob(jobsSelf, &job))
+			runJob(&job);
+		else
+			svcSleepThread(0); // The rest is running on other threads
+	}
+}
+
+void C3D_JobParallelFor(C3D_JobFunc func, void* param, u32 count, u32 grain)
+{
+	if (!count)
+		return;
+
+	// A few chunks per thread leave room for stealing without flooding the queue
+	u32 maxChunks = C3D_JobsThreads()*4;
+	if (grain < 1)
+		grain = 1;
+	if ((count + grain-1) / grain > maxChunks)
+		grain = (count + maxChunks-1) / maxChunks;
+
+	C3D_JobGroup group = { 0 };
+	u32 begin;
+	for (begin = grain; begin < count; begin += grain)
+		C3D_JobPush(&group, func, param, begin, begin+grain < count ? begin+grain : count);
+
+	func(param, 0, grain < count ? grain : count);
+	C3D_JobWait(&group);
+}
+
+typedef struct
+{
+	const C3D_Mtx* mtx;
+	void* out;
+	const void* in;
+	bool homogeneous;
+} C3Di_JobArray;
+
+static void mtxMultiplyJob(void* param, u32 begin, u32 end)
+{
+	C3Di_JobArray* j = (C3Di_JobArray*)param;
+	Mtx_MultiplyArray((C3D_Mtx*)j->out + begin, j->mtx, (const C3D_Mtx*)j->in + begin, end-begin);
+}
+
+void C3D_JobsMtxMultiplyArray(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b, size_t count)
+{
+	C3Di_JobArray j = { a, out, b, false };
+	C3D_JobParallelFor(mtxMultiplyJob, &j, count, 64);
+}
+
+static void vecMultiplyJob(void* param, u32 begin, u32 end)
+{
+	C3Di_JobArray* j = (C3Di_JobArray*)param;
+	Mtx_MultiplyFVec4Array(j->mtx, (C3D_FVec*)j->out + begin, (const C3D_FVec*)j->in + begin, end-begin, j->homogeneous);
+}
+
+void C3D_JobsMtxMultiplyFVec4Array(const C3D_Mtx* mtx, C3D_FVec* out, const C3D_FVec* in, size_t count, bool homogeneous)
+{
+	C3Di_JobArray j = { mtx, out, in, homogeneous };
+	C3D_JobParallelFor(vecMultiplyJob, &j, count, 256);
+}
+
+// Culling jobs work on whole words of the visibility mask, so no two of them write the same one
+typedef struct
+{
+	const C3D_Frustum* f;
+	int numFrusta;
+	const C3D_FVec* a;
+	const C3D_FVec* b;
+	size_t count;
+	u32* visible;
+} C3Di_JobCull;
+
+static void cullSpheresJob(void* param, u32 begin, u32 end)
+{
+	C3Di_JobCull* j = (C3Di_JobCull*)param;
+	u32 last = end*32 < j->count ? end*32 : j->count;
+	Frustum_CullSpheres(j->f, j->numFrusta, j->a + begin*32, last - begin*32, j->visible + begin);
+}
+
+void C3D_JobsCullSpheres(const C3D_Frustum* f, int numFrusta, const C3D_FVec* spheres, size_t count, u32* visible)
+{
+	C3Di_JobCull j = { f, numFrusta, spheres, NULL, count, visible };
+	C3D_JobParallelFor(cullSpheresJob, &j, (count+31)/32, 4);
+}
+
+static void cullAABBsJob(void* param, u32 begin, u32 end)
+{
+	C3Di_JobCull* j = (C3Di_JobCull*)param;
+	u32 last = end*32 < j->count ? end*32 : j->count;
+	Frustum_CullAABBs(j->f, j->numFrusta, j->a + begin*32, j->b + begin*32, last - begin*32, j->visible + begin);
+}
+
+void C3D_JobsCullAABBs(const C3D_Frustum* f, int numFrusta, const C3D_FVec* mins, const C3D_FVec* maxs, size_t count, u32* visible)
+{
+	C3Di_JobCull j = { f, numFrusta, mins, maxs, count, visible };
+	C3D_JobParallelFor(cullAABBsJob, &j, (count+31)/32, 4);
+}
+
+static void animSampleJob(void* param, u32 begin, u32 end)
+{
+	const C3D_AnimInstance* inst = (const C3D_AnimInstance*)param;
+	u32 i;
+	for (i = begin; i < end; i ++)
+	{
+		const C3D_AnimInstance* a = &inst[i];
+		C3D_AnimSample(a->clip, a->time, a->loop, a->pose, a->cursors);
+		if (a->skel && a->world)
+			C3D_SkeletonWorld(a->skel, a->pose, a->world);
+	}
+}
+
+void C3D_JobsAnimSample(const C3D_AnimInstance* inst, size_t count)
+{
+	C3D_JobParallelFor(animSampleJob, (void*)inst, count, 1);
+}
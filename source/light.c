@@ -1,10 +1,13 @@
 #include "internal.h"
 
 void C3Di_LightMtlBlend(C3D_Light* light)
+{
+	C3Di_LightMtlConf(&light->conf.material, &light->parent->material, light);
+}
+
+void C3Di_LightMtlConf(C3D_LightMatConf* conf, const C3D_Material* mtl, const C3D_Light* light)
 {
 	int i;
-	C3D_Material* mtl = &light->parent->material;
-	C3D_LightMatConf* conf = &light->conf.material;
 	memset(conf, 0, sizeof(*conf));
 
 	for (i = 0; i < 3; i ++)
@@ -35,6 +38,7 @@ int C3D_LightInit(C3D_Light* light, C3D_LightEnv* env)
 	light->specular1[0] = light->specular1[1] = light->specular1[2] = 1.0f;
 
 	env->flags |= C3DF_LightEnv_LCDirty;
+	env->colorGen ++;
 	return i;
 }
 
@@ -57,7 +61,7 @@ void C3D_LightTwoSideDiffuse(C3D_Light* light, bool enable)
 		light->conf.config |= BIT(1);
 	else
 		light->conf.config &= ~BIT(1);
-	light->flags |= C3DF_Light_Dirty;
+	light->flags |= C3DF_Light_ConfigDirty;
 }
 
 void C3D_LightGeoFactor(C3D_Light* light, int id, bool enable)
@@ -67,7 +71,7 @@ void C3D_LightGeoFactor(C3D_Light* light, int id, bool enable)
 		light->conf.config |= BIT(id);
 	else
 		light->conf.config &= ~BIT(id);
-	light->flags |= C3DF_Light_Dirty;
+	light->flags |= C3DF_Light_ConfigDirty;
 }
 
 void C3D_LightAmbient(C3D_Light* light, float r, float g, float b)
@@ -76,6 +80,7 @@ void C3D_LightAmbient(C3D_Light* light, float r, float g, float b)
 	light->ambient[1] = g;
 	light->ambient[2] = r;
 	light->flags |= C3DF_Light_MatDirty;
+	light->parent->colorGen ++;
 }
 
 void C3D_LightDiffuse(C3D_Light* light, float r, float g, float b)
@@ -84,6 +89,7 @@ void C3D_LightDiffuse(C3D_Light* light, float r, float g, float b)
 	light->diffuse[1] = g;
 	light->diffuse[2] = r;
 	light->flags |= C3DF_Light_MatDirty;
+	light->parent->colorGen ++;
 }
 
 void C3D_LightSpecular0(C3D_Light* light, float r, float g, float b)
@@ -92,6 +98,7 @@ void C3D_LightSpecular0(C3D_Light* light, float r, float g, float b)
 	light->specular0[1] = g;
 	light->specular0[2] = r;
 	light->flags |= C3DF_Light_MatDirty;
+	light->parent->colorGen ++;
 }
 
 void C3D_LightSpecular1(C3D_Light* light, float r, float g, float b)
@@ -100,17 +107,36 @@ void C3D_LightSpecular1(C3D_Light* light, float r, float g, float b)
 	light->specular1[1] = g;
 	light->specular1[2] = r;
 	light->flags |= C3DF_Light_MatDirty;
+	light->parent->colorGen ++;
 }
 
 void C3D_LightPosition(C3D_Light* light, C3D_FVec* pos)
 {
 	// Enable/disable positional light depending on W coordinate
-	light->conf.config &= ~BIT(0);
-	light->conf.config |= (pos->w == 0.0f);
+	u32 config = (light->conf.config &~ BIT(0)) | (pos->w == 0.0f);
+	if (config != light->conf.config)
+	{
+		light->conf.config = config;
+		light->flags |= C3DF_Light_ConfigDirty;
+	}
 	light->conf.position[0] = f32tof16(pos->x);
 	light->conf.position[1] = f32tof16(pos->y);
 	light->conf.position[2] = f32tof16(pos->z);
-	light->flags |= C3DF_Light_Dirty;
+	light->flags |= C3DF_Light_PosDirty;
+}
+
+void C3D_LightPositionArray(C3D_Light* const* lights, const C3D_FVec* pos, size_t count, const C3D_Mtx* view)
+{
+	C3D_FVec tmp[16];
+	size_t i, j;
+
+	for (i = 0; i < count; i += 16)
+	{
+		size_t n = count-i < 16 ? count-i : 16;
+		Mtx_MultiplyFVec4Array(view, tmp, &pos[i], n, false);
+		for (j = 0; j < n; j ++)
+			C3D_LightPosition(lights[i+j], &tmp[j]);
+	}
 }
 
 static void C3Di_EnableCommon(C3D_Light* light, bool enable, u32 bit)
@@ -152,7 +178,7 @@ void C3D_LightSpotDir(C3D_Light* light, float x, float y, float z)
 	light->conf.spotDir[0] = floattofix2_11(vec.x);
 	light->conf.spotDir[1] = floattofix2_11(vec.y);
 	light->conf.spotDir[2] = floattofix2_11(vec.z);
-	light->flags |= C3DF_Light_Dirty;
+	light->flags |= C3DF_Light_SpotDirDirty;
 }
 
 void C3D_LightSpotLut(C3D_Light* light, C3D_LightLut* lut)
@@ -178,5 +204,5 @@ void C3D_LightDistAttn(C3D_Light* light, C3D_LightLutDA* lut)
 	light->conf.distAttnBias  = f32tof20(lut->bias);
 	light->conf.distAttnScale = f32tof20(lut->scale);
 	light->lut_DA = &lut->lut;
-	light->flags |= C3DF_Light_Dirty | C3DF_Light_DADirty;
+	light->flags |= C3DF_Light_AttnDirty | C3DF_Light_DADirty;
 }
@@ -1,9 +1,8 @@
 #include "internal.h"
 
-static void C3Di_LightEnvMtlBlend(C3D_LightEnv* env)
+u32 C3Di_LightEnvMtlAmbient(const C3D_LightEnv* env, const C3D_Material* mtl)
 {
 	int i;
-	C3D_Material* mtl = &env->material;
 	u32 color = 0;
 	for (i = 0; i < 3; i ++)
 	{
@@ -12,15 +11,81 @@ static void C3Di_LightEnvMtlBlend(C3D_LightEnv* env)
 		else if (v > 255) v = 255;
 		color |= v << (i*10);
 	}
-	env->conf.ambient = color;
+	return color;
+}
+
+static void C3Di_LightEnvMtlBlend(C3D_LightEnv* env)
+{
+	env->conf.ambient = C3Di_LightEnvMtlAmbient(env, &env->material);
 }
 
-static void C3Di_LightLutUpload(u32 config, C3D_LightLut* lut)
+static void C3Di_LightLutUpload(int slot, u32 config, C3D_LightLut* lut)
 {
 	int i;
+	C3Di_LutSlot* res = &C3Di_GetContext()->lightLuts[slot];
+	if (lut->gen && res->lut == lut && res->gen == lut->gen)
+		return;
+	res->lut = lut;
+	res->gen = lut->gen;
+
 	GPUCMD_AddWrite(GPUREG_LIGHTING_LUT_INDEX, config);
 	for (i = 0; i < 256; i += 8)
 		GPUCMD_AddWrites(GPUREG_LIGHTING_LUT_DATA0, &lut->data[i], 8);
+	C3Di_STAT_ADD(lutUploads, 1);
+}
+
+// Writes the registers of a block that differ from what the GPU holds
+static void C3Di_LightRegsDiff(u32 reg, const void* src, void* shadow, u32 num, bool resident)
+{
+	const u32* vals = (const u32*)src;
+	u32* cur = (u32*)shadow;
+	u32 first = 0, last = num-1;
+
+	if (resident)
+	{
+		for (; first < num && vals[first] == cur[first]; first ++);
+		if (first == num)
+			return;
+		for (; last > first && vals[last] == cur[last]; last --);
+	}
+
+	num = last-first+1;
+	memcpy(cur+first, vals+first, num*4);
+	if (num == 1)
+		GPUCMD_AddWrite(reg+first, vals[first]);
+	else
+		GPUCMD_AddIncrementalWrites(reg+first, (u32*)vals+first, num);
+}
+
+static void C3Di_LightPartsUpdate(C3D_Light* light, int id, C3D_LightConf* cur, bool resident)
+{
+	// Word ranges of C3D_LightConf covered by each dirty bit
+	static const u8 parts[5][2] =
+	{
+		{ 0, 4 }, // Colours
+		{ 4, 2 }, // Position
+		{ 6, 2 }, // Spot direction
+		{ 9, 1 }, // Config
+		{ 10, 2 }, // Attenuation
+	};
+
+	u32 reg = GPUREG_LIGHT0_SPECULAR0 + id*0x10;
+	const u32* src = (const u32*)&light->conf;
+	u32* dst = (u32*)cur;
+	int i;
+
+	if (!resident || (light->flags & C3DF_Light_Dirty))
+	{
+		C3Di_LightRegsDiff(reg, src, dst, 12, resident);
+		return;
+	}
+
+	for (i = 0; i < 5; i ++)
+	{
+		if (!(light->flags & (C3DF_Light_ColorDirty << i))) continue;
+		int first = parts[i][0];
+		C3Di_LightRegsDiff(reg+first, src+first, dst+first, parts[i][1], true);
+	}
 }
 
 static void C3Di_LightEnvSelectLayer(C3D_LightEnv* env)
@@ -52,7 +117,9 @@ static void C3Di_LightEnvSelectLayer(C3D_LightEnv* env)
 void C3Di_LightEnvUpdate(C3D_LightEnv* env)
 {
 	int i;
+	C3D_Context* ctx = C3Di_GetContext();
 	C3D_LightEnvConf* conf = &env->conf;
+	C3D_LightEnvConf* cur = &ctx->lightEnvConf;
 
 	if (env->flags & C3DF_LightEnv_LCDirty)
 	{
@@ -79,11 +146,13 @@ void C3Di_LightEnvUpdate(C3D_LightEnv* env)
 
 	if (env->flags & C3DF_LightEnv_Dirty)
 	{
+		bool resident = (ctx->lightResident & BIT(8)) != 0;
 		C3Di_LightEnvSelectLayer(env);
-		GPUCMD_AddWrite(GPUREG_LIGHTING_AMBIENT, conf->ambient);
-		GPUCMD_AddIncrementalWrites(GPUREG_LIGHTING_NUM_LIGHTS, (u32*)&conf->numLights, 3);
-		GPUCMD_AddIncrementalWrites(GPUREG_LIGHTING_LUTINPUT_ABS, (u32*)&conf->lutInput, 3);
-		GPUCMD_AddWrite(GPUREG_LIGHTING_LIGHT_PERMUTATION, conf->permutation);
+		C3Di_LightRegsDiff(GPUREG_LIGHTING_AMBIENT, &conf->ambient, &cur->ambient, 1, resident);
+		C3Di_LightRegsDiff(GPUREG_LIGHTING_NUM_LIGHTS, &conf->numLights, &cur->numLights, 3, resident);
+		C3Di_LightRegsDiff(GPUREG_LIGHTING_LUTINPUT_ABS, &conf->lutInput, &cur->lutInput, 3, resident);
+		C3Di_LightRegsDiff(GPUREG_LIGHTING_LIGHT_PERMUTATION, &conf->permutation, &cur->permutation, 1, resident);
+		ctx->lightResident |= BIT(8);
 		env->flags &= ~C3DF_LightEnv_Dirty;
 	}
 
@@ -93,7 +162,7 @@ void C3Di_LightEnvUpdate(C3D_LightEnv* env)
 		{
 			static const u8 lutIds[] = { 0, 1, 3, 4, 5, 6 };
 			if (!(env->flags & C3DF_LightEnv_LutDirty(i))) continue;
-			C3Di_LightLutUpload(GPU_LIGHTLUTIDX(GPU_LUTSELECT_COMMON, (u32)lutIds[i], 0), env->luts[i]);
+			C3Di_LightLutUpload(C3Di_LutSlot_Common+i, GPU_LIGHTLUTIDX(GPU_LUTSELECT_COMMON, (u32)lutIds[i], 0), env->luts[i]);
 		}
 
 		env->flags &= ~C3DF_LightEnv_LutDirtyAll;
@@ -108,24 +177,25 @@ void C3Di_LightEnvUpdate(C3D_LightEnv* env)
 		{
 			C3Di_LightMtlBlend(light);
 			light->flags &= ~C3DF_Light_MatDirty;
-			light->flags |= C3DF_Light_Dirty;
+			light->flags |= C3DF_Light_ColorDirty;
 		}
 
-		if (light->flags & C3DF_Light_Dirty)
+		if (light->flags & (C3DF_Light_Dirty | C3DF_Light_PartsDirty))
 		{
-			GPUCMD_AddIncrementalWrites(GPUREG_LIGHT0_SPECULAR0 + i*0x10, (u32*)&light->conf, 12);
-			light->flags &= ~C3DF_Light_Dirty;
+			C3Di_LightPartsUpdate(light, i, &ctx->lightConf[i], (ctx->lightResident & BIT(i)) != 0);
+			ctx->lightResident |= BIT(i);
+			light->flags &= ~(C3DF_Light_Dirty | C3DF_Light_PartsDirty);
 		}
 
 		if (light->flags & C3DF_Light_SPDirty)
 		{
-			C3Di_LightLutUpload(GPU_LIGHTLUTIDX(GPU_LUTSELECT_SP, i, 0), light->lut_SP);
+			C3Di_LightLutUpload(C3Di_LutSlot_SP+i, GPU_LIGHTLUTIDX(GPU_LUTSELECT_SP, i, 0), light->lut_SP);
 			light->flags &= ~C3DF_Light_SPDirty;
 		}
 
 		if (light->flags & C3DF_Light_DADirty)
 		{
-			C3Di_LightLutUpload(GPU_LIGHTLUTIDX(GPU_LUTSELECT_DA, i, 0), light->lut_DA);
+			C3Di_LightLutUpload(C3Di_LutSlot_DA+i, GPU_LIGHTLUTIDX(GPU_LUTSELECT_DA, i, 0), light->lut_DA);
 			light->flags &= ~C3DF_Light_DADirty;
 		}
 	}
@@ -172,6 +242,10 @@ void C3D_LightEnvBind(C3D_LightEnv* env)
 	if (ctx->lightEnv == env)
 		return;
 
+	// The GPU holds the previous env's state, only the registers and LUTs that differ are sent
+	if (env)
+		C3Di_LightEnvDirty(env);
+
 	ctx->flags |= C3DiF_LightEnv;
 	ctx->lightEnv = env;
 }
@@ -194,6 +268,7 @@ void C3D_LightEnvAmbient(C3D_LightEnv* env, float r, float g, float b)
 	env->ambient[1] = g;
 	env->ambient[2] = r;
 	env->flags |= C3DF_LightEnv_MtlDirty;
+	env->colorGen ++;
 }
 
 void C3D_LightEnvLut(C3D_LightEnv* env, GPU_LIGHTLUTID lutId, GPU_LIGHTLUTINPUT input, bool negative, C3D_LightLut* lut)
@@ -1,73 +1,100 @@
 #include "internal.h"
 
-void LightLut_FromArray(C3D_LightLut* lut, float* data)
+static u32 lutGen;
+
+u32 C3Di_LutNextGen(void)
 {
-	int i;
-	for (i = 0; i < 256; i ++)
+	// Generations are global so that a LUT reallocated at the same address never matches
+	if (!++lutGen)
+		++lutGen;
+	return lutGen;
+}
+
+void LightLut_Changed(C3D_LightLut* lut)
+{
+	lut->gen = C3Di_LutNextGen();
+}
+
+static inline u32 C3Di_LightLutEntry(float in, float diff)
+{
+	u32 val = 0;
+	if (in > 0.0f)
 	{
-		float in = data[i], diff = data[i+256];
+		in *= 0x1000;
+		val = (in < 0x1000) ? (u32)in : 0xFFF;
+	}
 
-		u32 val = 0;
-		if (in > 0.0f)
+	u32 val2 = 0;
+	if (diff != 0.0f)
+	{
+		if (diff < 0)
 		{
-			in *= 0x1000;
-			val = (in < 0x1000) ? (u32)in : 0xFFF;
+			diff = -diff;
+			val2 = 0x800;
 		}
+		diff *= 0x800;
+		val2 |= (diff < 0x800) ? (u32)diff : 0x7FF;
+	}
 
-		u32 val2 = 0;
-		if (diff != 0.0f)
-		{
-			if (diff < 0)
-			{
-				diff = -diff;
-				val2 = 0x800;
-			}
-			diff *= 0x800;
-			val2 |= (diff < 0x800) ? (u32)diff : 0x7FF;
-		}
+	return val | (val2 << 12);
+}
 
-		lut->data[i] = val | (val2 << 12);
-	}
+void LightLut_FromArray(C3D_LightLut* lut, float* data)
+{
+	int i;
+	for (i = 0; i < 256; i ++)
+		lut->data[i] = C3Di_LightLutEntry(data[i], data[i+256]);
+	LightLut_Changed(lut);
 }
 
 void LightLut_FromFunc(C3D_LightLut* lut, C3D_LightLutFunc func, float param, bool negative)
 {
 	int i;
-	float data[512];
-	memset(data, 0, sizeof(data));
 	int min = negative ? (-128) : 0;
 	int max = negative ?   128  : 256;
+	float prev = 0.0f;
+
+	// Each entry holds its value and the step to the next one, so entries are emitted one behind
 	for (i = min; i <= max; i ++)
 	{
-		float x   = (float)i/max;
-		float val = func(x, param);
-		int   idx = negative ? (i & 0xFF) : i;
-		if (i < max)
-			data[idx] = val;
+		float val = func((float)i/max, param);
 		if (i > min)
-			data[idx+255] = val-data[idx-1];
+			lut->data[(i-1) & 0xFF] = C3Di_LightLutEntry(prev, val-prev);
+		prev = val;
 	}
-	LightLut_FromArray(lut, data);
+	LightLut_Changed(lut);
 }
 
 void LightLutDA_Create(C3D_LightLutDA* lut, C3D_LightLutFuncDA func, float from, float to, float arg0, float arg1)
 {
 	int i;
-	float data[512];
-
 	float range = to-from;
+	float prev = 0.0f;
 	lut->scale = 1.0f / range;
 	lut->bias = -from*lut->scale;
 
 	for (i = 0; i <= 256; i ++)
 	{
-		float x   = from + range*i/256.0f;
-		float val = func(x, arg0, arg1);
-		if (i < 256)
-			data[i] = val;
+		float val = func(from + range*i/256.0f, arg0, arg1);
 		if (i > 0)
-			data[i+255] = val-data[i-1];
+			lut->lut.data[i-1] = C3Di_LightLutEntry(prev, val-prev);
+		prev = val;
 	}
+	LightLut_Changed(&lut->lut);
+}
 
-	LightLut_FromArray(&lut->lut, data);
+void LightLut_PhongFast(C3D_LightLut* lut, float shininess)
+{
+	int i;
+	float prev = 0.0f;
+
+	// x^s as 2^(s*log2(x)), log2 of i/256 is log2(i) - 8
+	for (i = 0; i <= 256; i ++)
+	{
+		float val = i ? C3Di_FastExp2(shininess*(C3Di_FastLog2((float)i) - 8.0f)) : (shininess > 0.0f ? 0.0f : 1.0f);
+		if (i > 0)
+			lut->data[i-1] = C3Di_LightLutEntry(prev, val-prev);
+		prev = val;
+	}
+	LightLut_Changed(lut);
 }
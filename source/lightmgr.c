@@ -0,0 +1,138 @@
+#include "internal.h"
+#include <float.h>
+#include <c3d/lightmgr.h>
+
+bool C3D_LightManagerInit(C3D_LightManager* mgr, C3D_LightEnv* env, C3D_SceneLight* lights, int numLights)
+{
+	int i;
+	memset(mgr, 0, sizeof(*mgr));
+	mgr->env = env;
+	mgr->lights = lights;
+	mgr->numLights = numLights;
+
+	for (i = 0; i < 8; i ++)
+	{
+		mgr->slotLight[i] = -1;
+		if (C3D_LightInit(&mgr->slots[mgr->numSlots], env) < 0)
+			break;
+		C3D_LightEnable(&mgr->slots[mgr->numSlots++], false);
+	}
+
+	return mgr->numSlots > 0;
+}
+
+static float C3Di_LightInfluence(const C3D_SceneLight* l, C3D_FVec center, float radius)
+{
+	if (l->position.w == 0.0f)
+		return FLT_MAX;
+
+	float d = FVec3_Distance(center, l->position) - radius;
+	if (d < 0.0f)
+		d = 0.0f;
+	if (d >= l->radius)
+		return 0.0f;
+
+	float f = 1.0f - d/l->radius;
+	return l->intensity*f*f;
+}
+
+// Hardware lights keep their colours as b, g, r
+static inline bool C3Di_LightColorSame(const float hw[3], const float rgb[3])
+{
+	return hw[0] == rgb[2] && hw[1] == rgb[1] && hw[2] == rgb[0];
+}
+
+static void C3Di_LightManagerBind(C3D_Light* hw, const C3D_SceneLight* l)
+{
+	C3D_FVec pos = l->position;
+	C3D_LightPosition(hw, &pos);
+
+	// Setting a colour bumps the env's colorGen and with it every material built from it,
+	// lights that only moved leave them alone
+	if (!C3Di_LightColorSame(hw->ambient, l->ambient))
+		C3D_LightAmbient(hw, l->ambient[0], l->ambient[1], l->ambient[2]);
+	if (!C3Di_LightColorSame(hw->diffuse, l->diffuse))
+		C3D_LightDiffuse(hw, l->diffuse[0], l->diffuse[1], l->diffuse[2]);
+	if (!C3Di_LightColorSame(hw->specular0, l->specular0))
+		C3D_LightSpecular0(hw, l->specular0[0], l->specular0[1], l->specular0[2]);
+	if (!C3Di_LightColorSame(hw->specular1, l->specular1))
+		C3D_LightSpecular1(hw, l->specular1[0], l->specular1[1], l->specular1[2]);
+
+	if (l->spot)
+	{
+		C3D_LightSpotLut(hw, l->spot);
+		C3D_LightSpotDir(hw, l->spotDir.x, l->spotDir.y, l->spotDir.z);
+	} else
+		C3D_LightSpotEnable(hw, false);
+
+	if (l->distAttn)
+		C3D_LightDistAttn(hw, l->distAttn);
+	else
+		C3D_LightDistAttnEnable(hw, false);
+}
+
+int C3D_LightManagerSelect(C3D_LightManager* mgr, C3D_FVec center, float radius)
+{
+	int i, j, n = 0;
+	int best[8];
+	float score[8];
+
+	// Keep the strongest lights in a small sorted list
+	for (i = 0; i < mgr->numLights; i ++)
+	{
+		float s = C3Di_LightInfluence(&mgr->lights[i], center, radius);
+		if (s <= 0.0f || (n == mgr->numSlots && s <= score[n-1]))
+			continue;
+
+		if (n < mgr->numSlots)
+			n ++;
+		for (j = n-1; j > 0 && score[j-1] < s; j --)
+		{
+			best[j] = best[j-1];
+			score[j] = score[j-1];
+		}
+		best[j] = i;
+		score[j] = s;
+	}
+
+	// Lights that are still selected stay where they are
+	u8 placed = 0, used = 0;
+	for (i = 0; i < mgr->numSlots; i ++)
+	{
+		if (mgr->slotLight[i] < 0) continue;
+		for (j = 0; j < n; j ++)
+			if (best[j] == mgr->slotLight[i])
+				break;
+		if (j < n)
+		{
+			placed |= BIT(j);
+			used |= BIT(i);
+		} else
+			mgr->slotLight[i] = -1;
+	}
+
+	// The others go into the slots that were freed
+	for (j = 0, i = 0; j < n; j ++)
+	{
+		if (placed & BIT(j)) continue;
+		while (used & BIT(i)) i ++;
+		mgr->slotLight[i] = best[j];
+		mgr->slotGen[i] = mgr->lights[best[j]].gen-1;
+		used |= BIT(i);
+	}
+
+	for (i = 0; i < mgr->numSlots; i ++)
+	{
+		C3D_Light* hw = &mgr->slots[i];
+		int id = mgr->slotLight[i];
+		C3D_LightEnable(hw, id >= 0);
+		if (id < 0) continue;
+
+		const C3D_SceneLight* l = &mgr->lights[id];
+		if (mgr->slotGen[i] == l->gen) continue;
+		C3Di_LightManagerBind(hw, l);
+		mgr->slotGen[i] = l->gen;
+	}
+
+	return n;
+}
@@ -0,0 +1,70 @@
+#include "internal.h"
+#include <c3d/lod.h>
+
+void C3D_LodViewInit(C3D_LodView* v, const C3D_Mtx* proj, const C3D_Mtx* view, float far)
+{
+	C3D_Mtx clip;
+	Mtx_Multiply(&clip, proj, view);
+	Frustum_FromMtx(&v->frusta[0], &clip);
+	v->numFrusta = 1;
+	Mtx_Copy(&v->proj, proj);
+	Mtx_Copy(&v->view, view);
+	v->far = far;
+}
+
+void C3D_LodViewStereoTilt(C3D_LodView* v, const C3D_Mtx* view, float fovx, float invaspect, float near, float far, float iod, float screen, bool isLeftHanded)
+{
+	Frustum_FromPerspStereoTilt(v->frusta, view, fovx, invaspect, near, far, iod, screen, isLeftHanded);
+	v->numFrusta = 2;
+	Mtx_PerspStereoTilt(&v->proj, fovx, invaspect, near, far, 0.0f, screen, isLeftHanded);
+	Mtx_Copy(&v->view, view);
+	v->far = far;
+}
+
+u32 C3D_LodQueue(C3D_DrawQueue* q, const C3D_LodView* v, const C3D_FVec* spheres, C3D_LodObject* objects, size_t count)
+{
+	C3D_Mtx clip;
+	Mtx_Multiply(&clip, &v->proj, &v->view);
+	const C3D_FVec* w = &clip.r[3];
+	float invFar = v->far > 0.0f ? 1.0f/v->far : 0.0f;
+
+	// One visibility word at a time, so no scratch memory is needed
+	float sizes[32];
+	u32 visible, pushed = 0;
+	size_t n, k;
+	for (n = 0; n < count; n += 32)
+	{
+		size_t num = count-n < 32 ? count-n : 32;
+		Frustum_CullSpheres(v->frusta, v->numFrusta, &spheres[n], num, &visible);
+		if (!visible)
+			continue;
+		Lod_ProjectedSizes(&v->proj, &v->view, &spheres[n], num, sizes);
+
+		for (k = 0; k < num; k ++)
+		{
+			if (!(visible & BIT(k)))
+				continue;
+
+			C3D_LodObject* o = &objects[n+k];
+			const C3D_LodModel* m = o->model;
+			o->level = Lod_Select(m->minSizes, m->numLevels, m->hysteresis, sizes[k], o->level);
+
+			const C3D_DrawItem* draw = &m->levels[o->level];
+			if (!draw->count)
+				continue;
+
+			const C3D_FVec* s = &spheres[n+k];
+			float depth = (w->x*s->x + w->y*s->y + w->z*s->z + w->w)*invFar;
+			u32 key = m->blended ? C3D_DrawKeyBlended(m->stateId, depth) : C3D_DrawKeyOpaque(m->stateId, depth);
+
+			C3D_DrawItem* it = C3D_DrawQueuePush(q, key);
+			if (!it)
+				return pushed;
+			*it = *draw;
+			it->key = key;
+			it->param = o->param;
+			pushed ++;
+		}
+	}
+	return pushed;
+}
@@ -0,0 +1,137 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/lutcache.h>
+
+enum
+{
+	C3Di_LutKind_Light,
+	C3Di_LutKind_LightNeg,
+	C3Di_LutKind_DistAttn,
+	C3Di_LutKind_FogExp,
+};
+
+bool C3D_LutCacheInit(C3D_LutCache* cache, int count)
+{
+	if (count < 1)
+		return false;
+
+	C3D_LutCacheEntry* entries = (C3D_LutCacheEntry*)malloc(count*sizeof(C3D_LutCacheEntry));
+	if (!entries)
+		return false;
+	C3D_LutCacheInitWithBuffer(cache, entries, count);
+	cache->ownsBuf = true;
+	return true;
+}
+
+void C3D_LutCacheInitWithBuffer(C3D_LutCache* cache, C3D_LutCacheEntry* entries, int count)
+{
+	cache->entries = entries;
+	cache->count = count;
+	cache->ownsBuf = false;
+	C3D_LutCacheClear(cache);
+}
+
+void C3D_LutCacheDelete(C3D_LutCache* cache)
+{
+	if (cache->ownsBuf)
+		free(cache->entries);
+	memset(cache, 0, sizeof(*cache));
+}
+
+void C3D_LutCacheClear(C3D_LutCache* cache)
+{
+	int i;
+	for (i = 0; i < cache->count; i ++)
+	{
+		cache->entries[i].func = NULL;
+		cache->entries[i].lastUse = 0;
+	}
+	cache->clock = 0;
+}
+
+// Returns the matching entry, or the least recently used one with *hit cleared
+static C3D_LutCacheEntry* C3Di_LutCacheFind(C3D_LutCache* cache, const void* func, u32 kind, const float params[4], bool* hit)
+{
+	C3D_LutCacheEntry* lru = &cache->entries[0];
+	int i;
+
+	for (i = 0; i < cache->count; i ++)
+	{
+		C3D_LutCacheEntry* e = &cache->entries[i];
+		if (e->func == func && e->kind == kind && memcmp(e->params, params, sizeof(e->params)) == 0)
+		{
+			e->lastUse = ++cache->clock;
+			*hit = true;
+			return e;
+		}
+		if (e->lastUse < lru->lastUse)
+			lru = e;
+	}
+
+	lru->func = func;
+	lru->kind = kind;
+	memcpy(lru->params, params, sizeof(lru->params));
+	lru->lastUse = ++cache->clock;
+	*hit = false;
+	return lru;
+}
+
+static void C3Di_LutCacheCopyLight(C3D_LutCacheEntry* e, C3D_LightLut* lut, bool hit)
+{
+	if (!hit)
+	{
+		memcpy(e->data, lut->data, sizeof(e->data));
+		e->gen = lut->gen;
+	} else if (lut->gen != e->gen)
+	{
+		// Same contents, same generation
+		memcpy(lut->data, e->data, sizeof(lut->data));
+		lut->gen = e->gen;
+	}
+}
+
+void LightLut_FromFuncCached(C3D_LutCache* cache, C3D_LightLut* lut, C3D_LightLutFunc func, float param, bool negative)
+{
+	const float params[4] = { param, 0.0f, 0.0f, 0.0f };
+	bool hit;
+	C3D_LutCacheEntry* e = C3Di_LutCacheFind(cache, (const void*)func, negative ? C3Di_LutKind_LightNeg : C3Di_LutKind_Light, params, &hit);
+	if (!hit)
+		LightLut_FromFunc(lut, func, param, negative);
+	C3Di_LutCacheCopyLight(e, lut, hit);
+}
+
+void LightLutDA_CreateCached(C3D_LutCache* cache, C3D_LightLutDA* lut, C3D_LightLutFuncDA func, float from, float to, float arg0, float arg1)
+{
+	const float params[4] = { from, to, arg0, arg1 };
+	bool hit;
+	C3D_LutCacheEntry* e = C3Di_LutCacheFind(cache, (const void*)func, C3Di_LutKind_DistAttn, params, &hit);
+	if (!hit)
+	{
+		LightLutDA_Create(lut, func, from, to, arg0, arg1);
+		e->bias = lut->bias;
+		e->scale = lut->scale;
+	} else
+	{
+		lut->bias = e->bias;
+		lut->scale = e->scale;
+	}
+	C3Di_LutCacheCopyLight(e, &lut->lut, hit);
+}
+
+void FogLut_ExpCached(C3D_LutCache* cache, C3D_FogLut* lut, float density, float gradient, float near, float far)
+{
+	const float params[4] = { density, gradient, near, far };
+	bool hit;
+	// Keyed by the builder like the others, a NULL func is what marks an empty slot
+	C3D_LutCacheEntry* e = C3Di_LutCacheFind(cache, (const void*)FogLut_ExpFast, C3Di_LutKind_FogExp, params, &hit);
+	if (!hit)
+	{
+		FogLut_ExpFast(lut, density, gradient, near, far);
+		memcpy(e->data, lut->data, sizeof(lut->data));
+		e->gen = lut->gen;
+	} else if (lut->gen != e->gen)
+	{
+		memcpy(lut->data, e->data, sizeof(lut->data));
+		lut->gen = e->gen;
+	}
+}
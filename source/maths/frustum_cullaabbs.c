@@ -0,0 +1,39 @@
+#include <c3d/maths.h>
+
+void Frustum_CullAABBs(const C3D_Frustum* f, int numFrusta, const C3D_FVec* mins, const C3D_FVec* maxs, size_t count, u32* visible)
+{
+	size_t n;
+	int i, j;
+
+	for (n = 0; n < count; n += 32)
+	{
+		size_t end = count - n < 32 ? count - n : 32;
+		u32 mask = 0;
+		size_t k;
+
+		for (k = 0; k < end; ++k)
+		{
+			const C3D_FVec* lo = &mins[n+k];
+			const C3D_FVec* hi = &maxs[n+k];
+			for (j = 0; j < numFrusta; ++j)
+			{
+				// The box is outside a plane when even its corner furthest along the normal is
+				const C3D_FVec* p = f[j].planes;
+				for (i = 0; i < 6; ++i)
+				{
+					float x = p[i].x >= 0.0f ? hi->x : lo->x;
+					float y = p[i].y >= 0.0f ? hi->y : lo->y;
+					float z = p[i].z >= 0.0f ? hi->z : lo->z;
+					if (p[i].x*x + p[i].y*y + p[i].z*z + p[i].w < 0.0f)
+						break;
+				}
+				if (i == 6)
+				{
+					mask |= 1U << k;
+					break;
+				}
+			}
+		}
+		visible[n/32] = mask;
+	}
+}
@@ -0,0 +1,32 @@
+#include <c3d/maths.h>
+
+void Frustum_CullSpheres(const C3D_Frustum* f, int numFrusta, const C3D_FVec* spheres, size_t count, u32* visible)
+{
+	size_t n;
+	int i, j;
+
+	for (n = 0; n < count; n += 32)
+	{
+		size_t end = count - n < 32 ? count - n : 32;
+		u32 mask = 0;
+		size_t k;
+
+		for (k = 0; k < end; ++k)
+		{
+			const C3D_FVec* s = &spheres[n+k];
+			for (j = 0; j < numFrusta; ++j)
+			{
+				const C3D_FVec* p = f[j].planes;
+				for (i = 0; i < 6; ++i)
+					if (p[i].x*s->x + p[i].y*s->y + p[i].z*s->z + p[i].w < -s->w)
+						break;
+				if (i == 6)
+				{
+					mask |= 1U << k;
+					break;
+				}
+			}
+		}
+		visible[n/32] = mask;
+	}
+}
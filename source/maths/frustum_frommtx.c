@@ -0,0 +1,24 @@
+#include <c3d/maths.h>
+
+void Frustum_FromMtx(C3D_Frustum* f, const C3D_Mtx* clip)
+{
+	// Clip space is -w <= x <= w, -w <= y <= w and -w <= z <= 0, so each plane is a sum of rows.
+	// This holds for the tilted projections too, they only swap the meaning of the rows.
+	const C3D_FVec* r = clip->r;
+	int i;
+
+	f->planes[0] = FVec4_Add(r[3], r[0]);
+	f->planes[1] = FVec4_Subtract(r[3], r[0]);
+	f->planes[2] = FVec4_Add(r[3], r[1]);
+	f->planes[3] = FVec4_Subtract(r[3], r[1]);
+	f->planes[4] = FVec4_Add(r[3], r[2]);
+	f->planes[5] = FVec4_Negate(r[2]);
+
+	// Normalise so that distances to the planes can be compared with radii
+	for (i = 0; i < 6; ++i)
+	{
+		float m = FVec3_Magnitude(f->planes[i]);
+		if (m > 0.0f)
+			f->planes[i] = FVec4_Scale(f->planes[i], 1.0f/m);
+	}
+}
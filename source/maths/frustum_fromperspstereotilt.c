@@ -0,0 +1,20 @@
+#include <c3d/maths.h>
+
+void Frustum_FromPerspStereoTilt(C3D_Frustum f[2], const C3D_Mtx* view, float fovx, float invaspect, float near, float far, float iod, float screen, bool isLeftHanded)
+{
+	C3D_Mtx proj, clip;
+	int eye;
+
+	// Same eye convention as Mtx_PerspStereoTilt: -iod for the left eye, iod for the right one
+	for (eye = 0; eye < 2; ++eye)
+	{
+		Mtx_PerspStereoTilt(&proj, fovx, invaspect, near, far, eye ? iod : -iod, screen, isLeftHanded);
+		if (view)
+		{
+			Mtx_Multiply(&clip, &proj, view);
+			Frustum_FromMtx(&f[eye], &clip);
+		}
+		else
+			Frustum_FromMtx(&f[eye], &proj);
+	}
+}
@@ -0,0 +1,33 @@
+#include <c3d/maths.h>
+
+void Lod_ProjectedSizes(const C3D_Mtx* proj, const C3D_Mtx* view, const C3D_FVec* spheres, size_t count, float* sizes)
+{
+	C3D_Mtx clip;
+	size_t n;
+
+	// The larger of the x and y scales belongs to the shorter side, whether the projection is tilted or not
+	float sx = sqrtf(proj->r[0].x*proj->r[0].x + proj->r[0].y*proj->r[0].y);
+	float sy = sqrtf(proj->r[1].x*proj->r[1].x + proj->r[1].y*proj->r[1].y);
+	float scale = sx > sy ? sx : sy;
+
+	if (view)
+		Mtx_Multiply(&clip, proj, view);
+	else
+		Mtx_Copy(&clip, proj);
+
+	// Orthographic projections have a constant w
+	const C3D_FVec* w = &clip.r[3];
+	if (w->x == 0.0f && w->y == 0.0f && w->z == 0.0f)
+	{
+		for (n = 0; n < count; ++n)
+			sizes[n] = spheres[n].w*scale / w->w;
+		return;
+	}
+
+	for (n = 0; n < count; ++n)
+	{
+		const C3D_FVec* s = &spheres[n];
+		float depth = w->x*s->x + w->y*s->y + w->z*s->z + w->w;
+		sizes[n] = depth > s->w ? s->w*scale / depth : INFINITY;
+	}
+}
@@ -0,0 +1,38 @@
+#include <c3d/maths.h>
+
+void Mtx_FromQuatArray(C3D_Mtx* out, const C3D_FQuat* q, size_t count)
+{
+	size_t n;
+
+	for (n = 0; n < count; ++n)
+	{
+		C3D_Mtx* m = &out[n];
+		float i = q[n].i, j = q[n].j, k = q[n].k, r = q[n].r;
+
+		// Same products as Mtx_FromQuat, with the doubling folded into one operand
+		float i2 = i + i, j2 = j + j, k2 = k + k;
+		float ii = i*i2, ij = i*j2, ik = i*k2;
+		float jj = j*j2, jk = j*k2, kk = k*k2;
+		float ri = r*i2, rj = r*j2, rk = r*k2;
+
+		m->r[0].x = 1.0f - (jj + kk);
+		m->r[0].y = ij - rk;
+		m->r[0].z = ik + rj;
+		m->r[0].w = 0.0f;
+
+		m->r[1].x = ij + rk;
+		m->r[1].y = 1.0f - (ii + kk);
+		m->r[1].z = jk - ri;
+		m->r[1].w = 0.0f;
+
+		m->r[2].x = ik - rj;
+		m->r[2].y = jk + ri;
+		m->r[2].z = 1.0f - (ii + jj);
+		m->r[2].w = 0.0f;
+
+		m->r[3].x = 0.0f;
+		m->r[3].y = 0.0f;
+		m->r[3].z = 0.0f;
+		m->r[3].w = 1.0f;
+	}
+}
@@ -0,0 +1,41 @@
+#include <float.h>
+#include <c3d/maths.h>
+
+float Mtx_InverseAffine(C3D_Mtx* out)
+{
+	// inverse([A t; 0 1]) = [inverse(A) -inverse(A)*t; 0 1]
+	float a = out->r[0].x, b = out->r[0].y, c = out->r[0].z;
+	float d = out->r[1].x, e = out->r[1].y, f = out->r[1].z;
+	float g = out->r[2].x, h = out->r[2].y, i = out->r[2].z;
+	float tx = out->r[0].w, ty = out->r[1].w, tz = out->r[2].w;
+
+	// Cofactors of the first row double as the determinant expansion
+	float c00 = e*i - f*h;
+	float c01 = f*g - d*i;
+	float c02 = d*h - e*g;
+
+	float det = a*c00 + b*c01 + c*c02;
+	if (fabsf(det) < FLT_EPSILON)
+		//Returns 0.0f if we find the determinant is less than +/- FLT_EPSILON.
+		return 0.0f;
+
+	float s = 1.0f / det;
+	float m00 = c00*s, m01 = (c*h - b*i)*s, m02 = (b*f - c*e)*s;
+	float m10 = c01*s, m11 = (a*i - c*g)*s, m12 = (c*d - a*f)*s;
+	float m20 = c02*s, m21 = (b*g - a*h)*s, m22 = (a*e - b*d)*s;
+
+	out->r[0].x = m00; out->r[0].y = m01; out->r[0].z = m02;
+	out->r[1].x = m10; out->r[1].y = m11; out->r[1].z = m12;
+	out->r[2].x = m20; out->r[2].y = m21; out->r[2].z = m22;
+
+	out->r[0].w = -(m00*tx + m01*ty + m02*tz);
+	out->r[1].w = -(m10*tx + m11*ty + m12*tz);
+	out->r[2].w = -(m20*tx + m21*ty + m22*tz);
+
+	out->r[3].x = 0.0f;
+	out->r[3].y = 0.0f;
+	out->r[3].z = 0.0f;
+	out->r[3].w = 1.0f;
+
+	return det;
+}
@@ -0,0 +1,23 @@
+#include <c3d/maths.h>
+
+void Mtx_InverseOrthonormal(C3D_Mtx* out)
+{
+	// inverse([R t; 0 1]) = [transpose(R) -transpose(R)*t; 0 1]
+	float a = out->r[0].x, b = out->r[0].y, c = out->r[0].z;
+	float d = out->r[1].x, e = out->r[1].y, f = out->r[1].z;
+	float g = out->r[2].x, h = out->r[2].y, i = out->r[2].z;
+	float tx = out->r[0].w, ty = out->r[1].w, tz = out->r[2].w;
+
+	out->r[0].x = a; out->r[0].y = d; out->r[0].z = g;
+	out->r[1].x = b; out->r[1].y = e; out->r[1].z = h;
+	out->r[2].x = c; out->r[2].y = f; out->r[2].z = i;
+
+	out->r[0].w = -(a*tx + d*ty + g*tz);
+	out->r[1].w = -(b*tx + e*ty + h*tz);
+	out->r[2].w = -(c*tx + f*ty + i*tz);
+
+	out->r[3].x = 0.0f;
+	out->r[3].y = 0.0f;
+	out->r[3].z = 0.0f;
+	out->r[3].w = 1.0f;
+}
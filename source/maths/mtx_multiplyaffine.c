@@ -0,0 +1,26 @@
+#include <c3d/maths.h>
+
+void Mtx_MultiplyAffine(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b)
+{
+	// With both bottom rows being (0,0,0,1) only the upper 3x4 part has to be computed.
+	// b is loaded up front and each row of a before its row of out is written, so out may be a or b.
+	float b00 = b->r[0].x, b01 = b->r[0].y, b02 = b->r[0].z, b03 = b->r[0].w;
+	float b10 = b->r[1].x, b11 = b->r[1].y, b12 = b->r[1].z, b13 = b->r[1].w;
+	float b20 = b->r[2].x, b21 = b->r[2].y, b22 = b->r[2].z, b23 = b->r[2].w;
+	int j;
+
+	for (j = 0; j < 3; ++j)
+	{
+		float x = a->r[j].x, y = a->r[j].y, z = a->r[j].z, w = a->r[j].w;
+
+		out->r[j].x = x*b00 + y*b10 + z*b20;
+		out->r[j].y = x*b01 + y*b11 + z*b21;
+		out->r[j].z = x*b02 + y*b12 + z*b22;
+		out->r[j].w = x*b03 + y*b13 + z*b23 + w;
+	}
+
+	out->r[3].x = 0.0f;
+	out->r[3].y = 0.0f;
+	out->r[3].z = 0.0f;
+	out->r[3].w = 1.0f;
+}
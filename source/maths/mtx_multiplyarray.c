@@ -0,0 +1,32 @@
+#include <c3d/maths.h>
+
+void Mtx_MultiplyArray(C3D_Mtx* out, const C3D_Mtx* a, const C3D_Mtx* b, size_t count)
+{
+	// a stays in registers for the whole batch
+	float a00 = a->r[0].x, a01 = a->r[0].y, a02 = a->r[0].z, a03 = a->r[0].w;
+	float a10 = a->r[1].x, a11 = a->r[1].y, a12 = a->r[1].z, a13 = a->r[1].w;
+	float a20 = a->r[2].x, a21 = a->r[2].y, a22 = a->r[2].z, a23 = a->r[2].w;
+	float a30 = a->r[3].x, a31 = a->r[3].y, a32 = a->r[3].z, a33 = a->r[3].w;
+	size_t n;
+	int i;
+
+	for (n = 0; n < count; ++n)
+	{
+		const C3D_Mtx* m = &b[n];
+		C3D_Mtx* o = &out[n];
+
+		// Each output column only depends on the same column of b, so out may be b
+		for (i = 0; i < 4; ++i)
+		{
+			float b0 = m->r[0].c[i];
+			float b1 = m->r[1].c[i];
+			float b2 = m->r[2].c[i];
+			float b3 = m->r[3].c[i];
+
+			o->r[0].c[i] = a00*b0 + a01*b1 + a02*b2 + a03*b3;
+			o->r[1].c[i] = a10*b0 + a11*b1 + a12*b2 + a13*b3;
+			o->r[2].c[i] = a20*b0 + a21*b1 + a22*b2 + a23*b3;
+			o->r[3].c[i] = a30*b0 + a31*b1 + a32*b2 + a33*b3;
+		}
+	}
+}
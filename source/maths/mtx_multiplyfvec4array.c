@@ -0,0 +1,21 @@
+#include <c3d/maths.h>
+
+void Mtx_MultiplyFVec4Array(const C3D_Mtx* mtx, C3D_FVec* out, const C3D_FVec* in, size_t count, bool homogeneous)
+{
+	float m00 = mtx->r[0].x, m01 = mtx->r[0].y, m02 = mtx->r[0].z, m03 = mtx->r[0].w;
+	float m10 = mtx->r[1].x, m11 = mtx->r[1].y, m12 = mtx->r[1].z, m13 = mtx->r[1].w;
+	float m20 = mtx->r[2].x, m21 = mtx->r[2].y, m22 = mtx->r[2].z, m23 = mtx->r[2].w;
+	float m30 = mtx->r[3].x, m31 = mtx->r[3].y, m32 = mtx->r[3].z, m33 = mtx->r[3].w;
+	size_t n;
+
+	for (n = 0; n < count; ++n)
+	{
+		// All loads come before the stores, so out may be in
+		float x = in[n].x, y = in[n].y, z = in[n].z, w = homogeneous ? 1.0f : in[n].w;
+
+		out[n].x = m00*x + m01*y + m02*z + m03*w;
+		out[n].y = m10*x + m11*y + m12*z + m13*w;
+		out[n].z = m20*x + m21*y + m22*z + m23*w;
+		out[n].w = m30*x + m31*y + m32*z + m33*w;
+	}
+}
@@ -0,0 +1,24 @@
+#include <c3d/maths.h>
+
+C3D_FQuat Quat_Slerp(C3D_FQuat lhs, C3D_FQuat rhs, float t)
+{
+	float d = Quat_Dot(lhs, rhs);
+	float sign = 1.0f;
+
+	if (d < 0.0f)
+	{
+		d    = -d;
+		sign = -1.0f;
+	}
+
+	// sin(angle) approaches zero, the interpolation is linear there anyway
+	if (d > 0.9995f)
+		return Quat_Nlerp(lhs, rhs, t);
+
+	float angle = acosf(d);
+	float inv   = 1.0f / sinf(angle);
+	float s0    = sinf((1.0f - t) * angle) * inv;
+	float s1    = sinf(t * angle) * inv * sign;
+
+	return Quat_New(lhs.i*s0 + rhs.i*s1, lhs.j*s0 + rhs.j*s1, lhs.k*s0 + rhs.k*s1, lhs.r*s0 + rhs.r*s1);
+}
@@ -0,0 +1,171 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/base.h>
+#include <c3d/mesh.h>
+#include <c3d/renderqueue.h>
+
+static bool C3Di_MeshReadData(decompressCallback callback, void** userdata, void* buffer, size_t size, size_t* insize)
+{
+	if (callback)
+		return callback(*userdata, buffer, size) == (ssize_t)size;
+	if (size > *insize)
+		return false;
+
+	memcpy(buffer, *userdata, size);
+	*userdata = (u8*)*userdata + size;
+	*insize -= size;
+	return true;
+}
+
+// Reads the header and the buffer configs, leaving the input at the payload
+static bool C3Di_MeshReadHeader(C3D_Mesh* mesh, C3D_MeshFileHeader* hdr, decompressCallback callback, void** userdata, size_t* insize)
+{
+	C3D_MeshFileBuf buf;
+	u8 pad[16];
+	int i;
+
+	memset(mesh, 0, sizeof(*mesh));
+	if (!C3Di_MeshReadData(callback, userdata, hdr, sizeof(*hdr), insize))
+		return false;
+	if (hdr->magic != C3D_MESH_MAGIC || hdr->version != C3D_MESH_VERSION)
+		return false;
+	if (hdr->numBufs > 12 || hdr->attrCount > 12 || (hdr->vertexSize & 0xF) || hdr->indexType > C3D_UNSIGNED_SHORT
+		|| hdr->primitive > (GPU_GEOMETRY_PRIM >> 8))
+		return false;
+	// Compared without shifting numIndices or adding the sizes, both of which could wrap
+	if (hdr->numIndices > hdr->indexSize >> hdr->indexType || hdr->indexSize > UINT32_MAX - hdr->vertexSize)
+		return false;
+
+	mesh->numIndices = hdr->numIndices;
+	mesh->primitive  = (GPU_Primitive_t)(hdr->primitive << 8);
+	mesh->indexType  = hdr->indexType;
+	mesh->attrInfo.flags[0]    = hdr->attrFlags[0];
+	mesh->attrInfo.flags[1]    = hdr->attrFlags[1];
+	mesh->attrInfo.permutation = hdr->attrPermutation[0] | ((u64)hdr->attrPermutation[1] << 32);
+	mesh->attrInfo.attrCount   = hdr->attrCount;
+	mesh->bufInfo.bufCount     = hdr->numBufs;
+
+	for (i = 0; i < hdr->numBufs; i ++)
+	{
+		if (!C3Di_MeshReadData(callback, userdata, &buf, sizeof(buf), insize))
+			return false;
+		if (buf.offset >= hdr->vertexSize)
+			return false;
+		mesh->bufInfo.buffers[i].offset   = buf.offset;
+		mesh->bufInfo.buffers[i].flags[0] = buf.flags[0];
+		mesh->bufInfo.buffers[i].flags[1] = buf.flags[1];
+	}
+
+	size_t pos = sizeof(*hdr) + hdr->numBufs*sizeof(buf);
+	if (hdr->payloadOffset < pos)
+		return false;
+	while (pos < hdr->payloadOffset)
+	{
+		size_t n = hdr->payloadOffset - pos < sizeof(pad) ? hdr->payloadOffset - pos : sizeof(pad);
+		if (!C3Di_MeshReadData(callback, userdata, pad, n, insize))
+			return false;
+		pos += n;
+	}
+	return true;
+}
+
+static void C3Di_MeshSetBase(C3D_Mesh* mesh, void* vertices, u32 vertexSize)
+{
+	mesh->vertices = vertices;
+	mesh->indices = (u8*)vertices + vertexSize;
+	mesh->bufInfo.base_paddr = osConvertVirtToPhys(vertices);
+}
+
+static bool C3Di_MeshImportCommon(C3D_Mesh* mesh, decompressCallback callback, void* userdata, size_t insize)
+{
+	C3D_MeshFileHeader hdr;
+	if (!C3Di_MeshReadHeader(mesh, &hdr, callback, &userdata, &insize))
+		return false;
+
+	void* data = linearAlloc(hdr.vertexSize + hdr.indexSize);
+	if (!data)
+		return false;
+
+	decompressIOVec iov[2];
+	iov[0].data = data;
+	iov[0].size = hdr.vertexSize;
+	iov[1].data = (u8*)data + hdr.vertexSize;
+	iov[1].size = hdr.indexSize;
+	if (!decompressV(iov, 2, callback, userdata, insize))
+	{
+		linearFree(data);
+		return false;
+	}
+
+	C3Di_MeshSetBase(mesh, data, hdr.vertexSize);
+	mesh->ownsBuf = true;
+	C3D_FlushMarkRange(data, hdr.vertexSize + hdr.indexSize);
+	return true;
+}
+
+bool C3D_MeshImport(C3D_Mesh* mesh, const void* input, size_t insize)
+{
+	return C3Di_MeshImportCommon(mesh, NULL, (void*)input, insize);
+}
+
+bool C3D_MeshImportCallback(C3D_Mesh* mesh, decompressCallback callback, void* userdata)
+{
+	return C3Di_MeshImportCommon(mesh, callback, userdata, 0);
+}
+
+bool C3D_MeshImportFD(C3D_Mesh* mesh, int fd)
+{
+	return C3Di_MeshImportCommon(mesh, decompressCallback_FD, &fd, 0);
+}
+
+bool C3D_MeshImportStdio(C3D_Mesh* mesh, FILE* fp)
+{
+	return C3Di_MeshImportCommon(mesh, decompressCallback_Stdio, fp, 0);
+}
+
+bool C3D_MeshMap(C3D_Mesh* mesh, const void* input, size_t insize)
+{
+	C3D_MeshFileHeader hdr;
+	void* in = (void*)input;
+	if (!C3Di_MeshReadHeader(mesh, &hdr, NULL, &in, &insize))
+		return false;
+
+	// Uncompressed decompress() stream: type 0 and the size in the upper 24 bits, or in the
+	// following word if those are zero
+	const u8* p = (const u8*)in;
+	if (insize < 4 || p[0] != 0)
+		return false;
+	u32 size = p[1] | (p[2] << 8) | (p[3] << 16);
+	u32 hdrSize = 4;
+	if (!size)
+	{
+		if (insize < 8)
+			return false;
+		size = p[4] | (p[5] << 8) | (p[6] << 16) | ((u32)p[7] << 24);
+		hdrSize = 8;
+	}
+
+	u8* data = (u8*)in + hdrSize;
+	if (size < hdr.vertexSize + hdr.indexSize || insize - hdrSize < hdr.vertexSize + hdr.indexSize)
+		return false;
+	if (((u32)data & 0xF) || !osConvertVirtToPhys(data))
+		return false;
+
+	C3Di_MeshSetBase(mesh, data, hdr.vertexSize);
+	mesh->ownsBuf = false;
+	GSPGPU_FlushDataCache(data, hdr.vertexSize + hdr.indexSize);
+	return true;
+}
+
+void C3D_MeshFree(C3D_Mesh* mesh)
+{
+	if (mesh->ownsBuf)
+		linearFree(mesh->vertices);
+	memset(mesh, 0, sizeof(*mesh));
+}
+
+void C3D_MeshDraw(C3D_Mesh* mesh)
+{
+	C3D_MeshBind(mesh);
+	C3D_DrawElements(mesh->primitive, mesh->numIndices, mesh->indexType, mesh->indices);
+}
@@ -0,0 +1,272 @@
+#include <stdlib.h>
+#include <string.h>
+#include <c3d/meshopt.h>
+
+typedef struct
+{
+	u32* adjOffset; // numVerts+1, triangles using each vertex
+	u32* adj;
+	u32* live;      // Triangles not yet emitted per vertex
+	u32* cacheTime;
+	u32* deadEnd;
+	u32* cand;
+	u8*  emitted;
+	size_t numDeadEnd;
+	size_t cursor;
+} C3Di_Tipsify;
+
+static int C3Di_TipsifySkipDeadEnd(C3Di_Tipsify* t, size_t numVerts)
+{
+	while (t->numDeadEnd)
+	{
+		u32 v = t->deadEnd[--t->numDeadEnd];
+		if (t->live[v])
+			return v;
+	}
+	for (; t->cursor < numVerts; t->cursor ++)
+		if (t->live[t->cursor])
+			return t->cursor;
+	return -1;
+}
+
+// Prefers the candidate that stays in the cache the longest once its remaining triangles are done
+static int C3Di_TipsifyNext(C3Di_Tipsify* t, size_t numCand, u32 time, u32 cacheSize, size_t numVerts)
+{
+	int best = -1, bestPrio = -1;
+	size_t i;
+
+	for (i = 0; i < numCand; i ++)
+	{
+		u32 v = t->cand[i];
+		if (!t->live[v])
+			continue;
+
+		int prio = 0;
+		if (time - t->cacheTime[v] + 2*t->live[v] <= cacheSize)
+			prio = time - t->cacheTime[v];
+		if (prio > bestPrio)
+		{
+			bestPrio = prio;
+			best = v;
+		}
+	}
+
+	if (best < 0)
+		best = C3Di_TipsifySkipDeadEnd(t, numVerts);
+	return best;
+}
+
+bool C3D_IndexOptimizeCache(u16* dst, const u16* src, size_t numIndices, size_t numVerts, u32 cacheSize)
+{
+	size_t numTris = numIndices / 3;
+	size_t i, out = 0;
+
+	if (!numTris || !numVerts)
+		return true;
+	if (!cacheSize)
+		cacheSize = C3D_VTXCACHE_SIZE;
+
+	C3Di_Tipsify t;
+	size_t words = (numVerts+1) + numTris*3 + numVerts*2 + numTris*3*2;
+	u32* mem = (u32*)malloc(words*sizeof(u32) + numTris + numTris*3*sizeof(u16));
+	if (!mem)
+		return false;
+
+	t.adjOffset = mem;
+	t.adj       = t.adjOffset + numVerts+1;
+	t.live      = t.adj + numTris*3;
+	t.cacheTime = t.live + numVerts;
+	t.deadEnd   = t.cacheTime + numVerts;
+	t.cand      = t.deadEnd + numTris*3;
+	u16* tris   = (u16*)(t.cand + numTris*3);
+	t.emitted   = (u8*)(tris + numTris*3);
+	t.numDeadEnd = 0;
+	t.cursor = 0;
+
+	// dst may overlap src
+	memcpy(tris, src, numTris*3*sizeof(u16));
+	memset(t.live, 0, numVerts*sizeof(u32));
+	memset(t.cacheTime, 0, numVerts*sizeof(u32));
+	memset(t.emitted, 0, numTris);
+
+	for (i = 0; i < numTris*3; i ++)
+		t.live[tris[i]] ++;
+	t.adjOffset[0] = 0;
+	for (i = 0; i < numVerts; i ++)
+		t.adjOffset[i+1] = t.adjOffset[i] + t.live[i];
+	for (i = 0; i < numVerts; i ++)
+		t.cacheTime[i] = t.adjOffset[i]; // Used as fill cursors for now
+	for (i = 0; i < numTris*3; i ++)
+		t.adj[t.cacheTime[tris[i]]++] = i/3;
+	memset(t.cacheTime, 0, numVerts*sizeof(u32));
+
+	u32 time = cacheSize+1;
+	int fan = tris[0];
+	while (fan >= 0)
+	{
+		size_t numCand = 0;
+		u32 a;
+		for (a = t.adjOffset[fan]; a < t.adjOffset[fan+1]; a ++)
+		{
+			u32 tri = t.adj[a];
+			if (t.emitted[tri])
+				continue;
+			t.emitted[tri] = 1;
+
+			for (i = 0; i < 3; i ++)
+			{
+				u32 v = tris[tri*3+i];
+				dst[out++] = v;
+				t.deadEnd[t.numDeadEnd++] = v;
+				t.cand[numCand++] = v;
+				t.live[v] --;
+				if (time - t.cacheTime[v] > cacheSize)
+					t.cacheTime[v] = time++;
+			}
+		}
+		fan = C3Di_TipsifyNext(&t, numCand, time, cacheSize, numVerts);
+	}
+
+	free(mem);
+	return true;
+}
+
+float C3D_IndexACMR(const u16* indices, size_t numIndices, u32 cacheSize)
+{
+	u16 fifo[64];
+	size_t i, misses = 0;
+	u32 j, head = 0, used = 0;
+
+	if (numIndices < 3)
+		return 0.0f;
+	if (!cacheSize)
+		cacheSize = C3D_VTXCACHE_SIZE;
+	if (cacheSize > 64)
+		cacheSize = 64;
+
+	for (i = 0; i < numIndices; i ++)
+	{
+		for (j = 0; j < used && fifo[j] != indices[i]; j ++);
+		if (j < used)
+			continue;
+
+		misses ++;
+		if (used < cacheSize)
+			fifo[used++] = indices[i];
+		else
+		{
+			fifo[head] = indices[i];
+			head = (head+1) % cacheSize;
+		}
+	}
+	return (float)misses / (numIndices/3);
+}
+
+size_t C3D_VertexFetchOptimize(void* dstVerts, u16* indices, size_t numIndices, const void* srcVerts, size_t numVerts, size_t stride)
+{
+	size_t i, next = 0;
+	u16* remap = (u16*)malloc(numVerts*sizeof(u16));
+	if (!remap)
+		return 0;
+
+	memset(remap, 0xFF, numVerts*sizeof(u16));
+	for (i = 0; i < numIndices; i ++)
+	{
+		u16 v = indices[i];
+		if (remap[v] == 0xFFFF)
+		{
+			memcpy((u8*)dstVerts + next*stride, (const u8*)srcVerts + v*stride, stride);
+			remap[v] = next++;
+		}
+		indices[i] = remap[v];
+	}
+
+	free(remap);
+	return next;
+}
+
+// Returns which rotation of tri continues the strip ending in dst[n-2], dst[n-1], or -1.
+// Triangle k of a strip is (s[k], s[k+1], s[k+2]) when k is even and (s[k+1], s[k], s[k+2]) when
+// odd, so one of the rotations has to start with the last edge in that order.
+static int C3Di_StripContinues(const u16* dst, size_t n, const u16* tri)
+{
+	u16 a = dst[n-2], b = dst[n-1];
+	bool odd = (n-2) & 1;
+	int r;
+	for (r = 0; r < 3; r ++)
+	{
+		u16 x = tri[r], y = tri[(r+1)%3];
+		if (odd ? (x == b && y == a) : (x == a && y == b))
+			return r;
+	}
+	return -1;
+}
+
+#define C3Di_STRIP_WINDOW 16
+
+size_t C3D_IndexToStrip(u16* dst, const u16* src, size_t numIndices)
+{
+	const u16* window[C3Di_STRIP_WINDOW];
+	size_t next = 0, n = 0;
+	int i, r, count = 0;
+
+	for (;;)
+	{
+		// The next few triangles of the list are candidates for continuing the strip
+		while (count < C3Di_STRIP_WINDOW && next+2 < numIndices)
+		{
+			window[count++] = &src[next];
+			next += 3;
+		}
+		if (!count)
+			break;
+
+		const u16* tri = window[0];
+		i = 0;
+		r = -1;
+		if (n >= 3)
+		{
+			for (i = 0; i < count; i ++)
+				if ((r = C3Di_StripContinues(dst, n, window[i])) >= 0)
+					break;
+			if (r < 0)
+				i = 0;
+			tri = window[i];
+		}
+		memmove(&window[i], &window[i+1], (count-i-1)*sizeof(window[0]));
+		count --;
+
+		if (r >= 0)
+		{
+			dst[n++] = tri[(r+2)%3];
+			continue;
+		}
+
+		if (!n)
+		{
+			dst[n++] = tri[0];
+			dst[n++] = tri[1];
+			dst[n++] = tri[2];
+			continue;
+		}
+
+		// Degenerate join b, b, x, x, y, z, the new triangle has to start at an even position
+		// right after a repeat of its first vertex. When it contains b, starting the triangle
+		// there makes b the repeated vertex.
+		u16 b = dst[n-1];
+		for (r = 0; r < 3 && tri[r] != b; r ++);
+		if (r == 3)
+		{
+			r = 0;
+			dst[n++] = b;
+		}
+		if (dst[n-1] != tri[r])
+			dst[n++] = tri[r];
+		if (n & 1)
+			dst[n++] = tri[r];
+		dst[n++] = tri[r];
+		dst[n++] = tri[(r+1)%3];
+		dst[n++] = tri[(r+2)%3];
+	}
+	return n;
+}
@@ -0,0 +1,222 @@
+#include "mipmap.h"
+
+void C3Di_MipRGBA8(void* dst, const void* const src[4])
+{
+	u32 i, j;
+	u32* d = (u32*)dst;
+	for (i = 0; i < 64; i ++)
+	{
+		const u32* a = (const u32*)src[i>>4] + (i<<2 & 0x3F);
+		u32 dest = 0;
+		for (j = 0; j < 32; j += 8)
+		{
+			u32 val = (((a[0]>>j)&0xFF)+((a[1]>>j)&0xFF)+((a[2]>>j)&0xFF)+((a[3]>>j)&0xFF))>>2;
+			dest |= val<<j;
+		}
+		*d++ = dest;
+	}
+}
+
+void C3Di_MipRGB8(void* dst, const void* const src[4])
+{
+	u32 i, j;
+	u8* d = (u8*)dst;
+	for (i = 0; i < 64; i ++)
+	{
+		const u8* a = (const u8*)src[i>>4] + 3*(i<<2 & 0x3F);
+		for (j = 0; j < 3; j ++)
+		{
+			*d++ = ((u32)a[0] + a[3] + a[6] + a[9])>>2;
+			a++;
+		}
+	}
+}
+
+// Averages one bit field of four packed pixels
+static inline u32 avgField(const u16* a, u32 shift, u32 bits)
+{
+	u32 mask = (1U << bits) - 1;
+	u32 sum = ((a[0]>>shift)&mask) + ((a[1]>>shift)&mask) + ((a[2]>>shift)&mask) + ((a[3]>>shift)&mask);
+	return ((sum + 2) >> 2) << shift;
+}
+
+#define MIP_KERNEL16(_name, _fields) \
+	void _name(void* dst, const void* const src[4]) \
+	{ \
+		u32 i; \
+		u16* d = (u16*)dst; \
+		for (i = 0; i < 64; i ++) \
+		{ \
+			const u16* a = (const u16*)src[i>>4] + (i<<2 & 0x3F); \
+			*d++ = _fields; \
+		} \
+	}
+
+MIP_KERNEL16(C3Di_MipRGBA5551, avgField(a,11,5) | avgField(a,6,5) | avgField(a,1,5) | avgField(a,0,1))
+MIP_KERNEL16(C3Di_MipRGB565,   avgField(a,11,5) | avgField(a,5,6) | avgField(a,0,5))
+MIP_KERNEL16(C3Di_MipRGBA4,    avgField(a,12,4) | avgField(a,8,4) | avgField(a,4,4) | avgField(a,0,4))
+MIP_KERNEL16(C3Di_MipLA8,      avgField(a,8,8)  | avgField(a,0,8))
+
+void C3Di_MipL8(void* dst, const void* const src[4])
+{
+	u32 i;
+	u8* d = (u8*)dst;
+	for (i = 0; i < 64; i ++)
+	{
+		const u8* a = (const u8*)src[i>>4] + (i<<2 & 0x3F);
+		*d++ = ((u32)a[0] + a[1] + a[2] + a[3] + 2)>>2;
+	}
+}
+
+void C3Di_MipLA4(void* dst, const void* const src[4])
+{
+	u32 i;
+	u8* d = (u8*)dst;
+	for (i = 0; i < 64; i ++)
+	{
+		const u8* a = (const u8*)src[i>>4] + (i<<2 & 0x3F);
+		u32 hi = (a[0]>>4) + (a[1]>>4) + (a[2]>>4) + (a[3]>>4);
+		u32 lo = (a[0]&0xF) + (a[1]&0xF) + (a[2]&0xF) + (a[3]&0xF);
+		*d++ = (((hi + 2) >> 2) << 4) | ((lo + 2) >> 2);
+	}
+}
+
+void C3Di_MipL4(void* dst, const void* const src[4])
+{
+	// Two pixels per byte, so the four inputs of an output pixel are two bytes
+	u32 i;
+	u8* d = (u8*)dst;
+	for (i = 0; i < 64; i += 2)
+	{
+		const u8* a = (const u8*)src[i>>4] + ((i<<1) & 0x1F);
+		u32 p0 = ((a[0]&0xF) + (a[0]>>4) + (a[1]&0xF) + (a[1]>>4) + 2) >> 2;
+		u32 p1 = ((a[2]&0xF) + (a[2]>>4) + (a[3]&0xF) + (a[3]>>4) + 2) >> 2;
+		*d++ = p0 | (p1 << 4);
+	}
+}
+
+// Packed averaging of every field in a word: the low bit of each field is dropped before the
+// shift so that nothing spills over into the field below. With the ARMv6 media instructions
+// UHADD8 does this for bytes in a single instruction.
+static inline u32 havg(u32 a, u32 b, u32 keep)
+{
+	return (a & b) + (((a ^ b) & keep) >> 1);
+}
+
+static inline u32 havg8(u32 a, u32 b)
+{
+#if defined(__ARM_FEATURE_SIMD32) || (defined(__ARM_ARCH_6K__) && !defined(__thumb__))
+	u32 r;
+	__asm__("uhadd8 %0, %1, %2" : "=r"(r) : "r"(a), "r"(b));
+	return r;
+#else
+	return havg(a, b, 0xFEFEFEFE);
+#endif
+}
+
+void C3Di_MipRGBA8_SIMD(void* dst, const void* const src[4])
+{
+	u32 i;
+	u32* d = (u32*)dst;
+	for (i = 0; i < 64; i ++)
+	{
+		const u32* a = (const u32*)src[i>>4] + (i<<2 & 0x3F);
+		*d++ = havg8(havg8(a[0], a[1]), havg8(a[2], a[3]));
+	}
+}
+
+void C3Di_MipRGB8_SIMD(void* dst, const void* const src[4])
+{
+	// Four pixels are three words; realign them so the channels of all four share lanes 0-2
+	u32 i;
+	u32* d = (u32*)dst;
+	for (i = 0; i < 64; i += 4)
+	{
+		u32 r[4], k;
+		for (k = 0; k < 4; k ++)
+		{
+			const u32* w = (const u32*)((const u8*)src[i>>4] + 3*((i+k)<<2 & 0x3F));
+			u32 p0 = w[0];
+			u32 p1 = (w[0] >> 24) | (w[1] << 8);
+			u32 p2 = (w[1] >> 16) | (w[2] << 16);
+			u32 p3 = w[2] >> 8;
+			r[k] = havg8(havg8(p0, p1), havg8(p2, p3)) & 0xFFFFFF;
+		}
+		*d++ = r[0] | (r[1] << 24);
+		*d++ = (r[1] >> 8) | (r[2] << 16);
+		*d++ = (r[2] >> 16) | (r[3] << 8);
+	}
+}
+
+// Two 16-bit pixels per word, two output pixels per iteration
+#define MIP_KERNEL16_SIMD(_name, _keep, _avg) \
+	void _name(void* dst, const void* const src[4]) \
+	{ \
+		u32 i; \
+		u32* d = (u32*)dst; \
+		for (i = 0; i < 64; i += 2) \
+		{ \
+			const u32* w = (const u32*)src[i>>4] + ((i<<1) & 0x1F); \
+			u32 h01 = _avg(w[0], w[1], _keep); \
+			u32 h23 = _avg(w[2], w[3], _keep); \
+			u32 lo = (h01 & 0xFFFF) | (h23 << 16); \
+			u32 hi = (h01 >> 16) | (h23 & 0xFFFF0000); \
+			*d++ = _avg(lo, hi, _keep); \
+		} \
+	}
+
+#define AVG16(_a, _b, _keep) havg(_a, _b, _keep)
+#define AVG8(_a, _b, _keep)  havg8(_a, _b)
+
+MIP_KERNEL16_SIMD(C3Di_MipRGBA5551_SIMD, 0xF7BCF7BC, AVG16)
+MIP_KERNEL16_SIMD(C3Di_MipRGB565_SIMD,   0xF7DEF7DE, AVG16)
+MIP_KERNEL16_SIMD(C3Di_MipRGBA4_SIMD,    0xEEEEEEEE, AVG16)
+MIP_KERNEL16_SIMD(C3Di_MipLA8_SIMD,      0,          AVG8)
+
+void C3Di_MipL8_SIMD(void* dst, const void* const src[4])
+{
+	u32 i;
+	u32* d = (u32*)dst;
+	for (i = 0; i < 64; i += 4)
+	{
+		const u32* w = (const u32*)src[i>>4] + (i & 0xF);
+		u32 out = 0, k;
+		for (k = 0; k < 4; k ++)
+		{
+			u32 t = havg8(w[k], w[k] >> 8);
+			out |= (havg8(t, t >> 16) & 0xFF) << (8*k);
+		}
+		*d++ = out;
+	}
+}
+
+void C3Di_MipLA4_SIMD(void* dst, const void* const src[4])
+{
+	u32 i;
+	u32* d = (u32*)dst;
+	for (i = 0; i < 64; i += 4)
+	{
+		const u32* w = (const u32*)src[i>>4] + (i & 0xF);
+		u32 out = 0, k;
+		for (k = 0; k < 4; k ++)
+		{
+			u32 t = havg(w[k], w[k] >> 8, 0xEEEEEEEE);
+			out |= (havg(t, t >> 16, 0xEEEEEEEE) & 0xFF) << (8*k);
+		}
+		*d++ = out;
+	}
+}
+
+void C3Di_MipL4_SIMD(void* dst, const void* const src[4])
+{
+	// Eight pixels per word make two output pixels
+	u32 i;
+	u8* d = (u8*)dst;
+	for (i = 0; i < 64; i += 2)
+	{
+		u32 w = *((const u32*)src[i>>4] + ((i>>1) & 0x7));
+		u32 t = havg(w, w >> 4, 0xEEEEEEEE);
+		u32 u = havg(t, t >> 8, 0xEEEEEEEE);
+		*d++ = (u & 0xF) | ((u >> 12) & 0xF0);
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <c3d/types.h>
+
+// Downscaling kernels for C3D_TexGenerateMipmap. Each one averages the four tiled 8x8 blocks
+// covering a 16x16 area of a level into the 8x8 block of the next level. In Morton order the
+// 2x2 pixels that make up one output pixel are consecutive, and every source block feeds
+// one quadrant of the output block.
+typedef void (* C3Di_MipKernel)(void* dst, const void* const src[4]);
+
+void C3Di_MipRGBA8(void* dst, const void* const src[4]);
+void C3Di_MipRGB8(void* dst, const void* const src[4]);
+void C3Di_MipRGBA5551(void* dst, const void* const src[4]);
+void C3Di_MipRGB565(void* dst, const void* const src[4]);
+void C3Di_MipRGBA4(void* dst, const void* const src[4]);
+void C3Di_MipLA8(void* dst, const void* const src[4]); // Also HILO8
+void C3Di_MipL8(void* dst, const void* const src[4]);  // Also A8
+void C3Di_MipLA4(void* dst, const void* const src[4]);
+void C3Di_MipL4(void* dst, const void* const src[4]);  // Also A4
+
+// Same results within one step per channel, several channels per operation. On ARMv6 these use
+// the media instructions; elsewhere they fall back to plain packed integer arithmetic.
+void C3Di_MipRGBA8_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipRGB8_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipRGBA5551_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipRGB565_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipRGBA4_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipLA8_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipL8_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipLA4_SIMD(void* dst, const void* const src[4]);
+void C3Di_MipL4_SIMD(void* dst, const void* const src[4]);
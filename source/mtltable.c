@@ -0,0 +1,77 @@
+#include "internal.h"
+#include <stdlib.h>
+
+bool C3D_MaterialTableInit(C3D_MaterialTable* table, C3D_LightEnv* env, const C3D_Material* materials, int count)
+{
+	memset(table, 0, sizeof(*table));
+	if (count < 1)
+		return false;
+
+	table->ambient = (u32*)malloc(count*(sizeof(u32) + 8*sizeof(C3D_LightMatConf)));
+	if (!table->ambient)
+		return false;
+
+	table->conf = (C3D_LightMatConf*)(table->ambient + count);
+	table->env = env;
+	table->materials = materials;
+	table->count = count;
+	return true;
+}
+
+void C3D_MaterialTableDelete(C3D_MaterialTable* table)
+{
+	free(table->ambient);
+	memset(table, 0, sizeof(*table));
+}
+
+static void C3Di_MaterialTableBuild(C3D_MaterialTable* table)
+{
+	C3D_LightEnv* env = table->env;
+	int i, j;
+
+	for (i = 0; i < table->count; i ++)
+	{
+		const C3D_Material* mtl = &table->materials[i];
+		C3D_LightMatConf* conf = &table->conf[i*8];
+
+		table->ambient[i] = C3Di_LightEnvMtlAmbient(env, mtl);
+		for (j = 0; j < 8; j ++)
+		{
+			C3D_Light* light = env->lights[j];
+			if (light)
+				C3Di_LightMtlConf(&conf[j], mtl, light);
+			else
+				memset(&conf[j], 0, sizeof(conf[j]));
+		}
+	}
+
+	table->gen = env->colorGen;
+	table->valid = true;
+}
+
+void C3D_MaterialTableApply(C3D_MaterialTable* table, int id)
+{
+	C3D_LightEnv* env = table->env;
+	int i;
+
+	if (id < 0 || id >= table->count)
+		return;
+
+	if (!table->valid || table->gen != env->colorGen)
+		C3Di_MaterialTableBuild(table);
+
+	// Keep the env consistent so that later blends start from this material
+	memcpy(&env->material, &table->materials[id], sizeof(env->material));
+	env->conf.ambient = table->ambient[id];
+	env->flags = (env->flags &~ C3DF_LightEnv_MtlDirty) | C3DF_LightEnv_Dirty;
+
+	const C3D_LightMatConf* conf = &table->conf[id*8];
+	for (i = 0; i < 8; i ++)
+	{
+		C3D_Light* light = env->lights[i];
+		if (!light) continue;
+
+		light->conf.material = conf[i];
+		light->flags = (light->flags &~ C3DF_Light_MatDirty) | C3DF_Light_ColorDirty;
+	}
+}
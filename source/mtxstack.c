@@ -1,3 +1,4 @@
+#include <stdlib.h>
 #include <c3d/mtxstack.h>
 #include <c3d/uniforms.h>
 
@@ -41,3 +42,97 @@ void MtxStack_Update(C3D_MtxStack* stk)
 
 	stk->isDirty = false;
 }
+
+bool MtxStackEx_Init(C3D_MtxStackEx* stk, int depth)
+{
+	if (depth < 1)
+		return false;
+
+	C3D_MtxStackLevel* levels = (C3D_MtxStackLevel*)malloc(depth*sizeof(C3D_MtxStackLevel));
+	if (!levels)
+		return false;
+
+	MtxStackEx_InitWithBuffer(stk, levels, depth);
+	stk->ownsBuf = true;
+	return true;
+}
+
+void MtxStackEx_InitWithBuffer(C3D_MtxStackEx* stk, C3D_MtxStackLevel* levels, int depth)
+{
+	stk->levels = levels;
+	stk->depth = depth;
+	stk->pos = 0;
+	stk->gen = 1;
+	stk->unifPos = 0xFF;
+	stk->isDirty = true;
+	stk->ownsBuf = false;
+	Mtx_Identity(&stk->prefix);
+	Mtx_Identity(MtxStackEx_Cur(stk));
+}
+
+void MtxStackEx_Free(C3D_MtxStackEx* stk)
+{
+	if (stk->ownsBuf)
+		free(stk->levels);
+	stk->levels = NULL;
+	stk->depth = 0;
+}
+
+void MtxStackEx_Bind(C3D_MtxStackEx* stk, GPU_SHADER_TYPE unifType, int unifPos, int unifLen)
+{
+	stk->unifType = unifType;
+	stk->unifPos = unifPos;
+	stk->unifLen = unifLen;
+	stk->isDirty = true;
+}
+
+void MtxStackEx_SetPrefix(C3D_MtxStackEx* stk, const C3D_Mtx* prefix)
+{
+	if (prefix)
+		Mtx_Copy(&stk->prefix, prefix);
+	else
+		Mtx_Identity(&stk->prefix);
+
+	// Invalidates the cached products of every level at once
+	stk->gen ++;
+	stk->isDirty = true;
+}
+
+C3D_Mtx* MtxStackEx_Push(C3D_MtxStackEx* stk)
+{
+	if (stk->pos == stk->depth-1) return NULL;
+	stk->pos ++;
+	Mtx_Copy(&stk->levels[stk->pos].m, &stk->levels[stk->pos-1].m);
+	return MtxStackEx_Cur(stk);
+}
+
+const C3D_Mtx* MtxStackEx_Pop(C3D_MtxStackEx* stk)
+{
+	if (stk->pos == 0) return NULL;
+	stk->pos --;
+
+	// The level below keeps its cached product, modify it through MtxStackEx_Cur
+	stk->isDirty = true;
+	return &stk->levels[stk->pos].m;
+}
+
+const C3D_Mtx* MtxStackEx_Combined(C3D_MtxStackEx* stk)
+{
+	C3D_MtxStackLevel* lvl = &stk->levels[stk->pos];
+	if (lvl->combinedGen != stk->gen)
+	{
+		Mtx_Multiply(&lvl->combined, &stk->prefix, &lvl->m);
+		lvl->combinedGen = stk->gen;
+	}
+	return &lvl->combined;
+}
+
+void MtxStackEx_Update(C3D_MtxStackEx* stk)
+{
+	if (!stk->isDirty) return;
+
+	if (stk->unifPos != 0xFF)
+		C3D_FVUnifMtxNx4Update(stk->unifType, stk->unifPos, MtxStackEx_Combined(stk), stk->unifLen);
+
+	stk->isDirty = false;
+}
@@ -0,0 +1,79 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/particle.h>
+
+bool C3D_ParticleEmitterInit(C3D_ParticleEmitter* e, C3D_Tex* tex, u32 capacity)
+{
+	if (!capacity)
+		return false;
+
+	C3D_Particle* particles = (C3D_Particle*)malloc(capacity*sizeof(C3D_Particle));
+	if (!particles)
+		return false;
+	C3D_ParticleEmitterInitWithBuffer(e, tex, particles, capacity);
+	e->ownsBuf = true;
+	return true;
+}
+
+bool C3D_ParticleEmitterInitWithBuffer(C3D_ParticleEmitter* e, C3D_Tex* tex, C3D_Particle* particles, u32 capacity)
+{
+	memset(e, 0, sizeof(*e));
+	if (!capacity)
+		return false;
+
+	e->tex = tex;
+	e->particles = particles;
+	e->capacity = capacity;
+	e->scale = 1.0f;
+	return true;
+}
+
+void C3D_ParticleEmitterDelete(C3D_ParticleEmitter* e)
+{
+	if (e->ownsBuf)
+		free(e->particles);
+	memset(e, 0, sizeof(*e));
+}
+
+C3D_Particle* C3D_ParticleEmit(C3D_ParticleEmitter* e)
+{
+	u32 i = e->first + e->count;
+	if (e->count == e->capacity)
+	{
+		// Replace the oldest one
+		e->first = (e->first + 1) % e->capacity;
+		e->count --;
+	}
+	e->count ++;
+
+	C3D_Particle* p = &e->particles[i % e->capacity];
+	memset(p, 0, sizeof(*p));
+	p->color[0] = p->color[1] = 0xFFFFFFFF;
+	e->verts = NULL;
+	return p;
+}
+
+void C3D_ParticleEmitterUpdate(C3D_ParticleEmitter* e, float dt)
+{
+	u32 i;
+	for (i = 0; i < e->count; i ++)
+	{
+		C3D_Particle* p = &e->particles[(e->first + i) % e->capacity];
+		p->age += dt;
+		p->angle += p->spin*dt;
+		p->vel[0] += e->gravity[0]*dt;
+		p->vel[1] += e->gravity[1]*dt;
+		p->vel[2] += e->gravity[2]*dt;
+		p->pos[0] += p->vel[0]*dt;
+		p->pos[1] += p->vel[1]*dt;
+		p->pos[2] += p->vel[2]*dt;
+	}
+
+	// Older particles usually die first; the others are skipped when drawing until they do
+	while (e->count && e->particles[e->first].age >= e->particles[e->first].life)
+	{
+		e->first = (e->first + 1) % e->capacity;
+		e->count --;
+	}
+	e->verts = NULL;
+}
@@ -0,0 +1,111 @@
+#include "internal.h"
+#include <c3d/base.h>
+#include <c3d/particle.h>
+#include "particle_shbin.h"
+
+static inline u32 lerpColor(u32 a, u32 b, float t)
+{
+	u32 out = 0;
+	int i;
+	for (i = 0; i < 32; i += 8)
+	{
+		float ca = (a >> i) & 0xFF, cb = (b >> i) & 0xFF;
+		out |= (u32)(ca + (cb-ca)*t + 0.5f) << i;
+	}
+	return out;
+}
+
+bool C3D_ParticleRendererInit(C3D_ParticleRenderer* r, C3D_StreamBuf* stream)
+{
+	memset(r, 0, sizeof(*r));
+	r->dvlb = DVLB_ParseFile((u32*)particle_shbin, particle_shbin_size);
+	if (!r->dvlb)
+		return false;
+
+	// Each point hands the three vertex shader outputs to the geometry shader
+	shaderProgramInit(&r->program);
+	shaderProgramSetVsh(&r->program, &r->dvlb->DVLE[0]);
+	shaderProgramSetGsh(&r->program, &r->dvlb->DVLE[1], 3);
+
+	r->stream = stream;
+	r->modelViewLoc  = shaderInstanceGetUniformLocation(r->program.vertexShader, "modelView");
+	r->spinLoc       = shaderInstanceGetUniformLocation(r->program.vertexShader, "spin");
+	r->projectionLoc = shaderInstanceGetUniformLocation(r->program.geometryShader, "projection");
+	return true;
+}
+
+void C3D_ParticleRendererDelete(C3D_ParticleRenderer* r)
+{
+	if (r->dvlb)
+	{
+		shaderProgramFree(&r->program);
+		DVLB_Free(r->dvlb);
+	}
+	memset(r, 0, sizeof(*r));
+}
+
+void C3D_ParticleRendererBegin(C3D_ParticleRenderer* r, const C3D_Mtx* projection, const C3D_Mtx* modelView)
+{
+	C3D_BindProgram(&r->program);
+	C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, r->modelViewLoc, modelView);
+	C3D_FVUnifMtx4x4(GPU_GEOMETRY_SHADER, r->projectionLoc, projection);
+
+	C3D_AttrInfo* attrInfo = C3D_GetAttrInfo();
+	AttrInfo_Init(attrInfo);
+	AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3);
+	AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 2);
+	AttrInfo_AddLoader(attrInfo, 2, GPU_UNSIGNED_BYTE, 4);
+}
+
+static bool C3Di_ParticleUpload(C3D_ParticleRenderer* r, C3D_ParticleEmitter* e)
+{
+	C3D_ParticleVertex* v = (C3D_ParticleVertex*)C3D_StreamBufAlloc(r->stream, e->count*sizeof(C3D_ParticleVertex), 8);
+	if (!v)
+		return false;
+
+	u32 i, n = 0;
+	for (i = 0; i < e->count; i ++)
+	{
+		const C3D_Particle* p = &e->particles[(e->first + i) % e->capacity];
+		if (p->age >= p->life)
+			continue;
+
+		float t = p->life > 0.0f ? p->age / p->life : 0.0f;
+		float size = p->size[0] + (p->size[1]-p->size[0])*t;
+		C3D_ParticleVertex* out = &v[n++];
+		out->pos[0] = p->pos[0];
+		out->pos[1] = p->pos[1];
+		out->pos[2] = p->pos[2];
+		out->axis[0] = size*cosf(p->angle);
+		out->axis[1] = size*sinf(p->angle);
+		out->color = lerpColor(p->color[0], p->color[1], t);
+	}
+
+	e->verts = v;
+	e->numVerts = n;
+	e->vertsStream = r->stream;
+	e->vertsFrame = r->stream->frameId;
+	return true;
+}
+
+bool C3D_ParticleEmitterDraw(C3D_ParticleRenderer* r, C3D_ParticleEmitter* e)
+{
+	if (!e->count)
+		return true;
+	// Vertices from an earlier frame may have been reclaimed by the stream buffer already
+	bool stale = e->vertsStream != r->stream || e->vertsFrame != r->stream->frameId;
+	if ((!e->verts || stale) && !C3Di_ParticleUpload(r, e))
+		return false;
+	if (!e->numVerts)
+		return true;
+
+	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
+	BufInfo_Init(bufInfo);
+	BufInfo_Add(bufInfo, e->verts, sizeof(C3D_ParticleVertex), 3, 0x210);
+
+	C3D_FVUnifSet(GPU_VERTEX_SHADER, r->spinLoc, e->scale*cosf(e->angle), e->scale*sinf(e->angle), 0.0f, 0.0f);
+	if (e->tex)
+		C3D_TexBind(0, e->tex);
+	C3D_DrawArrays(GPU_GEOMETRY_PRIM, 0, e->numVerts);
+	return true;
+}
@@ -0,0 +1,171 @@
+#include "internal.h"
+#include <c3d/passgraph.h>
+
+void C3D_PassGraphInit(C3D_PassGraph* g)
+{
+	memset(g, 0, sizeof(*g));
+}
+
+int C3D_PassGraphAdd(C3D_PassGraph* g, C3D_RenderTarget* target, void (* draw)(void* param), void* param)
+{
+	if (g->numPasses == C3D_PASSGRAPH_MAX_PASSES)
+		return -1;
+
+	int id = g->numPasses++;
+	C3D_RenderPass* p = &g->passes[id];
+	memset(p, 0, sizeof(*p));
+	p->target = target;
+	p->draw = draw;
+	p->param = param;
+	return id;
+}
+
+void C3D_PassGraphClear(C3D_PassGraph* g, int pass, C3D_ClearBits clearBits, u32 clearColor, u32 clearDepth)
+{
+	C3D_RenderPass* p = &g->passes[pass];
+	p->clearBits = clearBits;
+	p->clearColor = clearColor;
+	p->clearDepth = clearDepth;
+}
+
+void C3D_PassGraphDepends(C3D_PassGraph* g, int pass, int before)
+{
+	if (before != pass)
+		g->passes[pass].deps |= 1U << before;
+}
+
+bool C3D_PassGraphReads(C3D_PassGraph* g, int pass, C3D_Tex* tex)
+{
+	C3D_RenderPass* p = &g->passes[pass];
+	if (p->numReads == C3D_PASSGRAPH_MAX_READS)
+		return false;
+	p->reads[p->numReads++] = tex;
+	return true;
+}
+
+static bool C3Di_TargetHoldsTex(C3D_RenderTarget* target, C3D_Tex* tex)
+{
+	u32 fb = (u32)target->frameBuf.colorBuf;
+	u32 size = C3D_TexCalcTotalSize(tex->size, tex->maxLevel);
+	int i, faces = 1;
+	void* const* data = &tex->data;
+
+	if (C3D_TexGetType(tex) == GPU_TEX_CUBE_MAP)
+	{
+		faces = 6;
+		data = tex->cube->data;
+	}
+
+	for (i = 0; i < faces; i ++)
+		if (fb >= (u32)data[i] && fb < (u32)data[i] + size)
+			return true;
+	return false;
+}
+
+// Topological order, preferring to stay on the target of the previous pass and otherwise
+// keeping the declaration order
+static bool C3Di_PassGraphSchedule(C3D_PassGraph* g)
+{
+	u32 deps[C3D_PASSGRAPH_MAX_PASSES];
+	u32 done = 0;
+	C3D_RenderTarget* last = NULL;
+	int i, j, k, n = g->numPasses;
+
+	for (i = 0; i < n; i ++)
+	{
+		C3D_RenderPass* p = &g->passes[i];
+		deps[i] = p->deps;
+		for (k = 0; k < p->numReads; k ++)
+			for (j = 0; j < i; j ++)
+				if (C3Di_TargetHoldsTex(g->passes[j].target, p->reads[k]))
+					deps[i] |= 1U << j;
+	}
+
+	for (k = 0; k < n; k ++)
+	{
+		int pick = -1;
+		for (i = 0; i < n; i ++)
+		{
+			if ((done & (1U << i)) || (deps[i] &~ done))
+				continue;
+			if (pick < 0)
+				pick = i;
+			if (g->passes[i].target == last)
+			{
+				pick = i;
+				break;
+			}
+		}
+		if (pick < 0)
+			return false;
+
+		g->order[k] = pick;
+		done |= 1U << pick;
+		last = g->passes[pick].target;
+	}
+	return true;
+}
+
+bool C3D_PassGraphExecute(C3D_PassGraph* g)
+{
+	C3D_RenderTargetClearOp clears[C3D_PASSGRAPH_MAX_PASSES];
+	C3D_RenderTarget* cur = NULL;
+	int i, j, k, start = 0, n = g->numPasses;
+
+	if (!C3Di_PassGraphSchedule(g))
+		return false;
+
+	while (start < n)
+	{
+		// Gather the clears of the segment; it ends at the first clear of a target that an
+		// earlier pass of the segment already drew on or sampled, since the memory fills run
+		// ahead of the command list
+		int numClears = 0, end;
+		for (end = start; end < n; end ++)
+		{
+			C3D_RenderPass* p = &g->passes[g->order[end]];
+			if (!p->clearBits)
+				continue;
+
+			bool used = false;
+			for (j = start; j < end && !used; j ++)
+			{
+				const C3D_RenderPass* q = &g->passes[g->order[j]];
+				used = q->target == p->target;
+				for (k = 0; k < q->numReads && !used; k ++)
+					used = C3Di_TargetHoldsTex(p->target, q->reads[k]);
+			}
+			if (used)
+				break;
+
+			clears[numClears].target = p->target;
+			clears[numClears].clearBits = p->clearBits;
+			clears[numClears].clearColor = p->clearColor;
+			clears[numClears].clearDepth = p->clearDepth;
+			numClears ++;
+		}
+
+		if (numClears)
+			C3D_RenderTargetClearMany(clears, numClears);
+
+		for (i = start; i < end; i ++)
+		{
+			C3D_RenderPass* p = &g->passes[g->order[i]];
+			if (p->target != cur)
+			{
+				C3D_FrameDrawOn(p->target);
+				cur = p->target;
+			}
+			if (p->draw)
+				p->draw(p->param);
+		}
+
+		start = end;
+		if (start < n)
+		{
+			C3D_FrameSplit(0);
+			cur = NULL;
+		}
+	}
+	return true;
+}
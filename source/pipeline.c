@@ -0,0 +1,146 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/base.h>
+#include <c3d/pipeline.h>
+
+#define PIPELINE_BASE_WORDS 512 // Everything but the constant float uniforms of the shaders
+#define PIPELINE_FVEC_WORDS 8   // Index write plus three data words per float uniform, padded
+#define PIPELINE_GUARD_WORDS 0x102 // Largest single packet: 256 parameters, header and padding
+
+struct C3D_PipelineState
+{
+	shaderProgram_s* program;
+	C3D_AttrInfo attrInfo;
+	C3D_Effect effect;
+	C3D_TexEnv texEnv[6];
+
+	u32* cmds;
+	u32 size; // in words
+	u32 progEnd, attrEnd;
+};
+
+static u32 C3Di_PipelineMaxWords(const shaderProgram_s* program)
+{
+	u32 words = PIPELINE_BASE_WORDS;
+	if (program->vertexShader)
+		words += program->vertexShader->numFloat24Uniforms*PIPELINE_FVEC_WORDS;
+	if (program->geometryShader)
+		words += program->geometryShader->numFloat24Uniforms*PIPELINE_FVEC_WORDS;
+	return words;
+}
+
+C3D_PipelineState* C3D_PipelineStateCreate(void)
+{
+	int i;
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || !ctx->program)
+		return NULL;
+
+	C3D_PipelineState* ps = (C3D_PipelineState*)malloc(sizeof(C3D_PipelineState));
+	if (!ps) return NULL;
+
+	u32 maxWords = C3Di_PipelineMaxWords(ctx->program);
+	u32* scratch = (u32*)malloc((maxWords+PIPELINE_GUARD_WORDS)*4);
+	if (!scratch)
+	{
+		free(ps);
+		return NULL;
+	}
+
+	ps->program = ctx->program;
+	memcpy(&ps->attrInfo, &ctx->attrInfo, sizeof(ps->attrInfo));
+	memcpy(&ps->effect, &ctx->effect, sizeof(ps->effect));
+	memcpy(ps->texEnv, ctx->texEnv, sizeof(ps->texEnv));
+
+	u32 *savedBuf, savedSize, savedOffset;
+	GPUCMD_GetBuffer(&savedBuf, &savedSize, &savedOffset);
+	// GPUCMD_Add silently drops packets that do not fit. Any dropped packet would have started
+	// past maxWords, so recording with a guard behind it and checking the offset catches them.
+	GPUCMD_SetBuffer(scratch, maxWords+PIPELINE_GUARD_WORDS, 0);
+
+	// Encode every register, the shadow copy must not see these writes
+	C3Di_RegCacheInvalidate();
+	shaderProgramConfigure(ps->program, false, false);
+	ps->progEnd = gpuCmdBufOffset;
+	C3Di_AttrInfoBind(&ps->attrInfo);
+	ps->attrEnd = gpuCmdBufOffset;
+	C3Di_EffectBind(&ps->effect);
+	for (i = 0; i < 6; i ++)
+		C3Di_TexEnvBind(i, &ps->texEnv[i]);
+	ps->size = gpuCmdBufOffset;
+	C3Di_RegCacheInvalidate();
+
+	GPUCMD_SetBuffer(savedBuf, savedSize, savedOffset);
+
+	if (ps->size > maxWords)
+	{
+		free(scratch);
+		free(ps);
+		return NULL;
+	}
+
+	ps->cmds = (u32*)realloc(scratch, ps->size*4);
+	if (!ps->cmds)
+		ps->cmds = scratch;
+	return ps;
+}
+
+void C3D_PipelineStateDelete(C3D_PipelineState* ps)
+{
+	if (!ps) return;
+	free(ps->cmds);
+	free(ps);
+}
+
+void C3D_PipelineStateBind(const C3D_PipelineState* ps)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active))
+		return;
+
+	C3D_BindProgram(ps->program);
+	memcpy(&ctx->attrInfo, &ps->attrInfo, sizeof(ctx->attrInfo));
+	memcpy(&ctx->effect, &ps->effect, sizeof(ctx->effect));
+	memcpy(ctx->texEnv, ps->texEnv, sizeof(ctx->texEnv));
+	ctx->flags |= C3DiF_AttrInfo | C3DiF_Effect | C3DiF_TexEnvAll;
+	ctx->effectFlags = C3DiE_All;
+
+	// Without a command buffer, C3Di_UpdateContext encodes the state as usual
+	u32* buf;
+	GPUCMD_GetBuffer(&buf, NULL, NULL);
+	if (!buf)
+		return;
+
+	u32 start;
+	C3Di_CmdBufEnsureSpace(ps->size + C3Di_CmdBufHeadroom(ctx));
+	if ((ctx->flags & C3DiF_Program) && C3Di_ProgramCodeNeeded(ctx, NULL, NULL))
+	{
+		// The shader code is uploaded by C3Di_UpdateContext, which also has to configure
+		// the program and the attributes afterwards
+		start = ps->attrEnd;
+		ctx->flags &= ~(C3DiF_Effect | C3DiF_TexEnvAll);
+	} else if (ctx->flags & C3DiF_Program)
+	{
+		start = 0;
+		ctx->flags &= ~(C3DiF_Program | C3DiF_AttrInfo | C3DiF_Effect | C3DiF_TexEnvAll);
+	} else
+	{
+		start = ps->progEnd;
+		ctx->flags &= ~(C3DiF_AttrInfo | C3DiF_Effect | C3DiF_TexEnvAll);
+	}
+
+	if (!(ctx->flags & C3DiF_Effect))
+		ctx->effectFlags = 0;
+	// The early depth reference recorded with the object belongs to whatever target was bound then
+	if (ps->effect.earlyDepthAuto)
+	{
+		ctx->flags |= C3DiF_Effect;
+		ctx->effectFlags |= C3DiE_EarlyDepth;
+	}
+	GPUCMD_AddRawCommands(ps->cmds + start, ps->size - start);
+	memcpy(ctx->texEnvResident, ps->texEnv, sizeof(ctx->texEnvResident));
+	ctx->texEnvResidentMask = 0x3F;
+	C3Di_RegCacheInvalidate();
+}
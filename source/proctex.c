@@ -141,6 +141,25 @@ void ProcTexColorLut_Write(C3D_ProcTexColorLut* out, const u32* in, int offset,
 	out->diff[offset+width-1] = 0;
 }
 
+// Uploads the span of a LUT between the first and the last entry that differ from the GPU copy
+static void C3Di_ProcTexLutDiff(u32 lutSel, const u32* src, u32* cur, int num, bool resident)
+{
+	int first = 0, last = num-1;
+	if (resident)
+	{
+		for (; first < num && src[first] == cur[first]; first ++);
+		if (first == num)
+			return;
+		for (; last > first && src[last] == cur[last]; last --);
+	}
+
+	num = last-first+1;
+	GPUCMD_AddWrite(GPUREG_PROCTEX_LUT, (lutSel<<8) | first);
+	GPUCMD_AddWrites(GPUREG_PROCTEX_LUT_DATA0, (u32*)src+first, num);
+	memcpy(cur+first, src+first, num*4);
+	C3Di_STAT_ADD(lutUploads, 1);
+}
+
 void C3Di_ProcTexUpdate(C3D_Context* ctx)
 {
 	if (!(ctx->texConfig & BIT(10)))
@@ -161,20 +180,23 @@ void C3Di_ProcTexUpdate(C3D_Context* ctx)
 			if (!(ctx->flags & C3DiF_ProcTexLut(i)) || !ctx->procTexLut[i])
 				continue;
 
-			GPUCMD_AddWrite(GPUREG_PROCTEX_LUT, j<<8);
-			GPUCMD_AddWrites(GPUREG_PROCTEX_LUT_DATA0, *ctx->procTexLut[i], 128);
+			C3Di_ProcTexLutDiff(j, *ctx->procTexLut[i], ctx->procTexLutResident[i], 128, (ctx->procTexResident & BIT(i)) != 0);
+			ctx->procTexResident |= BIT(i);
 		}
 		ctx->flags &= ~C3DiF_ProcTexLutAll;
 	}
 	if (ctx->flags & C3DiF_ProcTexColorLut)
 	{
 		ctx->flags &= ~C3DiF_ProcTexColorLut;
-		if (ctx->procTexColorLut)
+		C3D_ProcTexColorLut* lut = ctx->procTexColorLut;
+		if (lut)
 		{
-			GPUCMD_AddWrite(GPUREG_PROCTEX_LUT, GPU_LUT_COLOR<<8);
-			GPUCMD_AddWrites(GPUREG_PROCTEX_LUT_DATA0, ctx->procTexColorLut->color, 256);
-			GPUCMD_AddWrite(GPUREG_PROCTEX_LUT, GPU_LUT_COLORDIF<<8);
-			GPUCMD_AddWrites(GPUREG_PROCTEX_LUT_DATA0, ctx->procTexColorLut->diff, 256);
+			// Palette animations usually only touch the range given to ProcTexColorLut_Write
+			bool resident = (ctx->procTexResident & BIT(3)) != 0;
+			C3D_ProcTexColorLut* cur = &ctx->procTexColorLutResident;
+			C3Di_ProcTexLutDiff(GPU_LUT_COLOR, lut->color, cur->color, 256, resident);
+			C3Di_ProcTexLutDiff(GPU_LUT_COLORDIF, lut->diff, cur->diff, 256, resident);
+			ctx->procTexResident |= BIT(3);
 		}
 	}
 }
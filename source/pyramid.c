@@ -0,0 +1,86 @@
+#include "internal.h"
+#include <c3d/pyramid.h>
+
+bool C3D_PyramidInit(C3D_Pyramid* p, u16 width, u16 height, GPU_TEXCOLOR fmt, int numLevels)
+{
+	int i;
+	memset(p, 0, sizeof(*p));
+
+	if (C3Di_MipTransferFmt(fmt) < 0 || (width & (width-1)) || (height & (height-1)))
+		return false;
+
+	width >>= 1;
+	height >>= 1;
+	if (numLevels > C3D_PYRAMID_MAX_LEVELS)
+		numLevels = C3D_PYRAMID_MAX_LEVELS;
+	for (i = 0; i < numLevels; i ++)
+		if ((width >> i) < C3Di_MIP_HW_MIN || (height >> i) < C3Di_MIP_HW_MIN)
+			break;
+	numLevels = i;
+	if (!numLevels)
+		return false;
+
+	if (!C3D_TexInitWithParams(&p->tex, NULL,
+		(C3D_TexInitParams){ width, height, (u8)(numLevels-1), fmt, GPU_TEX_2D, true }))
+		return false;
+	C3D_TexSetFilter(&p->tex, GPU_LINEAR, GPU_LINEAR);
+	C3D_TexSetWrap(&p->tex, GPU_CLAMP_TO_EDGE, GPU_CLAMP_TO_EDGE);
+
+	// The views share the storage of the chain, one level each
+	u8* data = (u8*)p->tex.data;
+	u32 size = p->tex.size;
+	for (i = 0; i < numLevels; i ++)
+	{
+		C3D_Tex* level = &p->levels[i];
+		*level = p->tex;
+		level->data = data;
+		level->size = size;
+		level->width = width >> i;
+		level->height = height >> i;
+		level->maxLevel = 0;
+		level->minLevel = 0;
+		data += size;
+		size >>= 2;
+	}
+
+	p->numLevels = numLevels;
+	return true;
+}
+
+void C3D_PyramidDelete(C3D_Pyramid* p)
+{
+	if (!p->numLevels)
+		return;
+	C3D_TexDelete(&p->tex);
+	p->numLevels = 0;
+}
+
+bool C3D_PyramidBuild(C3D_Pyramid* p, C3D_RenderTarget* src)
+{
+	int i;
+	C3D_FrameBuf* fb = &src->frameBuf;
+	if (!p->numLevels || !fb->colorBuf || fb->block32)
+		return false;
+	if ((GPU_TEXCOLOR)fb->colorFmt != p->tex.fmt || (fb->width >> 1) != p->tex.width || (fb->height >> 1) != p->tex.height)
+		return false;
+
+	int transferFmt = C3Di_MipTransferFmt(p->tex.fmt);
+	const u32 transferFlags =
+		GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_XY) | BIT(5) |
+		GX_TRANSFER_IN_FORMAT(transferFmt) | GX_TRANSFER_OUT_FORMAT(transferFmt);
+
+	// Each level is scaled from the one before it, tile to tile
+	u32* in = (u32*)fb->colorBuf;
+	u32 inDim = GX_BUFFER_DIM((u32)fb->width, (u32)fb->height);
+	for (i = 0; i < p->numLevels; i ++)
+	{
+		C3D_Tex* level = &p->levels[i];
+		u32 outDim = GX_BUFFER_DIM((u32)level->width, (u32)level->height);
+		C3D_SyncDisplayTransfer(in, inDim, (u32*)level->data, outDim, transferFlags);
+		in = (u32*)level->data;
+		inDim = outDim;
+	}
+
+	C3Di_TexCacheInvalidate();
+	return true;
+}
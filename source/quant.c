@@ -0,0 +1,195 @@
+#include "internal.h"
+#include <c3d/quant.h>
+
+static inline int formatSize(GPU_FORMATS format)
+{
+	switch (format)
+	{
+		case GPU_BYTE:
+		case GPU_UNSIGNED_BYTE:
+			return 1;
+		case GPU_SHORT:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+static inline void formatRange(GPU_FORMATS format, float* qmin, float* qmax)
+{
+	switch (format)
+	{
+		case GPU_BYTE:
+			*qmin = -128.0f;
+			*qmax = 127.0f;
+			break;
+		case GPU_UNSIGNED_BYTE:
+			*qmin = 0.0f;
+			*qmax = 255.0f;
+			break;
+		case GPU_SHORT:
+			*qmin = -32768.0f;
+			*qmax = 32767.0f;
+			break;
+		default:
+			*qmin = 0.0f;
+			*qmax = 0.0f;
+			break;
+	}
+}
+
+// C3D_FVec stores its components backwards
+static inline float* component(C3D_FVec* v, int i)
+{
+	return &v->c[3-i];
+}
+
+void C3D_QuantLayoutInit(C3D_QuantLayout* layout)
+{
+	memset(layout, 0, sizeof(*layout));
+}
+
+int C3D_QuantLayoutAdd(C3D_QuantLayout* layout, GPU_FORMATS format, int count)
+{
+	if (layout->numAttribs == C3D_QUANT_MAX_ATTRIBS || count < 1 || count > 4)
+		return -1;
+
+	int id = layout->numAttribs++;
+	C3D_QuantAttrib* a = &layout->attribs[id];
+	int size = formatSize(format);
+	int i, maxSize = size;
+
+	// Components have to be aligned to their size, and so does the vertex stride
+	u32 offset = (layout->stride + size-1) &~ (size-1);
+	if (offset > 0xFF)
+	{
+		layout->numAttribs--;
+		return -1;
+	}
+
+	a->format = format;
+	a->count  = count;
+	a->offset = offset;
+	a->scale  = FVec4_New(1.0f, 1.0f, 1.0f, 1.0f);
+	a->bias   = FVec4_New(0.0f, 0.0f, 0.0f, 0.0f);
+
+	for (i = 0; i < id; i ++)
+	{
+		int s = formatSize(layout->attribs[i].format);
+		if (s > maxSize)
+			maxSize = s;
+	}
+
+	layout->stride = offset + size*count;
+	layout->stride = (layout->stride + maxSize-1) &~ (maxSize-1);
+	return id;
+}
+
+static void quantWrite(C3D_QuantAttrib* a, u8* dst, u32 stride, const float* src, size_t srcStride, int count, const float* min, const float* max)
+{
+	float qmin, qmax;
+	float scale[4], bias[4];
+	int i, j;
+
+	formatRange(a->format, &qmin, &qmax);
+
+	for (j = 0; j < a->count; j ++)
+	{
+		if (a->format == GPU_FLOAT || max[j] <= min[j])
+		{
+			// Floats are stored as they are, constant components only need the bias
+			scale[j] = 1.0f;
+			bias[j]  = a->format == GPU_FLOAT ? 0.0f : min[j];
+		} else
+		{
+			scale[j] = (max[j]-min[j]) / (qmax-qmin);
+			bias[j]  = min[j] - qmin*scale[j];
+		}
+		*component(&a->scale, j) = scale[j];
+		*component(&a->bias,  j) = bias[j];
+	}
+
+	for (i = 0; i < count; i ++)
+	{
+		const float* v = (const float*)((const u8*)src + i*srcStride);
+		u8* out = dst + i*stride + a->offset;
+
+		for (j = 0; j < a->count; j ++)
+		{
+			if (a->format == GPU_FLOAT)
+			{
+				((float*)out)[j] = v[j];
+				continue;
+			}
+
+			float q = (v[j]-bias[j]) / scale[j];
+			q = q < qmin ? qmin : (q > qmax ? qmax : q);
+			int r = (int)(q < 0.0f ? q-0.5f : q+0.5f);
+
+			switch (a->format)
+			{
+				case GPU_BYTE:
+					((s8*)out)[j] = r;
+					break;
+				case GPU_UNSIGNED_BYTE:
+					out[j] = r;
+					break;
+				default:
+					((s16*)out)[j] = r;
+					break;
+			}
+		}
+	}
+}
+
+void C3D_QuantLayoutWrite(C3D_QuantLayout* layout, int attrib, void* vertices, const float* src, size_t srcStride, int count)
+{
+	C3D_QuantAttrib* a = &layout->attribs[attrib];
+	float min[4], max[4];
+	int i, j;
+
+	for (j = 0; j < a->count; j ++)
+	{
+		min[j] = count ? src[j] : 0.0f;
+		max[j] = min[j];
+	}
+
+	for (i = 1; i < count; i ++)
+	{
+		const float* v = (const float*)((const u8*)src + i*srcStride);
+		for (j = 0; j < a->count; j ++)
+		{
+			if (v[j] < min[j]) min[j] = v[j];
+			if (v[j] > max[j]) max[j] = v[j];
+		}
+	}
+
+	quantWrite(a, (u8*)vertices, layout->stride, src, srcStride, count, min, max);
+}
+
+void C3D_QuantLayoutWriteRange(C3D_QuantLayout* layout, int attrib, void* vertices, const float* src, size_t srcStride, int count, float min, float max)
+{
+	C3D_QuantAttrib* a = &layout->attribs[attrib];
+	float mins[4] = { min, min, min, min };
+	float maxs[4] = { max, max, max, max };
+
+	quantWrite(a, (u8*)vertices, layout->stride, src, srcStride, count, mins, maxs);
+}
+
+bool C3D_QuantLayoutBind(const C3D_QuantLayout* layout, C3D_AttrInfo* attrInfo, C3D_BufInfo* bufInfo, const void* vertices, const int* regIds)
+{
+	int i;
+	u64 permutation = 0;
+
+	if (attrInfo->attrCount + layout->numAttribs > 12)
+		return false;
+
+	for (i = 0; i < layout->numAttribs; i ++)
+	{
+		const C3D_QuantAttrib* a = &layout->attribs[i];
+		int id = AttrInfo_AddLoader(attrInfo, regIds ? regIds[i] : -1, a->format, a->count);
+		permutation |= (u64)id << (i*4);
+	}
+
+	return BufInfo_Add(bufInfo, vertices, layout->stride, layout->numAttribs, permutation) >= 0;
+}
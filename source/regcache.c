@@ -0,0 +1,152 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/base.h>
+
+// Shadow copy of the last value written to each PICA register, tracked per byte lane
+typedef struct
+{
+	u32 value[0x400];
+	u8 valid[0x400];
+} C3Di_RegCache;
+
+static C3Di_RegCache* regCache;
+static bool regRestore;
+
+static inline u32 maskToBits(u32 mask)
+{
+	u32 bits = 0;
+	if (mask & 1) bits |= 0x000000FF;
+	if (mask & 2) bits |= 0x0000FF00;
+	if (mask & 4) bits |= 0x00FF0000;
+	if (mask & 8) bits |= 0xFF000000;
+	return bits;
+}
+
+static inline bool regMatches(u32 reg, u32 mask, u32 val)
+{
+	u32 bits = maskToBits(mask);
+	return (regCache->valid[reg] & mask) == mask && ((regCache->value[reg] ^ val) & bits) == 0;
+}
+
+static inline void regStore(u32 reg, u32 mask, u32 val)
+{
+	u32 bits = maskToBits(mask);
+	regCache->value[reg] = (regCache->value[reg] &~ bits) | (val & bits);
+	regCache->valid[reg] |= mask;
+}
+
+bool C3D_RegCacheEnable(bool enable)
+{
+	if (!enable)
+	{
+		free(regCache);
+		regCache = NULL;
+		regRestore = false;
+		return true;
+	}
+
+	if (!regCache)
+	{
+		regCache = (C3Di_RegCache*)malloc(sizeof(C3Di_RegCache));
+		if (!regCache)
+			return false;
+		C3Di_RegCacheInvalidate();
+	}
+	return true;
+}
+
+void C3D_RegCacheInvalidate(void)
+{
+	C3Di_RegCacheInvalidate();
+}
+
+void C3Di_RegCacheInvalidate(void)
+{
+	if (regCache)
+		memset(regCache->valid, 0, sizeof(regCache->valid));
+	regRestore = false;
+}
+
+bool C3Di_RegCacheSnapshot(void)
+{
+	// The shadow copy already is the state to put back once the GPU is ours again
+	regRestore = regCache != NULL;
+	return regRestore;
+}
+
+bool C3Di_RegCacheHasSnapshot(void)
+{
+	return regRestore;
+}
+
+bool C3Di_RegCacheReplay(void)
+{
+	if (!regRestore)
+		return false;
+	regRestore = false;
+
+	// Every register is sent exactly once: fully known runs as incremental writes,
+	// partially known registers with only their known byte lanes enabled
+	u32 reg = 0;
+	while (reg < 0x400)
+	{
+		u8 valid = regCache->valid[reg];
+		if (!valid)
+		{
+			reg ++;
+			continue;
+		}
+		if (valid != 0xF)
+		{
+			GPUCMD_AddMaskedWrite(reg, valid, regCache->value[reg]);
+			reg ++;
+			continue;
+		}
+
+		u32 num;
+		for (num = 1; num < 0x80 && reg+num < 0x400 && regCache->valid[reg+num] == 0xF; num ++);
+		if (num == 1)
+			GPUCMD_AddWrite(reg, regCache->value[reg]);
+		else
+			GPUCMD_AddIncrementalWrites(reg, &regCache->value[reg], num);
+		reg += num;
+	}
+	return true;
+}
+
+void C3Di_RegMaskedWrite(u32 reg, u32 mask, u32 val)
+{
+	if (regCache)
+	{
+		if (regMatches(reg, mask, val))
+			return;
+		regStore(reg, mask, val);
+	}
+	GPUCMD_AddMaskedWrite(reg, mask, val);
+}
+
+void C3Di_RegIncrementalWrites(u32 reg, const u32* vals, u32 num)
+{
+	if (regCache)
+	{
+		// Only emit the range between the first and the last changed register
+		u32 first, last;
+		for (first = 0; first < num && regMatches(reg+first, 0xF, vals[first]); first ++);
+		if (first == num)
+			return;
+		for (last = num-1; last > first && regMatches(reg+last, 0xF, vals[last]); last --);
+
+		reg  += first;
+		vals += first;
+		num   = last-first+1;
+
+		u32 i;
+		for (i = 0; i < num; i ++)
+			regStore(reg+i, 0xF, vals[i]);
+	}
+
+	if (num == 1)
+		GPUCMD_AddWrite(reg, vals[0]);
+	else
+		GPUCMD_AddIncrementalWrites(reg, vals, num);
+}
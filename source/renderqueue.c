@@ -1,6 +1,7 @@
 #include "internal.h"
 #include <c3d/base.h>
 #include <c3d/renderqueue.h>
+#include <c3d/vram.h>
 #include <stdlib.h>
 
 static C3D_RenderTarget *firstTarget, *lastTarget;
@@ -8,11 +9,49 @@ static C3D_RenderTarget *linkedTarget[3];
 
 static TickCounter gpuTime, cpuTime;
 
-static bool inFrame, inSafeTransfer, measureGpuTime;
+static bool inFrame, inSafeTransfer, measureGpuTime, prevFramePending;
 static bool needSwapTop, needSwapBot, isTopStereo;
 static float framerate = 60.0f;
 static float framerateCounter[2] = { 60.0f, 60.0f };
 static u32 frameCounter[2];
+static u64 queueBase, frameFenceStart;
+static u32 queueSeq; // Odd while queueBase and the queue are being retired, see C3D_FenceIsSignaled
+static u64 lastListEntry = ~0ULL; // Queue position of the last command list added by C3D_FrameSplit
+static u32* lastListEnd;
+static u32* lastListFinalize;
+static u8 lastListFlags;
+static u32 frameIndex;
+
+static u32 frameSplitWords, drawTargetStart;
+static u32 bandScissor[3], savedScissor[3]; // Scissor set by C3D_FrameDrawOnBand and the one it replaced
+static bool bandScissorSet;
+static C3D_RenderTarget* drawTarget;
+static float framePeakUsage, cmdBufPeakUsage;
+static float usageHistory[C3D_CMDBUF_HISTORY];
+static u32 usageHistoryPos, usageHistoryCount;
+typedef struct
+{
+	C3D_Tex* tex;
+	const void* src;
+	void* dst;
+	u32 size;
+	u32 dstDim; // Output line width and gap, 0 for a contiguous copy
+	C3D_TexUploadCallback callback;
+	void* param;
+	u64 fence; // 0 until handed to the queue
+} C3Di_TexUpload;
+
+static C3Di_TexUpload texUploads[C3D_TEXUPLOAD_MAX];
+static u32 texUploadHead, texUploadCount, texUploadSubmitted;
+
+static bool flushTracking, flushOverflow;
+static u32 flushRanges[C3D_FLUSH_RANGES][2]; // start, end
+static u32 numFlushRanges;
+
+static bool pacing;
+static float pacingHistory[C3D_PACING_HISTORY];
+static u32 pacingPos, pacingCount;
+
 static void (* frameEndCb)(void*);
 static void* frameEndCbData;
 
@@ -41,6 +80,16 @@ static void onVBlank1(C3D_UNUSED void* unused)
 		frameCounter[1]++;
 }
 
+static void C3Di_RetireQueue(gxCmdQueue_s* queue)
+{
+	__atomic_store_n(&queueSeq, queueSeq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	C3Di_CaptureQueue(queue, queueBase);
+	queueBase += queue->numEntries;
+	gxCmdQueueClear(queue);
+	__atomic_store_n(&queueSeq, queueSeq+1, __ATOMIC_RELEASE);
+}
+
 static void onQueueFinish(gxCmdQueue_s* queue)
 {
 	if (measureGpuTime)
@@ -54,7 +103,7 @@ static void onQueueFinish(gxCmdQueue_s* queue)
 		if (inFrame)
 		{
 			gxCmdQueueStop(queue);
-			gxCmdQueueClear(queue);
+			C3Di_RetireQueue(queue);
 		}
 	}
 	else
@@ -95,10 +144,95 @@ static bool C3Di_WaitAndClearQueue(s64 timeout)
 	if (!gxCmdQueueWait(queue, timeout))
 		return false;
 	gxCmdQueueStop(queue);
-	gxCmdQueueClear(queue);
+	C3Di_StatsQueueUsage(queue->numEntries);
+	C3Di_RetireQueue(queue);
+	prevFramePending = false;
+	return true;
+}
+
+static void C3Di_TexUploadSubmit(void)
+{
+	gxCmdQueue_s* queue = &C3Di_GetContext()->gxQueue;
+	bool added = false;
+
+	// Outside a frame nothing else clears the queue, reclaim it once it has gone idle
+	if (!inFrame && texUploadSubmitted < texUploadCount && queue->numEntries + 4 >= queue->maxEntries)
+		C3Di_WaitAndClearQueue(0);
+
+	// Keep a few entries free for the split and the display transfers of C3D_FrameEnd
+	while (texUploadSubmitted < texUploadCount && queue->numEntries + 4 < queue->maxEntries)
+	{
+		C3Di_TexUpload* u = &texUploads[(texUploadHead + texUploadSubmitted) % C3D_TEXUPLOAD_MAX];
+		GX_TextureCopy((u32*)u->src, 0, (u32*)u->dst, u->dstDim, u->size, 8);
+		u->fence = queueBase + queue->numEntries;
+		texUploadSubmitted++;
+		added = true;
+	}
+
+	// Outside a frame nothing else is going to start the queue
+	if (added && !inFrame)
+		gxCmdQueueRun(queue);
+}
+
+bool C3Di_TexUploadQueueDim(C3D_Tex* tex, const void* src, void* dst, u32 size, u32 dstDim, C3D_TexUploadCallback callback, void* param)
+{
+	if (texUploadCount == C3D_TEXUPLOAD_MAX && C3D_TexUploadPoll() == C3D_TEXUPLOAD_MAX)
+		return false;
+
+	C3Di_TexUpload* u = &texUploads[(texUploadHead + texUploadCount) % C3D_TEXUPLOAD_MAX];
+	u->tex = tex;
+	u->src = src;
+	u->dst = dst;
+	u->size = size;
+	u->dstDim = dstDim;
+	u->callback = callback;
+	u->param = param;
+	u->fence = 0;
+	texUploadCount++;
+
+	if (!addrIsVRAM(src))
+		GSPGPU_FlushDataCache(src, size);
+	if (!inFrame)
+		C3Di_TexUploadSubmit();
 	return true;
 }
 
+u32 C3D_TexUploadPoll(void)
+{
+	while (texUploadSubmitted)
+	{
+		C3Di_TexUpload* u = &texUploads[texUploadHead];
+		if (!C3D_FenceIsSignaled(u->fence))
+			break;
+
+		texUploadHead = (texUploadHead + 1) % C3D_TEXUPLOAD_MAX;
+		texUploadCount--;
+		texUploadSubmitted--;
+		if (u->callback)
+			u->callback(u->tex, u->param);
+	}
+
+	if (!inFrame)
+		C3Di_TexUploadSubmit();
+	return texUploadCount;
+}
+
+void C3D_TexUploadFinish(void)
+{
+	if (inFrame) return;
+	while (C3D_TexUploadPoll())
+		C3Di_WaitAndClearQueue(-1);
+}
+
+static void C3Di_FinishPrevFrame(void)
+{
+	// The previous frame may still be running when multiple command buffers are in use.
+	// Anything that reads CPU written data has to wait for it, since linear memory is
+	// only flushed in C3D_FrameEnd and the queue must be stopped to collect this frame.
+	if (prevFramePending)
+		C3Di_WaitAndClearQueue(-1);
+}
+
 void C3Di_RenderQueueEnableVBlank(void)
 {
 	gspSetEventCallback(GSPGPU_EVENT_VBlank0, onVBlank0, NULL, false);
@@ -127,6 +261,7 @@ void C3Di_RenderQueueExit(void)
 	int i;
 	C3D_RenderTarget *a, *next;
 
+	C3D_TexUploadFinish();
 	C3Di_WaitAndClearQueue(-1);
 	gxCmdQueueSetCallback(&C3Di_GetContext()->gxQueue, NULL, NULL);
 	GX_BindQueue(NULL);
@@ -148,6 +283,66 @@ void C3Di_RenderQueueWaitDone(void)
 	C3Di_WaitAndClearQueue(-1);
 }
 
+static u32 C3Di_FrameCmdWords(void)
+{
+	return frameSplitWords + gpuCmdBufOffset;
+}
+
+static void C3Di_CmdBufTrack(u32 size)
+{
+	frameSplitWords += size;
+	float usage = C3Di_GetContext()->cmdBufUsage;
+	if (usage > framePeakUsage)
+		framePeakUsage = usage;
+}
+
+static void C3Di_TargetAccount(C3D_RenderTarget* next)
+{
+	u32 pos = C3Di_FrameCmdWords();
+	if (drawTarget)
+		drawTarget->cmdWords += pos - drawTargetStart;
+	drawTarget = next;
+	drawTargetStart = pos;
+}
+
+float C3D_GetCmdBufPeakUsage(void)
+{
+	return cmdBufPeakUsage;
+}
+
+void C3D_ResetCmdBufPeakUsage(void)
+{
+	cmdBufPeakUsage = 0.0f;
+}
+
+void C3D_ResetCmdBufHistory(void)
+{
+	usageHistoryPos = 0;
+	usageHistoryCount = 0;
+}
+
+u32 C3D_GetCmdBufHistory(float* out, u32 max)
+{
+	u32 i, count = usageHistoryCount < max ? usageHistoryCount : max;
+	u32 first = usageHistoryPos + C3D_CMDBUF_HISTORY - count;
+	for (i = 0; i < count; i ++)
+		out[i] = usageHistory[(first + i) % C3D_CMDBUF_HISTORY];
+	return count;
+}
+
+void C3D_GetCmdBufHistogram(u32 bins[C3D_CMDBUF_HIST_BINS])
+{
+	u32 i;
+	memset(bins, 0, C3D_CMDBUF_HIST_BINS*sizeof(u32));
+	for (i = 0; i < usageHistoryCount; i ++)
+	{
+		int bin = (int)(usageHistory[i]*C3D_CMDBUF_HIST_BINS);
+		if (bin < 0) bin = 0;
+		if (bin >= C3D_CMDBUF_HIST_BINS) bin = C3D_CMDBUF_HIST_BINS-1;
+		bins[bin]++;
+	}
+}
+
 float C3D_FrameRate(float fps)
 {
 	float old = framerate;
@@ -160,6 +355,59 @@ float C3D_FrameRate(float fps)
 	return old;
 }
 
+void C3D_FramePacingEnable(bool enable)
+{
+	pacing = enable;
+	pacingPos = 0;
+	pacingCount = 0;
+	if (!enable)
+		C3D_FrameRate(60.0f);
+}
+
+float C3D_FrameBudget(void)
+{
+	return 1000.0f / framerate;
+}
+
+static void C3Di_FramePacingUpdate(void)
+{
+	static const float rates[] = { 60.0f, 30.0f, 20.0f };
+	float cpu = C3D_GetProcessingTime(), gpu = C3D_GetDrawingTime();
+	pacingHistory[pacingPos] = cpu > gpu ? cpu : gpu;
+	pacingPos = (pacingPos + 1) % C3D_PACING_HISTORY;
+	if (pacingCount < C3D_PACING_HISTORY)
+		pacingCount++;
+
+	int cur;
+	for (cur = 0; cur < 2 && rates[cur] > framerate; cur ++);
+
+	// Drop a step as soon as frames start missing the budget, only go back up after
+	// a full history of frames that would have fit comfortably
+	u32 i, over = 0, fitUp = 0;
+	float budget = 1000.0f / rates[cur];
+	float budgetUp = cur > 0 ? 1000.0f / rates[cur-1] : 0.0f;
+	for (i = 0; i < pacingCount; i ++)
+	{
+		if (pacingHistory[i] > budget*0.95f)
+			over++;
+		if (pacingHistory[i] < budgetUp*0.8f)
+			fitUp++;
+	}
+
+	int next = cur;
+	if (over >= 2 && cur < 2)
+		next = cur+1;
+	else if (cur > 0 && pacingCount == C3D_PACING_HISTORY && fitUp == pacingCount)
+		next = cur-1;
+
+	if (next != cur)
+	{
+		C3D_FrameRate(rates[next]);
+		pacingPos = 0;
+		pacingCount = 0;
+	}
+}
+
 bool C3D_FrameBegin(u8 flags)
 {
 	C3D_Context* ctx = C3Di_GetContext();
@@ -167,12 +415,38 @@ bool C3D_FrameBegin(u8 flags)
 
 	if (flags & C3D_FRAME_SYNCDRAW)
 		C3D_FrameSync();
-	if (!C3Di_WaitAndClearQueue((flags & C3D_FRAME_NONBLOCK) ? 0 : -1))
+	if (ctx->cmdBufCount > 1)
+	{
+		// The other buffer was last used before the previous frame, which C3D_FrameEnd already
+		// waited on. Memory fills may still be queued behind the running frame, everything else
+		// waits in C3Di_FinishPrevFrame.
+		ctx->cmdBufCur ^= 1;
+		prevFramePending = !C3Di_WaitAndClearQueue(0);
+	}
+	else if (!C3Di_WaitAndClearQueue((flags & C3D_FRAME_NONBLOCK) ? 0 : -1))
 		return false;
 
+	if (pacing)
+		C3Di_FramePacingUpdate();
+	C3D_TexUploadPoll();
+	C3Di_TexResUpdate();
 	inFrame = true;
+	frameFenceStart = queueBase + ctx->gxQueue.numEntries;
+	C3Di_CaptureFrameBegin(frameFenceStart);
+
+	C3D_RenderTarget* target;
+	for (target = firstTarget; target; target = target->next)
+		target->cmdWords = 0;
+	frameSplitWords = 0;
+	framePeakUsage = 0.0f;
+	drawTarget = NULL;
+
+	C3Di_StatsFrameBegin();
 	osTickCounterStart(&cpuTime);
-	GPUCMD_SetBuffer(ctx->cmdBuf, ctx->cmdBufSize, 0);
+	GPUCMD_SetBuffer(C3Di_CurCmdBuf(ctx), ctx->cmdBufSize, 0);
+
+	// Textures may have been written by the CPU or the transfer engine since the last frame
+	C3Di_TexCacheInvalidate();
 	return true;
 }
 
@@ -181,17 +455,248 @@ bool C3D_FrameDrawOn(C3D_RenderTarget* target)
 	if (!inFrame) return false;
 
 	target->used = true;
+	target->bandTop = 0;
+	target->bandBottom = target->frameBuf.height;
+	C3Di_StatsDrawOn(target);
+	C3Di_TargetAccount(target);
+
+	// Put back the scissor that was current before a band, unless it was changed since
+	C3D_Context* ctx = C3Di_GetContext();
+	if (bandScissorSet)
+	{
+		bandScissorSet = false;
+		if (!memcmp(ctx->scissor, bandScissor, sizeof(bandScissor)))
+		{
+			memcpy(ctx->scissor, savedScissor, sizeof(savedScissor));
+			ctx->flags |= C3DiF_Scissor;
+		}
+	}
 	C3D_SetFrameBuf(&target->frameBuf);
 	C3D_SetViewport(0, 0, target->frameBuf.width, target->frameBuf.height);
 	return true;
 }
 
+bool C3D_FrameDrawOnBand(C3D_RenderTarget* target, u32 top, u32 bottom)
+{
+	u32 height = target->frameBuf.height;
+	top &= ~7;
+	bottom = (bottom + 7) &~ 7;
+	if (bottom > height)
+		bottom = height;
+	if (top >= bottom)
+		return false;
+
+	// Keep the rows already drawn on during this frame
+	u16 bandTop = top, bandBottom = bottom;
+	if (target->used && target->bandBottom > target->bandTop)
+	{
+		if (target->bandTop < bandTop)
+			bandTop = target->bandTop;
+		if (target->bandBottom > bandBottom)
+			bandBottom = target->bandBottom;
+	}
+	if (!C3D_FrameDrawOn(target))
+		return false;
+
+	C3D_Context* ctx = C3Di_GetContext();
+	target->bandTop = bandTop;
+	target->bandBottom = bandBottom;
+	memcpy(savedScissor, ctx->scissor, sizeof(savedScissor));
+	C3D_SetScissor(GPU_SCISSOR_NORMAL, 0, top, target->frameBuf.width, bottom);
+	memcpy(bandScissor, ctx->scissor, sizeof(bandScissor));
+	bandScissorSet = true;
+	return true;
+}
+
+void C3D_FlushTrackingEnable(bool enable)
+{
+	flushTracking = enable;
+	flushOverflow = false;
+	numFlushRanges = 0;
+}
+
+bool C3Di_InFrame(void)
+{
+	return inFrame;
+}
+
+bool C3Di_FlushDeferred(void)
+{
+	return flushTracking && inFrame;
+}
+
+void C3D_FlushMarkRange(const void* addr, size_t size)
+{
+	if (!flushTracking || flushOverflow || !size)
+		return;
+
+	// Whole cache lines, with ranges that touch or overlap merged into one
+	u32 start = (u32)addr &~ 0x1F;
+	u32 end = ((u32)addr + size + 0x1F) &~ 0x1F;
+	u32 i = 0;
+	while (i < numFlushRanges)
+	{
+		u32* r = flushRanges[i];
+		if (start > r[1] || end < r[0])
+		{
+			i ++;
+			continue;
+		}
+		if (r[0] < start) start = r[0];
+		if (r[1] > end) end = r[1];
+		r[0] = flushRanges[numFlushRanges-1][0];
+		r[1] = flushRanges[numFlushRanges-1][1];
+		numFlushRanges--;
+		i = 0;
+	}
+
+	if (numFlushRanges == C3D_FLUSH_RANGES)
+	{
+		flushOverflow = true; // Too scattered, flush everything instead
+		return;
+	}
+	flushRanges[numFlushRanges][0] = start;
+	flushRanges[numFlushRanges][1] = end;
+	numFlushRanges++;
+}
+
+static void C3Di_FlushLinearHeap(void)
+{
+	extern u32 __ctru_linear_heap;
+	extern u32 __ctru_linear_heap_size;
+
+	if (flushTracking && !flushOverflow)
+	{
+		u32 i;
+		for (i = 0; i < numFlushRanges; i ++)
+			GSPGPU_FlushDataCache((void*)flushRanges[i][0], flushRanges[i][1]-flushRanges[i][0]);
+	}
+	else
+		GSPGPU_FlushDataCache((void*)__ctru_linear_heap, __ctru_linear_heap_size);
+
+	flushOverflow = false;
+	numFlushRanges = 0;
+}
+
+void C3Di_CmdBufEnsureSpace(u32 words)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	u32 *buf, size, offset;
+	GPUCMD_GetBuffer(&buf, &size, &offset);
+	if (!inFrame || size - offset >= words)
+		return;
+
+	// Leave command lists that are being recorded alone
+	u32* frameBuf = C3Di_CurCmdBuf(ctx);
+	if (buf < frameBuf || buf >= frameBuf + ctx->cmdBufSize)
+		return;
+
+	// Run everything recorded so far and start over at the beginning of the buffer. Only the
+	// recorded commands and the marked ranges are flushed, not the whole heap.
+	u32 *cmdBuf, cmdBufSize;
+	C3Di_FinishPrevFrame();
+	if (!C3Di_SplitFrame(&cmdBuf, &cmdBufSize))
+		return;
+	C3Di_CmdBufTrack(cmdBufSize);
+	GSPGPU_FlushDataCache(frameBuf, (cmdBuf + cmdBufSize - frameBuf)*4);
+	GX_ProcessCommandList(cmdBuf, cmdBufSize*4, 0);
+	if (flushTracking)
+		C3Di_FlushLinearHeap();
+
+	// Texture uploads go out with the next split, so the wait below only covers the buffer
+	C3Di_StatsQueueRun();
+	gxCmdQueueRun(&ctx->gxQueue);
+	C3Di_WaitAndClearQueue(-1);
+	GPUCMD_SetBuffer(frameBuf, ctx->cmdBufSize, 0);
+}
+
+// The gx handler reads queue entries while the previous frame is still running
+static inline bool C3Di_QueueStopped(void)
+{
+	gxCmdQueue_s* queue = &C3Di_GetContext()->gxQueue;
+	return !prevFramePending && queue->curEntry < queue->numEntries;
+}
+
+// Makes room for a few more entries while the queue is stopped, so a busy frame does not stall
+static void C3Di_QueueReserve(u32 entries)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	gxCmdQueue_s* queue = &ctx->gxQueue;
+	if (inSafeTransfer || queue->numEntries + entries <= queue->maxEntries || queue->maxEntries >= ctx->gxQueueLimit)
+		return;
+	if (prevFramePending || queue->curEntry != 0)
+		return;
+
+	u32 size = queue->maxEntries*2;
+	if (size > ctx->gxQueueLimit)
+		size = ctx->gxQueueLimit;
+	gxCmdEntry_s* buf = (gxCmdEntry_s*)realloc(queue->entries, size*sizeof(gxCmdEntry_s));
+	if (!buf)
+		return;
+	queue->entries = buf;
+	queue->maxEntries = size;
+}
+
+// Appends a command list that directly follows the previous one to it, if nothing else has been
+// queued in between and the queue has not started on it. The finalize command ending the previous
+// list becomes a write without any byte enabled, like the padding GPUCMD_Split puts after it.
+static bool C3Di_QueueMergeList(u32* cmdBuf, u32 cmdBufSize, u8 flags)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	gxCmdQueue_s* queue = &ctx->gxQueue;
+	if (!ctx->gxQueueMerge || !queue->numEntries || lastListEntry != queueBase + queue->numEntries - 1)
+		return false;
+	if (lastListEnd != cmdBuf || lastListFlags != flags || inSafeTransfer || C3Di_StatsFrame)
+		return false;
+
+	// An entry the GX engine has started already read its length
+	if (!C3Di_QueueStopped())
+		return false;
+
+	gxCmdEntry_s* entry = &queue->entries[queue->numEntries-1];
+	if ((entry->d[0] & 0xFF) != 0x01)
+		return false;
+
+	// Everything from the finalize command on was written by GPUCMD_Split: the finalize and the
+	// padding up to a multiple of 16 bytes, which are single writes to the finalize register
+	u32* list = (u32*)entry->d[1];
+	u32* end = list + entry->d[2]/4;
+	u32* p = lastListFinalize;
+	if (p < list || p+2 > end || p[1] != GPUCMD_HEADER(0, 0xF, GPUREG_FINALIZE))
+		return false;
+	for (; p+2 <= end; p += 2)
+		if ((p[1] & 0xFFF0FFFF) == GPUREG_FINALIZE)
+			p[1] = GPUCMD_HEADER(0, 0, GPUREG_FINALIZE);
+
+	entry->d[2] += cmdBufSize*4;
+	lastListEnd = cmdBuf + cmdBufSize;
+	lastListFinalize = ctx->splitFinalize;
+	if (flags & GX_CMDLIST_FLUSH)
+		GSPGPU_FlushDataCache(list, entry->d[2]);
+	return true;
+}
+
 void C3D_FrameSplit(u8 flags)
 {
 	u32 *cmdBuf, cmdBufSize;
 	if (!inFrame) return;
+	C3Di_FinishPrevFrame();
 	if (C3Di_SplitFrame(&cmdBuf, &cmdBufSize))
-		GX_ProcessCommandList(cmdBuf, cmdBufSize*4, flags);
+	{
+		C3Di_CmdBufTrack(cmdBufSize);
+		C3D_FlushMarkRange(cmdBuf, cmdBufSize*4);
+		if (!C3Di_QueueMergeList(cmdBuf, cmdBufSize, flags))
+		{
+			// Room for this list, the display transfers of C3D_FrameEnd and a few transfers
+			C3Di_QueueReserve(8);
+			GX_ProcessCommandList(cmdBuf, cmdBufSize*4, flags);
+			lastListEntry = queueBase + C3Di_GetContext()->gxQueue.numEntries - 1;
+			lastListEnd = cmdBuf + cmdBufSize;
+			lastListFinalize = C3Di_GetContext()->splitFinalize;
+			lastListFlags = flags;
+		}
+		C3Di_TexUploadSubmit();
+	}
 }
 
 void C3D_FrameEnd(u8 flags)
@@ -202,18 +707,23 @@ void C3D_FrameEnd(u8 flags)
 	if (frameEndCb)
 		frameEndCb(frameEndCbData);
 
+	C3Di_TargetAccount(NULL);
 	C3D_FrameSplit(flags);
+
+	usageHistory[usageHistoryPos] = framePeakUsage;
+	usageHistoryPos = (usageHistoryPos + 1) % C3D_CMDBUF_HISTORY;
+	if (usageHistoryCount < C3D_CMDBUF_HISTORY)
+		usageHistoryCount++;
+	if (framePeakUsage > cmdBufPeakUsage)
+		cmdBufPeakUsage = framePeakUsage;
 	GPUCMD_SetBuffer(NULL, 0, 0);
 	osTickCounterUpdate(&cpuTime);
 	inFrame = false;
 
-	// Flush the entire linear memory if the user did not explicitly mandate to flush the command list
-	if (!(flags & GX_CMDLIST_FLUSH))
-	{
-		extern u32 __ctru_linear_heap;
-		extern u32 __ctru_linear_heap_size;
-		GSPGPU_FlushDataCache((void*)__ctru_linear_heap, __ctru_linear_heap_size);
-	}
+	// Flush the entire linear memory if the user did not explicitly mandate to flush the command list,
+	// marked ranges are always flushed
+	if (!(flags & GX_CMDLIST_FLUSH) || flushTracking)
+		C3Di_FlushLinearHeap();
 
 	int i;
 	C3D_RenderTarget* target;
@@ -224,7 +734,24 @@ void C3D_FrameEnd(u8 flags)
 		if (!target || !target->used)
 			continue;
 		target->used = false;
-		C3D_FrameBufTransfer(&target->frameBuf, target->screen, target->side, target->transferFlags);
+
+		// The back buffer was last written two presents ago, it lacks the rows changed since
+		u32 top = target->bandTop, bottom = target->bandBottom;
+		if (target->staleBottom > target->staleTop)
+		{
+			if (target->staleTop < top)
+				top = target->staleTop;
+			if (target->staleBottom > bottom)
+				bottom = target->staleBottom;
+		}
+		if (target->transferFlags & GX_TRANSFER_SCALING(3))
+		{
+			top = 0;
+			bottom = target->frameBuf.height;
+		}
+		target->staleTop = target->bandTop;
+		target->staleBottom = target->bandBottom;
+		C3Di_FrameBufTransferBand(&target->frameBuf, target->screen, target->side, target->transferFlags, top, bottom);
 		if (target->screen == GFX_TOP)
 		{
 			needSwapTop = true;
@@ -235,11 +762,71 @@ void C3D_FrameEnd(u8 flags)
 			needSwapBot = true;
 	}
 
+	// Transient targets become free as soon as everything queued for this frame has run
+	u64 fence = queueBase + ctx->gxQueue.numEntries;
+	for (target = firstTarget; target; target = target->next)
+	{
+		if (!target->poolBusy)
+			continue;
+		target->poolBusy = false;
+		target->poolFence = fence;
+	}
+	C3Di_StreamBufFrameEnd(fence);
+	C3Di_CaptureFrameEnd(fence);
+	frameIndex++;
+
 	measureGpuTime = true;
 	osTickCounterStart(&gpuTime);
+	C3Di_StatsQueueRun();
+	C3Di_StatsQueueUsage(ctx->gxQueue.numEntries);
+	C3Di_StatsFrameEnd();
 	gxCmdQueueRun(&ctx->gxQueue);
 }
 
+C3D_Fence C3D_FenceInsert(void)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	// Hand everything recorded so far to the queue
+	C3D_FrameSplit(0);
+	return queueBase + ctx->gxQueue.numEntries;
+}
+
+bool C3D_FenceIsSignaled(C3D_Fence fence)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	u32 seq;
+	u64 pos;
+
+	// The queue finish callback retires the queue from another thread, retry if it did meanwhile
+	do
+	{
+		seq = __atomic_load_n(&queueSeq, __ATOMIC_ACQUIRE);
+		pos = queueBase + __atomic_load_n(&ctx->gxQueue.lastEntry, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((seq & 1) || __atomic_load_n(&queueSeq, __ATOMIC_RELAXED) != seq);
+	return pos >= fence;
+}
+
+bool C3D_FenceWait(C3D_Fence fence, s64 timeout)
+{
+	if (C3D_FenceIsSignaled(fence))
+		return true;
+
+	// Work queued during this frame only starts running in C3D_FrameEnd
+	if (!timeout || (inFrame && fence > frameFenceStart))
+		return false;
+
+	u64 deadline = svcGetSystemTick() + (u64)timeout*(SYSCLOCK_ARM11/1000000)/1000;
+	while (!C3D_FenceIsSignaled(fence))
+	{
+		if (timeout > 0 && svcGetSystemTick() >= deadline)
+			return false;
+		gspWaitForAnyEvent();
+	}
+	return true;
+}
+
 void C3D_FrameEndHook(void (* hook)(void*), void* param)
 {
 	frameEndCb = hook;
@@ -256,6 +843,11 @@ float C3D_GetProcessingTime(void)
 	return osTickCounterRead(&cpuTime);
 }
 
+C3D_RenderTarget* C3Di_RenderTargetFirst(void)
+{
+	return firstTarget;
+}
+
 static C3D_RenderTarget* C3Di_RenderTargetNew(void)
 {
 	C3D_RenderTarget* target = (C3D_RenderTarget*)malloc(sizeof(C3D_RenderTarget));
@@ -279,15 +871,13 @@ C3D_RenderTarget* C3D_RenderTargetCreate(int width, int height, GPU_COLORBUF col
 {
 	GPU_DEPTHBUF depthFmtReal = GPU_RB_DEPTH16;
 	void* depthBuf = NULL;
-	void* colorBuf = vramAlloc(C3D_CalcColorBufSize(width,height,colorFmt));
+	void* colorBuf = C3D_VramAlloc(C3D_CalcColorBufSize(width,height,colorFmt), C3D_VRAM_COLOR, NULL);
 	if (!colorBuf) goto _fail0;
 	if (C3D_DEPTHTYPE_OK(depthFmt))
 	{
 		depthFmtReal = C3D_DEPTHTYPE_VAL(depthFmt);
 		size_t depthSize = C3D_CalcDepthBufSize(width,height,depthFmtReal);
-		vramAllocPos vramBank = addrGetVRAMBank(colorBuf);
-		depthBuf = vramAllocAt(depthSize, vramBank ^ VRAM_ALLOC_ANY); // Attempt opposite bank first...
-		if (!depthBuf) depthBuf = vramAllocAt(depthSize, vramBank); // ... if that fails, attempt same bank
+		depthBuf = C3D_VramAlloc(depthSize, C3D_VRAM_DEPTH, colorBuf); // Opposite bank of the colour buffer if possible
 		if (!depthBuf) goto _fail1;
 	}
 
@@ -307,9 +897,9 @@ C3D_RenderTarget* C3D_RenderTargetCreate(int width, int height, GPU_COLORBUF col
 	return target;
 
 _fail2:
-	if (depthBuf) vramFree(depthBuf);
+	if (depthBuf) C3D_VramFree(depthBuf);
 _fail1:
-	vramFree(colorBuf);
+	C3D_VramFree(colorBuf);
 _fail0:
 	return NULL;
 }
@@ -327,9 +917,7 @@ C3D_RenderTarget* C3D_RenderTargetCreateFromTex(C3D_Tex* tex, GPU_TEXFACE face,
 	{
 		GPU_DEPTHBUF depthFmtReal = C3D_DEPTHTYPE_VAL(depthFmt);
 		size_t depthSize = C3D_CalcDepthBufSize(fb->width,fb->height,depthFmtReal);
-		vramAllocPos vramBank = addrGetVRAMBank(tex->data);
-		void* depthBuf = vramAllocAt(depthSize, vramBank ^ VRAM_ALLOC_ANY); // Attempt opposite bank first...
-		if (!depthBuf) depthBuf = vramAllocAt(depthSize, vramBank); // ... if that fails, attempt same bank
+		void* depthBuf = C3D_VramAlloc(depthSize, C3D_VRAM_DEPTH, tex->data); // Opposite bank of the texture if possible
 		if (!depthBuf)
 		{
 			free(target);
@@ -344,12 +932,61 @@ C3D_RenderTarget* C3D_RenderTargetCreateFromTex(C3D_Tex* tex, GPU_TEXFACE face,
 	return target;
 }
 
+static bool C3Di_RenderTargetMatches(C3D_RenderTarget* target, int width, int height, GPU_COLORBUF colorFmt, C3D_DEPTHTYPE depthFmt)
+{
+	C3D_FrameBuf* fb = &target->frameBuf;
+	if (fb->width != width || fb->height != height || fb->colorFmt != colorFmt)
+		return false;
+	if (!C3D_DEPTHTYPE_OK(depthFmt))
+		return !fb->depthBuf;
+	return fb->depthBuf && fb->depthFmt == C3D_DEPTHTYPE_VAL(depthFmt);
+}
+
+C3D_RenderTarget* C3D_RenderTargetAcquire(int width, int height, GPU_COLORBUF colorFmt, C3D_DEPTHTYPE depthFmt)
+{
+	if (!inFrame) return NULL;
+
+	C3D_RenderTarget* target;
+	for (target = firstTarget; target; target = target->next)
+	{
+		if (!target->pooled || target->poolBusy || !C3D_FenceIsSignaled(target->poolFence))
+			continue;
+		if (C3Di_RenderTargetMatches(target, width, height, colorFmt, depthFmt))
+			break;
+	}
+
+	if (!target)
+	{
+		target = C3D_RenderTargetCreate(width, height, colorFmt, depthFmt);
+		if (!target) return NULL;
+		target->pooled = true;
+	}
+
+	target->poolBusy = true;
+	target->poolFrame = frameIndex;
+	return target;
+}
+
+void C3D_RenderTargetPoolTrim(u32 maxIdleFrames)
+{
+	C3D_RenderTarget *target, *next;
+	for (target = firstTarget; target; target = next)
+	{
+		next = target->next;
+		if (!target->pooled || target->poolBusy || frameIndex - target->poolFrame <= maxIdleFrames)
+			continue;
+		// Targets the GPU may still be using stay around until a later trim
+		if (C3D_FenceIsSignaled(target->poolFence))
+			C3Di_RenderTargetDestroy(target);
+	}
+}
+
 void C3Di_RenderTargetDestroy(C3D_RenderTarget* target)
 {
 	if (target->ownsColor)
-		vramFree(target->frameBuf.colorBuf);
+		C3D_VramFree(target->frameBuf.colorBuf);
 	if (target->ownsDepth)
-		vramFree(target->frameBuf.depthBuf);
+		C3D_VramFree(target->frameBuf.depthBuf);
 
 	C3D_RenderTarget** prevNext = target->prev ? &target->prev->next : &firstTarget;
 	C3D_RenderTarget** nextPrev = target->next ? &target->next->prev : &lastTarget;
@@ -360,7 +997,7 @@ void C3Di_RenderTargetDestroy(C3D_RenderTarget* target)
 
 void C3D_RenderTargetDelete(C3D_RenderTarget* target)
 {
-	if (inFrame)
+	if (inFrame || target->pooled)
 		svcBreak(USERBREAK_PANIC); // Shouldn't happen.
 	if (target->linked)
 		C3D_RenderTargetDetachOutput(target);
@@ -369,6 +1006,51 @@ void C3D_RenderTargetDelete(C3D_RenderTarget* target)
 	C3Di_RenderTargetDestroy(target);
 }
 
+void C3D_RenderTargetClearMany(const C3D_RenderTargetClearOp* ops, int count)
+{
+	C3Di_Fill fills[16];
+	int i = 0;
+
+	while (i < count)
+	{
+		// Gather a batch of fills
+		int j, numFills = 0;
+		for (; i < count && numFills <= 14; i ++)
+			numFills += C3Di_FrameBufFills(&ops[i].target->frameBuf, ops[i].clearBits, ops[i].clearColor, ops[i].clearDepth, &fills[numFills]);
+
+		// Pair every fill with one in the other bank where possible so both engines work in parallel
+		for (j = 0; j < numFills; j ++)
+		{
+			if (!fills[j].buf)
+				continue;
+			C3Di_Fill* a = &fills[j];
+			C3Di_Fill* b = NULL;
+			int k;
+			for (k = j+1; k < numFills; k ++)
+			{
+				if (!fills[k].buf)
+					continue;
+				if (!b)
+					b = &fills[k];
+				if (addrGetVRAMBank(fills[k].buf) != addrGetVRAMBank(a->buf))
+				{
+					b = &fills[k];
+					break;
+				}
+			}
+
+			if (b)
+			{
+				GX_MemoryFill(a->buf, a->value, a->end, a->control, b->buf, b->value, b->end, b->control);
+				b->buf = NULL;
+			}
+			else
+				GX_MemoryFill(a->buf, a->value, a->end, a->control, NULL, 0, NULL, 0);
+			a->buf = NULL;
+		}
+	}
+}
+
 void C3D_RenderTargetSetOutput(C3D_RenderTarget* target, gfxScreen_t screen, gfx3dSide_t side, u32 transferFlags)
 {
 	int id = 0;
@@ -385,6 +1067,8 @@ void C3D_RenderTargetSetOutput(C3D_RenderTarget* target, gfxScreen_t screen, gfx
 	{
 		target->linked = true;
 		target->transferFlags = transferFlags;
+		target->staleTop = 0;
+		target->staleBottom = target->frameBuf.height;
 		target->screen = screen;
 		target->side = side;
 	}
@@ -0,0 +1,173 @@
+#include "internal.h"
+#include <c3d/secondary.h>
+#include <c3d/uniforms.h>
+
+static void C3Di_SecAdd(C3D_SecondaryList* sl, u32 header, const u32* param, u32 num)
+{
+	C3D_CmdList* list = &sl->list;
+	if (sl->overflow || !num)
+		return;
+	if (list->used + num + 2 > list->size)
+	{
+		sl->overflow = true;
+		return;
+	}
+
+	// Same packet layout as GPUCMD_Add: first parameter, header, remaining parameters, 8-byte padding
+	u32* p = list->buf + list->used;
+	u32 i;
+	*p++ = param[0];
+	*p++ = header | ((num-1) << 20);
+	for (i = 1; i < num; i ++)
+		*p++ = param[i];
+	list->used += num + 1;
+	if (list->used & 1)
+		list->buf[list->used++] = 0;
+}
+
+static inline void C3Di_SecWrite(C3D_SecondaryList* sl, u32 reg, u32 mask, u32 val)
+{
+	C3Di_SecAdd(sl, GPUCMD_HEADER(0, mask, reg), &val, 1);
+}
+
+bool C3D_SecondaryInit(C3D_SecondaryList* sl, size_t size)
+{
+	if (!C3D_CmdListInit(&sl->list, size))
+		return false;
+	C3D_SecondaryReset(sl);
+	return true;
+}
+
+void C3D_SecondaryDelete(C3D_SecondaryList* sl)
+{
+	C3D_CmdListDelete(&sl->list);
+}
+
+void C3D_SecondaryReset(C3D_SecondaryList* sl)
+{
+	sl->list.used = 0;
+	sl->touched = 0;
+	sl->bufBase = 0;
+	sl->draws = 0;
+	sl->overflow = false;
+	sl->invalid = false;
+}
+
+void C3D_SecondaryWrite(C3D_SecondaryList* sl, u32 reg, u32 mask, u32 val)
+{
+	C3Di_SecWrite(sl, reg, mask, val);
+	sl->touched |= C3D_SECONDARY_RAW;
+}
+
+void C3D_SecondaryUniforms(C3D_SecondaryList* sl, GPU_SHADER_TYPE type, int id, const C3D_FVec* data, int num)
+{
+	int offset = type == GPU_GEOMETRY_SHADER ? (GPUREG_GSH_BOOLUNIFORM-GPUREG_VSH_BOOLUNIFORM) : 0;
+	if (id < 0 || num <= 0 || id+num > C3D_FVUNIF_COUNT)
+		return;
+
+	while (num > 0)
+	{
+		// A packet holds at most 256 parameters
+		int n = num > 64 ? 64 : num;
+		C3Di_SecWrite(sl, GPUREG_VSH_FLOATUNIFORM_CONFIG+offset, 0xF, 0x80000000|id);
+		C3Di_SecAdd(sl, GPUCMD_HEADER(0, 0xF, GPUREG_VSH_FLOATUNIFORM_DATA+offset), (const u32*)data, n*4);
+		id += n;
+		data += n;
+		num -= n;
+	}
+	sl->touched |= type == GPU_GEOMETRY_SHADER ? C3D_SECONDARY_GSHUNIF : C3D_SECONDARY_VSHUNIF;
+}
+
+void C3D_SecondaryBufInfo(C3D_SecondaryList* sl, const C3D_BufInfo* info)
+{
+	C3Di_SecWrite(sl, GPUREG_ATTRIBBUFFERS_LOC, 0xF, info->base_paddr >> 3);
+	C3Di_SecAdd(sl, GPUCMD_HEADER(1, 0xF, GPUREG_ATTRIBBUFFER0_OFFSET), (const u32*)info->buffers, sizeof(info->buffers)/sizeof(u32));
+	sl->bufBase = info->base_paddr;
+	sl->touched |= C3D_SECONDARY_BUFINFO;
+}
+
+void C3D_SecondaryDrawArrays(C3D_SecondaryList* sl, GPU_Primitive_t primitive, int first, int size)
+{
+	C3Di_SecWrite(sl, GPUREG_PRIMITIVE_CONFIG, 2, primitive);
+	C3Di_SecWrite(sl, GPUREG_RESTART_PRIMITIVE, 0xF, 1);
+	C3Di_SecWrite(sl, GPUREG_INDEXBUFFER_CONFIG, 0xF, 0x80000000);
+	C3Di_SecWrite(sl, GPUREG_NUMVERTICES, 0xF, size);
+	C3Di_SecWrite(sl, GPUREG_VERTEX_OFFSET, 0xF, first);
+	C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG2, 1, 1);
+	C3Di_SecWrite(sl, GPUREG_START_DRAW_FUNC0, 1, 0);
+	C3Di_SecWrite(sl, GPUREG_DRAWARRAYS, 0xF, 1);
+	C3Di_SecWrite(sl, GPUREG_START_DRAW_FUNC0, 1, 1);
+	C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG2, 1, 0);
+	C3Di_SecWrite(sl, GPUREG_VTX_FUNC, 0xF, 1);
+	sl->touched |= C3D_SECONDARY_DRAW;
+	sl->draws++;
+}
+
+void C3D_SecondaryDrawElements(C3D_SecondaryList* sl, GPU_Primitive_t primitive, int count, int type, const void* indices)
+{
+	// Indices are relative to the attribute buffer base, which the recording has to set itself
+	u32 pa = osConvertVirtToPhys(indices);
+	if (!sl->bufBase || pa < sl->bufBase)
+	{
+		sl->invalid = true;
+		return;
+	}
+
+	C3Di_SecWrite(sl, GPUREG_PRIMITIVE_CONFIG, 2, primitive != GPU_TRIANGLES ? primitive : GPU_GEOMETRY_PRIM);
+	C3Di_SecWrite(sl, GPUREG_RESTART_PRIMITIVE, 0xF, 1);
+	C3Di_SecWrite(sl, GPUREG_INDEXBUFFER_CONFIG, 0xF, (pa - sl->bufBase) | (type << 31));
+	C3Di_SecWrite(sl, GPUREG_NUMVERTICES, 0xF, count);
+	C3Di_SecWrite(sl, GPUREG_VERTEX_OFFSET, 0xF, 0);
+	if (primitive == GPU_TRIANGLES)
+	{
+		C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG, 2, 0x100);
+		C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG2, 2, 0x100);
+	}
+	C3Di_SecWrite(sl, GPUREG_START_DRAW_FUNC0, 1, 0);
+	C3Di_SecWrite(sl, GPUREG_DRAWELEMENTS, 0xF, 1);
+	C3Di_SecWrite(sl, GPUREG_START_DRAW_FUNC0, 1, 1);
+	if (primitive == GPU_TRIANGLES)
+	{
+		C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG, 2, 0);
+		C3Di_SecWrite(sl, GPUREG_GEOSTAGE_CONFIG2, 2, 0);
+	}
+	C3Di_SecWrite(sl, GPUREG_VTX_FUNC, 0xF, 1);
+	C3Di_SecWrite(sl, GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
+	C3Di_SecWrite(sl, GPUREG_PRIMITIVE_CONFIG, 0x8, 0);
+	sl->touched |= C3D_SECONDARY_DRAW;
+	sl->draws++;
+}
+
+bool C3D_SecondaryCall(C3D_SecondaryList* sl)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || sl->overflow || sl->invalid)
+		return false;
+	if (!sl->list.used)
+		return true;
+
+	// Send the pending primary state first, the secondary inherits it
+	C3Di_UpdateContext();
+	C3Di_CmdBufEnsureSpace(sl->list.used + C3Di_CmdBufHeadroom(ctx));
+	C3Di_FrameBufUpdate(ctx);
+	GPUCMD_AddRawCommands(sl->list.buf, sl->list.used);
+
+	// Restore whatever the secondary changed
+	if (sl->touched & C3D_SECONDARY_RAW)
+		C3Di_DirtyState(ctx, false);
+	else
+	{
+		if (sl->touched & C3D_SECONDARY_VSHUNIF)
+			C3Di_DirtyUniforms(GPU_VERTEX_SHADER);
+		if (sl->touched & C3D_SECONDARY_GSHUNIF)
+			C3Di_DirtyUniforms(GPU_GEOMETRY_SHADER);
+		if (sl->touched & C3D_SECONDARY_BUFINFO)
+			ctx->flags |= C3DiF_BufInfo;
+	}
+
+	if (sl->touched & C3D_SECONDARY_DRAW)
+		ctx->flags |= C3DiF_DrawUsed;
+	C3Di_STAT_ADD(draws, sl->draws);
+	return true;
+}
@@ -0,0 +1,122 @@
+#include "internal.h"
+#include <c3d/effect.h>
+#include <c3d/shadow.h>
+
+bool C3D_ShadowPassInit(C3D_ShadowPass* pass, C3D_Tex* tex, C3D_DEPTHTYPE depthFmt)
+{
+	int i;
+	memset(pass, 0, sizeof(*pass));
+	pass->tex = tex;
+	pass->numFaces = C3D_TexGetType(tex) == GPU_TEX_SHADOW_CUBE ? 6 : 1;
+
+	for (i = 0; i < pass->numFaces; i ++)
+	{
+		pass->targets[i] = C3D_RenderTargetCreateFromTex(tex, (GPU_TEXFACE)i, 0, depthFmt);
+		if (!pass->targets[i])
+		{
+			C3D_ShadowPassDelete(pass);
+			return false;
+		}
+	}
+	return true;
+}
+
+void C3D_ShadowPassDelete(C3D_ShadowPass* pass)
+{
+	int i;
+	for (i = 0; i < 6; i ++)
+		if (pass->targets[i])
+			C3D_RenderTargetDelete(pass->targets[i]);
+	C3D_PipelineStateDelete(pass->caster);
+	C3D_PipelineStateDelete(pass->receiver);
+	C3D_CmdListDelete(&pass->casterList);
+	memset(pass, 0, sizeof(*pass));
+}
+
+bool C3D_ShadowPassBakeCaster(C3D_ShadowPass* pass, float scale, float bias)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	C3D_Effect saved = ctx->effect;
+
+	C3D_FragOpMode(GPU_FRAGOPMODE_SHADOW);
+	C3D_FragOpShadow(scale, bias);
+	C3D_PipelineStateDelete(pass->caster);
+	pass->caster = C3D_PipelineStateCreate();
+
+	ctx->effect = saved;
+	return pass->caster != NULL;
+}
+
+bool C3D_ShadowPassBakeReceiver(C3D_ShadowPass* pass, bool perspective, float bias)
+{
+	pass->texShadow = C3Di_TexShadowValue(perspective, bias);
+
+	C3D_PipelineStateDelete(pass->receiver);
+	pass->receiver = C3D_PipelineStateCreate();
+	return pass->receiver != NULL;
+}
+
+bool C3D_ShadowPassBeginCaster(C3D_ShadowPass* pass, int face)
+{
+	if (!pass->caster || face < 0 || face >= pass->numFaces || !C3D_FrameDrawOn(pass->targets[face]))
+		return false;
+
+	C3D_PipelineStateBind(pass->caster);
+	return true;
+}
+
+bool C3D_ShadowPassBeginReceiver(C3D_ShadowPass* pass, C3D_RenderTarget* target)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!pass->receiver || !C3D_FrameDrawOn(target))
+		return false;
+
+	C3D_PipelineStateBind(pass->receiver);
+	C3D_TexBind(0, pass->tex);
+	if (ctx->texShadow != pass->texShadow)
+	{
+		ctx->texShadow = pass->texShadow;
+		ctx->flags |= C3DiF_TexStatus;
+	}
+	return true;
+}
+
+bool C3D_ShadowPassRecordBegin(C3D_ShadowPass* pass, size_t size, int viewProjUniform)
+{
+	if (!pass->caster || pass->recording)
+		return false;
+
+	if (pass->casterList.size*4 < size)
+	{
+		C3D_CmdListDelete(&pass->casterList);
+		if (!C3D_CmdListInit(&pass->casterList, size))
+			return false;
+	}
+
+	if (!C3D_CmdListBeginStereo(&pass->casterList, viewProjUniform))
+		return false;
+
+	C3D_PipelineStateBind(pass->caster);
+	pass->recording = true;
+	return true;
+}
+
+bool C3D_ShadowPassRecordEnd(C3D_ShadowPass* pass)
+{
+	if (!pass->recording)
+		return false;
+
+	pass->recording = false;
+	return C3D_CmdListEnd(&pass->casterList);
+}
+
+void C3D_ShadowPassRenderCube(C3D_ShadowPass* pass, const C3D_Mtx viewProj[6])
+{
+	int i;
+	if (pass->recording || C3D_CmdListIsEmpty(&pass->casterList))
+		return;
+
+	for (i = 0; i < pass->numFaces; i ++)
+		C3D_CmdListCallProj(&pass->casterList, pass->targets[i], &viewProj[i]);
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <c3d/skeleton.h>
+
+static inline void poseLerp(C3D_BonePose* out, const C3D_BonePose* a, const C3D_BonePose* b, float t)
+{
+	float s = 1.0f - t;
+	out->rot   = Quat_Nlerp(a->rot, b->rot, t);
+	out->pos   = FVec3_New(a->pos.x*s + b->pos.x*t, a->pos.y*s + b->pos.y*t, a->pos.z*s + b->pos.z*t);
+	out->scale = FVec3_New(a->scale.x*s + b->scale.x*t, a->scale.y*s + b->scale.y*t, a->scale.z*s + b->scale.z*t);
+}
+
+// Returns the last key at or before time, starting the search at the cached key
+static int findKey(const C3D_AnimTrack* track, float time, int k)
+{
+	const float* times = track->times;
+	int n = track->numKeys;
+	int i;
+
+	if (k >= n || times[k] > time)
+		k = 0;
+
+	// Playback usually advances by at most a few keys per frame
+	for (i = 0; i < 4 && k+1 < n && times[k+1] <= time; i ++)
+		k ++;
+
+	if (k+1 < n && times[k+1] <= time)
+	{
+		int lo = k+1, hi = n-1;
+		while (lo < hi)
+		{
+			int mid = (lo+hi+1)/2;
+			if (times[mid] <= time)
+				lo = mid;
+			else
+				hi = mid-1;
+		}
+		k = lo;
+	}
+	return k;
+}
+
+void C3D_AnimSample(const C3D_AnimClip* clip, float time, bool loop, C3D_BonePose* pose, u16* cursors)
+{
+	int i;
+
+	if (loop && clip->duration > 0.0f)
+	{
+		time = fmodf(time, clip->duration);
+		if (time < 0.0f)
+			time += clip->duration;
+	} else if (time > clip->duration)
+		time = clip->duration;
+
+	for (i = 0; i < clip->numTracks; i ++)
+	{
+		const C3D_AnimTrack* track = &clip->tracks[i];
+		C3D_BonePose* out = &pose[track->bone];
+
+		if (!track->numKeys)
+			continue;
+
+		int k = findKey(track, time, cursors ? cursors[i] : 0);
+		if (cursors)
+			cursors[i] = k;
+
+		if (k+1 >= track->numKeys || time <= track->times[k])
+		{
+			*out = track->keys[k];
+			continue;
+		}
+
+		float t0 = track->times[k], t1 = track->times[k+1];
+		poseLerp(out, &track->keys[k], &track->keys[k+1], (time-t0) / (t1-t0));
+	}
+}
+
+void C3D_PoseBlend(C3D_BonePose* out, const C3D_BonePose* a, const C3D_BonePose* b, float t, int count)
+{
+	int i;
+	for (i = 0; i < count; i ++)
+		poseLerp(&out[i], &a[i], &b[i], t);
+}
+
+static void poseToMtx(C3D_Mtx* m, const C3D_BonePose* p)
+{
+	C3D_FQuat q = p->rot;
+	float sx = p->scale.x, sy = p->scale.y, sz = p->scale.z;
+	float ii = q.i*q.i, ij = q.i*q.j, ik = q.i*q.k;
+	float jj = q.j*q.j, jk = q.j*q.k, kk = q.k*q.k;
+	float ri = q.r*q.i, rj = q.r*q.j, rk = q.r*q.k;
+
+	// Mtx_FromQuat with the scale folded into the columns and the translation into w
+	m->r[0].x = (1.0f - 2.0f*(jj + kk)) * sx;
+	m->r[0].y = 2.0f*(ij - rk) * sy;
+	m->r[0].z = 2.0f*(ik + rj) * sz;
+	m->r[0].w = p->pos.x;
+
+	m->r[1].x = 2.0f*(ij + rk) * sx;
+	m->r[1].y = (1.0f - 2.0f*(ii + kk)) * sy;
+	m->r[1].z = 2.0f*(jk - ri) * sz;
+	m->r[1].w = p->pos.y;
+
+	m->r[2].x = 2.0f*(ik - rj) * sx;
+	m->r[2].y = 2.0f*(jk + ri) * sy;
+	m->r[2].z = (1.0f - 2.0f*(ii + jj)) * sz;
+	m->r[2].w = p->pos.z;
+
+	m->r[3] = FVec4_New(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void C3D_SkeletonWorld(const C3D_Skeleton* skel, const C3D_BonePose* pose, C3D_Mtx* world)
+{
+	int i;
+	for (i = 0; i < skel->numBones; i ++)
+	{
+		int parent = skel->parents ? skel->parents[i] : -1;
+		if (parent < 0)
+		{
+			poseToMtx(&world[i], &pose[i]);
+			continue;
+		}
+
+		C3D_Mtx local;
+		poseToMtx(&local, &pose[i]);
+		Mtx_MultiplyAffine(&world[i], &world[parent], &local);
+	}
+}
+
+bool C3D_SkeletonUpload(GPU_SHADER_TYPE type, int id, const C3D_Skeleton* skel, const C3D_BonePose* pose, C3D_Mtx* world)
+{
+	int rows = skel->numBones*3;
+	if (id < 0 || id+rows > C3D_FVUNIF_COUNT)
+		return false;
+
+	C3D_SkeletonWorld(skel, pose, world);
+
+	// Rows are written in place, the dirty range is only marked once it is known
+	C3D_FVec* unif = &C3D_FVUnif[type][id];
+	int first = rows, last = -1;
+	int i, j;
+	for (i = 0; i < skel->numBones; i ++)
+	{
+		const C3D_Mtx* m = &world[i];
+		C3D_Mtx skin;
+		if (skel->invBind)
+		{
+			Mtx_MultiplyAffine(&skin, m, &skel->invBind[i]);
+			m = &skin;
+		}
+
+		for (j = 0; j < 3; j ++)
+		{
+			C3D_FVec* dst = &unif[i*3+j];
+			if (memcmp(dst, &m->r[j], sizeof(C3D_FVec)) == 0)
+				continue;
+
+			*dst = m->r[j];
+			if (first > i*3+j)
+				first = i*3+j;
+			last = i*3+j;
+		}
+	}
+
+	if (last >= first)
+		C3D_FVUnifWritePtr(type, id+first, last-first+1);
+	return true;
+}
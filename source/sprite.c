@@ -0,0 +1,177 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/base.h>
+#include <c3d/sprite.h>
+#include <tex3ds.h>
+
+bool C3D_SpriteBatchInit(C3D_SpriteBatch* sb, C3D_StreamBuf* stream, u32 capacity)
+{
+	if (capacity < 1 || capacity > 0xFFFF)
+		return false;
+
+	C3D_Sprite* sprites = (C3D_Sprite*)malloc(capacity*sizeof(C3D_Sprite));
+	u16* order = (u16*)malloc(capacity*2*sizeof(u16));
+	if (!sprites || !order)
+	{
+		free(sprites);
+		free(order);
+		return false;
+	}
+	C3D_SpriteBatchInitWithBuffer(sb, stream, sprites, order, capacity);
+	sb->ownsBuf = true;
+	return true;
+}
+
+void C3D_SpriteBatchInitWithBuffer(C3D_SpriteBatch* sb, C3D_StreamBuf* stream, C3D_Sprite* sprites, u16* order, u32 capacity)
+{
+	sb->stream = stream;
+	sb->sprites = sprites;
+	sb->order = order;
+	sb->count = 0;
+	sb->capacity = capacity;
+	sb->sort = C3D_SPRITESORT_NONE;
+	sb->ownsBuf = false;
+}
+
+void C3D_SpriteBatchDelete(C3D_SpriteBatch* sb)
+{
+	if (sb->ownsBuf)
+	{
+		free(sb->sprites);
+		free(sb->order);
+	}
+	memset(sb, 0, sizeof(*sb));
+}
+
+C3D_Sprite* C3D_SpriteBatchAdd(C3D_SpriteBatch* sb, C3D_Tex* tex)
+{
+	if (sb->count == sb->capacity)
+		return NULL;
+
+	C3D_Sprite* s = &sb->sprites[sb->count++];
+	memset(s, 0, sizeof(*s));
+	s->tex = tex;
+	if (tex)
+	{
+		s->width  = tex->width;
+		s->height = tex->height;
+	}
+	s->top   = 1.0f;
+	s->right = 1.0f;
+	s->color = 0xFFFFFFFF;
+	return s;
+}
+
+void C3D_SpriteSetSubTex(C3D_Sprite* s, const Tex3DS_SubTexture* subtex)
+{
+	s->width  = subtex->width;
+	s->height = subtex->height;
+	s->left   = subtex->left;
+	s->top    = subtex->top;
+	s->right  = subtex->right;
+	s->bottom = subtex->bottom;
+	if (Tex3DS_SubTextureRotated(subtex))
+		s->flags |= C3D_SPRITE_UV_SWAP;
+	else
+		s->flags &= ~C3D_SPRITE_UV_SWAP;
+}
+
+static inline void C3Di_SpriteVertex(C3D_SpriteVertex* v, const C3D_Sprite* s, float x, float y, float u, float t, float c, float sn, float dx)
+{
+	if (s->flags & C3D_SPRITE_ROTATE)
+	{
+		float rx = x*c - y*sn;
+		y = x*sn + y*c;
+		x = rx;
+	}
+	v->pos[0] = s->x + x + dx;
+	v->pos[1] = s->y + y;
+	v->pos[2] = s->z;
+	if (s->flags & C3D_SPRITE_UV_SWAP)
+	{
+		v->uv[0] = t;
+		v->uv[1] = u;
+	} else
+	{
+		v->uv[0] = u;
+		v->uv[1] = t;
+	}
+	v->color = s->color;
+}
+
+static void C3Di_SpriteQuad(C3D_SpriteVertex* v, const C3D_Sprite* s, float parallax)
+{
+	float x0 = -s->pivotX*s->width,  x1 = x0 + s->width;
+	float y0 = -s->pivotY*s->height, y1 = y0 + s->height;
+	float u0 = s->left, u1 = s->right;
+	float v0 = s->top,  v1 = s->bottom;
+	float c = 1.0f, sn = 0.0f;
+	float dx = s->depth*parallax;
+
+	if (s->flags & C3D_SPRITE_FLIP_X)
+	{
+		u0 = s->right;
+		u1 = s->left;
+	}
+	if (s->flags & C3D_SPRITE_FLIP_Y)
+	{
+		v0 = s->bottom;
+		v1 = s->top;
+	}
+	if (s->flags & C3D_SPRITE_ROTATE)
+	{
+		c  = cosf(s->angle);
+		sn = sinf(s->angle);
+	}
+
+	// Two triangles: top left, bottom left, top right and top right, bottom left, bottom right
+	C3Di_SpriteVertex(&v[0], s, x0, y0, u0, v0, c, sn, dx);
+	C3Di_SpriteVertex(&v[1], s, x0, y1, u0, v1, c, sn, dx);
+	C3Di_SpriteVertex(&v[2], s, x1, y0, u1, v0, c, sn, dx);
+	v[3] = v[2];
+	v[4] = v[1];
+	C3Di_SpriteVertex(&v[5], s, x1, y1, u1, v1, c, sn, dx);
+}
+
+bool C3D_SpriteBatchDraw(C3D_SpriteBatch* sb, float parallax)
+{
+	u32 i, n = sb->count;
+	if (!n)
+		return true;
+
+	C3D_SpriteVertex* verts = (C3D_SpriteVertex*)C3D_StreamBufAlloc(sb->stream, n*6*sizeof(C3D_SpriteVertex), 8);
+	if (!verts)
+		return false;
+
+	const u16* order = NULL;
+	if (sb->sort == C3D_SPRITESORT_TEXTURE)
+		order = C3Di_RadixSort(&sb->sprites[0].tex, sizeof(C3D_Sprite), n, sb->order, sb->order + sb->capacity);
+
+	for (i = 0; i < n; i ++)
+		C3Di_SpriteQuad(&verts[i*6], &sb->sprites[order ? order[i] : i], parallax);
+
+	C3D_AttrInfo* attrInfo = C3D_GetAttrInfo();
+	AttrInfo_Init(attrInfo);
+	AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3);
+	AttrInfo_AddLoader(attrInfo, 1, GPU_FLOAT, 2);
+	AttrInfo_AddLoader(attrInfo, 2, GPU_UNSIGNED_BYTE, 4);
+
+	C3D_BufInfo* bufInfo = C3D_GetBufInfo();
+	BufInfo_Init(bufInfo);
+	BufInfo_Add(bufInfo, verts, sizeof(C3D_SpriteVertex), 3, 0x210);
+
+	// One draw per run of sprites sharing a texture
+	u32 start = 0;
+	for (i = 1; i <= n; i ++)
+	{
+		C3D_Tex* tex = sb->sprites[order ? order[start] : start].tex;
+		if (i < n && sb->sprites[order ? order[i] : i].tex == tex)
+			continue;
+
+		if (tex)
+			C3D_TexBind(0, tex);
+		C3D_DrawArrays(GPU_TRIANGLES, start*6, (i-start)*6);
+		start = i;
+	}
+	return true;
+}
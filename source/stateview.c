@@ -0,0 +1,216 @@
+#include "internal.h"
+#include <c3d/base.h>
+#include <c3d/stateview.h>
+
+typedef struct
+{
+	u32 groups;
+	shaderProgram_s* program;
+	C3D_AttrInfo attrInfo;
+	C3D_BufInfo bufInfo;
+	C3D_Effect effect;
+	C3D_TexEnv texEnv[6];
+	u32 texEnvBuf, texEnvBufClr;
+	u32 texConfig, texShadow;
+	C3D_Tex* tex[3];
+	u32 viewport[5];
+	u32 scissor[3];
+	C3D_LightEnv* lightEnv;
+	C3D_FogLut* fogLut;
+	u32 fogClr;
+} C3Di_StateView;
+
+static C3Di_StateView stateStack[C3D_STATE_STACK_DEPTH];
+static int stateDepth;
+
+// Bits of texEnvBuf holding the fog/gas mode and the z flip, the rest are the update masks
+#define TEXENVBUF_MODE_MASK 0x100FF
+
+static u32 effectDiff(const C3D_Effect* a, const C3D_Effect* b)
+{
+	u32 parts = 0;
+	if (a->zBuffer != b->zBuffer || a->zScale != b->zScale || a->zOffset != b->zOffset)
+		parts |= C3DiE_DepthMap;
+	if (a->cullMode != b->cullMode)
+		parts |= C3DiE_Cull;
+	if (a->alphaTest != b->alphaTest)
+		parts |= C3DiE_AlphaTest;
+	if (a->stencilMode != b->stencilMode || a->stencilOp != b->stencilOp)
+		parts |= C3DiE_Stencil;
+	if (a->depthTest != b->depthTest)
+		parts |= C3DiE_DepthTest;
+	if (a->alphaBlend != b->alphaBlend || ((a->fragOpMode ^ b->fragOpMode) & 0xFF00))
+		parts |= C3DiE_Blend;
+	if (a->blendClr != b->blendClr)
+		parts |= C3DiE_BlendColor;
+	if (a->clrLogicOp != b->clrLogicOp)
+		parts |= C3DiE_LogicOp;
+	if (((a->fragOpMode ^ b->fragOpMode) & 0xFF00FF) || a->fragOpShadow != b->fragOpShadow)
+		parts |= C3DiE_FragOp;
+	if (a->earlyDepth != b->earlyDepth || a->earlyDepthFunc != b->earlyDepthFunc || a->earlyDepthRef != b->earlyDepthRef
+		|| a->earlyDepthAuto != b->earlyDepthAuto)
+		parts |= C3DiE_EarlyDepth;
+	return parts;
+}
+
+bool C3D_StatePush(u32 groups)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || stateDepth == C3D_STATE_STACK_DEPTH)
+		return false;
+
+	C3Di_StateView* v = &stateStack[stateDepth++];
+	v->groups = groups;
+
+	if (groups & C3D_STATE_PROGRAM)
+		v->program = ctx->program;
+	if (groups & C3D_STATE_ATTRIB)
+		v->attrInfo = ctx->attrInfo;
+	if (groups & C3D_STATE_BUFFER)
+		v->bufInfo = ctx->bufInfo;
+	if (groups & C3D_STATE_EFFECT)
+		v->effect = ctx->effect;
+	if (groups & C3D_STATE_TEXENV)
+		memcpy(v->texEnv, ctx->texEnv, sizeof(v->texEnv));
+	if (groups & C3D_STATE_TEX)
+		memcpy(v->tex, ctx->tex, sizeof(v->tex));
+	if (groups & C3D_STATE_VIEWPORT)
+	{
+		memcpy(v->viewport, ctx->viewport, sizeof(v->viewport));
+		memcpy(v->scissor, ctx->scissor, sizeof(v->scissor));
+	}
+	if (groups & C3D_STATE_LIGHTENV)
+		v->lightEnv = ctx->lightEnv;
+	if (groups & C3D_STATE_FOG)
+	{
+		v->fogLut = ctx->fogLut;
+		v->fogClr = ctx->fogClr;
+	}
+
+	v->texEnvBuf = ctx->texEnvBuf;
+	v->texEnvBufClr = ctx->texEnvBufClr;
+	v->texConfig = ctx->texConfig;
+	v->texShadow = ctx->texShadow;
+	return true;
+}
+
+void C3D_StatePop(void)
+{
+	int i;
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active) || !stateDepth)
+		return;
+
+	C3Di_StateView* v = &stateStack[--stateDepth];
+	u32 groups = v->groups;
+
+	if ((groups & C3D_STATE_PROGRAM) && v->program && v->program != ctx->program)
+		C3D_BindProgram(v->program);
+
+	if ((groups & C3D_STATE_ATTRIB) && memcmp(&v->attrInfo, &ctx->attrInfo, sizeof(v->attrInfo)) != 0)
+	{
+		ctx->attrInfo = v->attrInfo;
+		ctx->flags |= C3DiF_AttrInfo;
+	}
+
+	if ((groups & C3D_STATE_BUFFER) && memcmp(&v->bufInfo, &ctx->bufInfo, sizeof(v->bufInfo)) != 0)
+	{
+		ctx->bufInfo = v->bufInfo;
+		ctx->flags |= C3DiF_BufInfo;
+	}
+
+	if (groups & C3D_STATE_EFFECT)
+	{
+		u32 parts = effectDiff(&v->effect, &ctx->effect);
+		if (parts)
+		{
+			ctx->effect = v->effect;
+			ctx->effectFlags |= parts;
+			ctx->flags |= C3DiF_Effect;
+		}
+	}
+
+	if (groups & C3D_STATE_TEXENV)
+	{
+		// C3Di_UpdateContext skips stages that still match what the GPU holds
+		for (i = 0; i < 6; i ++)
+		{
+			if (memcmp(&v->texEnv[i], &ctx->texEnv[i], sizeof(C3D_TexEnv)) == 0)
+				continue;
+			ctx->texEnv[i] = v->texEnv[i];
+			ctx->flags |= C3DiF_TexEnv(i);
+		}
+
+		u32 diff = (v->texEnvBuf ^ ctx->texEnvBuf) &~ TEXENVBUF_MODE_MASK;
+		if (diff)
+		{
+			ctx->texEnvBuf ^= diff;
+			ctx->texEnvBufFlags |= C3DiB_Update;
+			ctx->flags |= C3DiF_TexEnvBuf;
+		}
+		if (v->texEnvBufClr != ctx->texEnvBufClr)
+		{
+			ctx->texEnvBufClr = v->texEnvBufClr;
+			ctx->texEnvBufFlags |= C3DiB_Color;
+			ctx->flags |= C3DiF_TexEnvBuf;
+		}
+	}
+
+	if (groups & C3D_STATE_TEX)
+	{
+		// Units whose contents did not change are skipped by C3Di_SetTex
+		for (i = 0; i < 3; i ++)
+		{
+			if (v->tex[i] == ctx->tex[i])
+				continue;
+			ctx->tex[i] = v->tex[i];
+			ctx->flags |= C3DiF_Tex(i);
+		}
+		if (v->texConfig != ctx->texConfig || v->texShadow != ctx->texShadow)
+		{
+			ctx->texConfig = v->texConfig;
+			ctx->texShadow = v->texShadow;
+			ctx->flags |= C3DiF_TexStatus;
+		}
+	}
+
+	if (groups & C3D_STATE_VIEWPORT)
+	{
+		if (memcmp(v->viewport, ctx->viewport, sizeof(v->viewport)) != 0)
+		{
+			memcpy(ctx->viewport, v->viewport, sizeof(v->viewport));
+			ctx->flags |= C3DiF_Viewport;
+		}
+		if (memcmp(v->scissor, ctx->scissor, sizeof(v->scissor)) != 0)
+		{
+			memcpy(ctx->scissor, v->scissor, sizeof(v->scissor));
+			ctx->flags |= C3DiF_Scissor;
+		}
+	}
+
+	if (groups & C3D_STATE_LIGHTENV)
+		C3D_LightEnvBind(v->lightEnv);
+
+	if (groups & C3D_STATE_FOG)
+	{
+		u32 diff = (v->texEnvBuf ^ ctx->texEnvBuf) & TEXENVBUF_MODE_MASK;
+		if (diff)
+		{
+			ctx->texEnvBuf ^= diff;
+			ctx->texEnvBufFlags |= C3DiB_Mode;
+			ctx->flags |= C3DiF_TexEnvBuf;
+		}
+		if (v->fogClr != ctx->fogClr)
+		{
+			ctx->fogClr = v->fogClr;
+			ctx->texEnvBufFlags |= C3DiB_FogColor;
+			ctx->flags |= C3DiF_TexEnvBuf;
+		}
+		// The upload is skipped if the LUT is still resident
+		ctx->fogLut = v->fogLut;
+		if (ctx->fogLut)
+			ctx->flags |= C3DiF_FogLut;
+	}
+}
@@ -0,0 +1,174 @@
+#include "internal.h"
+#include <c3d/stats.h>
+#include <c3d/renderqueue.h>
+
+#define STATS_FRAMES  3
+#define STATS_PENDING 64
+
+C3D_FrameStats* C3Di_StatsFrame;
+
+static bool statsEnabled;
+static C3D_FrameStats frames[STATS_FRAMES];
+static u64 segReady[STATS_FRAMES][C3D_STATS_MAX_SPLITS];
+static volatile u32 framePending[STATS_FRAMES];
+static volatile bool frameEnded[STATS_FRAMES];
+static int curFrame;
+static volatile int lastFrame = -1;
+static struct C3D_RenderTarget_tag* curTarget;
+
+static struct
+{
+	u8 frame, seg;
+} pending[STATS_PENDING];
+static volatile u32 pendHead, pendTail;
+static u64 lastEnd;
+
+static void frameCheckDone(int id)
+{
+	if (frameEnded[id] && !framePending[id])
+		lastFrame = id;
+}
+
+static void onP3D(C3D_UNUSED void* unused)
+{
+	if (pendHead == pendTail)
+		return; // Not one of ours
+
+	int id = pending[pendHead % STATS_PENDING].frame;
+	int seg = pending[pendHead % STATS_PENDING].seg;
+	pendHead++;
+
+	u64 now = svcGetSystemTick();
+	u64 start = segReady[id][seg] > lastEnd ? segReady[id][seg] : lastEnd;
+	frames[id].splits[seg].gpuTime = (now - start) / CPU_TICKS_PER_MSEC;
+	lastEnd = now;
+
+	framePending[id]--;
+	frameCheckDone(id);
+}
+
+void C3D_StatsEnable(bool enable)
+{
+	if (enable == statsEnabled)
+		return;
+
+	statsEnabled = enable;
+	C3Di_StatsFrame = NULL;
+	lastFrame = -1;
+	pendHead = pendTail = 0;
+	gspSetEventCallback(GSPGPU_EVENT_P3D, enable ? onP3D : NULL, NULL, false);
+}
+
+bool C3D_StatsGetLast(C3D_FrameStats* out)
+{
+	int id = lastFrame;
+	if (id < 0)
+		return false;
+	memcpy(out, &frames[id], sizeof(*out));
+	return true;
+}
+
+void C3Di_StatsFrameBegin(void)
+{
+	if (!statsEnabled)
+		return;
+
+	curFrame = (curFrame + 1) % STATS_FRAMES;
+	if (lastFrame == curFrame)
+		lastFrame = -1;
+
+	memset(&frames[curFrame], 0, sizeof(frames[curFrame]));
+	memset(segReady[curFrame], 0, sizeof(segReady[curFrame]));
+	framePending[curFrame] = 0;
+	frameEnded[curFrame] = false;
+	curTarget = NULL;
+	C3Di_StatsFrame = &frames[curFrame];
+}
+
+void C3Di_StatsFrameEnd(void)
+{
+	if (!C3Di_StatsFrame)
+		return;
+
+	C3Di_StatsFrame = NULL;
+	frameEnded[curFrame] = true;
+	frameCheckDone(curFrame);
+}
+
+void C3Di_StatsDrawOn(struct C3D_RenderTarget_tag* target)
+{
+	if (!C3Di_StatsFrame || target == curTarget)
+		return;
+
+	// Give each target its own command list so that its GPU time can be told apart
+	C3D_FrameSplit(0);
+	curTarget = target;
+}
+
+void C3Di_StatsSplit(u32 words)
+{
+	C3D_FrameStats* f = C3Di_StatsFrame;
+	if (!f)
+		return;
+
+	f->cmdWords += words;
+	if (f->numSplits >= C3D_STATS_MAX_SPLITS || pendTail - pendHead >= STATS_PENDING)
+		return;
+
+	u32 seg = f->numSplits++;
+	f->splits[seg].target = curTarget;
+	f->splits[seg].cmdWords = words;
+	framePending[curFrame]++;
+	pending[pendTail % STATS_PENDING].frame = curFrame;
+	pending[pendTail % STATS_PENDING].seg = seg;
+	pendTail++;
+}
+
+void C3Di_StatsQueueUsage(u32 entries)
+{
+	C3D_FrameStats* f = C3Di_StatsFrame;
+	if (!f)
+		return;
+
+	if (entries > f->queuePeak)
+		f->queuePeak = entries;
+	f->queueSize = C3Di_GetContext()->gxQueue.maxEntries;
+}
+
+void C3Di_StatsQueueRun(void)
+{
+	if (!C3Di_StatsFrame)
+		return;
+
+	// Command lists queued until now can start executing from this point on
+	u32 i;
+	u64 now = svcGetSystemTick();
+	for (i = 0; i < C3Di_StatsFrame->numSplits; i ++)
+		if (!segReady[curFrame][i])
+			segReady[curFrame][i] = now;
+}
+
+void C3Di_StatsState(u32 flags)
+{
+	C3D_FrameStats* f = C3Di_StatsFrame;
+	int i;
+
+	if (flags & C3DiF_FrameBuf)                f->stateBinds[C3D_STAT_FRAMEBUF]++;
+	if (flags & C3DiF_Viewport)                f->stateBinds[C3D_STAT_VIEWPORT]++;
+	if (flags & C3DiF_Scissor)                 f->stateBinds[C3D_STAT_SCISSOR]++;
+	if (flags & C3DiF_Program)                 f->stateBinds[C3D_STAT_PROGRAM]++;
+	if (flags & (C3DiF_VshCode|C3DiF_GshCode)) f->stateBinds[C3D_STAT_SHADERCODE]++;
+	if (flags & C3DiF_AttrInfo)                f->stateBinds[C3D_STAT_ATTRINFO]++;
+	if (flags & C3DiF_BufInfo)                 f->stateBinds[C3D_STAT_BUFINFO]++;
+	if (flags & C3DiF_Effect)                  f->stateBinds[C3D_STAT_EFFECT]++;
+	if (flags & C3DiF_TexAll)                  f->stateBinds[C3D_STAT_TEXUNITS]++;
+	if (flags & (C3DiF_TexStatus|C3DiF_TexAll)) f->stateBinds[C3D_STAT_TEXSTATUS]++;
+	if (flags & (C3DiF_ProcTex|C3DiF_ProcTexColorLut|C3DiF_ProcTexLutAll)) f->stateBinds[C3D_STAT_PROCTEX]++;
+	if (flags & C3DiF_TexEnvBuf)               f->stateBinds[C3D_STAT_TEXENVBUF]++;
+	if (flags & C3DiF_FogLut)                  f->stateBinds[C3D_STAT_FOGLUT]++;
+	if (flags & (C3DiF_Gas|C3DiF_GasLut))      f->stateBinds[C3D_STAT_GAS]++;
+	if (flags & C3DiF_LightEnv)                f->stateBinds[C3D_STAT_LIGHTENV]++;
+	for (i = 0; i < 6; i ++)
+		if (flags & C3DiF_TexEnv(i))
+			f->stateBinds[C3D_STAT_TEXENV]++;
+}
@@ -0,0 +1,151 @@
+#include "internal.h"
+#include <c3d/streambuf.h>
+
+static C3D_StreamBuf *firstStream, *lastStream;
+
+bool C3D_StreamBufInit(C3D_StreamBuf* sb, size_t size)
+{
+	size = (size + 0xF) &~ 0xF;
+	void* buf = linearAlloc(size);
+	if (!buf)
+		return false;
+
+	C3D_StreamBufInitWithBuffer(sb, buf, size);
+	sb->ownsBuf = true;
+	return true;
+}
+
+void C3D_StreamBufInitWithBuffer(C3D_StreamBuf* sb, void* buf, size_t size)
+{
+	memset(sb, 0, sizeof(*sb));
+	sb->buf = (u8*)buf;
+	sb->size = size;
+
+	sb->prev = lastStream;
+	if (lastStream)
+		lastStream->next = sb;
+	else
+		firstStream = sb;
+	lastStream = sb;
+}
+
+void C3D_StreamBufDelete(C3D_StreamBuf* sb)
+{
+	if (sb->numFrames)
+		C3D_FenceWait(sb->frames[sb->numFrames-1].fence, -1);
+
+	if (sb->prev)
+		sb->prev->next = sb->next;
+	else
+		firstStream = sb->next;
+	if (sb->next)
+		sb->next->prev = sb->prev;
+	else
+		lastStream = sb->prev;
+
+	if (sb->ownsBuf)
+		linearFree(sb->buf);
+	sb->buf = NULL;
+	sb->size = 0;
+}
+
+static void C3Di_StreamBufPop(C3D_StreamBuf* sb)
+{
+	sb->tail = sb->frames[0].end;
+	sb->numFrames--;
+	memmove(&sb->frames[0], &sb->frames[1], sb->numFrames*sizeof(sb->frames[0]));
+
+}
+
+static void C3Di_StreamBufReclaim(C3D_StreamBuf* sb)
+{
+	while (sb->numFrames && C3D_FenceIsSignaled(sb->frames[0].fence))
+		C3Di_StreamBufPop(sb);
+}
+
+// Finds room for size bytes. Outside of an empty ring head never catches up with tail,
+// so head == tail always means that nothing is in use.
+static bool C3Di_StreamBufFit(C3D_StreamBuf* sb, u32 size, u32 align, u32* offset)
+{
+	if (!sb->numFrames && sb->frameStart == sb->head)
+		sb->head = sb->tail = sb->frameStart = 0;
+
+	u32 start = (sb->head + align-1) &~ (align-1);
+	if (sb->head >= sb->tail)
+	{
+		// Free space runs to the end of the buffer, then from the beginning up to tail
+		if (start + size <= sb->size)
+		{
+			*offset = start;
+			return true;
+		}
+		if (size < sb->tail)
+		{
+			*offset = 0;
+			return true;
+		}
+		return false;
+	}
+
+	if (start + size < sb->tail)
+	{
+		*offset = start;
+		return true;
+	}
+	return false;
+}
+
+void* C3D_StreamBufAlloc(C3D_StreamBuf* sb, size_t size, size_t align)
+{
+	u32 offset;
+
+	if (!sb->buf || !size || size >= sb->size)
+		return NULL;
+	if (align < 4)
+		align = 4;
+
+	C3Di_StreamBufReclaim(sb);
+	while (!C3Di_StreamBufFit(sb, size, align, &offset))
+	{
+		// Only work from earlier frames can free space, the current frame has not been submitted
+		if (!sb->numFrames || !C3D_FenceWait(sb->frames[0].fence, -1))
+			return NULL;
+		C3Di_StreamBufPop(sb);
+	}
+
+	sb->head = offset + size;
+
+	void* p = sb->buf + offset;
+	C3D_FlushMarkRange(p, size);
+	return p;
+}
+
+size_t C3D_StreamBufAvailable(C3D_StreamBuf* sb)
+{
+	C3Di_StreamBufReclaim(sb);
+	if (!sb->numFrames && sb->frameStart == sb->head)
+		return sb->size;
+	if (sb->head >= sb->tail)
+		return sb->size - sb->head + sb->tail;
+	return sb->tail - sb->head;
+}
+
+void C3Di_StreamBufFrameEnd(C3D_Fence fence)
+{
+	C3D_StreamBuf* sb;
+	for (sb = firstStream; sb; sb = sb->next)
+	{
+		if (sb->head == sb->frameStart)
+			continue;
+
+		// Too many frames in flight, the newest one absorbs this frame
+		if (sb->numFrames == C3D_STREAMBUF_FRAMES)
+			sb->numFrames--;
+
+		sb->frames[sb->numFrames].end = sb->head;
+		sb->frames[sb->numFrames].fence = fence;
+		sb->numFrames++;
+		sb->frameStart = sb->head;
+		sb->frameId++;
+	}
+}
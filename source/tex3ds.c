@@ -23,7 +23,9 @@
 /** @file tex3ds.c
  *  @brief Tex3DS routines
  */
+#include "internal.h"
 #include <tex3ds.h>
+#include <c3d/jobs.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -70,12 +72,308 @@ static inline bool Tex3DSi_ReadData(decompressCallback callback, void** userdata
 	return true;
 }
 
+static bool
+Tex3DSi_StagedUpload(C3D_Tex* tex, size_t texsize, size_t base_texsize, decompressCallback callback, void* userdata, size_t insize)
+{
+	// Allocate staging buffer in linear memory
+	void* texdata = linearAlloc(texsize);
+	if (!texdata)
+		return false;
+
+	// Decompress into staging buffer for VRAM upload
+	if (!decompress(texdata, texsize, callback, userdata, insize))
+	{
+		linearFree(texdata);
+		return false;
+	}
+
+	// Flush buffer to prepare DMA to VRAM
+	GSPGPU_FlushDataCache(texdata, texsize);
+
+	// Upload texture(s) to VRAM
+	size_t texcount = texsize / base_texsize;
+	for (size_t i = 0; i < texcount; ++i)
+		C3D_TexLoadImage(tex, (u8*)texdata + i * base_texsize, i, -1);
+
+	linearFree(texdata);
+	return true;
+}
+
+#define TEX3DSI_CHUNK_SIZE 0x8000
+#define TEX3DSI_ASYNC_STACK 0x4000
+
+/** @brief Streaming VRAM upload state
+ */
+typedef struct
+{
+	C3D_Tex* tex;
+	size_t   faceSize;          ///< Size of one face, including mipmaps
+	size_t   total;             ///< Number of bytes to produce
+	size_t   pos;               ///< Number of bytes produced so far
+	u8*      chunks[2];         ///< Linear staging chunks
+	u32      pending[2];        ///< Copies in flight out of each chunk
+	int      cur;               ///< Chunk being filled
+	size_t   fill;              ///< Bytes in the current chunk
+	u8       history[0x1000];   ///< LZ back-reference window
+
+	decompressCallback callback;
+	void*    userdata;
+	size_t   insize;
+	u8       inbuf[0x200];
+	size_t   inpos, inlen;
+	bool     error;
+} Tex3DSi_Stream;
+
+static ssize_t
+Tex3DSi_StreamRead(void* userdata, void* buffer, size_t size)
+{
+	Tex3DSi_Stream* s = (Tex3DSi_Stream*)userdata;
+
+	// Hand out what was buffered before reading more
+	if (s->inpos < s->inlen)
+	{
+		size_t n = s->inlen - s->inpos < size ? s->inlen - s->inpos : size;
+		memcpy(buffer, s->inbuf + s->inpos, n);
+		s->inpos += n;
+		return n;
+	}
+
+	if (s->callback)
+		return s->callback(s->userdata, buffer, size);
+
+	size_t n = s->insize < size ? s->insize : size;
+	memcpy(buffer, s->userdata, n);
+	s->userdata = (u8*)s->userdata + n;
+	s->insize -= n;
+	return n;
+}
+
+static inline u8
+Tex3DSi_StreamGet(Tex3DSi_Stream* s)
+{
+	if (s->inpos == s->inlen)
+	{
+		s->inpos = s->inlen = 0;
+		ssize_t n = s->error ? 0 : Tex3DSi_StreamRead(s, s->inbuf, sizeof(s->inbuf));
+		if (n <= 0)
+		{
+			s->error = true;
+			return 0;
+		}
+		s->inlen = n;
+	}
+	return s->inbuf[s->inpos++];
+}
+
+static void
+Tex3DSi_ChunkDone(C3D_UNUSED C3D_Tex* tex, void* param)
+{
+	(*(u32*)param)--;
+}
+
+static void
+Tex3DSi_StreamWait(u32* pending)
+{
+	while (*pending)
+	{
+		if (C3D_TexUploadPoll() && *pending)
+			gspWaitForAnyEvent();
+	}
+}
+
+static void
+Tex3DSi_StreamFlush(Tex3DSi_Stream* s)
+{
+	u8*    chunk = s->chunks[s->cur];
+	size_t start = s->pos - s->fill;
+	size_t done  = 0;
+
+	// A chunk may straddle cube map faces
+	while (done < s->fill)
+	{
+		size_t off   = start + done;
+		size_t face  = off / s->faceSize;
+		size_t inner = off % s->faceSize;
+		size_t n     = s->fill - done < s->faceSize - inner ? s->fill - done : s->faceSize - inner;
+		u8*    dst   = (u8*)(C3Di_TexIs2D(s->tex) ? s->tex->data : s->tex->cube->data[face]) + inner;
+
+		while (!C3Di_TexUploadQueue(s->tex, chunk + done, dst, n, Tex3DSi_ChunkDone, &s->pending[s->cur]))
+			gspWaitForAnyEvent();
+		s->pending[s->cur]++;
+		done += n;
+	}
+
+	// Start filling the other chunk once its copies are done
+	s->cur ^= 1;
+	s->fill = 0;
+	Tex3DSi_StreamWait(&s->pending[s->cur]);
+}
+
+static inline void
+Tex3DSi_StreamPut(Tex3DSi_Stream* s, u8 value)
+{
+	s->history[s->pos & 0xFFF] = value;
+	s->chunks[s->cur][s->fill++] = value;
+	s->pos++;
+	if (s->fill == TEX3DSI_CHUNK_SIZE || s->pos == s->total)
+		Tex3DSi_StreamFlush(s);
+}
+
+static inline void
+Tex3DSi_StreamCopy(Tex3DSi_Stream* s, size_t disp, size_t len)
+{
+	if (disp > s->pos)
+	{
+		s->error = true;
+		return;
+	}
+	while (len-- && s->pos < s->total)
+		Tex3DSi_StreamPut(s, s->history[(s->pos - disp) & 0xFFF]);
+}
+
+static void
+Tex3DSi_StreamLZ(Tex3DSi_Stream* s, bool lz11)
+{
+	while (s->pos < s->total && !s->error)
+	{
+		u8 flags = Tex3DSi_StreamGet(s);
+		for (int i = 0; i < 8 && s->pos < s->total && !s->error; ++i, flags <<= 1)
+		{
+			if (!(flags & 0x80))
+			{
+				Tex3DSi_StreamPut(s, Tex3DSi_StreamGet(s));
+				continue;
+			}
+
+			u8 b0 = Tex3DSi_StreamGet(s);
+			u8 b1 = Tex3DSi_StreamGet(s);
+			size_t len, disp;
+			if (!lz11)
+			{
+				len  = (b0 >> 4) + 3;
+				disp = (((b0 & 0xF) << 8) | b1) + 1;
+			}
+			else if ((b0 >> 4) == 0)
+			{
+				u8 b2 = Tex3DSi_StreamGet(s);
+				len  = (((b0 & 0xF) << 4) | (b1 >> 4)) + 0x11;
+				disp = (((b1 & 0xF) << 8) | b2) + 1;
+			}
+			else if ((b0 >> 4) == 1)
+			{
+				u8 b2 = Tex3DSi_StreamGet(s);
+				u8 b3 = Tex3DSi_StreamGet(s);
+				len  = (((b0 & 0xF) << 12) | (b1 << 4) | (b2 >> 4)) + 0x111;
+				disp = (((b2 & 0xF) << 8) | b3) + 1;
+			}
+			else
+			{
+				len  = (b0 >> 4) + 1;
+				disp = (((b0 & 0xF) << 8) | b1) + 1;
+			}
+			Tex3DSi_StreamCopy(s, disp, len);
+		}
+	}
+}
+
+static void
+Tex3DSi_StreamRLE(Tex3DSi_Stream* s)
+{
+	while (s->pos < s->total && !s->error)
+	{
+		u8 flag = Tex3DSi_StreamGet(s);
+		if (flag & 0x80)
+		{
+			size_t len = (flag & 0x7F) + 3;
+			u8 value = Tex3DSi_StreamGet(s);
+			while (len-- && s->pos < s->total)
+				Tex3DSi_StreamPut(s, value);
+		}
+		else
+		{
+			size_t len = (flag & 0x7F) + 1;
+			while (len-- && s->pos < s->total && !s->error)
+				Tex3DSi_StreamPut(s, Tex3DSi_StreamGet(s));
+		}
+	}
+}
+
+static bool
+Tex3DSi_StreamUpload(C3D_Tex* tex, size_t texsize, size_t base_texsize, decompressCallback callback, void* userdata, size_t insize)
+{
+	Tex3DSi_Stream* s = (Tex3DSi_Stream*)malloc(sizeof(Tex3DSi_Stream));
+	if (!s)
+		return false;
+
+	memset(s, 0, sizeof(*s));
+	s->tex      = tex;
+	s->faceSize = base_texsize;
+	s->total    = texsize;
+	s->callback = callback;
+	s->userdata = userdata;
+	s->insize   = insize;
+
+	s->chunks[0] = (u8*)linearAlloc(2*TEX3DSI_CHUNK_SIZE);
+	if (!s->chunks[0])
+	{
+		free(s);
+		return false;
+	}
+	s->chunks[1] = s->chunks[0] + TEX3DSI_CHUNK_SIZE;
+
+	// Compression header: type, then 24-bit size or 0 followed by a 32-bit size
+	u8 type = Tex3DSi_StreamGet(s);
+	bool ok;
+	if ((type & 0xF0) == 0x20)
+	{
+		// Huffman streams are decompressed in one go as before
+		s->inpos--;
+		ok = !s->error && Tex3DSi_StagedUpload(tex, texsize, base_texsize, Tex3DSi_StreamRead, s, 0);
+	}
+	else
+	{
+		size_t size = Tex3DSi_StreamGet(s);
+		size |= Tex3DSi_StreamGet(s) << 8;
+		size |= Tex3DSi_StreamGet(s) << 16;
+		if (!size)
+		{
+			for (int i = 0; i < 4; ++i)
+				size |= (size_t)Tex3DSi_StreamGet(s) << (8*i);
+		}
+		if (size < texsize)
+			s->error = true;
+
+		if (type == 0x00)
+		{
+			while (s->pos < s->total && !s->error)
+				Tex3DSi_StreamPut(s, Tex3DSi_StreamGet(s));
+		}
+		else if (type == 0x10 || type == 0x11)
+			Tex3DSi_StreamLZ(s, type == 0x11);
+		else if (type == 0x30)
+			Tex3DSi_StreamRLE(s);
+		else
+			s->error = true;
+
+		ok = !s->error && s->pos == s->total;
+	}
+
+	Tex3DSi_StreamWait(&s->pending[0]);
+	Tex3DSi_StreamWait(&s->pending[1]);
+	linearFree(s->chunks[0]);
+	free(s);
+	return ok;
+}
+
+/** @brief Read the header and subtextures
+ *  @param[out] type Texture type
+ */
 static Tex3DS_Texture
-Tex3DSi_ImportCommon(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCallback callback, void* userdata, size_t insize)
+Tex3DSi_ReadHeader(decompressCallback callback, void** userdata, size_t* insize, GPU_TEXTURE_MODE_PARAM* type)
 {
 	// Read header
 	Tex3DSi_Header hdr;
-	if (!Tex3DSi_ReadData(callback, &userdata, &hdr, sizeof(hdr), &insize))
+	if (!Tex3DSi_ReadData(callback, userdata, &hdr, sizeof(hdr), insize))
 		return NULL;
 
 	// Allocate space for header + subtextures
@@ -94,7 +392,7 @@ Tex3DSi_ImportCommon(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCa
 	for (size_t i = 0; i < hdr.numSubTextures; i ++)
 	{
 		Tex3DSi_SubTexture subtex;
-		if (!Tex3DSi_ReadData(callback, &userdata, &subtex, sizeof(Tex3DSi_SubTexture), &insize))
+		if (!Tex3DSi_ReadData(callback, userdata, &subtex, sizeof(Tex3DSi_SubTexture), insize))
 		{
 			free(texture);
 			return NULL;
@@ -107,61 +405,62 @@ Tex3DSi_ImportCommon(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCa
 		texture->subTextures[i].bottom = subtex.bottom / 1024.0f;
 	}
 
-	// Allocate texture memory
+	*type = (GPU_TEXTURE_MODE_PARAM)hdr.type;
+	return texture;
+}
+
+/** @brief Allocate texture memory for a Tex3DS texture
+ *  @param[out] base_texsize Size of one face, including mipmaps
+ *  @returns Size of all faces
+ */
+static size_t
+Tex3DSi_TexInit(Tex3DS_Texture texture, GPU_TEXTURE_MODE_PARAM type, C3D_Tex* tex, C3D_TexCube* texcube, bool vram, size_t* base_texsize)
+{
 	C3D_TexInitParams params;
 	params.width    = texture->width;
 	params.height   = texture->height;
 	params.maxLevel = texture->mipmapLevels;
 	params.format   = texture->format;
-	params.type     = (GPU_TEXTURE_MODE_PARAM)hdr.type;
+	params.type     = type;
 	params.onVram   = vram;
 	if (!C3D_TexInitWithParams(tex, texcube, params))
+		return 0;
+
+	// If this is a cubemap/skybox, there are 6 textures
+	*base_texsize = C3D_TexCalcTotalSize(tex->size, texture->mipmapLevels);
+	return type == GPU_TEX_CUBE_MAP ? 6 * *base_texsize : *base_texsize;
+}
+
+static Tex3DS_Texture
+Tex3DSi_ImportCommon(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCallback callback, void* userdata, size_t insize)
+{
+	GPU_TEXTURE_MODE_PARAM type;
+	Tex3DS_Texture texture = Tex3DSi_ReadHeader(callback, &userdata, &insize, &type);
+	if (!texture)
+		return NULL;
+
+	// Allocate texture memory
+	size_t base_texsize;
+	size_t texsize = Tex3DSi_TexInit(texture, type, tex, texcube, vram, &base_texsize);
+	if (!texsize)
 	{
 		free(texture);
 		return NULL;
 	}
 
-	// Get texture size, including mipmaps
-	size_t base_texsize = C3D_TexCalcTotalSize(tex->size, texture->mipmapLevels);
-	size_t texsize = base_texsize;
-
-	// If this is a cubemap/skybox, there are 6 textures
-	if (params.type == GPU_TEX_CUBE_MAP)
-		texsize *= 6;
-
 	if (vram)
 	{
-		// Allocate staging buffer in linear memory
-		void* texdata = linearAlloc(texsize);
-		if (!texdata)
+		// Outside a frame the copies run right away, so a small ring of staging chunks is enough
+		bool ok = C3Di_InFrame()
+			? Tex3DSi_StagedUpload(tex, texsize, base_texsize, callback, userdata, insize)
+			: Tex3DSi_StreamUpload(tex, texsize, base_texsize, callback, userdata, insize);
+		if (!ok)
 		{
 			C3D_TexDelete(tex);
 			free(texture);
 			return NULL;
 		}
-
-		// Decompress into staging buffer for VRAM upload
-		if (!decompress(texdata, texsize, callback, userdata, insize))
-		{
-			linearFree(texdata);
-			C3D_TexDelete(tex);
-			free(texture);
-			return NULL;
-		}
-
-		// Flush buffer to prepare DMA to VRAM
-		GSPGPU_FlushDataCache(texdata, texsize);
-
-		size_t texcount = 1;
-		if (params.type == GPU_TEX_CUBE_MAP)
-			texcount = 6;
-
-		// Upload texture(s) to VRAM
-		for (size_t i = 0; i < texcount; ++i)
-			C3D_TexLoadImage(tex, (u8*)texdata + i * base_texsize, i, -1);
-
-		linearFree(texdata);
-	} else if (params.type == GPU_TEX_CUBE_MAP)
+	} else if (type == GPU_TEX_CUBE_MAP)
 	{
 		decompressIOVec iov[6];
 
@@ -221,6 +520,336 @@ Tex3DS_TextureImportStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vra
 	return Tex3DSi_ImportCommon(tex, texcube, vram, decompressCallback_Stdio, fp, 0);
 }
 
+/** @brief Asynchronous import states
+ */
+typedef enum
+{
+	TEX3DSI_ASYNC_HEADER,    ///< Worker reads the header
+	TEX3DSI_ASYNC_ALLOC,     ///< Main thread allocates texture memory
+	TEX3DSI_ASYNC_DECODE,    ///< Worker decompresses the texture data
+	TEX3DSI_ASYNC_UPLOAD,    ///< Main thread queues the VRAM upload
+	TEX3DSI_ASYNC_UPLOADING, ///< Waiting for the VRAM upload
+	TEX3DSI_ASYNC_DONE,      ///< Finished
+	TEX3DSI_ASYNC_FAILED,    ///< Failed
+} Tex3DSi_AsyncState;
+
+/** @brief Asynchronous import
+ */
+struct Tex3DS_AsyncImport_s
+{
+	volatile Tex3DSi_AsyncState state; ///< Current state
+	LightEvent         resume;   ///< Signaled when the worker may decode
+	Thread             thread;   ///< Worker thread, NULL when running on the job system
+	C3D_JobGroup       jobs;     ///< Jobs still running for TEX3DS_ASYNC_JOBS
+	bool               abort;    ///< Worker must stop after the header
+
+	C3D_Tex*           tex;      ///< citro3d texture
+	C3D_TexCube*       texcube;  ///< citro3d texcube
+	bool               vram;     ///< Whether to store textures in VRAM
+	Tex3DS_Texture     texture;  ///< Tex3DS texture
+	GPU_TEXTURE_MODE_PARAM type; ///< Texture type
+
+	size_t             texsize;      ///< Size of all faces
+	size_t             base_texsize; ///< Size of one face
+	void*              staging;      ///< Linear staging buffer for VRAM textures
+	u32                pending;      ///< Faces still being uploaded
+	u32                queued;       ///< Faces handed to the upload queue so far
+	decompressIOVec    iov[6];       ///< Decompression targets
+	size_t             iovcnt;       ///< Number of decompression targets
+
+	decompressCallback callback; ///< Data callback
+	void*              userdata; ///< User data passed to callback
+	int                fd;       ///< File descriptor for Tex3DS_TextureImportAsyncFD
+};
+
+static void
+Tex3DSi_AsyncHeader(Tex3DS_AsyncImport imp)
+{
+	size_t insize = 0;
+
+	imp->texture = Tex3DSi_ReadHeader(imp->callback, &imp->userdata, &insize, &imp->type);
+	if (!imp->texture)
+	{
+		imp->state = TEX3DSI_ASYNC_FAILED;
+		return;
+	}
+
+	// Allocations belong to the main thread, wait for it to provide the memory
+	__dmb();
+	imp->state = TEX3DSI_ASYNC_ALLOC;
+}
+
+static void
+Tex3DSi_AsyncDecode(Tex3DS_AsyncImport imp)
+{
+	bool ok = decompressV(imp->iov, imp->iovcnt, imp->callback, imp->userdata, 0);
+	__dmb();
+	imp->state = ok ? TEX3DSI_ASYNC_UPLOAD : TEX3DSI_ASYNC_FAILED;
+}
+
+static void
+Tex3DSi_AsyncWorker(void* arg)
+{
+	Tex3DS_AsyncImport imp = (Tex3DS_AsyncImport)arg;
+
+	Tex3DSi_AsyncHeader(imp);
+	if (imp->state == TEX3DSI_ASYNC_FAILED)
+		return;
+
+	LightEvent_Wait(&imp->resume);
+	if (!imp->abort)
+		Tex3DSi_AsyncDecode(imp);
+}
+
+// On the job system both halves are jobs of their own, so no worker blocks in between
+static void
+Tex3DSi_AsyncHeaderJob(void* param, C3D_UNUSED u32 begin, C3D_UNUSED u32 end)
+{
+	Tex3DSi_AsyncHeader((Tex3DS_AsyncImport)param);
+}
+
+static void
+Tex3DSi_AsyncDecodeJob(void* param, C3D_UNUSED u32 begin, C3D_UNUSED u32 end)
+{
+	Tex3DSi_AsyncDecode((Tex3DS_AsyncImport)param);
+}
+
+static void
+Tex3DSi_AsyncUploaded(C3D_UNUSED C3D_Tex* tex, void* param)
+{
+	Tex3DS_AsyncImport imp = (Tex3DS_AsyncImport)param;
+	if (--imp->pending)
+		return;
+
+	linearFree(imp->staging);
+	imp->staging = NULL;
+	imp->state = TEX3DSI_ASYNC_DONE;
+}
+
+static bool
+Tex3DSi_AsyncAlloc(Tex3DS_AsyncImport imp)
+{
+	imp->texsize = Tex3DSi_TexInit(imp->texture, imp->type, imp->tex, imp->texcube, imp->vram, &imp->base_texsize);
+	if (!imp->texsize)
+		return false;
+
+	if (imp->vram)
+	{
+		imp->staging = linearAlloc(imp->texsize);
+		if (!imp->staging)
+		{
+			C3D_TexDelete(imp->tex);
+			imp->texsize = 0;
+			return false;
+		}
+		imp->iov[0].data = imp->staging;
+		imp->iov[0].size = imp->texsize;
+		imp->iovcnt = 1;
+	} else if (imp->type == GPU_TEX_CUBE_MAP)
+	{
+		for (size_t i = 0; i < 6; ++i)
+		{
+			u32 size;
+			imp->iov[i].data = C3D_TexCubeGetImagePtr(imp->tex, i, -1, &size);
+			imp->iov[i].size = size;
+		}
+		imp->iovcnt = 6;
+	} else
+	{
+		u32 size;
+		imp->iov[0].data = C3D_Tex2DGetImagePtr(imp->tex, -1, &size);
+		imp->iov[0].size = size;
+		imp->iovcnt = 1;
+	}
+	return true;
+}
+
+static bool
+Tex3DSi_AsyncUpload(Tex3DS_AsyncImport imp)
+{
+	if (!imp->vram)
+	{
+		C3D_TexFlush(imp->tex);
+		imp->state = TEX3DSI_ASYNC_DONE;
+		return true;
+	}
+
+	// Each face goes through the upload queue, which places it at a safe point of the frame
+	size_t texcount = imp->texsize / imp->base_texsize;
+	if (C3D_TexUploadPoll() + texcount > C3D_TEXUPLOAD_MAX)
+	{
+		// Outside a frame waiting frees up the queue, inside one it is retried on the next poll
+		if (C3Di_InFrame())
+			return false;
+		C3D_TexUploadFinish();
+	}
+
+	if (imp->state == TEX3DSI_ASYNC_UPLOAD)
+	{
+		imp->pending = texcount;
+		imp->queued  = 0;
+		imp->state   = TEX3DSI_ASYNC_UPLOADING;
+	}
+
+	// Faces that do not fit into the queue any more are queued on a later poll
+	while (imp->queued < texcount)
+	{
+		if (!C3D_TexLoadImageAsync(imp->tex, (u8*)imp->staging + imp->queued * imp->base_texsize,
+			imp->queued, -1, Tex3DSi_AsyncUploaded, imp))
+		{
+			if (C3Di_InFrame())
+				return false;
+
+			// Nothing of this import is in flight after waiting, so it can fail right away
+			C3D_TexUploadFinish();
+			if (!C3D_TexLoadImageAsync(imp->tex, (u8*)imp->staging + imp->queued * imp->base_texsize,
+				imp->queued, -1, Tex3DSi_AsyncUploaded, imp))
+			{
+				imp->state = TEX3DSI_ASYNC_FAILED;
+				return false;
+			}
+		}
+		imp->queued++;
+	}
+	return true;
+}
+
+static Tex3DS_AsyncImport
+Tex3DSi_ImportAsync(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCallback callback, void* userdata, int fd, int core)
+{
+	Tex3DS_AsyncImport imp = (Tex3DS_AsyncImport)calloc(1, sizeof(struct Tex3DS_AsyncImport_s));
+	if (!imp)
+		return NULL;
+
+	imp->state    = TEX3DSI_ASYNC_HEADER;
+	imp->tex      = tex;
+	imp->texcube  = texcube;
+	imp->vram     = vram;
+	imp->callback = callback;
+	imp->fd       = fd;
+	imp->userdata = callback == decompressCallback_FD ? &imp->fd : userdata;
+	LightEvent_Init(&imp->resume, RESET_ONESHOT);
+
+	if (core == TEX3DS_ASYNC_JOBS)
+	{
+		C3D_JobPushBackground(&imp->jobs, Tex3DSi_AsyncHeaderJob, imp, 0, 1);
+		return imp;
+	}
+
+	// Run below the calling thread so that loading does not hold up rendering
+	s32 prio = 0x30;
+	svcGetThreadPriority(&prio, CUR_THREAD_HANDLE);
+	imp->thread = threadCreate(Tex3DSi_AsyncWorker, imp, TEX3DSI_ASYNC_STACK, prio < 0x3F ? prio+1 : prio, core, false);
+	if (!imp->thread)
+	{
+		free(imp);
+		return NULL;
+	}
+	return imp;
+}
+
+Tex3DS_AsyncImport
+Tex3DS_TextureImportAsyncCallback(C3D_Tex* tex, C3D_TexCube* texcube, bool vram, decompressCallback callback, void* userdata, int core)
+{
+	return Tex3DSi_ImportAsync(tex, texcube, vram, callback, userdata, -1, core);
+}
+
+Tex3DS_AsyncImport
+Tex3DS_TextureImportAsyncFD(int fd, C3D_Tex* tex, C3D_TexCube* texcube, bool vram, int core)
+{
+	return Tex3DSi_ImportAsync(tex, texcube, vram, decompressCallback_FD, NULL, fd, core);
+}
+
+Tex3DS_AsyncImport
+Tex3DS_TextureImportAsyncStdio(FILE* fp, C3D_Tex* tex, C3D_TexCube* texcube, bool vram, int core)
+{
+	return Tex3DSi_ImportAsync(tex, texcube, vram, decompressCallback_Stdio, fp, -1, core);
+}
+
+Tex3DS_AsyncStatus
+Tex3DS_AsyncPoll(Tex3DS_AsyncImport imp)
+{
+	switch (imp->state)
+	{
+		case TEX3DSI_ASYNC_ALLOC:
+			__dmb();
+			if (Tex3DSi_AsyncAlloc(imp))
+			{
+				imp->state = TEX3DSI_ASYNC_DECODE;
+				if (!imp->thread)
+					C3D_JobPushBackground(&imp->jobs, Tex3DSi_AsyncDecodeJob, imp, 0, 1);
+			} else
+			{
+				imp->abort = true;
+				imp->state = TEX3DSI_ASYNC_FAILED;
+			}
+			if (imp->thread)
+				LightEvent_Signal(&imp->resume);
+			break;
+
+		case TEX3DSI_ASYNC_UPLOAD:
+			__dmb();
+			Tex3DSi_AsyncUpload(imp);
+			break;
+
+		case TEX3DSI_ASYNC_UPLOADING:
+			C3D_TexUploadPoll();
+			if (imp->queued < imp->texsize / imp->base_texsize)
+				Tex3DSi_AsyncUpload(imp);
+			break;
+
+		default:
+			break;
+	}
+
+	switch (imp->state)
+	{
+		case TEX3DSI_ASYNC_DONE:
+			return TEX3DS_ASYNC_DONE;
+		case TEX3DSI_ASYNC_FAILED:
+			return TEX3DS_ASYNC_FAILED;
+		default:
+			return TEX3DS_ASYNC_PENDING;
+	}
+}
+
+Tex3DS_Texture
+Tex3DS_AsyncFinish(Tex3DS_AsyncImport imp)
+{
+	Tex3DS_AsyncStatus status;
+	while ((status = Tex3DS_AsyncPoll(imp)) == TEX3DS_ASYNC_PENDING)
+	{
+		if (imp->state == TEX3DSI_ASYNC_UPLOADING)
+			C3D_TexUploadFinish();
+		else if (!imp->thread)
+			C3D_JobWait(&imp->jobs);
+		else
+			svcSleepThread(1000000);
+	}
+
+	if (imp->thread)
+	{
+		threadJoin(imp->thread, U64_MAX);
+		threadFree(imp->thread);
+	} else
+		C3D_JobWait(&imp->jobs);
+
+	Tex3DS_Texture texture = imp->texture;
+	if (status == TEX3DS_ASYNC_FAILED)
+	{
+		// Memory is only allocated once the header has been read
+		if (imp->texsize)
+			C3D_TexDelete(imp->tex);
+		if (imp->staging)
+			linearFree(imp->staging);
+		free(texture);
+		texture = NULL;
+	}
+
+	free(imp);
+	return texture;
+}
+
 size_t
 Tex3DS_GetNumSubTextures(const Tex3DS_Texture texture)
 {
@@ -239,3 +868,291 @@ void Tex3DS_TextureFree(Tex3DS_Texture texture)
 {
 	free(texture);
 }
+
+/** @brief Skyline segment, the area below height is taken */
+typedef struct
+{
+	u16 x;      ///< Left edge
+	u16 height; ///< Top of the taken area, counted from the top of the page
+	u16 width;  ///< Segment width
+} Tex3DSi_Skyline;
+
+/** @brief Atlas page */
+typedef struct
+{
+	C3D_Tex          tex;      ///< Page texture
+	Tex3DS_Texture   texture;  ///< Subtextures packed into the page
+	u16              capacity; ///< Allocated subtextures
+	u16              numNodes; ///< Skyline segments
+	Tex3DSi_Skyline* nodes;    ///< Skyline, ordered left to right
+} Tex3DSi_AtlasPage;
+
+/** @brief Runtime texture atlas
+ */
+struct Tex3DS_Atlas_s
+{
+	u16                width;    ///< Page width
+	u16                height;   ///< Page height
+	u16                padding;  ///< Gap kept around images
+	GPU_TEXCOLOR       format;   ///< Page format
+	size_t             numPages; ///< Number of pages
+	Tex3DSi_AtlasPage** pages;   ///< Pages, allocated one by one so that they never move
+};
+
+Tex3DS_Atlas
+Tex3DS_AtlasCreate(u16 width, u16 height, GPU_TEXCOLOR format, u16 padding)
+{
+	if (format == GPU_ETC1 || format == GPU_ETC1A4)
+		return NULL;
+
+	Tex3DS_Atlas atlas = (Tex3DS_Atlas)calloc(1, sizeof(struct Tex3DS_Atlas_s));
+	if (!atlas)
+		return NULL;
+
+	// 4-bit formats are tiled in pairs of texels, images have to start on an even column
+	if (format == GPU_L4 || format == GPU_A4)
+		padding = (padding + 1) &~ 1;
+
+	atlas->width   = width;
+	atlas->height  = height;
+	atlas->padding = padding;
+	atlas->format  = format;
+	return atlas;
+}
+
+static Tex3DSi_AtlasPage*
+Tex3DSi_AtlasAddPage(Tex3DS_Atlas atlas)
+{
+	// Bound textures and Tex3DS_AtlasGetPage keep pointing into existing pages
+	Tex3DSi_AtlasPage** pages = (Tex3DSi_AtlasPage**)realloc(atlas->pages, (atlas->numPages+1)*sizeof(Tex3DSi_AtlasPage*));
+	if (!pages)
+		return NULL;
+	atlas->pages = pages;
+
+	Tex3DSi_AtlasPage* page = (Tex3DSi_AtlasPage*)calloc(1, sizeof(Tex3DSi_AtlasPage));
+	if (!page)
+		return NULL;
+
+	// A page never holds more segments than it is wide, plus one while inserting
+	page->nodes = (Tex3DSi_Skyline*)malloc((atlas->width+1)*sizeof(Tex3DSi_Skyline));
+	page->texture = (Tex3DS_Texture)malloc(sizeof(struct Tex3DS_Texture_s));
+	if (!page->nodes || !page->texture || !C3D_TexInit(&page->tex, atlas->width, atlas->height, atlas->format))
+	{
+		free(page->nodes);
+		free(page->texture);
+		free(page);
+		return NULL;
+	}
+
+	u32 size;
+	void* data = C3D_Tex2DGetImagePtr(&page->tex, 0, &size);
+	memset(data, 0, size);
+	C3D_TexFlush(&page->tex);
+
+	page->texture->numSubTextures = 0;
+	page->texture->width          = atlas->width;
+	page->texture->height         = atlas->height;
+	page->texture->format         = atlas->format;
+	page->texture->mipmapLevels   = 0;
+
+	page->numNodes = 1;
+	page->nodes[0].x      = 0;
+	page->nodes[0].height = 0;
+	page->nodes[0].width  = atlas->width;
+
+	pages[atlas->numPages++] = page;
+	return page;
+}
+
+/** @brief Find where a w by h area would lie on the skyline starting at node
+ *  @returns Top of the area, or -1 if it does not fit there
+ */
+static int
+Tex3DSi_SkylineFit(const Tex3DSi_AtlasPage* page, u16 node, u16 w, u16 h, u16 pageWidth, u16 pageHeight)
+{
+	int x = page->nodes[node].x;
+	if (x + w > pageWidth)
+		return -1;
+
+	int top = 0;
+	int left = w;
+	while (left > 0)
+	{
+		if (page->nodes[node].height > top)
+			top = page->nodes[node].height;
+		if (top + h > pageHeight)
+			return -1;
+		left -= page->nodes[node].width;
+		node ++;
+	}
+	return top;
+}
+
+static void
+Tex3DSi_SkylineInsert(Tex3DSi_AtlasPage* page, u16 node, u16 top, u16 w, u16 h)
+{
+	Tex3DSi_Skyline seg = { page->nodes[node].x, top + h, w };
+	u16 i;
+
+	memmove(&page->nodes[node+1], &page->nodes[node], (page->numNodes-node)*sizeof(Tex3DSi_Skyline));
+	page->nodes[node] = seg;
+	page->numNodes ++;
+
+	// Cut away what the new segment covers
+	for (i = node+1; i < page->numNodes; )
+	{
+		Tex3DSi_Skyline* cur = &page->nodes[i];
+		u16 end = seg.x + seg.width;
+		if (cur->x >= end)
+			break;
+
+		u16 overlap = end - cur->x;
+		if (overlap < cur->width)
+		{
+			cur->x     += overlap;
+			cur->width -= overlap;
+			break;
+		}
+
+		memmove(cur, cur+1, (page->numNodes-i-1)*sizeof(Tex3DSi_Skyline));
+		page->numNodes --;
+	}
+
+	// Merge neighbours at the same height
+	for (i = 0; i+1 < page->numNodes; )
+	{
+		if (page->nodes[i].height == page->nodes[i+1].height)
+		{
+			page->nodes[i].width += page->nodes[i+1].width;
+			memmove(&page->nodes[i+1], &page->nodes[i+2], (page->numNodes-i-2)*sizeof(Tex3DSi_Skyline));
+			page->numNodes --;
+		}
+		else
+			i ++;
+	}
+}
+
+bool
+Tex3DS_AtlasAdd(Tex3DS_Atlas atlas, const void* image, u32 stride, u16 width, u16 height, size_t* pageIndex, size_t* index)
+{
+	if (!width || !height || width > atlas->width || height > atlas->height)
+		return false;
+
+	Tex3DSi_AtlasPage* page = NULL;
+	int bestTop = -1;
+	u16 bestNode = 0, bestWidth = 0, bestHeight = 0;
+	size_t p;
+
+	// Odd widths only fit 4-bit pages as reserved space, which keeps the next image on an even column
+	u16 padding = atlas->padding;
+	if ((atlas->format == GPU_L4 || atlas->format == GPU_A4) && (width & 1))
+		padding ++;
+
+	// First page with room, bottom-left on the lowest point of its skyline
+	for (p = 0; p < atlas->numPages && bestTop < 0; p ++)
+	{
+		Tex3DSi_AtlasPage* cur = atlas->pages[p];
+		u16 i;
+		if (cur->texture->numSubTextures == 0xFFFF)
+			continue;
+
+		for (i = 0; i < cur->numNodes; i ++)
+		{
+			// The padding may be cut off at the edges of the page
+			u16 w = width + padding, h = height + atlas->padding;
+			if (cur->nodes[i].x + w > atlas->width)
+				w = atlas->width - cur->nodes[i].x;
+
+			int top = Tex3DSi_SkylineFit(cur, i, w < width ? width : w, height, atlas->width, atlas->height);
+			if (top < 0 || (bestTop >= 0 && (top > bestTop || (top == bestTop && cur->nodes[i].width >= cur->nodes[bestNode].width))))
+				continue;
+
+			if (top + h > atlas->height)
+				h = atlas->height - top;
+			page = cur;
+			bestTop = top;
+			bestNode = i;
+			bestWidth = w;
+			bestHeight = h;
+		}
+	}
+
+	if (bestTop < 0)
+	{
+		page = Tex3DSi_AtlasAddPage(atlas);
+		if (!page)
+			return false;
+		p = atlas->numPages;
+		bestTop = 0;
+		bestNode = 0;
+		bestWidth = width + padding > atlas->width ? atlas->width : width + padding;
+		bestHeight = height + atlas->padding > atlas->height ? atlas->height : height + atlas->padding;
+	}
+
+	if (page->texture->numSubTextures == page->capacity)
+	{
+		u16 capacity = page->capacity ? (page->capacity > 0x7FFF ? 0xFFFF : 2*page->capacity) : 16;
+		Tex3DS_Texture texture = (Tex3DS_Texture)realloc(page->texture, sizeof(struct Tex3DS_Texture_s) + capacity*sizeof(Tex3DS_SubTexture));
+		if (!texture)
+			return false;
+		page->texture  = texture;
+		page->capacity = capacity;
+	}
+
+	u16 x = page->nodes[bestNode].x;
+	if (image && !C3D_TexTileRect(&page->tex, image, stride, GPU_TEXFACE_2D, 0, x, bestTop, width, height))
+		return false;
+
+	Tex3DSi_SkylineInsert(page, bestNode, bestTop, bestWidth, bestHeight);
+
+	Tex3DS_SubTexture* subtex = &page->texture->subTextures[page->texture->numSubTextures];
+	subtex->width  = width;
+	subtex->height = height;
+	subtex->left   = (float)x / atlas->width;
+	subtex->top    = 1.0f - (float)bestTop / atlas->height;
+	subtex->right  = (float)(x + width) / atlas->width;
+	subtex->bottom = 1.0f - (float)(bestTop + height) / atlas->height;
+
+	if (pageIndex)
+		*pageIndex = p-1;
+	if (index)
+		*index = page->texture->numSubTextures;
+	page->texture->numSubTextures ++;
+	return true;
+}
+
+size_t
+Tex3DS_AtlasGetNumPages(const Tex3DS_Atlas atlas)
+{
+	return atlas->numPages;
+}
+
+C3D_Tex*
+Tex3DS_AtlasGetPage(Tex3DS_Atlas atlas, size_t page)
+{
+	if (page < atlas->numPages)
+		return &atlas->pages[page]->tex;
+	return NULL;
+}
+
+Tex3DS_Texture
+Tex3DS_AtlasGetTexture(const Tex3DS_Atlas atlas, size_t page)
+{
+	if (page < atlas->numPages)
+		return atlas->pages[page]->texture;
+	return NULL;
+}
+
+void Tex3DS_AtlasFree(Tex3DS_Atlas atlas)
+{
+	size_t i;
+	for (i = 0; i < atlas->numPages; i ++)
+	{
+		C3D_TexDelete(&atlas->pages[i]->tex);
+		free(atlas->pages[i]->texture);
+		free(atlas->pages[i]->nodes);
+		free(atlas->pages[i]);
+	}
+	free(atlas->pages);
+	free(atlas);
+}
@@ -40,7 +40,38 @@ void C3D_DirtyTexEnv(C3D_TexEnv* env)
 void C3Di_TexEnvBind(int id, C3D_TexEnv* env)
 {
 	if (id >= 4) id += 2;
-	GPUCMD_AddIncrementalWrites(GPUREG_TEXENV0_SOURCE + id*8, (u32*)env, sizeof(C3D_TexEnv)/sizeof(u32));
+	C3Di_RegIncrementalWrites(GPUREG_TEXENV0_SOURCE + id*8, (u32*)env, sizeof(C3D_TexEnv)/sizeof(u32));
+}
+
+int C3D_TexEnvCompile(const C3D_TexEnv* envs, int count)
+{
+	while (count > 1 && C3D_TexEnvIsPassThrough(&envs[count-1]))
+		count --;
+	return count;
+}
+
+void C3D_TexEnvApply(const C3D_TexEnv* envs, int count)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	int i;
+
+	if (!(ctx->flags & C3DiF_Active))
+		return;
+
+	count = C3D_TexEnvCompile(envs, count > 6 ? 6 : count);
+	for (i = 0; i < 6; i ++)
+	{
+		C3D_TexEnv env;
+		if (i < count)
+			env = envs[i];
+		else
+			C3D_TexEnvInit(&env);
+
+		if (memcmp(&ctx->texEnv[i], &env, sizeof(env)) == 0)
+			continue;
+		ctx->texEnv[i] = env;
+		ctx->flags |= C3DiF_TexEnv(i);
+	}
 }
 
 void C3D_TexEnvBufUpdate(int mode, int mask)
@@ -67,6 +98,7 @@ void C3D_TexEnvBufUpdate(int mode, int mask)
 
 	ctx->texEnvBuf = val;
 	ctx->flags |= C3DiF_TexEnvBuf;
+	ctx->texEnvBufFlags |= C3DiB_Update;
 }
 
 void C3D_TexEnvBufColor(u32 color)
@@ -78,4 +110,5 @@ void C3D_TexEnvBufColor(u32 color)
 
 	ctx->texEnvBufClr = color;
 	ctx->flags |= C3DiF_TexEnvBuf;
+	ctx->texEnvBufFlags |= C3DiB_Color;
 }
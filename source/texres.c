@@ -0,0 +1,326 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/texres.h>
+#include <c3d/vram.h>
+#include <c3d/renderqueue.h>
+
+typedef struct
+{
+	C3D_Tex* tex; // NULL once unmanaged while a move is in flight
+	void* newData;
+	u32 size;
+	u32 lastUse;
+	bool moving;
+} C3Di_TexRes;
+
+typedef struct
+{
+	void* addr;
+	C3D_Fence fence;
+} C3Di_TexResFree;
+
+static bool resEnabled;
+static size_t resBudget, resRate, resVramUsed;
+static u32 resFrame;
+
+// Open addressing table from texture to entry, the capacity is a power of two
+static C3Di_TexRes** resTable;
+static u32 resCap, resCount;
+
+static C3Di_TexResFree* resFrees;
+static u32 resNumFrees, resMaxFrees;
+
+static inline u32 C3Di_TexResHash(C3D_Tex* tex)
+{
+	return (((u32)tex >> 2) * 2654435761U) & (resCap-1);
+}
+
+static u32 C3Di_TexResFind(C3D_Tex* tex)
+{
+	u32 i = C3Di_TexResHash(tex);
+	while (resTable[i] && resTable[i]->tex != tex)
+		i = (i+1) & (resCap-1);
+	return i;
+}
+
+static C3Di_TexRes* C3Di_TexResLookup(C3D_Tex* tex)
+{
+	return resCap ? resTable[C3Di_TexResFind(tex)] : NULL;
+}
+
+static bool C3Di_TexResGrow(void)
+{
+	u32 i, oldCap = resCap;
+	C3Di_TexRes** oldTable = resTable;
+	u32 newCap = oldCap ? 2*oldCap : 64;
+
+	C3Di_TexRes** newTable = (C3Di_TexRes**)calloc(newCap, sizeof(C3Di_TexRes*));
+	if (!newTable)
+		return false;
+
+	resTable = newTable;
+	resCap = newCap;
+	for (i = 0; i < oldCap; i ++)
+		if (oldTable[i])
+			resTable[C3Di_TexResFind(oldTable[i]->tex)] = oldTable[i];
+	free(oldTable);
+	return true;
+}
+
+static void C3Di_TexResRemove(u32 i)
+{
+	// Backward shift deletion keeps the probe sequences intact
+	resTable[i] = NULL;
+	resCount--;
+	u32 j = i;
+	for (;;)
+	{
+		j = (j+1) & (resCap-1);
+		if (!resTable[j])
+			break;
+		u32 home = C3Di_TexResHash(resTable[j]->tex);
+		if (((j - home) & (resCap-1)) >= ((j - i) & (resCap-1)))
+		{
+			resTable[i] = resTable[j];
+			resTable[j] = NULL;
+			i = j;
+		}
+	}
+}
+
+static void C3Di_TexResDeferFree(void* addr)
+{
+	if (resNumFrees == resMaxFrees)
+	{
+		u32 newMax = resMaxFrees ? 2*resMaxFrees : 16;
+		C3Di_TexResFree* newFrees = (C3Di_TexResFree*)realloc(resFrees, newMax*sizeof(C3Di_TexResFree));
+		if (!newFrees)
+		{
+			// Out of memory, fall back to waiting for the GPU
+			C3Di_RenderQueueWaitDone();
+			if (addrIsVRAM(addr))
+				C3D_VramFree(addr);
+			else
+				linearFree(addr);
+			return;
+		}
+		resFrees = newFrees;
+		resMaxFrees = newMax;
+	}
+
+	resFrees[resNumFrees].addr = addr;
+	resFrees[resNumFrees].fence = C3D_FenceInsert();
+	resNumFrees++;
+}
+
+static void C3Di_TexResCollect(bool wait)
+{
+	u32 i = 0;
+	while (i < resNumFrees)
+	{
+		C3Di_TexResFree* f = &resFrees[i];
+		if (!wait && !C3D_FenceIsSignaled(f->fence))
+		{
+			i ++;
+			continue;
+		}
+		if (addrIsVRAM(f->addr))
+			C3D_VramFree(f->addr);
+		else
+			linearFree(f->addr);
+		*f = resFrees[--resNumFrees];
+	}
+}
+
+static void C3Di_TexResMoved(C3D_UNUSED C3D_Tex* tex, void* param)
+{
+	C3Di_TexRes* r = (C3Di_TexRes*)param;
+	if (!r->tex)
+	{
+		C3Di_TexResDeferFree(r->newData);
+		free(r);
+		return;
+	}
+
+	C3Di_TexResDeferFree(r->tex->data);
+	r->tex->data = r->newData;
+	r->newData = NULL;
+	r->moving = false;
+
+	// Bound textures have to pick up the new address
+	C3Di_GetContext()->flags |= C3DiF_TexAll;
+}
+
+static bool C3Di_TexResMove(C3Di_TexRes* r, bool toVram)
+{
+	void* dst = toVram ? C3D_VramAlloc(r->size, C3D_VRAM_TEXTURE, NULL) : linearAlloc(r->size);
+	if (!dst)
+		return false;
+
+	// Stale lines must not be written back over the copied data
+	if (!toVram)
+		GSPGPU_InvalidateDataCache(dst, r->size);
+
+	r->newData = dst;
+	r->moving = true;
+	if (!C3Di_TexUploadQueue(r->tex, r->tex->data, dst, r->size, C3Di_TexResMoved, r))
+	{
+		if (toVram)
+			C3D_VramFree(dst);
+		else
+			linearFree(dst);
+		r->newData = NULL;
+		r->moving = false;
+		return false;
+	}
+
+	if (toVram)
+		resVramUsed += r->size;
+	else
+		resVramUsed -= r->size;
+	return true;
+}
+
+static C3Di_TexRes* C3Di_TexResColdest(void)
+{
+	u32 i;
+	C3Di_TexRes* best = NULL;
+	for (i = 0; i < resCap; i ++)
+	{
+		C3Di_TexRes* r = resTable[i];
+		if (!r || r->moving || !addrIsVRAM(r->tex->data) || r->lastUse+1 >= resFrame)
+			continue;
+		if (!best || r->lastUse < best->lastUse)
+			best = r;
+	}
+	return best;
+}
+
+void C3Di_TexResUpdate(void)
+{
+	u32 i;
+	size_t moved = 0;
+
+	if (!resEnabled)
+		return;
+
+	resFrame++;
+	C3Di_TexResCollect(false);
+
+	for (i = 0; i < resCap && moved < resRate; i ++)
+	{
+		C3Di_TexRes* r = resTable[i];
+		if (!r || r->moving || addrIsVRAM(r->tex->data) || r->lastUse+1 < resFrame)
+			continue;
+
+		// Make room by demoting textures that were not used in the last frame
+		while (resVramUsed + r->size > resBudget && moved < resRate)
+		{
+			C3Di_TexRes* cold = C3Di_TexResColdest();
+			if (!cold || !C3Di_TexResMove(cold, false))
+				break;
+			moved += cold->size;
+		}
+
+		if (resVramUsed + r->size > resBudget || moved >= resRate)
+			break;
+		if (!C3Di_TexResMove(r, true))
+			break;
+		moved += r->size;
+	}
+}
+
+void C3Di_TexResTouch(C3D_Tex* tex)
+{
+	if (!resCount)
+		return;
+	C3Di_TexRes* r = C3Di_TexResLookup(tex);
+	if (r)
+		r->lastUse = resFrame;
+}
+
+bool C3D_TexResidencyInit(size_t vramBudget, size_t bytesPerFrame)
+{
+	resBudget = vramBudget;
+	resRate = bytesPerFrame ? bytesPerFrame : (size_t)-1;
+	resEnabled = true;
+	return true;
+}
+
+void C3D_TexResidencyExit(void)
+{
+	u32 i;
+	if (!resEnabled)
+		return;
+
+	// Let moves in flight land before forgetting about the textures
+	C3D_TexUploadFinish();
+	for (i = 0; i < resCap; i ++)
+		free(resTable[i]);
+	free(resTable);
+	resTable = NULL;
+	resCap = resCount = 0;
+
+	C3Di_RenderQueueWaitDone();
+	C3Di_TexResCollect(true);
+	free(resFrees);
+	resFrees = NULL;
+	resNumFrees = resMaxFrees = 0;
+
+	resVramUsed = 0;
+	resEnabled = false;
+}
+
+bool C3D_TexResidencyManage(C3D_Tex* tex)
+{
+	if (!resEnabled || !C3Di_TexIs2D(tex) || C3Di_TexResLookup(tex))
+		return false;
+	if (2*(resCount+1) > resCap && !C3Di_TexResGrow())
+		return false;
+
+	C3Di_TexRes* r = (C3Di_TexRes*)malloc(sizeof(C3Di_TexRes));
+	if (!r)
+		return false;
+
+	r->tex = tex;
+	r->newData = NULL;
+	r->size = C3D_TexCalcTotalSize(tex->size, tex->maxLevel);
+	r->lastUse = resFrame;
+	r->moving = false;
+	if (addrIsVRAM(tex->data))
+		resVramUsed += r->size;
+
+	resTable[C3Di_TexResFind(tex)] = r;
+	resCount++;
+	return true;
+}
+
+void C3D_TexResidencyUnmanage(C3D_Tex* tex)
+{
+	if (!resCount)
+		return;
+
+	u32 i = C3Di_TexResFind(tex);
+	C3Di_TexRes* r = resTable[i];
+	if (!r)
+		return;
+
+	C3Di_TexResRemove(i);
+	if (r->moving)
+	{
+		// Undo the accounting of the move, the callback releases the copy
+		if (addrIsVRAM(r->newData))
+			resVramUsed -= r->size;
+		r->tex = NULL;
+		return;
+	}
+
+	if (addrIsVRAM(tex->data))
+		resVramUsed -= r->size;
+	free(r);
+}
+
+size_t C3D_TexResidencyVramUsage(void)
+{
+	return resVramUsed;
+}
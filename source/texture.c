@@ -1,5 +1,8 @@
 #include "internal.h"
 #include <c3d/renderqueue.h>
+#include <c3d/vram.h>
+#include <c3d/texres.h>
+#include "mipmap.h"
 
 // Return bits per pixel
 static inline size_t fmtSize(GPU_TEXCOLOR fmt)
@@ -39,10 +42,18 @@ static inline bool checkTexSize(u32 size)
 	return true;
 }
 
+// Cube maps are always rewritten, their faces are not tracked
+static inline bool C3Di_TexUnitMatches(const C3Di_TexUnitState* state, C3D_Tex* tex)
+{
+	return state->tex == tex && C3Di_TexIs2D(tex) && state->data == tex->data
+		&& state->border == tex->border && state->dim == tex->dim && state->param == tex->param
+		&& state->lodParam == tex->lodParam && state->fmt == tex->fmt;
+}
+
 static inline void allocFree(void* addr)
 {
 	if (addrIsVRAM(addr))
-		vramFree(addr);
+		C3D_VramFree(addr);
 	else
 		linearFree(addr);
 }
@@ -74,7 +85,7 @@ bool C3D_TexInitWithParams(C3D_Tex* tex, C3D_TexCube* cube, C3D_TexInitParams p)
 
 	if (!isCube)
 	{
-		tex->data = p.onVram ? vramAlloc(total_size) : linearAlloc(total_size);
+		tex->data = p.onVram ? C3D_VramAlloc(total_size, C3D_VRAM_TEXTURE, NULL) : linearAlloc(total_size);
 		if (!tex->data) return false;
 	} else
 	{
@@ -82,7 +93,7 @@ bool C3D_TexInitWithParams(C3D_Tex* tex, C3D_TexCube* cube, C3D_TexInitParams p)
 		int i;
 		for (i = 0; i < 6; i ++)
 		{
-			cube->data[i] = p.onVram ? vramAlloc(total_size) : linearAlloc(total_size);
+			cube->data[i] = p.onVram ? C3D_VramAlloc(total_size, C3D_VRAM_TEXTURE, NULL) : linearAlloc(total_size);
 			if (!cube->data[i] ||
 				(i>0 && (((u32)cube->data[0] ^ (u32)cube->data[i])>>(3+22)))) // Check upper 6bits match with first face
 			{
@@ -111,79 +122,162 @@ bool C3D_TexInitWithParams(C3D_Tex* tex, C3D_TexCube* cube, C3D_TexInitParams p)
 
 void C3D_TexLoadImage(C3D_Tex* tex, const void* data, GPU_TEXFACE face, int level)
 {
+	C3Di_TexCacheInvalidate();
 	u32 size = 0;
 	void* out = C3D_TexGetImagePtr(tex,
 		C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face],
 		level, &size);
 
 	if (!addrIsVRAM(out))
+	{
 		memcpy(out, data, size);
+		C3D_FlushMarkRange(out, size);
+	}
 	else
 		C3D_SyncTextureCopy((u32*)data, 0, (u32*)out, 0, size, 8);
 }
 
-static void C3Di_DownscaleRGBA8(u32* dst, const u32* src[4])
+bool C3D_TexLoadImageAsync(C3D_Tex* tex, const void* data, GPU_TEXFACE face, int level, C3D_TexUploadCallback callback, void* param)
 {
-	u32 i, j;
-	for (i = 0; i < 64; i ++)
+	u32 size = 0;
+	void* out = C3D_TexGetImagePtr(tex,
+		C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face],
+		level, &size);
+
+	if (!addrIsVRAM(out))
 	{
-		const u32* a = src[i>>4] + (i<<2 & 0x3F);
-		u32 dest = 0;
-		for (j = 0; j < 32; j += 8)
-		{
-			u32 val = (((a[0]>>j)&0xFF)+((a[1]>>j)&0xFF)+((a[2]>>j)&0xFF)+((a[3]>>j)&0xFF))>>2;
-			dest |= val<<j;
-		}
-		*dst++ = dest;
+		memcpy(out, data, size);
+		C3D_FlushMarkRange(out, size);
+		C3Di_TexCacheInvalidate();
+		if (callback)
+			callback(tex, param);
+		return true;
 	}
+
+	return C3Di_TexUploadQueue(tex, data, out, size, callback, param);
+}
+
+static void C3Di_TexRegionStaged(C3D_UNUSED C3D_Tex* tex, void* param)
+{
+	linearFree(param);
 }
 
-static void C3Di_DownscaleRGB8(u8* dst, const u8* src[4])
+bool C3D_TexUpdateRegion(C3D_Tex* tex, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h, const void* data)
 {
-	u32 i, j;
-	for (i = 0; i < 64; i ++)
+	u32 bpp = fmtSize(tex->fmt);
+	u32 stride = w*bpp/8;
+	void* base = C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face];
+	if (!w || !h || level < 0 || level > tex->maxLevel)
+		return false;
+	if (!addrIsVRAM(base))
+		return C3D_TexTileRect(tex, data, stride, face, level, x, y, w, h);
+
+	u32 width = tex->width >> level, height = tex->height >> level;
+	if (x+w > width || y+h > height)
+		return false;
+
+	// The touched tiles: a run of whole tiles in each tile row, with tile rows counted bottom-up
+	u32 tileSize = 8*bpp;
+	u32 rowSize = (width/8)*tileSize;
+	u32 tx0 = x/8, tx1 = (x+w+7)/8;
+	u32 ty0 = (height-(y+h))/8, ty1 = (height-1-y)/8;
+	u32 span = (tx1-tx0)*tileSize, rows = ty1-ty0+1;
+	u32 size = span*rows;
+	bool partial = ((x|w|y|h) & 7) != 0;
+	bool inFrame = C3Di_InFrame();
+
+	// Partly covered tiles have to be read back, which inside a frame would only happen at a split
+	if (partial && inFrame)
+		return false;
+
+	u8* out = (u8*)C3D_TexGetImagePtr(tex, base, level, NULL) + ty0*rowSize + tx0*tileSize;
+	u32 dim = span == rowSize ? 0 : GX_BUFFER_DIM(span/16, (rowSize-span)/16);
+	u8* staging = (u8*)linearAlloc(size);
+	if (!staging)
+		return false;
+
+	if (partial)
 	{
-		const u8* a = src[i>>4] + 3*(i<<2 & 0x3F);
-		for (j = 0; j < 3; j ++)
-		{
-			*dst++ = ((u32)a[0] + a[3] + a[6] + a[9])>>2;
-			a++;
-		}
+		C3D_SyncTextureCopy((u32*)out, dim, (u32*)staging, 0, size, 8);
+		GSPGPU_InvalidateDataCache(staging, size);
+	}
+
+	// Tile into a small image made of just the touched tiles
+	u32 sw = (tx1-tx0)*8, sh = rows*8;
+	if (!C3Di_TileRect(staging, (void*)data, stride, sw, sh, tex->fmt, x - tx0*8, y + sh + ty0*8 - height, w, h, false))
+	{
+		linearFree(staging);
+		return false;
 	}
+
+	C3Di_TexCacheInvalidate();
+	if (inFrame)
+	{
+		if (C3Di_TexUploadQueueDim(tex, staging, out, size, dim, C3Di_TexRegionStaged, staging))
+			return true;
+		linearFree(staging);
+		return false;
+	}
+
+	GSPGPU_FlushDataCache(staging, size);
+	C3D_SyncTextureCopy((u32*)staging, 0, (u32*)out, dim, size, 8);
+	linearFree(staging);
+	return true;
 }
 
-void C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face)
+// The packed kernels are used unless the scalar reference ones are asked for
+#ifdef C3D_MIPMAP_SCALAR
+#define C3Di_MIP(_fmt) C3Di_Mip##_fmt
+#else
+#define C3Di_MIP(_fmt) C3Di_Mip##_fmt##_SIMD
+#endif
+
+static C3Di_MipKernel C3Di_MipKernelFor(GPU_TEXCOLOR fmt)
 {
-	int fmt = tex->fmt;
-	size_t block_size = (8*8*fmtSize(fmt))/8;
+	switch (fmt)
+	{
+		case GPU_RGBA8:    return C3Di_MIP(RGBA8);
+		case GPU_RGB8:     return C3Di_MIP(RGB8);
+		case GPU_RGBA5551: return C3Di_MIP(RGBA5551);
+		case GPU_RGB565:   return C3Di_MIP(RGB565);
+		case GPU_RGBA4:    return C3Di_MIP(RGBA4);
+		case GPU_LA8:
+		case GPU_HILO8:    return C3Di_MIP(LA8);
+		case GPU_L8:
+		case GPU_A8:       return C3Di_MIP(L8);
+		case GPU_LA4:      return C3Di_MIP(LA4);
+		case GPU_L4:
+		case GPU_A4:       return C3Di_MIP(L4);
+		default:           return NULL; // ETC1 blocks can't be averaged
+	}
+}
 
-	/*
-	const u32 transfer_flags =
-		GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_XY) | BIT(5) |
-		GX_TRANSFER_IN_FORMAT(tex->fmt) | GX_TRANSFER_OUT_FORMAT(tex->fmt);
-	*/
+// Returns the display transfer format matching a texture format, or -1 if there is none
+int C3Di_MipTransferFmt(GPU_TEXCOLOR fmt)
+{
+	switch (fmt)
+	{
+		case GPU_RGBA8:    return GX_TRANSFER_FMT_RGBA8;
+		case GPU_RGB8:     return GX_TRANSFER_FMT_RGB8;
+		case GPU_RGBA5551: return GX_TRANSFER_FMT_RGB5A1;
+		case GPU_RGB565:   return GX_TRANSFER_FMT_RGB565;
+		case GPU_RGBA4:    return GX_TRANSFER_FMT_RGBA4;
+		default:           return -1;
+	}
+}
 
-	void* src = C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face];
-	if (addrIsVRAM(src))
-		return; // CPU can't write to VRAM
+static void C3Di_MipGenerateCPU(void* src, u32 level_size, u32 src_width, u32 src_height, int levels, GPU_TEXCOLOR fmt)
+{
+	C3Di_MipKernel kernel = C3Di_MipKernelFor(fmt);
+	size_t block_size = (8*8*fmtSize(fmt))/8;
+	int l;
 
-	int i;
-	u32 level_size = tex->size;
-	u32 src_width = tex->width;
-	u32 src_height = tex->height;
-	for (i = 0; i < tex->maxLevel; i ++)
+	for (l = 0; l < levels; l ++)
 	{
 		void* dst = (u8*)src + level_size;
 		u32 dst_width = src_width>>1;
 		u32 dst_height = src_height>>1;
 
-		/* Doesn't work due to size restriction bullshit
-		C3D_SyncDisplayTransfer(
-			(u32*)src, GX_BUFFER_DIM(src_width,src_height),
-			(u32*)dst, GX_BUFFER_DIM(dst_width,dst_height),
-			transfer_flags);
-		*/
-
 		u32 i,j;
 		u32 src_stride = src_width/8;
 		u32 dst_stride = dst_width/8;
@@ -199,16 +293,7 @@ void C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face)
 					(u8*)src + block_size*(2*i+0 + (2*j+1)*src_stride),
 					(u8*)src + block_size*(2*i+1 + (2*j+1)*src_stride),
 				};
-				switch (fmt)
-				{
-					case GPU_RGBA8:
-						C3Di_DownscaleRGBA8(dst_block, (const u32**)src_blocks);
-						break;
-					case GPU_RGB8:
-						C3Di_DownscaleRGB8(dst_block, (const u8**)src_blocks);
-					default:
-						break;
-				}
+				kernel(dst_block, src_blocks);
 			}
 		}
 
@@ -219,6 +304,45 @@ void C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face)
 	}
 }
 
+bool C3D_TexGenerateMipmap(C3D_Tex* tex, GPU_TEXFACE face)
+{
+	GPU_TEXCOLOR fmt = tex->fmt;
+	if (!C3Di_MipKernelFor(fmt))
+		return false;
+	if (!tex->maxLevel)
+		return true;
+
+	// Tile to tile scaling with the display transfer engine is not reliable, so the CPU does it
+	void* src = C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face];
+	u32 level_size = tex->size;
+	int levels = tex->maxLevel;
+	if (!addrIsVRAM(src))
+	{
+		C3Di_TexCacheInvalidate();
+		C3Di_MipGenerateCPU(src, level_size, tex->width, tex->height, levels, fmt);
+		return true;
+	}
+
+	// The CPU can't write to VRAM: the levels are generated in linear memory and copied back.
+	// Inside a frame the transfers only run at C3D_FrameEnd, so this has to be done outside one.
+	if (C3Di_InFrame())
+		return false;
+
+	u32 chain_size = C3D_TexCalcTotalSize(level_size, levels);
+	void* tmp = linearAlloc(chain_size);
+	if (!tmp)
+		return false;
+
+	C3Di_TexCacheInvalidate();
+	C3D_SyncTextureCopy((u32*)src, 0, (u32*)tmp, 0, level_size, 8);
+	GSPGPU_InvalidateDataCache(tmp, level_size);
+	C3Di_MipGenerateCPU(tmp, level_size, tex->width, tex->height, levels, fmt);
+	GSPGPU_FlushDataCache(tmp, chain_size);
+	C3D_SyncTextureCopy((u32*)((u8*)tmp + level_size), 0, (u32*)((u8*)src + level_size), 0, chain_size - level_size, 8);
+	linearFree(tmp);
+	return true;
+}
+
 void C3D_TexBind(int unitId, C3D_Tex* tex)
 {
 	C3D_Context* ctx = C3Di_GetContext();
@@ -229,24 +353,47 @@ void C3D_TexBind(int unitId, C3D_Tex* tex)
 	if (unitId > 0 && C3D_TexGetType(tex) != GPU_TEX_2D)
 		return;
 
-	ctx->flags |= C3DiF_Tex(unitId);
+	// Binding what the unit already holds costs nothing, as long as the unit is still enabled;
+	// unbinding leaves the unit state in place, so it may match after a NULL bind
+	if (!tex || ctx->tex[unitId] != tex || !(ctx->texConfig & BIT(unitId))
+		|| !C3Di_TexUnitMatches(&ctx->texUnit[unitId], tex))
+		ctx->flags |= C3DiF_Tex(unitId);
 	ctx->tex[unitId] = tex;
+	if (tex)
+		C3Di_TexResTouch(tex);
 }
 
 void C3D_TexFlush(C3D_Tex* tex)
 {
+	C3Di_TexCacheInvalidate();
 	if (!addrIsVRAM(tex->data))
-		GSPGPU_FlushDataCache(tex->data, C3D_TexCalcTotalSize(tex->size, tex->maxLevel));
+	{
+		u32 size = C3D_TexCalcTotalSize(tex->size, tex->maxLevel);
+		if (C3Di_FlushDeferred())
+			C3D_FlushMarkRange(tex->data, size);
+		else
+			GSPGPU_FlushDataCache(tex->data, size);
+	}
 }
 
 void C3D_TexDelete(C3D_Tex* tex)
 {
+	C3D_TexResidencyUnmanage(tex);
 	if (C3Di_TexIs2D(tex))
 		allocFree(tex->data);
 	else
 		C3Di_TexCubeDelete(tex->cube);
 }
 
+u32 C3Di_TexShadowValue(bool perspective, float bias)
+{
+	u32 iBias = (u32)(fabs(bias) * BIT(24));
+	if (iBias >= BIT(24))
+		iBias = BIT(24)-1;
+
+	return (iBias &~ 1) | (perspective ? 0 : 1);
+}
+
 void C3D_TexShadowParams(bool perspective, float bias)
 {
 	C3D_Context* ctx = C3Di_GetContext();
@@ -254,16 +401,38 @@ void C3D_TexShadowParams(bool perspective, float bias)
 	if (!(ctx->flags & C3DiF_Active))
 		return;
 
-	u32 iBias = (u32)(fabs(bias) * BIT(24));
-	if (iBias >= BIT(24))
-		iBias = BIT(24)-1;
+	ctx->texShadow = C3Di_TexShadowValue(perspective, bias);
+	ctx->flags |= C3DiF_TexStatus;
+}
+
+void C3Di_TexCacheInvalidate(void)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+
+	if (!(ctx->flags & C3DiF_Active))
+		return;
 
-	ctx->texShadow = (iBias &~ 1) | (perspective ? 0 : 1);
+	ctx->texConfig |= BIT(16);
 	ctx->flags |= C3DiF_TexStatus;
 }
 
 void C3Di_SetTex(int unit, C3D_Tex* tex)
 {
+	C3D_Context* ctx = C3Di_GetContext();
+	C3Di_TexUnitState* state = &ctx->texUnit[unit];
+
+	if (C3Di_TexUnitMatches(state, tex))
+		return;
+
+	state->tex = tex;
+	state->data = tex->data;
+	state->border = tex->border;
+	state->dim = tex->dim;
+	state->param = tex->param;
+	state->lodParam = tex->lodParam;
+	state->fmt = tex->fmt;
+
+	C3Di_STAT_ADD(texBinds, 1);
 	u32 reg[10];
 	u32 regcount = 5;
 	reg[0] = tex->border;
@@ -0,0 +1,152 @@
+#include "internal.h"
+#include <c3d/renderqueue.h>
+
+// Offsets of a texel inside its 8x8 tile, the coordinates are interleaved with x in the low bit
+static const u8 mortonX[8] = { 0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15 };
+static const u8 mortonY[8] = { 0x00, 0x02, 0x08, 0x0A, 0x20, 0x22, 0x28, 0x2A };
+
+// Bytes per unit moved at a time; 4-bit formats move pairs of texels, which share a byte in both layouts
+static inline u32 tileUnit(GPU_TEXCOLOR fmt)
+{
+	switch (fmt)
+	{
+		case GPU_RGBA8:
+			return 4;
+		case GPU_RGB8:
+			return 3;
+		case GPU_RGBA5551:
+		case GPU_RGB565:
+		case GPU_RGBA4:
+		case GPU_LA8:
+		case GPU_HILO8:
+			return 2;
+		case GPU_L8:
+		case GPU_A8:
+		case GPU_LA4:
+		case GPU_L4:
+		case GPU_A4:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+static inline void copyUnit(u8* dst, const u8* src, u32 unit)
+{
+	switch (unit)
+	{
+		case 4: *(u32*)dst = *(const u32*)src; break;
+		case 3: dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; break;
+		case 2: *(u16*)dst = *(const u16*)src; break;
+		default: *dst = *src; break;
+	}
+}
+
+// Inlined once per unit size, so the copies and offsets below fold into constants
+static inline void tileRect(u8* tiled, u8* linear, u32 stride, u32 texWidth, u32 texHeight,
+	u32 x, u32 y, u32 w, u32 h, const u32 unit, const u32 shift, const bool untile)
+{
+	u32 tileSize = (64*unit) >> shift;
+	u32 rowSize = (texWidth/8)*tileSize;
+	u32 step = 1 << shift;
+	u32 row, px;
+
+	for (row = 0; row < h; row ++)
+	{
+		// Tiled images are stored bottom-up
+		u32 ty = texHeight-1-(y+row);
+		u8* tileRow = tiled + (ty>>3)*rowSize;
+		u32 yoff = mortonY[ty&7];
+		u8* line = linear + row*stride;
+		u32 end = x+w;
+
+		px = x;
+		while (px < end)
+		{
+			u8* tile = tileRow + (px>>3)*tileSize;
+			u8* l = line + ((px-x)>>shift)*unit;
+			u32 i;
+
+			if (!(px & 7) && px+8 <= end)
+			{
+				// A whole tile row
+				for (i = 0; i < 8; i += step, l += unit)
+				{
+					u8* t = tile + ((mortonX[i] + yoff)>>shift)*unit;
+					if (untile)
+						copyUnit(l, t, unit);
+					else
+						copyUnit(t, l, unit);
+				}
+				px += 8;
+				continue;
+			}
+
+			u8* t = tile + ((mortonX[px&7] + yoff)>>shift)*unit;
+			if (untile)
+				copyUnit(l, t, unit);
+			else
+				copyUnit(t, l, unit);
+			px += step;
+		}
+	}
+}
+
+bool C3Di_TileRect(void* tiled, void* linear, u32 stride, u32 texWidth, u32 texHeight, GPU_TEXCOLOR fmt,
+	u32 x, u32 y, u32 w, u32 h, bool untile)
+{
+	u32 unit = tileUnit(fmt);
+	bool nibbles = fmt == GPU_L4 || fmt == GPU_A4;
+
+	if (!unit || x+w > texWidth || y+h > texHeight || (nibbles && ((x|w) & 1)))
+		return false;
+
+	switch (nibbles ? 0 : unit)
+	{
+		case 0: tileRect((u8*)tiled, (u8*)linear, stride, texWidth, texHeight, x, y, w, h, 1, 1, untile); break;
+		case 1: tileRect((u8*)tiled, (u8*)linear, stride, texWidth, texHeight, x, y, w, h, 1, 0, untile); break;
+		case 2: tileRect((u8*)tiled, (u8*)linear, stride, texWidth, texHeight, x, y, w, h, 2, 0, untile); break;
+		case 3: tileRect((u8*)tiled, (u8*)linear, stride, texWidth, texHeight, x, y, w, h, 3, 0, untile); break;
+		case 4: tileRect((u8*)tiled, (u8*)linear, stride, texWidth, texHeight, x, y, w, h, 4, 0, untile); break;
+	}
+	return true;
+}
+
+static void* texLevel(C3D_Tex* tex, GPU_TEXFACE face, int level, u32* width, u32* height)
+{
+	void* data = C3Di_TexIs2D(tex) ? tex->data : tex->cube->data[face];
+	if (level < 0 || level > tex->maxLevel || addrIsVRAM(data))
+		return NULL;
+
+	*width = tex->width >> level;
+	*height = tex->height >> level;
+	return C3D_TexGetImagePtr(tex, data, level, NULL);
+}
+
+bool C3D_TexTileRect(C3D_Tex* tex, const void* src, u32 stride, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h)
+{
+	u32 width, height;
+	u8* out = (u8*)texLevel(tex, face, level, &width, &height);
+	if (!out || !w || !h)
+		return false;
+
+	if (!C3Di_TileRect(out, (void*)src, stride, width, height, tex->fmt, x, y, w, h, false))
+		return false;
+
+	// Only the tile rows touched by the rectangle need to be flushed
+	u32 rowSize = C3D_TexCalcLevelSize(tex->size, level) / (height/8);
+	u32 first = (height-(y+h)) / 8, last = (height-1-y) / 8;
+	C3D_FlushMarkRange(out + first*rowSize, (last-first+1)*rowSize);
+	C3Di_TexCacheInvalidate();
+	return true;
+}
+
+bool C3D_TexUntileRect(C3D_Tex* tex, void* dst, u32 stride, GPU_TEXFACE face, int level, u32 x, u32 y, u32 w, u32 h)
+{
+	u32 width, height;
+	u8* in = (u8*)texLevel(tex, face, level, &width, &height);
+	if (!in)
+		return false;
+
+	return C3Di_TileRect(in, dst, stride, width, height, tex->fmt, x, y, w, h, true);
+}
@@ -5,7 +5,7 @@ C3D_FVec C3D_FVUnif[2][C3D_FVUNIF_COUNT];
 C3D_IVec C3D_IVUnif[2][C3D_IVUNIF_COUNT];
 u16      C3D_BoolUnifs[2];
 
-bool C3D_FVUnifDirty[2][C3D_FVUNIF_COUNT];
+u32  C3D_FVUnifDirty[2][C3D_FVUNIF_MASKWORDS];
 bool C3D_IVUnifDirty[2][C3D_IVUNIF_COUNT];
 bool C3D_BoolUnifsDirty[2];
 
@@ -16,9 +16,108 @@ static struct
 	float24Uniform_s* data;
 } C3Di_ShaderFVecData[2];
 
-static bool C3Di_FVUnifEverDirty[2][C3D_FVUNIF_COUNT];
+static u32  C3Di_FVUnifEverDirty[2][C3D_FVUNIF_MASKWORDS];
+static u32  C3Di_FVUnifHeld[2][C3D_FVUNIF_MASKWORDS]; // Kept dirty and not uploaded
+static u32  C3Di_FVUnifResident[2][C3D_FVUNIF_MASKWORDS]; // The GPU holds the CPU copy of these rows
 static bool C3Di_IVUnifEverDirty[2][C3D_IVUNIF_COUNT];
 
+// Last values uploaded to the GPU, used to drop writes that change nothing
+static bool C3Di_UnifCompare;
+static C3D_FVec C3Di_FVUnifLast[2][C3D_FVUNIF_COUNT];
+static C3D_IVec C3Di_IVUnifLast[2][C3D_IVUNIF_COUNT];
+static u32  C3Di_FVUnifLastValid[2][C3D_FVUNIF_MASKWORDS];
+static bool C3Di_IVUnifLastValid[2][C3D_IVUNIF_COUNT];
+
+// Returns the index of the first uniform at or after 'from' whose bit equals 'set'
+static inline int C3Di_FVUnifScan(const u32* mask, int from, bool set)
+{
+	while (from < C3D_FVUNIF_COUNT)
+	{
+		u32 word = set ? mask[from/32] : ~mask[from/32];
+		word &= ~0U << (from%32);
+		if (word)
+		{
+			from = (from &~ 31) + __builtin_ctz(word);
+			return from < C3D_FVUNIF_COUNT ? from : C3D_FVUNIF_COUNT;
+		}
+		from = (from &~ 31) + 32;
+	}
+	return C3D_FVUNIF_COUNT;
+}
+
+static inline bool C3Di_FVUnifAnyDirty(const u32* mask)
+{
+	int w;
+	u32 any = 0;
+	for (w = 0; w < C3D_FVUNIF_MASKWORDS; w ++)
+		any |= mask[w];
+	return any != 0;
+}
+
+static void C3Di_FVUnifDropUnchanged(GPU_SHADER_TYPE type)
+{
+	int i;
+	u32* dirty = C3D_FVUnifDirty[type];
+	u32* valid = C3Di_FVUnifLastValid[type];
+	for (i = C3Di_FVUnifScan(dirty, 0, true); i < C3D_FVUNIF_COUNT; i = C3Di_FVUnifScan(dirty, i+1, true))
+	{
+		if (!(valid[i/32] & BIT(i%32)))
+			continue;
+		if (memcmp(&C3D_FVUnif[type][i], &C3Di_FVUnifLast[type][i], sizeof(C3D_FVec)) == 0)
+			dirty[i/32] &= ~BIT(i%32);
+	}
+}
+
+void C3Di_FVUnifHold(GPU_SHADER_TYPE type, int id, int num, bool hold)
+{
+	int i;
+	for (i = id; i < id+num && i < C3D_FVUNIF_COUNT; i ++)
+	{
+		if (hold)
+			C3Di_FVUnifHeld[type][i/32] |= BIT(i%32);
+		else
+			C3Di_FVUnifHeld[type][i/32] &= ~BIT(i%32);
+	}
+}
+
+// The rows were written to the GPU behind the dirty tracking, they no longer match the last copy
+void C3Di_FVUnifForget(GPU_SHADER_TYPE type, int id, int num)
+{
+	int i;
+	for (i = id; i < id+num && i < C3D_FVUNIF_COUNT; i ++)
+	{
+		C3Di_FVUnifLastValid[type][i/32] &= ~BIT(i%32);
+		C3Di_FVUnifResident[type][i/32] &= ~BIT(i%32);
+	}
+}
+
+void C3D_UnifCompareEnable(bool enable)
+{
+	C3Di_UnifCompare = enable;
+	memset(C3Di_FVUnifLastValid, 0, sizeof(C3Di_FVUnifLastValid));
+	memset(C3Di_IVUnifLastValid, 0, sizeof(C3Di_IVUnifLastValid));
+}
+
+int C3D_FVUnifMtxNx4Update(GPU_SHADER_TYPE type, int id, const C3D_Mtx* mtx, int num)
+{
+	int i, changed = 0;
+	for (i = 0; i < num; i ++)
+	{
+		int u = id+i;
+		u32 bit = BIT(u%32);
+
+		// Rows that were not uploaded since the last shader constant or reset may hold something else
+		if (!(C3D_FVUnifDirty[type][u/32] & bit) && (C3Di_FVUnifResident[type][u/32] & bit)
+			&& memcmp(&C3D_FVUnif[type][u], &mtx->r[i], sizeof(C3D_FVec)) == 0)
+			continue;
+
+		C3D_FVUnif[type][u] = mtx->r[i];
+		C3D_FVUnifDirty[type][u/32] |= bit;
+		changed ++;
+	}
+	return changed;
+}
+
 void C3D_UpdateUniforms(GPU_SHADER_TYPE type)
 {
 	int offset = type == GPU_GEOMETRY_SHADER ? (GPUREG_GSH_BOOLUNIFORM-GPUREG_VSH_BOOLUNIFORM) : 0;
@@ -31,47 +130,72 @@ void C3D_UpdateUniforms(GPU_SHADER_TYPE type)
 		{
 			float24Uniform_s* u = &C3Di_ShaderFVecData[type].data[i++];
 			GPUCMD_AddIncrementalWrites(GPUREG_VSH_FLOATUNIFORM_CONFIG+offset, (u32*)u, 4);
-			C3D_FVUnifDirty[type][u->id] = false;
+			C3Di_STAT_ADD(uniformWords, 3);
+			C3D_FVUnifDirty[type][u->id/32] &= ~BIT(u->id%32);
+			C3Di_FVUnifLastValid[type][u->id/32] &= ~BIT(u->id%32);
+			C3Di_FVUnifResident[type][u->id/32] &= ~BIT(u->id%32);
 		}
 		C3Di_ShaderFVecData[type].dirty = false;
 		i = 0;
 	}
 
 	// Update FVec uniforms
-	while (i < C3D_FVUNIF_COUNT)
+	u32* dirty = C3D_FVUnifDirty[type];
+	u32 held[C3D_FVUNIF_MASKWORDS];
+	for (i = 0; i < C3D_FVUNIF_MASKWORDS; i ++)
+	{
+		held[i] = dirty[i] & C3Di_FVUnifHeld[type][i];
+		dirty[i] &= ~held[i];
+	}
+	if (C3Di_UnifCompare && C3Di_FVUnifAnyDirty(dirty))
+		C3Di_FVUnifDropUnchanged(type);
+	if (C3Di_FVUnifAnyDirty(dirty))
 	{
-		if (!C3D_FVUnifDirty[type][i])
+		for (i = C3Di_FVUnifScan(dirty, 0, true); i < C3D_FVUNIF_COUNT; i = C3Di_FVUnifScan(dirty, i, true))
 		{
-			i ++;
-			continue;
-		}
+			// Find the end of the run of consecutive dirty uniforms
+			int j = C3Di_FVUnifScan(dirty, i, false);
 
-		// Find the number of consecutive dirty uniforms
-		int j;
-		for (j = i; j < C3D_FVUNIF_COUNT && C3D_FVUnifDirty[type][j]; j ++);
+			// Upload the uniforms
+			GPUCMD_AddWrite(GPUREG_VSH_FLOATUNIFORM_CONFIG+offset, 0x80000000|i);
+			GPUCMD_AddWrites(GPUREG_VSH_FLOATUNIFORM_DATA+offset, (u32*)&C3D_FVUnif[type][i], (j-i)*4);
+			C3Di_STAT_ADD(uniformWords, (j-i)*4);
+			if (C3Di_UnifCompare)
+				memcpy(&C3Di_FVUnifLast[type][i], &C3D_FVUnif[type][i], (j-i)*sizeof(C3D_FVec));
 
-		// Upload the uniforms
-		GPUCMD_AddWrite(GPUREG_VSH_FLOATUNIFORM_CONFIG+offset, 0x80000000|i);
-		GPUCMD_AddWrites(GPUREG_VSH_FLOATUNIFORM_DATA+offset, (u32*)&C3D_FVUnif[type][i], (j-i)*4);
+			// Advance
+			i = j;
+		}
 
-		// Clear the dirty flag
-		int k;
-		for (k = i; k < j; k ++)
+		// Clear the dirty flags
+		int w;
+		for (w = 0; w < C3D_FVUNIF_MASKWORDS; w ++)
 		{
-			C3D_FVUnifDirty[type][k] = false;
-			C3Di_FVUnifEverDirty[type][k] = true;
+			C3Di_FVUnifEverDirty[type][w] |= dirty[w];
+			C3Di_FVUnifResident[type][w] |= dirty[w];
+			if (C3Di_UnifCompare)
+				C3Di_FVUnifLastValid[type][w] |= dirty[w];
+			dirty[w] = 0;
 		}
-
-		// Advance
-		i = j;
 	}
+	for (i = 0; i < C3D_FVUNIF_MASKWORDS; i ++)
+		dirty[i] |= held[i];
 
 	// Update IVec uniforms
 	for (i = 0; i < C3D_IVUNIF_COUNT; i ++)
 	{
 		if (!C3D_IVUnifDirty[type][i]) continue;
+		if (C3Di_UnifCompare)
+		{
+			C3D_IVUnifDirty[type][i] = false;
+			if (C3Di_IVUnifLastValid[type][i] && C3Di_IVUnifLast[type][i] == C3D_IVUnif[type][i])
+				continue;
+			C3Di_IVUnifLast[type][i] = C3D_IVUnif[type][i];
+			C3Di_IVUnifLastValid[type][i] = true;
+		}
 
 		GPUCMD_AddWrite(GPUREG_VSH_INTUNIFORM_I0+offset+i, C3D_IVUnif[type][i]);
+		C3Di_STAT_ADD(uniformWords, 1);
 		C3D_IVUnifDirty[type][i] = false;
 		C3Di_IVUnifEverDirty[type][i] = false;
 	}
@@ -80,6 +204,7 @@ void C3D_UpdateUniforms(GPU_SHADER_TYPE type)
 	if (C3D_BoolUnifsDirty[type])
 	{
 		GPUCMD_AddWrite(GPUREG_VSH_BOOLUNIFORM+offset, 0x7FFF0000 | C3D_BoolUnifs[type]);
+		C3Di_STAT_ADD(uniformWords, 1);
 		C3D_BoolUnifsDirty[type] = false;
 	}
 }
@@ -87,11 +212,15 @@ void C3D_UpdateUniforms(GPU_SHADER_TYPE type)
 void C3Di_DirtyUniforms(GPU_SHADER_TYPE type)
 {
 	int i;
+	// Whatever was uploaded before can no longer be trusted
+	memset(C3Di_FVUnifLastValid[type], 0, sizeof(C3Di_FVUnifLastValid[type]));
+	memset(C3Di_IVUnifLastValid[type], 0, sizeof(C3Di_IVUnifLastValid[type]));
+	memset(C3Di_FVUnifResident[type], 0, sizeof(C3Di_FVUnifResident[type]));
 	C3D_BoolUnifsDirty[type] = true;
 	if (C3Di_ShaderFVecData[type].count)
 		C3Di_ShaderFVecData[type].dirty = true;
-	for (i = 0; i < C3D_FVUNIF_COUNT; i ++)
-		C3D_FVUnifDirty[type][i] = C3D_FVUnifDirty[type][i] || C3Di_FVUnifEverDirty[type][i];
+	for (i = 0; i < C3D_FVUNIF_MASKWORDS; i ++)
+		C3D_FVUnifDirty[type][i] |= C3Di_FVUnifEverDirty[type][i];
 	for (i = 0; i < C3D_IVUNIF_COUNT; i ++)
 		C3D_IVUnifDirty[type][i] = C3D_IVUnifDirty[type][i] || C3Di_IVUnifEverDirty[type][i];
 }
@@ -0,0 +1,302 @@
+#include "internal.h"
+#include <stdlib.h>
+#include <c3d/vram.h>
+#include <c3d/renderqueue.h>
+
+typedef struct
+{
+	void* addr;
+	u32 size : 29;
+	C3D_VramClass cls : 3;
+} C3Di_VramBlock;
+
+static C3Di_VramBlock* blocks;
+static u32 numBlocks, maxBlocks;
+static size_t bankUsage[C3D_VRAM_CLASS_COUNT][2];
+
+static inline int bankId(const void* addr)
+{
+	return addrGetVRAMBank(addr) == VRAM_ALLOC_A ? 0 : 1;
+}
+
+static vramAllocPos C3Di_VramPlan(C3D_VramClass cls, const void* partner)
+{
+	if (partner && addrIsVRAM(partner))
+		return addrGetVRAMBank(partner) ^ VRAM_ALLOC_ANY;
+
+	size_t fbA = bankUsage[C3D_VRAM_COLOR][0] + bankUsage[C3D_VRAM_DEPTH][0];
+	size_t fbB = bankUsage[C3D_VRAM_COLOR][1] + bankUsage[C3D_VRAM_DEPTH][1];
+	if (fbA == fbB && cls >= C3D_VRAM_TEXTURE)
+	{
+		fbA = bankUsage[cls][0];
+		fbB = bankUsage[cls][1];
+	}
+	return fbA <= fbB ? VRAM_ALLOC_A : VRAM_ALLOC_B;
+}
+
+static bool C3Di_VramTrack(void* addr, size_t size, C3D_VramClass cls)
+{
+	if (numBlocks == maxBlocks)
+	{
+		u32 newMax = maxBlocks ? 2*maxBlocks : 32;
+		C3Di_VramBlock* newBlocks = (C3Di_VramBlock*)realloc(blocks, newMax*sizeof(C3Di_VramBlock));
+		if (!newBlocks)
+			return false;
+		blocks = newBlocks;
+		maxBlocks = newMax;
+	}
+
+	C3Di_VramBlock* b = &blocks[numBlocks++];
+	b->addr = addr;
+	b->size = size;
+	b->cls = cls;
+	bankUsage[cls][bankId(addr)] += size;
+	return true;
+}
+
+static void* C3Di_VramAllocAt(size_t size, C3D_VramClass cls, vramAllocPos pos)
+{
+	void* addr = vramAllocAt(size, pos);
+	if (!addr) return NULL;
+
+	if (!C3Di_VramTrack(addr, size, cls))
+	{
+		vramFree(addr);
+		return NULL;
+	}
+	return addr;
+}
+
+void* C3D_VramAlloc(size_t size, C3D_VramClass cls, const void* partner)
+{
+	if (cls >= C3D_VRAM_CLASS_COUNT)
+		return NULL;
+
+	vramAllocPos bank = C3Di_VramPlan(cls, partner);
+	void* addr = C3Di_VramAllocAt(size, cls, bank);
+	if (!addr) addr = C3Di_VramAllocAt(size, cls, bank ^ VRAM_ALLOC_ANY);
+	return addr;
+}
+
+void C3D_VramFree(void* addr)
+{
+	u32 i;
+	if (!addr)
+		return;
+	for (i = 0; i < numBlocks; i ++)
+	{
+		C3Di_VramBlock* b = &blocks[i];
+		if (b->addr != addr)
+			continue;
+		bankUsage[b->cls][bankId(addr)] -= b->size;
+		*b = blocks[--numBlocks];
+		break;
+	}
+	vramFree(addr);
+}
+
+void* C3D_VramUploadBuffer(const void* data, size_t size)
+{
+	// The transfer moves whole 16 byte blocks, a partial last block is read from a padded copy.
+	// Inside a frame the copy only runs later, when that copy could no longer be freed.
+	size_t head = size &~ 0xF, tail = size - head;
+	if (!size || (tail && C3Di_InFrame()))
+		return NULL;
+
+	void* out = C3D_VramAlloc(head + (tail ? 0x10 : 0), C3D_VRAM_VERTEX, NULL);
+	if (!out)
+		return NULL;
+
+	u32* last = NULL;
+	if (tail)
+	{
+		last = (u32*)linearAlloc(0x10);
+		if (!last)
+		{
+			C3D_VramFree(out);
+			return NULL;
+		}
+		memcpy(last, (const u8*)data + head, tail);
+		memset((u8*)last + tail, 0, 0x10 - tail);
+		GSPGPU_FlushDataCache(last, 0x10);
+	}
+
+	if (head)
+	{
+		GSPGPU_FlushDataCache(data, head);
+		C3D_SyncTextureCopy((u32*)data, 0, (u32*)out, 0, head, 8);
+	}
+	if (last)
+	{
+		C3D_SyncTextureCopy(last, 0, (u32*)((u8*)out + head), 0, 0x10, 8);
+		linearFree(last);
+	}
+	return out;
+}
+
+void C3D_VramGetUsage(C3D_VramClass cls, size_t* bankA, size_t* bankB)
+{
+	if (cls >= C3D_VRAM_CLASS_COUNT)
+		return;
+	if (bankA) *bankA = bankUsage[cls][0];
+	if (bankB) *bankB = bankUsage[cls][1];
+}
+
+typedef struct
+{
+	void** slot;
+	void* old;
+	void* fresh;
+	void* staged;
+	u32 size;
+	C3D_VramClass cls;
+	C3D_RenderTarget* target;
+} C3Di_VramMove;
+
+static int C3Di_VramMoveCmp(const void* a, const void* b)
+{
+	const C3Di_VramMove* x = (const C3Di_VramMove*)a;
+	const C3Di_VramMove* y = (const C3Di_VramMove*)b;
+	if (x->cls != y->cls)
+		return (int)x->cls - (int)y->cls; // Colour buffers first so that depth can be paired with them
+	return x->size > y->size ? -1 : x->size < y->size ? 1 : 0; // Largest first
+}
+
+static int C3Di_VramMoveAddrCmp(const void* a, const void* b)
+{
+	const C3Di_VramMove* x = (const C3Di_VramMove*)a;
+	const C3Di_VramMove* y = (const C3Di_VramMove*)b;
+	return x->old < y->old ? -1 : x->old > y->old ? 1 : 0;
+}
+
+static bool C3Di_VramPlace(C3Di_VramMove* moves, int count, bool planned)
+{
+	int i;
+	for (i = 0; i < count; i ++)
+	{
+		C3Di_VramMove* m = &moves[i];
+		if (planned)
+		{
+			const void* partner = NULL;
+			if (m->cls == C3D_VRAM_DEPTH && m->target->ownsColor)
+				partner = m->target->frameBuf.colorBuf;
+			m->fresh = C3D_VramAlloc(m->size, m->cls, partner);
+		} else
+			m->fresh = C3Di_VramAllocAt(m->size, m->cls, VRAM_ALLOC_ANY);
+
+		if (!m->fresh)
+		{
+			while (i--)
+				C3D_VramFree(moves[i].fresh);
+			return false;
+		}
+
+		// Depth buffers are paired with the colour buffer placed before them
+		if (m->target && m->cls == C3D_VRAM_COLOR)
+			m->target->frameBuf.colorBuf = m->fresh;
+	}
+	return true;
+}
+
+bool C3D_VramCompact(C3D_Tex* const* texs, int numTex)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	C3D_RenderTarget* target;
+	int i, count = 0;
+
+	if (!(ctx->flags & C3DiF_Active))
+		return false;
+
+	for (target = C3Di_RenderTargetFirst(); target; target = target->next)
+		count += target->ownsColor + target->ownsDepth;
+	count += numTex;
+
+	C3Di_VramMove* moves = (C3Di_VramMove*)calloc(count ? count : 1, sizeof(C3Di_VramMove));
+	if (!moves)
+		return false;
+
+	C3Di_RenderQueueWaitDone();
+
+	count = 0;
+	for (target = C3Di_RenderTargetFirst(); target; target = target->next)
+	{
+		C3D_FrameBuf* fb = &target->frameBuf;
+		if (target->ownsColor)
+			moves[count++] = (C3Di_VramMove){ &fb->colorBuf, fb->colorBuf, NULL, NULL,
+				C3D_CalcColorBufSize(fb->width, fb->height, fb->colorFmt), C3D_VRAM_COLOR, target };
+		if (target->ownsDepth)
+			moves[count++] = (C3Di_VramMove){ &fb->depthBuf, fb->depthBuf, NULL, NULL,
+				C3D_CalcDepthBufSize(fb->width, fb->height, fb->depthFmt), C3D_VRAM_DEPTH, target };
+	}
+
+	// Textures are staged in linear memory before anything is released
+	bool ok = true;
+	for (i = 0; i < numTex; i ++)
+	{
+		C3D_Tex* tex = texs[i];
+		if (!C3Di_TexIs2D(tex) || !addrIsVRAM(tex->data))
+			continue;
+
+		C3Di_VramMove* m = &moves[count];
+		m->slot = &tex->data;
+		m->old = tex->data;
+		m->size = C3D_TexCalcTotalSize(tex->size, tex->maxLevel);
+		m->cls = C3D_VRAM_TEXTURE;
+		m->staged = linearAlloc(m->size);
+		if (!m->staged)
+		{
+			ok = false;
+			break;
+		}
+		C3D_SyncTextureCopy((u32*)m->old, 0, (u32*)m->staged, 0, m->size, 8);
+		GSPGPU_InvalidateDataCache(m->staged, m->size);
+		count++;
+	}
+
+	if (!ok)
+	{
+		for (i = 0; i < count; i ++)
+			if (moves[i].staged)
+				linearFree(moves[i].staged);
+		free(moves);
+		return false;
+	}
+
+	for (i = 0; i < count; i ++)
+		C3D_VramFree(moves[i].old);
+
+	// Nothing is copied back until every block has its new place. When the packed layout does not
+	// fit, the blocks go back in their old address order: the allocator is first fit, so every
+	// block lands at or below its old address and the old layout always fits again.
+	qsort(moves, count, sizeof(C3Di_VramMove), C3Di_VramMoveCmp);
+	if (!C3Di_VramPlace(moves, count, true))
+	{
+		qsort(moves, count, sizeof(C3Di_VramMove), C3Di_VramMoveAddrCmp);
+		if (!C3Di_VramPlace(moves, count, false))
+			svcBreak(USERBREAK_PANIC); // Shouldn't happen, nothing else allocates in between.
+		ok = false;
+	}
+
+	for (i = 0; i < count; i ++)
+	{
+		C3Di_VramMove* m = &moves[i];
+		*m->slot = m->fresh;
+		if (!m->staged)
+			continue;
+
+		C3D_SyncTextureCopy((u32*)m->staged, 0, (u32*)m->fresh, 0, m->size, 8);
+		linearFree(m->staged);
+
+		// Render targets created from the texture follow it
+		for (target = C3Di_RenderTargetFirst(); target; target = target->next)
+		{
+			u32 offset = (u8*)target->frameBuf.colorBuf - (u8*)m->old;
+			if (!target->ownsColor && offset < m->size)
+				target->frameBuf.colorBuf = (u8*)m->fresh + offset;
+		}
+	}
+
+	free(moves);
+	ctx->flags |= C3DiF_FrameBuf | C3DiF_TexAll;
+	return ok;
+}
@@ -0,0 +1,485 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <3ds.h>
+#include <citro3d.h>
+
+#include "vshader_shbin.h"
+
+#define CLEAR_COLOR 0x404040FF
+
+#define DISPLAY_TRANSFER_FLAGS \
+  (GX_TRANSFER_FLIP_VERT(0) | GX_TRANSFER_OUT_TILED(0) | GX_TRANSFER_RAW_COPY(0) | \
+   GX_TRANSFER_IN_FORMAT(GX_TRANSFER_FMT_RGBA8) | GX_TRANSFER_OUT_FORMAT(GX_TRANSFER_FMT_RGB8) | \
+   GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_NO))
+
+// Frames measured per benchmark, after one warm-up frame
+#define BENCH_FRAMES 8
+
+#define RESULTS_PATH "sdmc:/citro3d_bench.csv"
+
+namespace
+{
+
+typedef struct
+{
+  float position[3];
+  float color[4];
+} vertex_t;
+
+// A single small triangle, so that the GPU time is dominated by the command processing
+const vertex_t vertex_list[] =
+{
+  { { 190.0f, 110.0f, 0.5f }, { 1.0f, 0.0f, 0.0f, 1.0f } },
+  { { 210.0f, 110.0f, 0.5f }, { 0.0f, 1.0f, 0.0f, 1.0f } },
+  { { 200.0f, 130.0f, 0.5f }, { 0.0f, 0.0f, 1.0f, 1.0f } },
+};
+
+const u16 index_list[] = { 0, 1, 2 };
+
+struct
+{
+  shaderProgram_s   program[2];
+  DVLB_s            *dvlb;
+  int               uLoc_projection;
+
+  C3D_RenderTarget  *target[2];
+  C3D_AttrInfo      attrInfo[2];
+  C3D_BufInfo       bufInfo[2];
+  C3D_Tex           tex[2];
+  C3D_Tex           vramTex;
+  void              *image;
+  C3D_LightEnv      lightEnv;
+  C3D_Light         light;
+  C3D_LightLut      lightLut[2];
+  C3D_FogLut        fogLut[2];
+  C3D_ProcTex       procTex[2];
+  C3D_ProcTexLut    procTexLut[2];
+
+  void              *vbo;
+  void              *ibo;
+} scene;
+
+typedef struct
+{
+  const char *name;
+  int        iterations;
+  void       (*run)(int i); // One iteration, recorded inside a frame
+  void       (*setup)();    // Optional, called once before the benchmark
+  void       (*teardown)(); // Optional
+  bool       timeFrameEnd;  // Measure C3D_FrameEnd instead of the recording
+} bench_t;
+
+typedef struct
+{
+  double cpuUs;   // per iteration, or per frame for timeFrameEnd
+  double gpuMs;   // per frame, from C3D_GetDrawingTime
+  double cmdWords; // per iteration
+} result_t;
+
+void draw()
+{
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+}
+
+void sceneInit()
+{
+  scene.dvlb = DVLB_ParseFile((u32*)vshader_shbin, vshader_shbin_size);
+  for(int i = 0; i < 2; ++i)
+  {
+    shaderProgramInit(&scene.program[i]);
+    shaderProgramSetVsh(&scene.program[i], &scene.dvlb->DVLE[0]);
+  }
+  C3D_BindProgram(&scene.program[0]);
+  scene.uLoc_projection = shaderInstanceGetUniformLocation(scene.program[0].vertexShader, "projection");
+
+  for(int i = 0; i < 2; ++i)
+  {
+    scene.target[i] = C3D_RenderTargetCreate(240, 400, GPU_RB_RGBA8, GPU_RB_DEPTH24_STENCIL8);
+    C3D_RenderTargetSetClear(scene.target[i], C3D_CLEAR_ALL, CLEAR_COLOR, 0);
+  }
+  C3D_RenderTargetSetOutput(scene.target[0], GFX_TOP, GFX_LEFT, DISPLAY_TRANSFER_FLAGS);
+
+  scene.vbo = linearAlloc(sizeof(vertex_list));
+  std::memcpy(scene.vbo, vertex_list, sizeof(vertex_list));
+  scene.ibo = linearAlloc(sizeof(index_list));
+  std::memcpy(scene.ibo, index_list, sizeof(index_list));
+
+  // Two equivalent layouts, so that switching between them changes the state but not the output
+  for(int i = 0; i < 2; ++i)
+  {
+    AttrInfo_Init(&scene.attrInfo[i]);
+    AttrInfo_AddLoader(&scene.attrInfo[i], 0, GPU_FLOAT, 3);
+    AttrInfo_AddLoader(&scene.attrInfo[i], 1, GPU_FLOAT, 4);
+
+    BufInfo_Init(&scene.bufInfo[i]);
+    BufInfo_Add(&scene.bufInfo[i], scene.vbo, sizeof(vertex_t), 2, 0x10);
+  }
+  C3D_SetAttrInfo(&scene.attrInfo[0]);
+  C3D_SetBufInfo(&scene.bufInfo[0]);
+
+  C3D_Mtx projection;
+  Mtx_OrthoTilt(&projection, 0.0f, 400.0f, 0.0f, 240.0f, 0.0f, 1.0f, true);
+  C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, scene.uLoc_projection, &projection);
+
+  // 128x128 RGBA8 image for the upload benchmarks
+  scene.image = linearAlloc(128*128*4);
+  std::memset(scene.image, 0x80, 128*128*4);
+  GSPGPU_FlushDataCache(scene.image, 128*128*4);
+  for(int i = 0; i < 2; ++i)
+  {
+    C3D_TexInit(&scene.tex[i], 128, 128, GPU_RGBA8);
+    C3D_TexUpload(&scene.tex[i], scene.image);
+  }
+  C3D_TexInitVRAM(&scene.vramTex, 128, 128, GPU_RGBA8);
+
+  C3D_LightEnvInit(&scene.lightEnv);
+  C3D_LightInit(&scene.light, &scene.lightEnv);
+  LightLut_Phong(&scene.lightLut[0], 30.0f);
+  LightLut_Phong(&scene.lightLut[1], 5.0f);
+
+  FogLut_Exp(&scene.fogLut[0], 0.05f, 1.5f, 0.01f, 20.0f);
+  FogLut_Exp(&scene.fogLut[1], 0.10f, 1.5f, 0.01f, 20.0f);
+
+  float ramp[129];
+  for(int i = 0; i < 129; ++i)
+    ramp[i] = i / 128.0f;
+  for(int i = 0; i < 2; ++i)
+  {
+    C3D_ProcTexInit(&scene.procTex[i], 0, 16);
+    C3D_ProcTexNoiseEnable(&scene.procTex[i], i != 0);
+    ProcTexLut_FromArray(&scene.procTexLut[i], ramp);
+    ramp[0] = 0.5f;
+  }
+
+  C3D_TexEnv* env = C3D_GetTexEnv(0);
+  C3D_TexEnvInit(env);
+  C3D_TexEnvSrc(env, C3D_Both, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR, GPU_PRIMARY_COLOR);
+  C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
+}
+
+void sceneExit()
+{
+  for(int i = 0; i < 2; ++i)
+  {
+    C3D_TexDelete(&scene.tex[i]);
+    C3D_RenderTargetDelete(scene.target[i]);
+    shaderProgramFree(&scene.program[i]);
+  }
+  C3D_TexDelete(&scene.vramTex);
+  linearFree(scene.image);
+  linearFree(scene.ibo);
+  linearFree(scene.vbo);
+  DVLB_Free(scene.dvlb);
+}
+
+// Draw calls
+void benchDrawArrays(int)
+{
+  draw();
+}
+
+void benchDrawElements(int)
+{
+  C3D_DrawElements(GPU_TRIANGLES, 3, C3D_UNSIGNED_SHORT, scene.ibo);
+}
+
+// Uniform uploads, the dirtied vectors start after the projection
+template <int N>
+void benchUniforms(int i)
+{
+  C3D_FVec* ptr = C3D_FVUnifWritePtr(GPU_VERTEX_SHADER, 4, N);
+  for(int j = 0; j < N; ++j)
+    ptr[j] = FVec4_New(i, j, 0.0f, 1.0f);
+  C3D_UpdateUniforms(GPU_VERTEX_SHADER);
+}
+
+// State group rebinds, each iteration switches to the other of two states and draws
+void benchAttrInfo(int i)
+{
+  C3D_SetAttrInfo(&scene.attrInfo[i & 1]);
+  draw();
+}
+
+void benchBufInfo(int i)
+{
+  C3D_SetBufInfo(&scene.bufInfo[i & 1]);
+  draw();
+}
+
+void benchProgram(int i)
+{
+  C3D_BindProgram(&scene.program[i & 1]);
+  draw();
+}
+
+void benchViewport(int i)
+{
+  C3D_SetViewport(0, i & 1, 240, 400 - (i & 1));
+  draw();
+}
+
+void benchScissor(int i)
+{
+  C3D_SetScissor(GPU_SCISSOR_NORMAL, 0, 0, 240, 400 - (i & 1));
+  draw();
+}
+
+void benchEffect(int i)
+{
+  C3D_DepthTest(true, (i & 1) ? GPU_GEQUAL : GPU_GREATER, GPU_WRITE_ALL);
+  draw();
+}
+
+void benchTexUnits(int i)
+{
+  C3D_TexBind(0, &scene.tex[i & 1]);
+  draw();
+}
+
+void benchTexEnv(int i)
+{
+  C3D_TexEnvColor(C3D_GetTexEnv(0), (i & 1) ? 0xFFFFFFFF : 0xFFFFFFFE);
+  draw();
+}
+
+void benchFramebuf(int i)
+{
+  C3D_FrameDrawOn(scene.target[i & 1]);
+  draw();
+}
+
+void benchLightEnv(int i)
+{
+  C3D_LightEnvBind((i & 1) ? &scene.lightEnv : nullptr);
+  draw();
+}
+
+void benchFogMode(int i)
+{
+  C3D_FogGasMode((i & 1) ? GPU_FOG : GPU_NO_FOG, GPU_PLAIN_DENSITY, false);
+  draw();
+}
+
+void benchProcTex(int i)
+{
+  C3D_ProcTexBind(0, &scene.procTex[i & 1]);
+  draw();
+}
+
+void teardownState()
+{
+  C3D_SetAttrInfo(&scene.attrInfo[0]);
+  C3D_SetBufInfo(&scene.bufInfo[0]);
+  C3D_BindProgram(&scene.program[0]);
+  C3D_SetViewport(0, 0, 240, 400);
+  C3D_SetScissor(GPU_SCISSOR_DISABLE, 0, 0, 0, 0);
+  C3D_DepthTest(true, GPU_GREATER, GPU_WRITE_ALL);
+  C3D_TexBind(0, nullptr);
+  C3D_LightEnvBind(nullptr);
+  C3D_FogGasMode(GPU_NO_FOG, GPU_PLAIN_DENSITY, false);
+  C3D_ProcTexBind(0, nullptr);
+}
+
+// Texture uploads
+void benchTexLinear(int)
+{
+  C3D_TexLoadImage(&scene.tex[0], scene.image, GPU_TEXFACE_2D, 0);
+}
+
+void benchTexVRAM(int)
+{
+  C3D_TexLoadImage(&scene.vramTex, scene.image, GPU_TEXFACE_2D, 0);
+}
+
+// LUT uploads, the LUTs alternate so that every draw has to upload one
+void setupLightLut()
+{
+  C3D_LightEnvBind(&scene.lightEnv);
+}
+
+void benchLightLut(int i)
+{
+  C3D_LightEnvLut(&scene.lightEnv, GPU_LUT_D0, GPU_LUTINPUT_NH, false, &scene.lightLut[i & 1]);
+  draw();
+}
+
+void setupFogLut()
+{
+  C3D_FogGasMode(GPU_FOG, GPU_PLAIN_DENSITY, false);
+}
+
+void benchFogLut(int i)
+{
+  C3D_FogLutBind(&scene.fogLut[i & 1]);
+  draw();
+}
+
+void setupProcTexLut()
+{
+  C3D_ProcTexBind(0, &scene.procTex[0]);
+}
+
+void benchProcTexLut(int i)
+{
+  C3D_ProcTexLutBind(GPU_LUT_NOISE, &scene.procTexLut[i & 1]);
+  draw();
+}
+
+// Frame submission, with a typical amount of recorded work
+void benchFrameEnd(int)
+{
+  draw();
+}
+
+const bench_t benches[] =
+{
+  { "DrawArrays",          500, benchDrawArrays,     nullptr,         nullptr,       false, },
+  { "DrawElements",        500, benchDrawElements,   nullptr,         nullptr,       false, },
+  { "UpdateUniforms x1",   500, benchUniforms<1>,    nullptr,         nullptr,       false, },
+  { "UpdateUniforms x8",   500, benchUniforms<8>,    nullptr,         nullptr,       false, },
+  { "UpdateUniforms x32",  200, benchUniforms<32>,   nullptr,         nullptr,       false, },
+  { "UpdateUniforms x92",  100, benchUniforms<92>,   nullptr,         nullptr,       false, },
+  { "Rebind AttrInfo",     500, benchAttrInfo,       nullptr,         teardownState, false, },
+  { "Rebind BufInfo",      500, benchBufInfo,        nullptr,         teardownState, false, },
+  { "Rebind Program",      200, benchProgram,        nullptr,         teardownState, false, },
+  { "Rebind Viewport",     500, benchViewport,       nullptr,         teardownState, false, },
+  { "Rebind Scissor",      500, benchScissor,        nullptr,         teardownState, false, },
+  { "Rebind Effect",       500, benchEffect,         nullptr,         teardownState, false, },
+  { "Rebind TexUnits",     500, benchTexUnits,       nullptr,         teardownState, false, },
+  { "Rebind TexEnv",       500, benchTexEnv,         nullptr,         teardownState, false, },
+  { "Rebind FrameBuf",     100, benchFramebuf,       nullptr,         teardownState, false, },
+  { "Rebind LightEnv",     200, benchLightEnv,       nullptr,         teardownState, false, },
+  { "Rebind FogGasMode",   500, benchFogMode,        nullptr,         teardownState, false, },
+  { "Rebind ProcTex",      500, benchProcTex,        nullptr,         teardownState, false, },
+  { "TexLoadImage linear",  16, benchTexLinear,      nullptr,         nullptr,       false, },
+  { "TexLoadImage VRAM",    16, benchTexVRAM,        nullptr,         nullptr,       false, },
+  { "LightLut upload",     200, benchLightLut,       setupLightLut,   teardownState, false, },
+  { "FogLut upload",       200, benchFogLut,         setupFogLut,     teardownState, false, },
+  { "ProcTexLut upload",   200, benchProcTexLut,     setupProcTexLut, teardownState, false, },
+  { "FrameEnd 100 draws",  100, benchFrameEnd,       nullptr,         nullptr,       true,  },
+  { "FrameEnd 1000 draws",1000, benchFrameEnd,       nullptr,         nullptr,       true,  },
+};
+
+const size_t num_benches = sizeof(benches)/sizeof(benches[0]);
+
+double ticksToUs(u64 ticks)
+{
+  return ticks * 1000000.0 / SYSCLOCK_ARM11;
+}
+
+result_t runBench(const bench_t &b)
+{
+  result_t res = {};
+  u64 cpuTicks = 0;
+  double gpuMs = 0.0, cmdWords = 0.0;
+
+  if(b.setup)
+    b.setup();
+
+  // The first frame warms up the caches and leaves the state the benchmark runs in
+  for(int frame = 0; frame <= BENCH_FRAMES; ++frame)
+  {
+    C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+    if(frame > 1)
+      gpuMs += C3D_GetDrawingTime();
+
+    C3D_FrameDrawOn(scene.target[0]);
+    float usage = C3D_GetCmdBufUsage();
+
+    u64 start = svcGetSystemTick();
+    for(int i = 0; i < b.iterations; ++i)
+      b.run(i);
+    u64 recorded = svcGetSystemTick();
+
+    if(frame > 0)
+      cmdWords += (C3D_GetCmdBufUsage() - usage) * C3D_DEFAULT_CMDBUF_SIZE / 4;
+
+    C3D_FrameEnd(0);
+    u64 end = svcGetSystemTick();
+
+    if(frame > 0)
+      cpuTicks += b.timeFrameEnd ? end - recorded : recorded - start;
+  }
+
+  // Wait for the last frame to get its GPU time
+  C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+  gpuMs += C3D_GetDrawingTime();
+  C3D_FrameEnd(0);
+
+  if(b.teardown)
+    b.teardown();
+
+  res.cpuUs    = ticksToUs(cpuTicks) / BENCH_FRAMES / (b.timeFrameEnd ? 1 : b.iterations);
+  res.gpuMs    = gpuMs / BENCH_FRAMES;
+  res.cmdWords = cmdWords / BENCH_FRAMES / b.iterations;
+  return res;
+}
+
+void runAll()
+{
+  result_t results[num_benches];
+
+  std::printf("\x1b[2J");
+  std::printf("%-20s %9s %8s %6s\n", "benchmark", "cpu us", "gpu ms", "words");
+  for(size_t i = 0; i < num_benches; ++i)
+  {
+    results[i] = runBench(benches[i]);
+    std::printf("%-20s %9.2f %8.3f %6.1f\n", benches[i].name, results[i].cpuUs, results[i].gpuMs, results[i].cmdWords);
+  }
+
+  FILE *fp = std::fopen(RESULTS_PATH, "w");
+  if(!fp)
+  {
+    std::printf("Could not write " RESULTS_PATH "\n");
+    return;
+  }
+
+  std::fprintf(fp, "benchmark,iterations,cpu_us,gpu_ms_per_frame,cmd_words\n");
+  for(size_t i = 0; i < num_benches; ++i)
+    std::fprintf(fp, "%s,%d,%.3f,%.4f,%.2f\n", benches[i].name, benches[i].iterations,
+                 results[i].cpuUs, results[i].gpuMs, results[i].cmdWords);
+  std::fclose(fp);
+
+  std::printf("Results written to " RESULTS_PATH "\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  gfxInitDefault();
+  gfxSet3D(false);
+  consoleInit(GFX_BOTTOM, nullptr);
+  C3D_Init(C3D_DEFAULT_CMDBUF_SIZE);
+
+  sceneInit();
+
+  std::printf("citro3d benchmarks\n\n");
+  std::printf("cpu us: per iteration (per frame for FrameEnd)\n");
+  std::printf("gpu ms: per frame of iterations\n\n");
+  std::printf("A: run  START: exit\n");
+
+  while(aptMainLoop())
+  {
+    gspWaitForVBlank();
+
+    hidScanInput();
+    u32 down = hidKeysDown();
+
+    if(down & KEY_A)
+    {
+      runAll();
+      std::printf("A: run again  START: exit\n");
+    }
+    else if(down & KEY_START)
+      break;
+  }
+
+  sceneExit();
+
+  C3D_Fini();
+  gfxExit();
+
+  return 0;
+}
@@ -0,0 +1,490 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include "host/host.h"
+
+extern "C" {
+#include <c3d/maths.h>
+#include <c3d/attribs.h>
+#include <c3d/buffers.h>
+#include <c3d/base.h>
+#include <c3d/effect.h>
+#include <c3d/uniforms.h>
+}
+
+typedef std::default_random_engine            generator_t;
+typedef std::uniform_real_distribution<float> distribution_t;
+
+namespace
+{
+// Keeps the compiler from dropping the computation of a result
+template <typename T>
+inline void
+consume(const T &t)
+{
+  asm volatile("" : : "r"(&t) : "memory");
+}
+
+inline glm::mat4
+loadMatrix(const C3D_Mtx &m)
+{
+  return glm::mat4(m.m[ 3], m.m[ 7], m.m[11], m.m[15],
+                   m.m[ 2], m.m[ 6], m.m[10], m.m[14],
+                   m.m[ 1], m.m[ 5], m.m[ 9], m.m[13],
+                   m.m[ 0], m.m[ 4], m.m[ 8], m.m[12]);
+}
+
+inline glm::quat
+loadQuat(const C3D_FQuat &q)
+{
+  return glm::quat(q.r, q.i, q.j, q.k);
+}
+
+struct Inputs
+{
+  std::vector<C3D_Mtx>   mtx;
+  std::vector<C3D_FVec>  vec;
+  std::vector<C3D_FQuat> quat;
+  std::vector<float>     scalar;
+
+  std::vector<glm::mat4> gmtx;
+  std::vector<glm::vec4> gvec;
+  std::vector<glm::quat> gquat;
+
+  // Scratch the batched routines write to
+  std::vector<C3D_Mtx>   outMtx;
+  std::vector<C3D_FVec>  outVec;
+
+  Inputs(size_t count, unsigned seed)
+  : mtx(count), vec(count), quat(count), scalar(count),
+    gmtx(count), gvec(count), gquat(count),
+    outMtx(count), outVec(count)
+  {
+    generator_t    gen(seed);
+    distribution_t dist(-10.0f, 10.0f);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+      for(size_t j = 0; j < 16; ++j)
+        mtx[i].m[j] = dist(gen);
+
+      vec[i]    = FVec4_New(dist(gen), dist(gen), dist(gen), dist(gen));
+      quat[i]   = Quat_Normalize(Quat_New(dist(gen), dist(gen), dist(gen), dist(gen)));
+      scalar[i] = dist(gen);
+
+      gmtx[i]  = loadMatrix(mtx[i]);
+      gvec[i]  = glm::vec4(vec[i].x, vec[i].y, vec[i].z, vec[i].w);
+      gquat[i] = loadQuat(quat[i]);
+    }
+  }
+};
+
+struct Result
+{
+  std::string name;
+  double      c3d; // ns/op
+  double      glm; // ns/op, NAN if GLM has no counterpart
+};
+
+struct Options
+{
+  size_t      count  = 4096;
+  size_t      reps   = 20;
+  std::string filter;
+  enum { TABLE, CSV, JSON } format = TABLE;
+};
+
+// Best time over all repetitions of running f over every input, in ns per call
+template <typename F>
+double
+measure(const Options &opt, F &&f)
+{
+  double best = INFINITY;
+  for(size_t r = 0; r < opt.reps; ++r)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < opt.count; ++i)
+      f(i);
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / opt.count;
+    best = std::min(best, ns);
+  }
+  return best;
+}
+
+class Suite
+{
+public:
+  Suite(const Options &opt)
+  : opt(opt)
+  {
+  }
+
+  template <typename F, typename G>
+  void
+  add(const char *name, F &&c3d, G &&glm)
+  {
+    if(!selected(name))
+      return;
+    results.push_back(Result{name, measure(opt, c3d), measure(opt, glm)});
+  }
+
+  template <typename F>
+  void
+  add(const char *name, F &&c3d)
+  {
+    if(!selected(name))
+      return;
+    results.push_back(Result{name, measure(opt, c3d), NAN});
+  }
+
+  // Batched routines process the whole input in one call, report them per element
+  template <typename F>
+  void
+  addBatch(const char *name, F &&c3d)
+  {
+    if(!selected(name))
+      return;
+
+    Options once = opt;
+    once.count = 1;
+    results.push_back(Result{name, measure(once, c3d) / opt.count, NAN});
+  }
+
+  void
+  print() const
+  {
+    switch(opt.format)
+    {
+      case Options::TABLE:
+        std::printf("%-28s %12s %12s %8s\n", "routine", "c3d ns/op", "glm ns/op", "ratio");
+        for(const Result &r : results)
+        {
+          if(std::isnan(r.glm))
+            std::printf("%-28s %12.2f %12s %8s\n", r.name.c_str(), r.c3d, "-", "-");
+          else
+            std::printf("%-28s %12.2f %12.2f %8.2f\n", r.name.c_str(), r.c3d, r.glm, r.c3d / r.glm);
+        }
+        break;
+
+      case Options::CSV:
+        std::printf("routine,c3d_ns,glm_ns\n");
+        for(const Result &r : results)
+        {
+          if(std::isnan(r.glm))
+            std::printf("%s,%.3f,\n", r.name.c_str(), r.c3d);
+          else
+            std::printf("%s,%.3f,%.3f\n", r.name.c_str(), r.c3d, r.glm);
+        }
+        break;
+
+      case Options::JSON:
+        std::printf("{\"count\":%zu,\"reps\":%zu,\"results\":[", opt.count, opt.reps);
+        for(size_t i = 0; i < results.size(); ++i)
+        {
+          const Result &r = results[i];
+          std::printf("%s\n  {\"routine\":\"%s\",\"c3d_ns\":%.3f,", i ? "," : "", r.name.c_str(), r.c3d);
+          if(std::isnan(r.glm))
+            std::printf("\"glm_ns\":null}");
+          else
+            std::printf("\"glm_ns\":%.3f}", r.glm);
+        }
+        std::printf("\n]}\n");
+        break;
+    }
+  }
+
+private:
+  bool
+  selected(const char *name) const
+  {
+    return opt.filter.empty() || std::strstr(name, opt.filter.c_str());
+  }
+
+  const Options       &opt;
+  std::vector<Result> results;
+};
+
+void
+benchVector(Suite &s, Inputs &in)
+{
+  const size_t n = in.vec.size();
+  auto next = [n](size_t i) { return (i + 1) % n; };
+
+  s.add("FVec4_Add",
+    [&](size_t i) { consume(FVec4_Add(in.vec[i], in.vec[next(i)])); },
+    [&](size_t i) { consume(in.gvec[i] + in.gvec[next(i)]); });
+  s.add("FVec4_Scale",
+    [&](size_t i) { consume(FVec4_Scale(in.vec[i], in.scalar[i])); },
+    [&](size_t i) { consume(in.gvec[i] * in.scalar[i]); });
+  s.add("FVec4_Dot",
+    [&](size_t i) { consume(FVec4_Dot(in.vec[i], in.vec[next(i)])); },
+    [&](size_t i) { consume(glm::dot(in.gvec[i], in.gvec[next(i)])); });
+  s.add("FVec4_Magnitude",
+    [&](size_t i) { consume(FVec4_Magnitude(in.vec[i])); },
+    [&](size_t i) { consume(glm::length(in.gvec[i])); });
+  s.add("FVec4_Normalize",
+    [&](size_t i) { consume(FVec4_Normalize(in.vec[i])); },
+    [&](size_t i) { consume(glm::normalize(in.gvec[i])); });
+  s.add("FVec4_PerspDivide",
+    [&](size_t i) { consume(FVec4_PerspDivide(in.vec[i])); },
+    [&](size_t i) { consume(in.gvec[i] / in.gvec[i].w); });
+
+  s.add("FVec3_Dot",
+    [&](size_t i) { consume(FVec3_Dot(in.vec[i], in.vec[next(i)])); },
+    [&](size_t i) { consume(glm::dot(glm::vec3(in.gvec[i]), glm::vec3(in.gvec[next(i)]))); });
+  s.add("FVec3_Cross",
+    [&](size_t i) { consume(FVec3_Cross(in.vec[i], in.vec[next(i)])); },
+    [&](size_t i) { consume(glm::cross(glm::vec3(in.gvec[i]), glm::vec3(in.gvec[next(i)]))); });
+  s.add("FVec3_Normalize",
+    [&](size_t i) { consume(FVec3_Normalize(in.vec[i])); },
+    [&](size_t i) { consume(glm::normalize(glm::vec3(in.gvec[i]))); });
+  s.add("FVec3_Distance",
+    [&](size_t i) { consume(FVec3_Distance(in.vec[i], in.vec[next(i)])); },
+    [&](size_t i) { consume(glm::distance(glm::vec3(in.gvec[i]), glm::vec3(in.gvec[next(i)]))); });
+}
+
+void
+benchMatrix(Suite &s, Inputs &in)
+{
+  const size_t n = in.mtx.size();
+  auto next = [n](size_t i) { return (i + 1) % n; };
+
+  s.add("Mtx_Multiply",
+    [&](size_t i) { Mtx_Multiply(&in.outMtx[i], &in.mtx[i], &in.mtx[next(i)]); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(in.gmtx[i] * in.gmtx[next(i)]); });
+  s.add("Mtx_MultiplyAffine",
+    [&](size_t i) { Mtx_MultiplyAffine(&in.outMtx[i], &in.mtx[i], &in.mtx[next(i)]); consume(in.outMtx[i]); });
+  s.add("Mtx_Inverse",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; consume(Mtx_Inverse(&in.outMtx[i])); },
+    [&](size_t i) { consume(glm::inverse(in.gmtx[i])); });
+  s.add("Mtx_InverseAffine",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; consume(Mtx_InverseAffine(&in.outMtx[i])); });
+  s.add("Mtx_InverseOrthonormal",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_InverseOrthonormal(&in.outMtx[i]); consume(in.outMtx[i]); });
+  s.add("Mtx_Transpose",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_Transpose(&in.outMtx[i]); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::transpose(in.gmtx[i])); });
+  s.add("Mtx_MultiplyFVec4",
+    [&](size_t i) { consume(Mtx_MultiplyFVec4(&in.mtx[i], in.vec[i])); },
+    [&](size_t i) { consume(in.gmtx[i] * in.gvec[i]); });
+  s.add("Mtx_MultiplyFVec3",
+    [&](size_t i) { consume(Mtx_MultiplyFVec3(&in.mtx[i], in.vec[i])); },
+    [&](size_t i) { consume(glm::mat3(in.gmtx[i]) * glm::vec3(in.gvec[i])); });
+  s.add("Mtx_MultiplyFVecH",
+    [&](size_t i) { consume(Mtx_MultiplyFVecH(&in.mtx[i], in.vec[i])); },
+    [&](size_t i) { consume(in.gmtx[i] * glm::vec4(glm::vec3(in.gvec[i]), 1.0f)); });
+  s.add("Mtx_FromQuat",
+    [&](size_t i) { Mtx_FromQuat(&in.outMtx[i], in.quat[i]); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::mat4_cast(in.gquat[i])); });
+
+  s.add("Mtx_Translate",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_Translate(&in.outMtx[i], in.vec[i].x, in.vec[i].y, in.vec[i].z, true); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::translate(in.gmtx[i], glm::vec3(in.gvec[i]))); });
+  s.add("Mtx_Scale",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_Scale(&in.outMtx[i], in.vec[i].x, in.vec[i].y, in.vec[i].z); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::scale(in.gmtx[i], glm::vec3(in.gvec[i]))); });
+  s.add("Mtx_Rotate",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_Rotate(&in.outMtx[i], in.vec[i], in.scalar[i], true); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::rotate(in.gmtx[i], in.scalar[i], glm::vec3(in.gvec[i]))); });
+  s.add("Mtx_RotateX",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_RotateX(&in.outMtx[i], in.scalar[i], true); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::rotate(in.gmtx[i], in.scalar[i], glm::vec3(1.0f, 0.0f, 0.0f))); });
+  s.add("Mtx_RotateY",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_RotateY(&in.outMtx[i], in.scalar[i], true); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::rotate(in.gmtx[i], in.scalar[i], glm::vec3(0.0f, 1.0f, 0.0f))); });
+  s.add("Mtx_RotateZ",
+    [&](size_t i) { in.outMtx[i] = in.mtx[i]; Mtx_RotateZ(&in.outMtx[i], in.scalar[i], true); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::rotate(in.gmtx[i], in.scalar[i], glm::vec3(0.0f, 0.0f, 1.0f))); });
+
+  s.add("Mtx_Ortho",
+    [&](size_t i) { Mtx_Ortho(&in.outMtx[i], -1.0f, 1.0f, -1.0f, 1.0f, 0.1f, in.scalar[i] + 20.0f, false); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, 0.1f, in.scalar[i] + 20.0f)); });
+  s.add("Mtx_OrthoTilt",
+    [&](size_t i) { Mtx_OrthoTilt(&in.outMtx[i], -1.0f, 1.0f, -1.0f, 1.0f, 0.1f, in.scalar[i] + 20.0f, false); consume(in.outMtx[i]); });
+  s.add("Mtx_Persp",
+    [&](size_t i) { Mtx_Persp(&in.outMtx[i], std::abs(in.scalar[i]) * 0.1f + 0.1f, C3D_AspectRatioTop, 0.1f, 100.0f, false); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::perspective(std::abs(in.scalar[i]) * 0.1f + 0.1f, C3D_AspectRatioTop, 0.1f, 100.0f)); });
+  s.add("Mtx_PerspTilt",
+    [&](size_t i) { Mtx_PerspTilt(&in.outMtx[i], std::abs(in.scalar[i]) * 0.1f + 0.1f, C3D_AspectRatioTop, 0.1f, 100.0f, false); consume(in.outMtx[i]); });
+  s.add("Mtx_PerspStereo",
+    [&](size_t i) { Mtx_PerspStereo(&in.outMtx[i], std::abs(in.scalar[i]) * 0.1f + 0.1f, C3D_AspectRatioTop, 0.1f, 100.0f, 0.5f, 2.0f, false); consume(in.outMtx[i]); });
+  s.add("Mtx_PerspStereoTilt",
+    [&](size_t i) { Mtx_PerspStereoTilt(&in.outMtx[i], std::abs(in.scalar[i]) * 0.1f + 0.1f, C3D_AspectRatioTop, 0.1f, 100.0f, 0.5f, 2.0f, false); consume(in.outMtx[i]); });
+  s.add("Mtx_LookAt",
+    [&](size_t i) { Mtx_LookAt(&in.outMtx[i], in.vec[i], in.vec[next(i)], FVec3_New(0.0f, 1.0f, 0.0f), false); consume(in.outMtx[i]); },
+    [&](size_t i) { consume(glm::lookAt(glm::vec3(in.gvec[i]), glm::vec3(in.gvec[next(i)]), glm::vec3(0.0f, 1.0f, 0.0f))); });
+
+  s.addBatch("Mtx_MultiplyArray",
+    [&](size_t) { Mtx_MultiplyArray(in.outMtx.data(), &in.mtx[0], in.mtx.data(), n); consume(in.outMtx[0]); });
+  s.addBatch("Mtx_MultiplyFVec4Array",
+    [&](size_t) { Mtx_MultiplyFVec4Array(&in.mtx[0], in.outVec.data(), in.vec.data(), n, false); consume(in.outVec[0]); });
+  s.addBatch("Mtx_FromQuatArray",
+    [&](size_t) { Mtx_FromQuatArray(in.outMtx.data(), in.quat.data(), n); consume(in.outMtx[0]); });
+}
+
+void
+benchQuaternion(Suite &s, Inputs &in)
+{
+  const size_t n = in.quat.size();
+  auto next = [n](size_t i) { return (i + 1) % n; };
+
+  s.add("Quat_Multiply",
+    [&](size_t i) { consume(Quat_Multiply(in.quat[i], in.quat[next(i)])); },
+    [&](size_t i) { consume(in.gquat[i] * in.gquat[next(i)]); });
+  s.add("Quat_Pow",
+    [&](size_t i) { consume(Quat_Pow(in.quat[i], in.scalar[i])); });
+  s.add("Quat_CrossFVec3",
+    [&](size_t i) { consume(Quat_CrossFVec3(in.quat[i], in.vec[i])); },
+    [&](size_t i) { consume(in.gquat[i] * glm::vec3(in.gvec[i])); });
+  s.add("Quat_Rotate",
+    [&](size_t i) { consume(Quat_Rotate(in.quat[i], in.vec[i], in.scalar[i], false)); },
+    [&](size_t i) { consume(glm::rotate(in.gquat[i], in.scalar[i], glm::vec3(in.gvec[i]))); });
+  s.add("Quat_RotateX",
+    [&](size_t i) { consume(Quat_RotateX(in.quat[i], in.scalar[i], false)); },
+    [&](size_t i) { consume(glm::rotate(in.gquat[i], in.scalar[i], glm::vec3(1.0f, 0.0f, 0.0f))); });
+  s.add("Quat_RotateY",
+    [&](size_t i) { consume(Quat_RotateY(in.quat[i], in.scalar[i], false)); },
+    [&](size_t i) { consume(glm::rotate(in.gquat[i], in.scalar[i], glm::vec3(0.0f, 1.0f, 0.0f))); });
+  s.add("Quat_RotateZ",
+    [&](size_t i) { consume(Quat_RotateZ(in.quat[i], in.scalar[i], false)); },
+    [&](size_t i) { consume(glm::rotate(in.gquat[i], in.scalar[i], glm::vec3(0.0f, 0.0f, 1.0f))); });
+  s.add("Quat_FromMtx",
+    [&](size_t i) { consume(Quat_FromMtx(&in.mtx[i])); },
+    [&](size_t i) { consume(glm::quat_cast(in.gmtx[i])); });
+  s.add("Quat_FromPitchYawRoll",
+    [&](size_t i) { consume(Quat_FromPitchYawRoll(in.vec[i].x, in.vec[i].y, in.vec[i].z, false)); },
+    [&](size_t i) { consume(glm::quat(glm::vec3(in.gvec[i]))); });
+  s.add("Quat_LookAt",
+    [&](size_t i) { consume(Quat_LookAt(in.vec[i], in.vec[next(i)], FVec3_New(0.0f, 0.0f, -1.0f), FVec3_New(0.0f, 1.0f, 0.0f))); });
+  s.add("Quat_FromAxisAngle",
+    [&](size_t i) { consume(Quat_FromAxisAngle(in.vec[i], in.scalar[i])); },
+    [&](size_t i) { consume(glm::angleAxis(in.scalar[i], glm::normalize(glm::vec3(in.gvec[i])))); });
+  s.add("Quat_Inverse",
+    [&](size_t i) { consume(Quat_Inverse(in.quat[i])); },
+    [&](size_t i) { consume(glm::inverse(in.gquat[i])); });
+  s.add("Quat_Nlerp",
+    [&](size_t i) { consume(Quat_Nlerp(in.quat[i], in.quat[next(i)], in.scalar[i] * 0.05f + 0.5f)); },
+    [&](size_t i) { consume(glm::normalize(glm::lerp(in.gquat[i], in.gquat[next(i)], in.scalar[i] * 0.05f + 0.5f))); });
+  s.add("Quat_Slerp",
+    [&](size_t i) { consume(Quat_Slerp(in.quat[i], in.quat[next(i)], in.scalar[i] * 0.05f + 0.5f)); },
+    [&](size_t i) { consume(glm::slerp(in.gquat[i], in.gquat[next(i)], in.scalar[i] * 0.05f + 0.5f)); });
+}
+
+void
+benchFrustum(Suite &s, Inputs &in)
+{
+  const size_t n = in.vec.size();
+  std::vector<u32> visible((n + 31) / 32);
+
+  C3D_Mtx proj;
+  Mtx_PerspTilt(&proj, C3D_AngleFromDegrees(60.0f), C3D_AspectRatioTop, 0.1f, 10.0f, false);
+
+  C3D_Frustum f;
+  Frustum_FromMtx(&f, &proj);
+
+  s.add("Frustum_FromMtx",
+    [&](size_t i) { C3D_Frustum t; Frustum_FromMtx(&t, &in.mtx[i]); consume(t); });
+  s.addBatch("Frustum_CullSpheres",
+    [&](size_t) { Frustum_CullSpheres(&f, 1, in.vec.data(), n, visible.data()); consume(visible[0]); });
+  s.addBatch("Frustum_CullAABBs",
+    [&](size_t) { Frustum_CullAABBs(&f, 1, in.vec.data(), in.vec.data(), n, visible.data()); consume(visible[0]); });
+}
+
+// Command generation against the host GPUCMD backend, which drops the buffer whenever it fills up
+void
+benchCmdGen(Suite &s, Inputs &in)
+{
+  if(!C3D_Init(C3D_DEFAULT_CMDBUF_SIZE))
+    return;
+
+  DVLP_s           dvlp = {};
+  DVLE_s           dvle = {};
+  shaderInstance_s vsh  = {};
+  shaderProgram_s  prog = {};
+  dvle.dvlp = &dvlp;
+  vsh.dvle  = &dvle;
+  prog.vertexShader = &vsh;
+  C3D_BindProgram(&prog);
+
+  C3D_AttrInfo *attrInfo = C3D_GetAttrInfo();
+  AttrInfo_Init(attrInfo);
+  AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3);
+
+  C3D_BufInfo *bufInfo = C3D_GetBufInfo();
+  BufInfo_Init(bufInfo);
+  BufInfo_Add(bufInfo, linearAlloc(3*3*sizeof(float)), 3*sizeof(float), 1, 0x0);
+
+  s.add("C3D_DrawArrays",
+    [&](size_t) { C3D_DrawArrays(GPU_TRIANGLES, 0, 3); });
+  s.add("C3D_DrawArrays+DepthTest",
+    [&](size_t i) { C3D_DepthTest(true, (i & 1) ? GPU_GEQUAL : GPU_GREATER, GPU_WRITE_ALL); C3D_DrawArrays(GPU_TRIANGLES, 0, 3); });
+  s.add("C3D_DrawArrays+FVUnifMtx4x4",
+    [&](size_t i) { C3D_FVUnifMtx4x4(GPU_VERTEX_SHADER, 0, &in.mtx[i]); C3D_DrawArrays(GPU_TRIANGLES, 0, 3); });
+
+  C3D_Fini();
+}
+
+void
+usage(const char *argv0)
+{
+  std::fprintf(stderr,
+    "usage: %s [--csv|--json] [--count N] [--reps N] [--filter NAME]\n"
+    "  --csv        print results as CSV\n"
+    "  --json       print results as JSON\n"
+    "  --count N    number of random inputs per routine (default 4096)\n"
+    "  --reps N     repetitions, the best one is reported (default 20)\n"
+    "  --filter S   only run routines whose name contains S\n",
+    argv0);
+}
+}
+
+int main(int argc, char *argv[])
+{
+  Options opt;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if(arg == "--csv")
+      opt.format = Options::CSV;
+    else if(arg == "--json")
+      opt.format = Options::JSON;
+    else if(arg == "--count" && i + 1 < argc)
+      opt.count = std::max(1l, std::strtol(argv[++i], nullptr, 0));
+    else if(arg == "--reps" && i + 1 < argc)
+      opt.reps = std::max(1l, std::strtol(argv[++i], nullptr, 0));
+    else if(arg == "--filter" && i + 1 < argc)
+      opt.filter = argv[++i];
+    else
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  Inputs in(opt.count, 0x3D5);
+  Suite  s(opt);
+
+  benchVector(s, in);
+  benchMatrix(s, in);
+  benchQuaternion(s, in);
+  benchFrustum(s, in);
+  benchCmdGen(s, in);
+
+  s.print();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,331 @@
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "host/host.h"
+
+extern "C" {
+#include <c3d/attribs.h>
+#include <c3d/buffers.h>
+#include <c3d/base.h>
+#include <c3d/effect.h>
+#include <c3d/texenv.h>
+#include <c3d/stateview.h>
+#include <c3d/uniforms.h>
+#include <c3d/cmddecode.h>
+}
+
+namespace
+{
+struct Write
+{
+  u32 reg, mask, value;
+
+  bool operator==(const Write &o) const
+  {
+    return reg == o.reg && mask == o.mask && value == o.value;
+  }
+};
+
+void
+collectWrite(void *param, u32 reg, u32 mask, u32 value)
+{
+  static_cast<std::vector<Write>*>(param)->push_back(Write{ reg, mask, value });
+}
+
+void
+collectCmds(void *param, const u32 *cmds, u32 words)
+{
+  std::vector<u32> &out = *static_cast<std::vector<u32>*>(param);
+  out.insert(out.end(), cmds, cmds + words);
+}
+
+void
+check_decoder()
+{
+  u32 buf[64];
+  GPUCMD_SetBuffer(buf, 64, 0);
+
+  const u32 vals[3] = { 0x11, 0x22, 0x33 };
+  GPUCMD_AddWrite(GPUREG_DEPTH_COLOR_MASK, 0x1F00);
+  GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG, 0x2, 0x100);
+  GPUCMD_AddIncrementalWrites(GPUREG_VIEWPORT_WIDTH, vals, 3);
+  GPUCMD_AddWrites(GPUREG_LIGHTING_LUT_DATA0, vals, 2);
+
+  u32 words;
+  GPUCMD_GetBuffer(nullptr, nullptr, &words);
+  assert(words == 2 + 2 + 4 + 4);
+
+  std::vector<Write> writes;
+  assert(C3D_CmdDecode(buf, words, collectWrite, &writes) == 7);
+
+  const std::vector<Write> expected =
+  {
+    { GPUREG_DEPTH_COLOR_MASK,     0xF, 0x1F00 },
+    { GPUREG_GEOSTAGE_CONFIG,      0x2, 0x100 },
+    { GPUREG_VIEWPORT_WIDTH,       0xF, 0x11 },
+    { GPUREG_VIEWPORT_WIDTH+1,     0xF, 0x22 },
+    { GPUREG_VIEWPORT_WIDTH+2,     0xF, 0x33 },
+    { GPUREG_LIGHTING_LUT_DATA0,   0xF, 0x11 },
+    { GPUREG_LIGHTING_LUT_DATA0,   0xF, 0x22 },
+  };
+  assert(writes == expected);
+
+  // A command claiming more parameters than there are words
+  assert(C3D_CmdDecode(buf, words - 2, nullptr, nullptr) == -1);
+
+  assert(C3D_RegGroupOf(GPUREG_DEPTH_COLOR_MASK) == C3D_REGGROUP_EFFECT);
+  assert(C3D_RegGroupOf(GPUREG_TEXENV0_SOURCE) == C3D_REGGROUP_TEXENV);
+  assert(C3D_RegGroupOf(GPUREG_FOG_COLOR) == C3D_REGGROUP_FOG);
+  assert(C3D_RegGroupOf(GPUREG_DRAWELEMENTS) == C3D_REGGROUP_DRAW);
+  assert(C3D_RegGroupOf(GPUREG_VSH_FLOATUNIFORM_DATA) == C3D_REGGROUP_UNIFORM);
+  assert(C3D_RegGroupOf(GPUREG_GSH_CODETRANSFER_DATA) == C3D_REGGROUP_SHADER);
+  assert(C3D_RegGroupOf(GPUREG_VSH_ENTRYPOINT) == C3D_REGGROUP_PROGRAM);
+
+  // Same value twice is redundant, LUT data never is
+  C3D_CmdStats stats;
+  C3D_CmdStatsInit(&stats);
+  assert(C3D_CmdStatsAdd(&stats, buf, words) == 7);
+  assert(C3D_CmdStatsAdd(&stats, buf, words) == 7);
+  assert(stats.redundant[C3D_REGGROUP_EFFECT] == 1);
+  assert(stats.redundant[C3D_REGGROUP_VIEWPORT] == 3);
+  assert(stats.redundant[C3D_REGGROUP_LIGHT] == 0);
+  // The masked write only ever set part of the register
+  assert(stats.redundant[C3D_REGGROUP_PROGRAM] == 0);
+  assert(stats.words[C3D_REGGROUP_VIEWPORT] == 2*4);
+}
+
+struct Scene
+{
+  DVLP_s           dvlp;
+  DVLE_s           dvle;
+  shaderInstance_s vsh;
+  shaderProgram_s  prog;
+  float           *vertices;
+};
+
+void
+setupScene(Scene &s)
+{
+  std::memset(&s, 0, sizeof(s));
+  s.dvle.type = GPU_VERTEX_SHADER;
+  s.dvle.dvlp = &s.dvlp;
+  s.vsh.dvle  = &s.dvle;
+  s.prog.vertexShader = &s.vsh;
+  C3D_BindProgram(&s.prog);
+
+  C3D_AttrInfo *attrInfo = C3D_GetAttrInfo();
+  AttrInfo_Init(attrInfo);
+  AttrInfo_AddLoader(attrInfo, 0, GPU_FLOAT, 3);
+
+  s.vertices = static_cast<float*>(linearAlloc(3*3*sizeof(float)));
+  C3D_BufInfo *bufInfo = C3D_GetBufInfo();
+  BufInfo_Init(bufInfo);
+  BufInfo_Add(bufInfo, s.vertices, 3*sizeof(float), 1, 0x0);
+
+  C3D_TexEnv *env = C3D_GetTexEnv(0);
+  C3D_TexEnvInit(env);
+  C3D_TexEnvSrc(env, C3D_Both, GPU_PRIMARY_COLOR);
+  C3D_TexEnvFunc(env, C3D_Both, GPU_REPLACE);
+}
+
+u32
+stateWrites(const C3D_CmdStats &stats)
+{
+  u32 n = 0;
+  for(int i = 0; i < C3D_REGGROUP_COUNT; ++i)
+    if(i != C3D_REGGROUP_DRAW && i != C3D_REGGROUP_MISC && i != C3D_REGGROUP_UNIFORM)
+      n += stats.writes[i];
+  return n;
+}
+
+void
+check_statelayer(bool bench)
+{
+  std::vector<u32> cmds;
+  host_SetCmdSink(collectCmds, &cmds);
+  assert(C3D_Init(C3D_DEFAULT_CMDBUF_SIZE));
+
+  Scene scene;
+  setupScene(scene);
+
+  C3D_CmdStats stats;
+  C3D_CmdStatsInit(&stats);
+
+  // The first draw sends everything
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  assert(C3D_CmdStatsAdd(&stats, cmds.data(), cmds.size()) > 0);
+  const size_t firstWords = cmds.size();
+  assert(stats.draws == 1);
+  assert(stats.writes[C3D_REGGROUP_EFFECT] > 0);
+  assert(stats.writes[C3D_REGGROUP_TEXENV] > 0);
+  assert(stats.writes[C3D_REGGROUP_ATTRIB] > 0);
+  assert(stats.writes[C3D_REGGROUP_PROGRAM] > 0);
+
+  // Nothing changed, only the draw itself goes out
+  C3D_CmdStats second;
+  C3D_CmdStatsInit(&second);
+  std::memcpy(second.regs, stats.regs, sizeof(stats.regs));
+  std::memcpy(second.known, stats.known, sizeof(stats.known));
+  cmds.clear();
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  C3D_CmdStatsAdd(&second, cmds.data(), cmds.size());
+  assert(second.draws == 1);
+  assert(stateWrites(second) == 0);
+
+  // Changing the depth test only sends the two registers holding it
+  cmds.clear();
+  C3D_DepthTest(true, GPU_GEQUAL, GPU_WRITE_ALL);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  std::vector<Write> writes;
+  C3D_CmdDecode(cmds.data(), cmds.size(), collectWrite, &writes);
+  u32 effect = 0;
+  for(const Write &w : writes)
+  {
+    C3D_RegGroup group = C3D_RegGroupOf(w.reg);
+    assert(group == C3D_REGGROUP_EFFECT || group == C3D_REGGROUP_DRAW || group == C3D_REGGROUP_MISC);
+    if(group == C3D_REGGROUP_EFFECT)
+    {
+      assert(w.reg == GPUREG_DEPTH_COLOR_MASK || w.reg == GPUREG_GAS_DELTAZ_DEPTH);
+      ++effect;
+    }
+  }
+  assert(effect == 2);
+
+  // Popping a view only sends back what the block in between changed
+  assert(C3D_StatePush(C3D_STATE_ALL));
+  C3D_CullFace(GPU_CULL_FRONT_CCW);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  C3D_StatePop();
+  host_CmdFlush();
+  cmds.clear();
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  writes.clear();
+  C3D_CmdDecode(cmds.data(), cmds.size(), collectWrite, &writes);
+  u32 restored = 0;
+  for(const Write &w : writes)
+  {
+    C3D_RegGroup group = C3D_RegGroupOf(w.reg);
+    if(group != C3D_REGGROUP_DRAW && group != C3D_REGGROUP_MISC)
+    {
+      assert(w.reg == GPUREG_FACECULLING_CONFIG && w.value == GPU_CULL_BACK_CCW);
+      ++restored;
+    }
+  }
+  assert(restored == 1);
+
+  if(bench)
+    std::printf("cmdgen: %u words for the first draw, redundancy %.3f\n",
+                static_cast<unsigned>(firstWords), C3D_CmdStatsRedundancy(&stats));
+
+  C3D_Fini();
+  host_SetCmdSink(nullptr, nullptr);
+}
+
+const Write *
+findWrite(const std::vector<Write> &writes, u32 reg)
+{
+  for(const Write &w : writes)
+    if(w.reg == reg)
+      return &w;
+  return nullptr;
+}
+
+void
+check_earlydepth()
+{
+  std::vector<u32> cmds;
+  host_SetCmdSink(collectCmds, &cmds);
+  assert(C3D_Init(C3D_DEFAULT_CMDBUF_SIZE));
+
+  Scene scene;
+  setupScene(scene);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+
+  // Follows the default GPU_GREATER depth test, the clear comes after the reference
+  cmds.clear();
+  C3D_EarlyDepthAuto(true);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  std::vector<Write> writes;
+  C3D_CmdDecode(cmds.data(), cmds.size(), collectWrite, &writes);
+  assert(findWrite(writes, GPUREG_EARLYDEPTH_TEST1)->value == 1);
+  assert(findWrite(writes, GPUREG_EARLYDEPTH_FUNC)->value == GPU_EARLYDEPTH_GREATER);
+  assert(findWrite(writes, GPUREG_EARLYDEPTH_DATA) < findWrite(writes, GPUREG_EARLYDEPTH_CLEAR));
+
+  // Alpha tested draws may discard fragments after the early test
+  cmds.clear();
+  C3D_AlphaTest(true, GPU_GREATER, 0x80);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  writes.clear();
+  C3D_CmdDecode(cmds.data(), cmds.size(), collectWrite, &writes);
+  assert(findWrite(writes, GPUREG_EARLYDEPTH_TEST1)->value == 0);
+  assert(!findWrite(writes, GPUREG_EARLYDEPTH_CLEAR));
+
+  C3D_Fini();
+  host_SetCmdSink(nullptr, nullptr);
+}
+
+void
+check_uniformswitch()
+{
+  std::vector<u32> cmds;
+  host_SetCmdSink(collectCmds, &cmds);
+  assert(C3D_Init(C3D_DEFAULT_CMDBUF_SIZE));
+
+  Scene scene;
+  setupScene(scene);
+
+  C3D_Mtx mtx;
+  std::memset(&mtx, 0, sizeof(mtx));
+  for(int i = 0; i < 4; ++i)
+    mtx.r[i].c[i] = 1.0f;
+  assert(C3D_FVUnifMtxNx4Update(GPU_VERTEX_SHADER, 0, &mtx, 4) == 4);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+
+  // Resident rows that did not change are dropped
+  assert(C3D_FVUnifMtxNx4Update(GPU_VERTEX_SHADER, 0, &mtx, 4) == 0);
+
+  // A second program keeps a DEF constant in the first row of the matrix
+  float24Uniform_s constant = { 0, { 1, 2, 3 } };
+  shaderInstance_s vshB = scene.vsh;
+  vshB.float24Uniforms    = &constant;
+  vshB.numFloat24Uniforms = 1;
+  shaderProgram_s progB = scene.prog;
+  progB.vertexShader = &vshB;
+  C3D_BindProgram(&progB);
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+
+  // Back on the first program only the overwritten row goes out again
+  C3D_BindProgram(&scene.prog);
+  assert(C3D_FVUnifMtxNx4Update(GPU_VERTEX_SHADER, 0, &mtx, 4) == 1);
+  cmds.clear();
+  C3D_DrawArrays(GPU_TRIANGLES, 0, 3);
+  host_CmdFlush();
+  std::vector<Write> writes;
+  C3D_CmdDecode(cmds.data(), cmds.size(), collectWrite, &writes);
+  const Write *config = findWrite(writes, GPUREG_VSH_FLOATUNIFORM_CONFIG);
+  assert(config && config->value == 0x80000000);
+
+  C3D_Fini();
+  host_SetCmdSink(nullptr, nullptr);
+}
+}
+
+void
+check_cmdgen(bool bench)
+{
+  check_decoder();
+  check_statelayer(bench);
+  check_earlydepth();
+  check_uniformswitch();
+}
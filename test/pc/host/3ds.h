@@ -0,0 +1,215 @@
+// Host stand-in for the parts of libctru the citro3d state layer uses. Only the declarations
+// are here, host/ctru.c implements what the host build links: a GPUCMD buffer that is never
+// submitted, linear memory from the heap and no-op services.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint8_t u8; typedef uint16_t u16; typedef uint32_t u32; typedef uint64_t u64;
+typedef int8_t s8; typedef int16_t s16; typedef int32_t s32; typedef int64_t s64;
+typedef volatile u32 vu32; typedef s32 Result; typedef u32 Handle;
+typedef volatile s32 vs32;
+#define BIT(n) (1U<<(n))
+#define ALIGN(m) __attribute__((aligned(m)))
+#define R_SUCCEEDED(r) ((r)>=0)
+#define R_FAILED(r) ((r)<0)
+#define OS_VRAM_VADDR 0x1F000000
+#define OS_VRAM_PADDR 0x18000000
+#define OS_VRAM_SIZE  0x600000
+#define OS_FCRAM_PADDR 0x20000000
+#define USERBREAK_PANIC 0
+#define SYSCLOCK_ARM11 268111856
+#define CPU_TICKS_PER_MSEC (SYSCLOCK_ARM11/1000.0)
+void svcBreak(int);
+u64 svcGetSystemTick(void);
+Result svcSleepThread(s64 ns);
+Result svcCreateEvent(Handle* e, int type);
+Result svcSignalEvent(Handle e);
+Result svcClearEvent(Handle e);
+Result svcWaitSynchronization(Handle h, s64 ns);
+Result svcCloseHandle(Handle h);
+Result svcGetThreadPriority(s32* prio, Handle h);
+#define CUR_THREAD_HANDLE 0xFFFF8000
+typedef enum { RESET_ONESHOT=0, RESET_STICKY=1, RESET_PULSE=2 } ResetType;
+typedef struct Thread_tag* Thread;
+typedef void (*ThreadFunc)(void*);
+Thread threadCreate(ThreadFunc f, void* arg, size_t stack, int prio, int core, bool detached);
+Result threadJoin(Thread t, u64 timeout);
+void threadFree(Thread t);
+void threadExit(int rc);
+typedef s32 LightLock; void LightLock_Init(LightLock*); void LightLock_Lock(LightLock*); void LightLock_Unlock(LightLock*); int LightLock_TryLock(LightLock*);
+typedef struct { LightLock lock; u16 thread_tag; u32 counter; } RecursiveLock;
+typedef s32 CondVar; void CondVar_Init(CondVar*); void CondVar_Wait(CondVar*, LightLock*); int CondVar_WaitTimeout(CondVar*, LightLock*, s64); void CondVar_Signal(CondVar*); void CondVar_Broadcast(CondVar*);
+typedef struct { s32 s; } LightEvent; void LightEvent_Init(LightEvent*, ResetType); void LightEvent_Signal(LightEvent*); void LightEvent_Clear(LightEvent*); void LightEvent_Wait(LightEvent*); int LightEvent_TryWait(LightEvent*);
+typedef struct { s32 current_count; s16 num_threads_acq; s16 max_count; } LightSemaphore;
+void LightSemaphore_Init(LightSemaphore*, s16, s16); void LightSemaphore_Acquire(LightSemaphore*, s32); void LightSemaphore_Release(LightSemaphore*, s32);
+bool APT_CheckNew3DS(void); Result APT_SetAppCpuTimeLimit(u32 percent);
+u32 osConvertVirtToPhys(const void* addr);
+void* osConvertPhysToVirt(u32 paddr);
+void* linearAlloc(size_t size); void* linearMemAlign(size_t size, size_t align); void linearFree(void* mem); u32 linearSpaceFree(void);
+typedef enum { VRAM_ALLOC_A = BIT(0), VRAM_ALLOC_B = BIT(1), VRAM_ALLOC_ANY = VRAM_ALLOC_A|VRAM_ALLOC_B } vramAllocPos;
+void* vramAlloc(size_t size); void* vramAllocAt(size_t size, vramAllocPos pos); void* vramMemAlign(size_t size, size_t align); void* vramMemAlignAt(size_t size, size_t align, vramAllocPos pos); void vramFree(void* mem); u32 vramSpaceFree(void);
+typedef struct { u64 elapsed; u64 reference; } TickCounter;
+static inline void osTickCounterStart(TickCounter* c) { (void)c; }
+void osTickCounterUpdate(TickCounter* c); double osTickCounterRead(const TickCounter* c);
+static inline u32 f32tof24(float vf)
+{
+	if (!vf) return 0;
+	union { float f; u32 v; } q;
+	q.f = vf;
+	u8 s = q.v >> 31;
+	s32 exp = ((q.v >> 23) & 0xFF) - 0x40;
+	u32 man = (q.v >> 7) & 0xFFFF;
+	if (exp >= 0)
+		return man | (exp << 16) | (s << 23);
+	return s << 23;
+}
+static inline u32 f32tof31(float vf)
+{
+	if (!vf) return 0;
+	union { float f; u32 v; } q;
+	q.f = vf;
+	u8 s = q.v >> 31;
+	s32 exp = ((q.v >> 23) & 0xFF) - 0x40;
+	u32 man = q.v & 0x7FFFFF;
+	if (exp >= 0)
+		return man | (exp << 23) | (s << 30);
+	return s << 30;
+}
+static inline u32 f32tof20(float vf)
+{
+	if (!vf) return 0;
+	union { float f; u32 v; } q;
+	q.f = vf;
+	u8 s = q.v >> 31;
+	s32 exp = ((q.v >> 23) & 0xFF) - 0x40;
+	u32 man = (q.v >> 11) & 0xFFF;
+	if (exp >= 0)
+		return man | (exp << 12) | (s << 19);
+	return s << 19;
+}
+static inline u16 f32tof16(float vf)
+{
+	union { float f; u32 v; } q;
+	q.f = vf;
+	u16 s = (q.v >> 31) << 15;
+	s32 exp = ((q.v >> 23) & 0xFF) - 127 + 15;
+	if (exp <= 0) return s;
+	if (exp >= 0x1F) return s | 0x7C00;
+	return s | (exp << 10) | ((q.v >> 13) & 0x3FF);
+}
+// APT
+typedef enum { APTHOOK_ONSUSPEND=0, APTHOOK_ONRESTORE, APTHOOK_ONSLEEP, APTHOOK_ONWAKEUP, APTHOOK_ONEXIT, APTHOOK_COUNT } APT_HookType;
+typedef void (*aptHookFn)(APT_HookType hook, void* param);
+typedef struct tag_aptHookCookie { struct tag_aptHookCookie* next; aptHookFn callback; void* param; } aptHookCookie;
+void aptHook(aptHookCookie* cookie, aptHookFn callback, void* param); void aptUnhook(aptHookCookie* cookie);
+// GSP
+typedef enum { GSPGPU_EVENT_PSC0=0, GSPGPU_EVENT_PSC1, GSPGPU_EVENT_VBlank0, GSPGPU_EVENT_VBlank1, GSPGPU_EVENT_PPF, GSPGPU_EVENT_P3D, GSPGPU_EVENT_DMA, GSPGPU_EVENT_MAX } GSPGPU_Event;
+typedef void (*ThreadFuncEv)(void*);
+void gspSetEventCallback(GSPGPU_Event id, ThreadFuncEv cb, void* data, bool oneShot);
+void gspWaitForEvent(GSPGPU_Event id, bool nextEvent);
+GSPGPU_Event gspWaitForAnyEvent(void);
+#define gspWaitForPSC0() gspWaitForEvent(GSPGPU_EVENT_PSC0, false)
+#define gspWaitForPSC1() gspWaitForEvent(GSPGPU_EVENT_PSC1, false)
+#define gspWaitForVBlank() gspWaitForEvent(GSPGPU_EVENT_VBlank0, true)
+#define gspWaitForPPF() gspWaitForEvent(GSPGPU_EVENT_PPF, false)
+#define gspWaitForP3D() gspWaitForEvent(GSPGPU_EVENT_P3D, false)
+Result GSPGPU_FlushDataCache(const void* adr, u32 size);
+Result GSPGPU_InvalidateDataCache(const void* adr, u32 size);
+// GFX
+typedef enum { GFX_TOP = 0, GFX_BOTTOM = 1 } gfxScreen_t;
+typedef enum { GFX_LEFT = 0, GFX_RIGHT = 1 } gfx3dSide_t;
+u8* gfxGetFramebuffer(gfxScreen_t screen, gfx3dSide_t side, u16* width, u16* height);
+void gfxScreenSwapBuffers(gfxScreen_t scr, bool hasStereo);
+bool gfxIs3D(void);
+// GX
+typedef struct { u32 d[8]; } gxCmdEntry_s;
+typedef struct tag_gxCmdQueue_s { gxCmdEntry_s* entries; u16 maxEntries; u16 numEntries; u16 curEntry; u16 lastEntry; void (*callback)(struct tag_gxCmdQueue_s*); void* user; } gxCmdQueue_s;
+void gxCmdQueueAdd(gxCmdQueue_s* queue, const gxCmdEntry_s* entry);
+void gxCmdQueueRun(gxCmdQueue_s* queue); void gxCmdQueueStop(gxCmdQueue_s* queue);
+bool gxCmdQueueWait(gxCmdQueue_s* queue, s64 timeout);
+static inline void gxCmdQueueClear(gxCmdQueue_s* q) { q->numEntries = 0; q->curEntry = 0; q->lastEntry = 0; }
+static inline void gxCmdQueueSetCallback(gxCmdQueue_s* q, void (*cb)(gxCmdQueue_s*), void* user) { q->callback = cb; q->user = user; }
+void GX_BindQueue(gxCmdQueue_s* queue);
+Result GX_RequestDma(u32* src, u32* dst, u32 length);
+Result GX_ProcessCommandList(u32* buf0a, u32 buf0s, u8 flags);
+Result GX_MemoryFill(u32* buf0a, u32 buf0v, u32* buf0e, u16 control0, u32* buf1a, u32 buf1v, u32* buf1e, u16 control1);
+Result GX_DisplayTransfer(u32* inadr, u32 indim, u32* outadr, u32 outdim, u32 flags);
+Result GX_TextureCopy(u32* inadr, u32 indim, u32* outadr, u32 outdim, u32 size, u32 flags);
+Result GX_FlushCacheRegions(u32* buf0a, u32 buf0s, u32* buf1a, u32 buf1s, u32* buf2a, u32 buf2s);
+#define GX_BUFFER_DIM(w,h) (((h)<<16)|((w)&0xFFFF))
+#define GX_CMDLIST_BIT0 BIT(0)
+#define GX_CMDLIST_FLUSH BIT(1)
+#define GX_TRANSFER_FLIP_VERT(x) ((x)<<0)
+#define GX_TRANSFER_OUT_TILED(x) ((x)<<1)
+#define GX_TRANSFER_RAW_COPY(x) ((x)<<3)
+#define GX_TRANSFER_IN_FORMAT(x) ((x)<<8)
+#define GX_TRANSFER_OUT_FORMAT(x) ((x)<<12)
+#define GX_TRANSFER_SCALING(x) ((x)<<24)
+typedef enum { GX_TRANSFER_FMT_RGBA8=0, GX_TRANSFER_FMT_RGB8=1, GX_TRANSFER_FMT_RGB565=2, GX_TRANSFER_FMT_RGB5A1=3, GX_TRANSFER_FMT_RGBA4=4 } GX_TRANSFER_FORMAT;
+typedef enum { GX_TRANSFER_SCALE_NO=0, GX_TRANSFER_SCALE_X=1, GX_TRANSFER_SCALE_XY=2 } GX_TRANSFER_SCALE;
+typedef enum { GX_FILL_TRIGGER=1, GX_FILL_FINISHED=2, GX_FILL_16BIT_DEPTH=0, GX_FILL_24BIT_DEPTH=0x100, GX_FILL_32BIT_DEPTH=0x200 } GX_FILL_CONTROL;
+// GPU CMD
+extern u32* gpuCmdBuf; extern u32 gpuCmdBufSize; extern u32 gpuCmdBufOffset;
+static inline void GPUCMD_SetBuffer(u32* adr, u32 size, u32 offset) { gpuCmdBuf=adr; gpuCmdBufSize=size; gpuCmdBufOffset=offset; }
+static inline void GPUCMD_SetBufOffset(u32 offset) { gpuCmdBufOffset = offset; }
+static inline void GPUCMD_GetBuffer(u32** adr, u32* size, u32* offset) { if(adr)*adr=gpuCmdBuf; if(size)*size=gpuCmdBufSize; if(offset)*offset=gpuCmdBufOffset; }
+void GPUCMD_AddRawCommands(const u32* cmd, u32 size);
+void GPUCMD_Add(u32 header, const u32* param, u32 paramlength);
+void GPUCMD_Split(u32** addr, u32* size);
+#define GPUCMD_HEADER(incremental, mask, reg) (((incremental)<<31)|(((mask)&0xF)<<16)|((reg)&0x3FF))
+static inline void GPUCMD_AddSingleParam(u32 header, u32 param) { GPUCMD_Add(header, &param, 1); }
+#define GPUCMD_AddMaskedWrite(reg, mask, val) GPUCMD_AddSingleParam(GPUCMD_HEADER(0, (mask), (reg)), (val))
+#define GPUCMD_AddWrite(reg, val) GPUCMD_AddMaskedWrite((reg), 0xF, (val))
+#define GPUCMD_AddMaskedWrites(reg, mask, vals, num) GPUCMD_Add(GPUCMD_HEADER(0, (mask), (reg)), (vals), (num))
+#define GPUCMD_AddWrites(reg, vals, num) GPUCMD_AddMaskedWrites((reg), 0xF, (vals), (num))
+#define GPUCMD_AddMaskedIncrementalWrites(reg, mask, vals, num) GPUCMD_Add(GPUCMD_HEADER(1, (mask), (reg)), (vals), (num))
+#define GPUCMD_AddIncrementalWrites(reg, vals, num) GPUCMD_AddMaskedIncrementalWrites((reg), 0xF, (vals), (num))
+// shaders
+typedef enum { GPU_VERTEX_SHADER=0x0, GPU_GEOMETRY_SHADER=0x1 } GPU_SHADER_TYPE;
+typedef enum { RESULT_POSITION=0, RESULT_NORMALQUAT, RESULT_COLOR, RESULT_TEXCOORD0, RESULT_TEXCOORD0W, RESULT_TEXCOORD1, RESULT_TEXCOORD2, RESULT_VIEW=8, RESULT_DUMMY } DVLE_outputAttribute_t;
+typedef enum { GSH_POINT=0, GSH_VARIABLE_PRIM=1, GSH_FIXED_PRIM=2 } DVLE_geoShaderMode;
+typedef struct { u16 type, id; u8 mask, unk[3]; } DVLE_outEntry_s;
+typedef struct { u32 symbolOffset; u16 startReg, endReg; } DVLE_uniformEntry_s;
+typedef struct { u16 type, id; u32 data[4]; } DVLE_constEntry_s;
+typedef struct { u32 codeSize; u32* codeData; u32 opdescSize; u32* opcdescData; } DVLP_s;
+typedef struct { GPU_SHADER_TYPE type; bool mergeOutmaps; DVLE_geoShaderMode gshMode; u8 gshFixedVtxStart, gshVariableVtxNum, gshFixedVtxNum; DVLP_s* dvlp; u32 mainOffset, endmainOffset; u32 constTableSize; DVLE_constEntry_s* constTableData; u32 outTableSize; DVLE_outEntry_s* outTableData; u32 uniformTableSize; DVLE_uniformEntry_s* uniformTableData; char* symbolTableData; u8 outmapMask; u32 outmapData[8]; u32 outmapMode; u32 outmapClock; } DVLE_s;
+typedef struct { u32 numDVLE; DVLP_s DVLP; DVLE_s* DVLE; } DVLB_s;
+DVLB_s* DVLB_ParseFile(u32* shbinData, u32 shbinSize); void DVLB_Free(DVLB_s* dvlb);
+typedef struct { u32 id; u32 data[3]; } float24Uniform_s;
+typedef struct { DVLE_s* dvle; u16 boolUniforms; u16 boolUniformMask; u32 intUniforms[4]; float24Uniform_s* float24Uniforms; u8 intUniformMask; u8 numFloat24Uniforms; } shaderInstance_s;
+typedef struct { shaderInstance_s* vertexShader; shaderInstance_s* geometryShader; u32 geoShaderInputPermutation[2]; u8 geoShaderInputStride; } shaderProgram_s;
+Result shaderInstanceInit(shaderInstance_s* si, DVLE_s* dvle); Result shaderInstanceFree(shaderInstance_s* si);
+s8 shaderInstanceGetUniformLocation(shaderInstance_s* si, const char* name);
+Result shaderProgramInit(shaderProgram_s* sp); Result shaderProgramFree(shaderProgram_s* sp);
+Result shaderProgramSetVsh(shaderProgram_s* sp, DVLE_s* dvle); Result shaderProgramSetGsh(shaderProgram_s* sp, DVLE_s* dvle, u8 stride);
+Result shaderProgramSetGshInputPermutation(shaderProgram_s* sp, u64 permutation);
+Result shaderProgramConfigure(shaderProgram_s* sp, bool sendVshCode, bool sendGshCode);
+Result shaderProgramUse(shaderProgram_s* sp);
+// decompress
+typedef ssize_t (*decompressCallback)(void* userdata, void* buffer, size_t size);
+ssize_t decompressCallback_FD(void* userdata, void* buffer, size_t size);
+ssize_t decompressCallback_Stdio(void* userdata, void* buffer, size_t size);
+typedef struct { void* data; size_t size; } decompressIOVec;
+bool decompressHeader(int* type, size_t* size, int fd, const void* buffer, size_t insize);
+bool decompressV(const decompressIOVec* iov, size_t iovcnt, decompressCallback callback, void* userdata, size_t insize);
+static inline bool decompress(void* output, size_t size, decompressCallback callback, void* userdata, size_t insize) { decompressIOVec iov; iov.data=output; iov.size=size; return decompressV(&iov,1,callback,userdata,insize); }
+#include "gpuregs.h"
+#include "gpuenums.h"
+#ifndef U64_MAX
+#define U64_MAX UINT64_MAX
+#endif
+static inline void __dmb(void) {}
+
+#ifdef __cplusplus
+}
+#endif
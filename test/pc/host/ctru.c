@@ -0,0 +1,173 @@
+#include <stdlib.h>
+#include <time.h>
+#include "internal.h"
+#include "host.h"
+
+// Linear memory comes from a static arena so that its "physical" addresses are stable
+#define ARENA_SIZE  (16*1024*1024)
+#define ARENA_PADDR OS_FCRAM_PADDR
+
+static u8 arena[ARENA_SIZE] __attribute__((aligned(0x1000)));
+static size_t arenaUsed;
+
+static host_CmdSink cmdSink;
+static void* cmdSinkParam;
+
+u32* gpuCmdBuf;
+u32 gpuCmdBufSize;
+u32 gpuCmdBufOffset;
+
+void* linearMemAlign(size_t size, size_t align)
+{
+	size_t offset = (arenaUsed + align-1) &~ (align-1);
+	if (offset + size > ARENA_SIZE)
+		return NULL;
+	arenaUsed = offset + size;
+	return &arena[offset];
+}
+
+void* linearAlloc(size_t size)
+{
+	return linearMemAlign(size, 0x80);
+}
+
+void linearFree(void* mem)
+{
+	// Tests allocate little, the arena is never reused
+	(void)mem;
+}
+
+u32 linearSpaceFree(void)
+{
+	return ARENA_SIZE - arenaUsed;
+}
+
+u32 osConvertVirtToPhys(const void* addr)
+{
+	const u8* p = (const u8*)addr;
+	if (p < arena || p >= arena + ARENA_SIZE)
+		return 0;
+	return ARENA_PADDR + (u32)(p - arena);
+}
+
+void* osConvertPhysToVirt(u32 paddr)
+{
+	if (paddr < ARENA_PADDR || paddr >= ARENA_PADDR + ARENA_SIZE)
+		return NULL;
+	return &arena[paddr - ARENA_PADDR];
+}
+
+u64 svcGetSystemTick(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec*SYSCLOCK_ARM11 + (u64)ts.tv_nsec*SYSCLOCK_ARM11/1000000000;
+}
+
+Result GSPGPU_FlushDataCache(const void* adr, u32 size) { (void)adr; (void)size; return 0; }
+Result GSPGPU_InvalidateDataCache(const void* adr, u32 size) { (void)adr; (void)size; return 0; }
+void gspSetEventCallback(GSPGPU_Event id, ThreadFuncEv cb, void* data, bool oneShot) { (void)id; (void)cb; (void)data; (void)oneShot; }
+void aptHook(aptHookCookie* cookie, aptHookFn callback, void* param) { (void)cookie; (void)callback; (void)param; }
+void aptUnhook(aptHookCookie* cookie) { (void)cookie; }
+
+void GPUCMD_Add(u32 header, const u32* param, u32 paramlength)
+{
+	u32 zero = 0;
+	if (!paramlength)
+		paramlength = 1;
+	if (!param)
+		param = &zero;
+	if (!gpuCmdBuf || gpuCmdBufOffset + paramlength + 1 > gpuCmdBufSize)
+		return;
+
+	gpuCmdBuf[gpuCmdBufOffset] = param[0];
+	gpuCmdBuf[gpuCmdBufOffset+1] = header | ((paramlength-1) << 20);
+	memcpy(&gpuCmdBuf[gpuCmdBufOffset+2], &param[1], (paramlength-1)*4);
+	gpuCmdBufOffset += paramlength + 1;
+	if (!(paramlength & 1))
+		gpuCmdBuf[gpuCmdBufOffset++] = 0;
+}
+
+void GPUCMD_AddRawCommands(const u32* cmd, u32 size)
+{
+	if (!gpuCmdBuf || gpuCmdBufOffset + size > gpuCmdBufSize)
+		return;
+	memcpy(&gpuCmdBuf[gpuCmdBufOffset], cmd, size*4);
+	gpuCmdBufOffset += size;
+}
+
+void GPUCMD_Split(u32** addr, u32* size)
+{
+	GPUCMD_AddWrite(GPUREG_FINALIZE, 0x12345678);
+	while (gpuCmdBufOffset & 3)
+	{
+		gpuCmdBuf[gpuCmdBufOffset++] = 0;
+		gpuCmdBuf[gpuCmdBufOffset++] = GPUCMD_HEADER(0, 0, GPUREG_FINALIZE);
+	}
+
+	if (addr) *addr = gpuCmdBuf;
+	if (size) *size = gpuCmdBufOffset;
+	gpuCmdBuf += gpuCmdBufOffset;
+	gpuCmdBufSize -= gpuCmdBufOffset;
+	gpuCmdBufOffset = 0;
+}
+
+// Only the shader unit configuration is emitted, the host has no shader code to upload
+Result shaderProgramConfigure(shaderProgram_s* sp, bool sendVshCode, bool sendGshCode)
+{
+	(void)sendVshCode;
+	(void)sendGshCode;
+	GPUCMD_AddWrite(GPUREG_VSH_ENTRYPOINT, 0x7FFF0000 | (sp->vertexShader->dvle->mainOffset & 0xFFFF));
+	GPUCMD_AddMaskedWrite(GPUREG_GEOSTAGE_CONFIG, 0xB, sp->geometryShader ? 2 : 0);
+	return 0;
+}
+
+void host_SetCmdSink(host_CmdSink sink, void* param)
+{
+	cmdSink = sink;
+	cmdSinkParam = param;
+}
+
+void host_CmdFlush(void)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	if (cmdSink && gpuCmdBufOffset)
+		cmdSink(cmdSinkParam, gpuCmdBuf, gpuCmdBufOffset);
+	GPUCMD_SetBuffer(ctx->cmdBuf, ctx->cmdBufSize, 0);
+}
+
+// The render queue, framebuffer and texture modules are not part of the host build
+
+void C3Di_RenderQueueInit(void)
+{
+	C3D_Context* ctx = C3Di_GetContext();
+	GPUCMD_SetBuffer(ctx->cmdBuf, ctx->cmdBufSize, 0);
+}
+
+void C3Di_RenderQueueExit(void)
+{
+	host_CmdFlush();
+	GPUCMD_SetBuffer(NULL, 0, 0);
+}
+
+void C3Di_RenderQueueWaitDone(void) { }
+void C3Di_RenderQueueEnableVBlank(void) { }
+void C3Di_RenderQueueDisableVBlank(void) { }
+
+void C3Di_CmdBufEnsureSpace(u32 words)
+{
+	if (gpuCmdBufOffset + words > gpuCmdBufSize)
+		host_CmdFlush();
+}
+
+void C3D_FrameSplit(u8 flags)
+{
+	(void)flags;
+	host_CmdFlush();
+}
+
+void C3Di_FrameBufBind(C3D_FrameBuf* fb) { (void)fb; }
+void C3Di_SetTex(int unit, C3D_Tex* tex) { (void)unit; (void)tex; }
+void C3Di_TexCacheInvalidate(void) { }
+void C3D_FlushMarkRange(const void* addr, size_t size) { (void)addr; (void)size; }
+void C3D_TexResidencyExit(void) { }
@@ -0,0 +1,63 @@
+#pragma once
+#define GPU_TEXTURE_MAG_FILTER(v) (((v)&0x1)<<1)
+#define GPU_TEXTURE_MIN_FILTER(v) (((v)&0x1)<<2)
+#define GPU_TEXTURE_MIP_FILTER(v) (((v)&0x1)<<24)
+#define GPU_TEXTURE_WRAP_S(v) (((v)&0x3)<<12)
+#define GPU_TEXTURE_WRAP_T(v) (((v)&0x3)<<8)
+#define GPU_TEXTURE_MODE(v) (((v)&0x7)<<28)
+#define GPU_TEXTURE_ETC1_PARAM BIT(5)
+#define GPU_TEXTURE_SHADOW_PARAM BIT(20)
+#define GPU_ATTRIBFMT(i, n, f) (((((n)-1)<<2)|((f)&3))<<((i)*4))
+#define GPU_TEVSOURCES(a,b,c) (((a))|((b)<<4)|((c)<<8))
+#define GPU_TEVOPERANDS(a,b,c) (((a))|((b)<<4)|((c)<<8))
+#define GPU_LIGHTPERM(i,n) ((n) << ((i)*4))
+#define GPU_LIGHTLUTINPUT(i,n) ((n) << ((i)*4))
+#define GPU_LIGHTLUTIDX(c,i,o) ((o) | ((i) << 8) | ((c) << 11))
+#define GPU_LC1_SHADOWBIT(n) BIT(n)
+#define GPU_LC1_SPOTBIT(n) BIT((n)+8)
+#define GPU_LC1_LUTBIT(n) BIT((n)+16)
+#define GPU_LC1_FRESNELBIT BIT(19)
+#define GPU_LC1_ATTNBIT(n) BIT((n)+24)
+#define GPU_LIGHT_ENV_LAYER_CONFIG(n) ((n)+((n)==7))
+#define GPU_MAKEGASDEPTHFUNC(n) (GPU_GASDEPTHFUNC)((0xAF02>>((int)(n)<<1))&3)
+typedef enum { GPU_NEAREST = 0x0, GPU_LINEAR = 0x1 } GPU_TEXTURE_FILTER_PARAM;
+typedef enum { GPU_CLAMP_TO_EDGE = 0x0, GPU_CLAMP_TO_BORDER = 0x1, GPU_REPEAT = 0x2, GPU_MIRRORED_REPEAT = 0x3 } GPU_TEXTURE_WRAP_PARAM;
+typedef enum { GPU_TEX_2D = 0x0, GPU_TEX_CUBE_MAP = 0x1, GPU_TEX_SHADOW_2D = 0x2, GPU_TEX_PROJECTION = 0x3, GPU_TEX_SHADOW_CUBE = 0x4, GPU_TEX_DISABLED = 0x5 } GPU_TEXTURE_MODE_PARAM;
+typedef enum { GPU_TEXUNIT0 = 0x1, GPU_TEXUNIT1 = 0x2, GPU_TEXUNIT2 = 0x4 } GPU_TEXUNIT;
+typedef enum { GPU_RGBA8=0x0, GPU_RGB8=0x1, GPU_RGBA5551=0x2, GPU_RGB565=0x3, GPU_RGBA4=0x4, GPU_LA8=0x5, GPU_HILO8=0x6, GPU_L8=0x7, GPU_A8=0x8, GPU_LA4=0x9, GPU_L4=0xA, GPU_A4=0xB, GPU_ETC1=0xC, GPU_ETC1A4=0xD } GPU_TEXCOLOR;
+typedef enum { GPU_POSITIVE_X = 0, GPU_NEGATIVE_X = 1, GPU_POSITIVE_Y = 2, GPU_NEGATIVE_Y = 3, GPU_POSITIVE_Z = 4, GPU_NEGATIVE_Z = 5 } GPU_TEXFACE;
+#define GPU_TEXFACE_2D GPU_POSITIVE_X
+typedef enum { GPU_PT_CLAMP_TO_ZERO=0, GPU_PT_CLAMP_TO_EDGE=1, GPU_PT_REPEAT=2, GPU_PT_MIRRORED_REPEAT=3, GPU_PT_PULSE=4 } GPU_PROCTEX_CLAMP;
+typedef enum { GPU_PT_U=0, GPU_PT_U2, GPU_PT_V, GPU_PT_V2, GPU_PT_ADD, GPU_PT_ADD2, GPU_PT_SQRT2, GPU_PT_MIN, GPU_PT_MAX, GPU_PT_RMAX } GPU_PROCTEX_MAPFUNC;
+typedef enum { GPU_PT_NONE=0, GPU_PT_ODD, GPU_PT_EVEN } GPU_PROCTEX_SHIFT;
+typedef enum { GPU_PT_NEAREST=0, GPU_PT_LINEAR, GPU_PT_NEAREST_MIP_NEAREST, GPU_PT_LINEAR_MIP_NEAREST, GPU_PT_NEAREST_MIP_LINEAR, GPU_PT_LINEAR_MIP_LINEAR } GPU_PROCTEX_FILTER;
+typedef enum { GPU_LUT_NOISE=0, GPU_LUT_RGBMAP=2, GPU_LUT_ALPHAMAP=3, GPU_LUT_COLOR=4, GPU_LUT_COLORDIF=5 } GPU_PROCTEX_LUTID;
+typedef enum { GPU_RB_RGBA8=0, GPU_RB_RGB8=1, GPU_RB_RGBA5551=2, GPU_RB_RGB565=3, GPU_RB_RGBA4=4 } GPU_COLORBUF;
+typedef enum { GPU_RB_DEPTH16=0, GPU_RB_DEPTH24=2, GPU_RB_DEPTH24_STENCIL8=3 } GPU_DEPTHBUF;
+typedef enum { GPU_BYTE=0, GPU_UNSIGNED_BYTE=1, GPU_SHORT=2, GPU_FLOAT=3 } GPU_FORMATS;
+typedef enum { GPU_CULL_NONE=0, GPU_CULL_FRONT_CCW=1, GPU_CULL_BACK_CCW=2 } GPU_CULLMODE;
+typedef enum { GPU_NEVER=0, GPU_ALWAYS=1, GPU_EQUAL=2, GPU_NOTEQUAL=3, GPU_LESS=4, GPU_LEQUAL=5, GPU_GREATER=6, GPU_GEQUAL=7 } GPU_TESTFUNC;
+typedef enum { GPU_EARLYDEPTH_GEQUAL=0, GPU_EARLYDEPTH_GREATER=1, GPU_EARLYDEPTH_LEQUAL=2, GPU_EARLYDEPTH_LESS=3 } GPU_EARLYDEPTHFUNC;
+typedef enum { GPU_GASDEPTH_NEVER=0, GPU_GASDEPTH_ALWAYS=1, GPU_GASDEPTH_GREATER=2, GPU_GASDEPTH_LESS=3 } GPU_GASDEPTHFUNC;
+typedef enum { GPU_SCISSOR_DISABLE=0, GPU_SCISSOR_INVERT=1, GPU_SCISSOR_NORMAL=3 } GPU_SCISSORMODE;
+typedef enum { GPU_STENCIL_KEEP=0, GPU_STENCIL_ZERO, GPU_STENCIL_REPLACE, GPU_STENCIL_INCR, GPU_STENCIL_DECR, GPU_STENCIL_INVERT, GPU_STENCIL_INCR_WRAP, GPU_STENCIL_DECR_WRAP } GPU_STENCILOP;
+typedef enum { GPU_WRITE_RED=1, GPU_WRITE_GREEN=2, GPU_WRITE_BLUE=4, GPU_WRITE_ALPHA=8, GPU_WRITE_DEPTH=0x10, GPU_WRITE_COLOR=0xF, GPU_WRITE_ALL=0x1F } GPU_WRITEMASK;
+typedef enum { GPU_BLEND_ADD=0, GPU_BLEND_SUBTRACT, GPU_BLEND_REVERSE_SUBTRACT, GPU_BLEND_MIN, GPU_BLEND_MAX } GPU_BLENDEQUATION;
+typedef enum { GPU_ZERO=0, GPU_ONE, GPU_SRC_COLOR, GPU_ONE_MINUS_SRC_COLOR, GPU_DST_COLOR, GPU_ONE_MINUS_DST_COLOR, GPU_SRC_ALPHA, GPU_ONE_MINUS_SRC_ALPHA, GPU_DST_ALPHA, GPU_ONE_MINUS_DST_ALPHA, GPU_CONSTANT_COLOR, GPU_ONE_MINUS_CONSTANT_COLOR, GPU_CONSTANT_ALPHA, GPU_ONE_MINUS_CONSTANT_ALPHA, GPU_SRC_ALPHA_SATURATE } GPU_BLENDFACTOR;
+typedef enum { GPU_LOGICOP_CLEAR=0, GPU_LOGICOP_AND, GPU_LOGICOP_AND_REVERSE, GPU_LOGICOP_COPY, GPU_LOGICOP_SET, GPU_LOGICOP_COPY_INVERTED, GPU_LOGICOP_NOOP, GPU_LOGICOP_INVERT, GPU_LOGICOP_NAND, GPU_LOGICOP_OR, GPU_LOGICOP_NOR, GPU_LOGICOP_XOR, GPU_LOGICOP_EQUIV, GPU_LOGICOP_AND_INVERTED, GPU_LOGICOP_OR_REVERSE, GPU_LOGICOP_OR_INVERTED } GPU_LOGICOP;
+typedef enum { GPU_FRAGOPMODE_GL=0, GPU_FRAGOPMODE_GAS_ACC=1, GPU_FRAGOPMODE_SHADOW=3 } GPU_FRAGOPMODE;
+typedef enum { GPU_PRIMARY_COLOR=0, GPU_FRAGMENT_PRIMARY_COLOR=1, GPU_FRAGMENT_SECONDARY_COLOR=2, GPU_TEXTURE0=3, GPU_TEXTURE1=4, GPU_TEXTURE2=5, GPU_TEXTURE3=6, GPU_PREVIOUS_BUFFER=0xD, GPU_CONSTANT=0xE, GPU_PREVIOUS=0xF } GPU_TEVSRC;
+typedef enum { GPU_TEVOP_RGB_SRC_COLOR=0, GPU_TEVOP_RGB_ONE_MINUS_SRC_COLOR=1, GPU_TEVOP_RGB_SRC_ALPHA=2, GPU_TEVOP_RGB_ONE_MINUS_SRC_ALPHA=3 } GPU_TEVOP_RGB;
+typedef enum { GPU_TEVOP_A_SRC_ALPHA=0, GPU_TEVOP_A_ONE_MINUS_SRC_ALPHA=1 } GPU_TEVOP_A;
+typedef enum { GPU_REPLACE=0, GPU_MODULATE, GPU_ADD, GPU_ADD_SIGNED, GPU_INTERPOLATE, GPU_SUBTRACT, GPU_DOT3_RGB, GPU_DOT3_RGBA, GPU_MULTIPLY_ADD, GPU_ADD_MULTIPLY } GPU_COMBINEFUNC;
+typedef enum { GPU_TEVSCALE_1=0, GPU_TEVSCALE_2=1, GPU_TEVSCALE_4=2 } GPU_TEVSCALE;
+typedef enum { GPU_NO_FOG=0, GPU_FOG=5, GPU_GAS=7 } GPU_FOGMODE;
+typedef enum { GPU_PLAIN_DENSITY=0, GPU_DEPTH_DENSITY=1 } GPU_GASMODE;
+typedef enum { GPU_GAS_DENSITY=0, GPU_GAS_LIGHT_FACTOR=1 } GPU_GASLUTINPUT;
+typedef enum { GPU_LUT_D0=0, GPU_LUT_D1=1, GPU_LUT_SP=2, GPU_LUT_FR=3, GPU_LUT_RB=4, GPU_LUT_RG=5, GPU_LUT_RR=6, GPU_LUT_DA=7 } GPU_LIGHTLUTID;
+typedef enum { GPU_LUTINPUT_NH=0, GPU_LUTINPUT_VH, GPU_LUTINPUT_NV, GPU_LUTINPUT_LN, GPU_LUTINPUT_SP, GPU_LUTINPUT_CP } GPU_LIGHTLUTINPUT;
+typedef enum { GPU_LUTSCALER_1x=0, GPU_LUTSCALER_2x, GPU_LUTSCALER_4x, GPU_LUTSCALER_8x, GPU_LUTSCALER_0_25x=6, GPU_LUTSCALER_0_5x=7 } GPU_LIGHTLUTSCALER;
+typedef enum { GPU_LUTSELECT_COMMON=0, GPU_LUTSELECT_SP=1, GPU_LUTSELECT_DA=2 } GPU_LIGHTLUTSELECT;
+typedef enum { GPU_NO_FRESNEL=0, GPU_PRI_ALPHA_FRESNEL, GPU_SEC_ALPHA_FRESNEL, GPU_PRI_SEC_ALPHA_FRESNEL } GPU_FRESNELSEL;
+typedef enum { GPU_BUMP_NOT_USED=0, GPU_BUMP_AS_BUMP, GPU_BUMP_AS_TANG } GPU_BUMPMODE;
+typedef enum { GPU_TRIANGLES=0x0000, GPU_TRIANGLE_STRIP=0x0100, GPU_TRIANGLE_FAN=0x0200, GPU_GEOMETRY_PRIM=0x0300 } GPU_Primitive_t;
@@ -0,0 +1,176 @@
+#pragma once
+#define GPUREG_FINALIZE 0x0010
+#define GPUREG_FACECULLING_CONFIG 0x0040
+#define GPUREG_VIEWPORT_WIDTH 0x0041
+#define GPUREG_VIEWPORT_INVW 0x0042
+#define GPUREG_VIEWPORT_HEIGHT 0x0043
+#define GPUREG_VIEWPORT_INVH 0x0044
+#define GPUREG_FRAGOP_CLIP 0x0047
+#define GPUREG_FRAGOP_CLIP_DATA0 0x0048
+#define GPUREG_DEPTHMAP_SCALE 0x004D
+#define GPUREG_DEPTHMAP_OFFSET 0x004E
+#define GPUREG_SH_OUTMAP_TOTAL 0x004F
+#define GPUREG_SH_OUTMAP_O0 0x0050
+#define GPUREG_EARLYDEPTH_FUNC 0x0061
+#define GPUREG_EARLYDEPTH_TEST1 0x0062
+#define GPUREG_EARLYDEPTH_CLEAR 0x0063
+#define GPUREG_SH_OUTATTR_MODE 0x0064
+#define GPUREG_SCISSORTEST_MODE 0x0065
+#define GPUREG_SCISSORTEST_POS 0x0066
+#define GPUREG_SCISSORTEST_DIM 0x0067
+#define GPUREG_VIEWPORT_XY 0x0068
+#define GPUREG_EARLYDEPTH_DATA 0x006A
+#define GPUREG_DEPTHMAP_ENABLE 0x006D
+#define GPUREG_RENDERBUF_DIM 0x006E
+#define GPUREG_SH_OUTATTR_CLOCK 0x006F
+#define GPUREG_TEXUNIT_CONFIG 0x0080
+#define GPUREG_TEXUNIT0_BORDER_COLOR 0x0081
+#define GPUREG_TEXUNIT0_DIM 0x0082
+#define GPUREG_TEXUNIT0_PARAM 0x0083
+#define GPUREG_TEXUNIT0_LOD 0x0084
+#define GPUREG_TEXUNIT0_ADDR1 0x0085
+#define GPUREG_TEXUNIT0_SHADOW 0x008B
+#define GPUREG_TEXUNIT0_TYPE 0x008E
+#define GPUREG_LIGHTING_ENABLE0 0x008F
+#define GPUREG_TEXUNIT1_BORDER_COLOR 0x0091
+#define GPUREG_TEXUNIT1_DIM 0x0092
+#define GPUREG_TEXUNIT1_TYPE 0x0096
+#define GPUREG_TEXUNIT2_BORDER_COLOR 0x0099
+#define GPUREG_TEXUNIT2_DIM 0x009A
+#define GPUREG_TEXUNIT2_TYPE 0x009E
+#define GPUREG_TEXUNIT3_PROCTEX0 0x00A8
+#define GPUREG_PROCTEX_LUT 0x00AF
+#define GPUREG_PROCTEX_LUT_DATA0 0x00B0
+#define GPUREG_TEXENV0_SOURCE 0x00C0
+#define GPUREG_TEXENV0_OPERAND 0x00C1
+#define GPUREG_TEXENV0_COMBINER 0x00C2
+#define GPUREG_TEXENV0_COLOR 0x00C3
+#define GPUREG_TEXENV0_SCALE 0x00C4
+#define GPUREG_TEXENV1_SOURCE 0x00C8
+#define GPUREG_TEXENV2_SOURCE 0x00D0
+#define GPUREG_TEXENV3_SOURCE 0x00D8
+#define GPUREG_TEXENV_UPDATE_BUFFER 0x00E0
+#define GPUREG_FOG_COLOR 0x00E1
+#define GPUREG_GAS_ATTENUATION 0x00E4
+#define GPUREG_GAS_ACCMAX 0x00E5
+#define GPUREG_FOG_LUT_INDEX 0x00E6
+#define GPUREG_FOG_LUT_DATA0 0x00E8
+#define GPUREG_TEXENV4_SOURCE 0x00F0
+#define GPUREG_TEXENV5_SOURCE 0x00F8
+#define GPUREG_TEXENV_BUFFER_COLOR 0x00FD
+#define GPUREG_COLOR_OPERATION 0x0100
+#define GPUREG_BLEND_FUNC 0x0101
+#define GPUREG_LOGIC_OP 0x0102
+#define GPUREG_BLEND_COLOR 0x0103
+#define GPUREG_FRAGOP_ALPHA_TEST 0x0104
+#define GPUREG_STENCIL_TEST 0x0105
+#define GPUREG_STENCIL_OP 0x0106
+#define GPUREG_DEPTH_COLOR_MASK 0x0107
+#define GPUREG_FRAMEBUFFER_INVALIDATE 0x0110
+#define GPUREG_FRAMEBUFFER_FLUSH 0x0111
+#define GPUREG_COLORBUFFER_READ 0x0112
+#define GPUREG_COLORBUFFER_WRITE 0x0113
+#define GPUREG_DEPTHBUFFER_READ 0x0114
+#define GPUREG_DEPTHBUFFER_WRITE 0x0115
+#define GPUREG_DEPTHBUFFER_FORMAT 0x0116
+#define GPUREG_COLORBUFFER_FORMAT 0x0117
+#define GPUREG_EARLYDEPTH_TEST2 0x0118
+#define GPUREG_FRAMEBUFFER_BLOCK32 0x011B
+#define GPUREG_DEPTHBUFFER_LOC 0x011C
+#define GPUREG_COLORBUFFER_LOC 0x011D
+#define GPUREG_FRAMEBUFFER_DIM 0x011E
+#define GPUREG_GAS_LIGHT_XY 0x0120
+#define GPUREG_GAS_LIGHT_Z 0x0121
+#define GPUREG_GAS_LIGHT_Z_COLOR 0x0122
+#define GPUREG_GAS_LUT_INDEX 0x0123
+#define GPUREG_GAS_LUT_DATA 0x0124
+#define GPUREG_GAS_ACCMAX_FEEDBACK 0x0125
+#define GPUREG_GAS_DELTAZ_DEPTH 0x0126
+#define GPUREG_FRAGOP_SHADOW 0x0130
+#define GPUREG_LIGHT0_SPECULAR0 0x0140
+#define GPUREG_LIGHT0_SPECULAR1 0x0141
+#define GPUREG_LIGHT0_DIFFUSE 0x0142
+#define GPUREG_LIGHT0_AMBIENT 0x0143
+#define GPUREG_LIGHT0_XY 0x0144
+#define GPUREG_LIGHT0_Z 0x0145
+#define GPUREG_LIGHT0_SPOTDIR_XY 0x0146
+#define GPUREG_LIGHT0_SPOTDIR_Z 0x0147
+#define GPUREG_LIGHT0_CONFIG 0x0149
+#define GPUREG_LIGHT0_ATTENUATION_BIAS 0x014A
+#define GPUREG_LIGHT0_ATTENUATION_SCALE 0x014B
+#define GPUREG_LIGHTING_AMBIENT 0x01C0
+#define GPUREG_LIGHTING_NUM_LIGHTS 0x01C2
+#define GPUREG_LIGHTING_CONFIG0 0x01C3
+#define GPUREG_LIGHTING_CONFIG1 0x01C4
+#define GPUREG_LIGHTING_LUT_INDEX 0x01C5
+#define GPUREG_LIGHTING_ENABLE1 0x01C6
+#define GPUREG_LIGHTING_LUT_DATA0 0x01C8
+#define GPUREG_LIGHTING_LUTINPUT_ABS 0x01D0
+#define GPUREG_LIGHTING_LUTINPUT_SELECT 0x01D1
+#define GPUREG_LIGHTING_LUTINPUT_SCALE 0x01D2
+#define GPUREG_LIGHTING_LIGHT_PERMUTATION 0x01D9
+#define GPUREG_ATTRIBBUFFERS_LOC 0x0200
+#define GPUREG_ATTRIBBUFFERS_FORMAT_LOW 0x0201
+#define GPUREG_ATTRIBBUFFERS_FORMAT_HIGH 0x0202
+#define GPUREG_ATTRIBBUFFER0_OFFSET 0x0203
+#define GPUREG_ATTRIBBUFFER0_CONFIG1 0x0204
+#define GPUREG_ATTRIBBUFFER0_CONFIG2 0x0205
+#define GPUREG_INDEXBUFFER_CONFIG 0x0227
+#define GPUREG_NUMVERTICES 0x0228
+#define GPUREG_GEOSTAGE_CONFIG 0x0229
+#define GPUREG_VERTEX_OFFSET 0x022A
+#define GPUREG_POST_VERTEX_CACHE_NUM 0x022D
+#define GPUREG_DRAWARRAYS 0x022E
+#define GPUREG_DRAWELEMENTS 0x022F
+#define GPUREG_VTX_FUNC 0x0231
+#define GPUREG_FIXEDATTRIB_INDEX 0x0232
+#define GPUREG_FIXEDATTRIB_DATA0 0x0233
+#define GPUREG_FIXEDATTRIB_DATA1 0x0234
+#define GPUREG_FIXEDATTRIB_DATA2 0x0235
+#define GPUREG_CMDBUF_SIZE0 0x0238
+#define GPUREG_CMDBUF_SIZE1 0x0239
+#define GPUREG_CMDBUF_ADDR0 0x023A
+#define GPUREG_CMDBUF_ADDR1 0x023B
+#define GPUREG_CMDBUF_JUMP0 0x023C
+#define GPUREG_CMDBUF_JUMP1 0x023D
+#define GPUREG_VSH_NUM_ATTR 0x0242
+#define GPUREG_VSH_COM_MODE 0x0244
+#define GPUREG_START_DRAW_FUNC0 0x0245
+#define GPUREG_VSH_OUTMAP_TOTAL1 0x024A
+#define GPUREG_VSH_OUTMAP_TOTAL2 0x0251
+#define GPUREG_GSH_MISC0 0x0252
+#define GPUREG_GEOSTAGE_CONFIG2 0x0253
+#define GPUREG_GSH_MISC1 0x0254
+#define GPUREG_PRIMITIVE_CONFIG 0x025E
+#define GPUREG_RESTART_PRIMITIVE 0x025F
+#define GPUREG_GSH_BOOLUNIFORM 0x0280
+#define GPUREG_GSH_INTUNIFORM_I0 0x0281
+#define GPUREG_GSH_INPUTBUFFER_CONFIG 0x0289
+#define GPUREG_GSH_ENTRYPOINT 0x028A
+#define GPUREG_GSH_ATTRIBUTES_PERMUTATION_LOW 0x028B
+#define GPUREG_GSH_ATTRIBUTES_PERMUTATION_HIGH 0x028C
+#define GPUREG_GSH_OUTMAP_MASK 0x028D
+#define GPUREG_GSH_CODETRANSFER_END 0x028F
+#define GPUREG_GSH_FLOATUNIFORM_CONFIG 0x0290
+#define GPUREG_GSH_FLOATUNIFORM_DATA 0x0291
+#define GPUREG_GSH_CODETRANSFER_CONFIG 0x029B
+#define GPUREG_GSH_CODETRANSFER_DATA 0x029C
+#define GPUREG_GSH_OPDESCS_CONFIG 0x02A5
+#define GPUREG_GSH_OPDESCS_DATA 0x02A6
+#define GPUREG_VSH_BOOLUNIFORM 0x02B0
+#define GPUREG_VSH_INTUNIFORM_I0 0x02B1
+#define GPUREG_VSH_INTUNIFORM_I1 0x02B2
+#define GPUREG_VSH_INTUNIFORM_I2 0x02B3
+#define GPUREG_VSH_INTUNIFORM_I3 0x02B4
+#define GPUREG_VSH_INPUTBUFFER_CONFIG 0x02B9
+#define GPUREG_VSH_ENTRYPOINT 0x02BA
+#define GPUREG_VSH_ATTRIBUTES_PERMUTATION_LOW 0x02BB
+#define GPUREG_VSH_ATTRIBUTES_PERMUTATION_HIGH 0x02BC
+#define GPUREG_VSH_OUTMAP_MASK 0x02BD
+#define GPUREG_VSH_CODETRANSFER_END 0x02BF
+#define GPUREG_VSH_FLOATUNIFORM_CONFIG 0x02C0
+#define GPUREG_VSH_FLOATUNIFORM_DATA 0x02C1
+#define GPUREG_VSH_CODETRANSFER_CONFIG 0x02CB
+#define GPUREG_VSH_CODETRANSFER_DATA 0x02CC
+#define GPUREG_VSH_OPDESCS_CONFIG 0x02D5
+#define GPUREG_VSH_OPDESCS_DATA 0x02D6
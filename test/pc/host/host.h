@@ -0,0 +1,17 @@
+#pragma once
+#include <3ds.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Receives every command buffer the host backend retires, either because the state layer
+// needed room (C3Di_CmdBufEnsureSpace), C3D_FrameSplit was called or host_CmdFlush was.
+typedef void (* host_CmdSink)(void* param, const u32* cmds, u32 words);
+
+void host_SetCmdSink(host_CmdSink sink, void* param);
+void host_CmdFlush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,8 +1,12 @@
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <random>
+#include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -13,6 +17,12 @@ extern "C" {
 #include <c3d/maths.h>
 }
 
+void check_mipmap(unsigned seed, bool bench);
+void check_meshopt(unsigned seed);
+void check_cmdgen(bool bench);
+void check_particle();
+void check_tiling(unsigned seed);
+
 typedef std::default_random_engine            generator_t;
 typedef std::uniform_real_distribution<float> distribution_t;
 
@@ -282,6 +292,49 @@ check_matrix(generator_t &gen, distribution_t &dist)
       }
     }
 
+    // check affine multiply and inverse
+    {
+      C3D_Mtx m1, m2, result, inv, id;
+
+      randomMatrix(m1, gen, dist);
+      randomMatrix(m2, gen, dist);
+      m1.r[3] = m2.r[3] = FVec4_New(0.0f, 0.0f, 0.0f, 1.0f);
+
+      Mtx_MultiplyAffine(&result, &m1, &m2);
+      assert(result == loadMatrix(m1) * loadMatrix(m2));
+
+      // cast to int to try to avoid assertion failure due to rounding error
+      for(size_t i = 0; i < 12; ++i)
+        m1.m[i] = static_cast<int>(m1.m[i]);
+
+      Mtx_Copy(&inv, &m1);
+      if(Mtx_InverseAffine(&inv))
+      {
+        assert(inv == glm::inverse(loadMatrix(m1)));
+        Mtx_MultiplyAffine(&id, &m1, &inv);
+        assert(id == glm::mat4()); // could still fail due to rounding errors
+      }
+
+      glm::vec3 v = randomVector3(gen, dist);
+      assert(Mtx_MultiplyFVecHAffine(&m2, FVec3_New(v.x, v.y, v.z)) == loadMatrix(m2) * glm::vec4(v, 1.0f));
+    }
+
+    // check orthonormal inverse
+    {
+      C3D_Mtx m, inv;
+      glm::vec3 axis = randomVector3(gen, dist);
+      glm::vec3 pos  = randomVector3(gen, dist);
+      float     r    = randomAngle(gen, dist);
+
+      Mtx_Identity(&m);
+      Mtx_Rotate(&m, FVec3_New(axis.x, axis.y, axis.z), r, false);
+      Mtx_Translate(&m, pos.x, pos.y, pos.z, false);
+
+      Mtx_Copy(&inv, &m);
+      Mtx_InverseOrthonormal(&inv);
+      assert(inv == glm::inverse(loadMatrix(m)));
+    }
+
     // check perspective
     {
       C3D_Mtx m;
@@ -963,17 +1016,278 @@ check_quaternion(generator_t &gen, distribution_t &dist)
       C3D_FQuat q2 = Quat_FromMtx(&m);
       assert(q2 == q || q2 == FVec4_Negate(q));
     }
+
+    // check interpolation
+    {
+      C3D_FQuat a = Quat_Normalize(randomQuat(gen, dist));
+      C3D_FQuat b = Quat_Normalize(randomQuat(gen, dist));
+      float     t = std::uniform_real_distribution<float>(0.0f, 1.0f)(gen);
+
+      // both take the shorter arc
+      C3D_FQuat s = Quat_Slerp(a, b, t);
+      glm::quat g = glm::slerp(loadQuat(a), Quat_Dot(a, b) < 0.0f ? -loadQuat(b) : loadQuat(b), t);
+      assert(s == g);
+
+      assert(Quat_Nlerp(a, b, 0.0f) == a);
+      C3D_FQuat n = Quat_Nlerp(a, b, 1.0f);
+      assert(n == b || n == FVec4_Negate(b));
+      assert(std::abs(FVec4_Magnitude(Quat_Nlerp(a, b, t)) - 1.0f) < 1e-5f);
+    }
   }
 }
 
+template <typename F>
+static double
+timeLoop(size_t iterations, F &&f)
+{
+  auto start = std::chrono::steady_clock::now();
+  for(size_t i = 0; i < iterations; ++i)
+    f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+static void
+check_batch(generator_t &gen, distribution_t &dist, bool bench)
+{
+  const size_t count = 256;
+
+  std::vector<C3D_Mtx>   mtxs(count), out(count);
+  std::vector<C3D_FVec>  vecs(count), vout(count);
+  std::vector<C3D_FQuat> quats(count);
+
+  C3D_Mtx a;
+  randomMatrix(a, gen, dist);
+  for(size_t i = 0; i < count; ++i)
+  {
+    randomMatrix(mtxs[i], gen, dist);
+    vecs[i]  = FVec4_New(dist(gen), dist(gen), dist(gen), dist(gen));
+    quats[i] = Quat_Normalize(randomQuat(gen, dist));
+  }
+
+  // check multiply array
+  {
+    Mtx_MultiplyArray(out.data(), &a, mtxs.data(), count);
+    for(size_t i = 0; i < count; ++i)
+      assert(out[i] == loadMatrix(a) * loadMatrix(mtxs[i]));
+
+    // check in-place multiply array
+    std::vector<C3D_Mtx> inplace(mtxs);
+    Mtx_MultiplyArray(inplace.data(), &a, inplace.data(), count);
+    assert(std::memcmp(inplace.data(), out.data(), count*sizeof(C3D_Mtx)) == 0);
+  }
+
+  // check vector array
+  {
+    Mtx_MultiplyFVec4Array(&a, vout.data(), vecs.data(), count, false);
+    for(size_t i = 0; i < count; ++i)
+    {
+      glm::vec4 v(vecs[i].x, vecs[i].y, vecs[i].z, vecs[i].w);
+      assert(vout[i] == loadMatrix(a) * v);
+    }
+
+    Mtx_MultiplyFVec4Array(&a, vout.data(), vecs.data(), count, true);
+    for(size_t i = 0; i < count; ++i)
+      assert(vout[i] == Mtx_MultiplyFVecH(&a, vecs[i]));
+
+    // check in-place vector array
+    std::vector<C3D_FVec> inplace(vecs);
+    Mtx_MultiplyFVec4Array(&a, inplace.data(), inplace.data(), count, true);
+    assert(std::memcmp(inplace.data(), vout.data(), count*sizeof(C3D_FVec)) == 0);
+  }
+
+  // check quaternion array
+  {
+    Mtx_FromQuatArray(out.data(), quats.data(), count);
+    for(size_t i = 0; i < count; ++i)
+      assert(out[i] == glm::mat4_cast(loadQuat(quats[i])));
+  }
+
+  if(!bench)
+    return;
+
+  double single, batched;
+
+  single = timeLoop(1000, [&]{
+    for(size_t i = 0; i < count; ++i)
+      Mtx_Multiply(&out[i], &a, &mtxs[i]);
+  });
+  batched = timeLoop(1000, [&]{ Mtx_MultiplyArray(out.data(), &a, mtxs.data(), count); });
+  std::printf("Mtx_MultiplyArray       %8.2f us  single %8.2f us  (%zu matrices)\n", batched, single, count);
+
+  single = timeLoop(1000, [&]{
+    for(size_t i = 0; i < count; ++i)
+      vout[i] = Mtx_MultiplyFVec4(&a, vecs[i]);
+  });
+  batched = timeLoop(1000, [&]{ Mtx_MultiplyFVec4Array(&a, vout.data(), vecs.data(), count, false); });
+  std::printf("Mtx_MultiplyFVec4Array  %8.2f us  single %8.2f us  (%zu vectors)\n", batched, single, count);
+
+  single = timeLoop(1000, [&]{
+    for(size_t i = 0; i < count; ++i)
+      Mtx_FromQuat(&out[i], quats[i]);
+  });
+  batched = timeLoop(1000, [&]{ Mtx_FromQuatArray(out.data(), quats.data(), count); });
+  std::printf("Mtx_FromQuatArray       %8.2f us  single %8.2f us  (%zu quaternions)\n", batched, single, count);
+}
+
+static bool
+clipContains(const C3D_Mtx &clip, const C3D_FVec &p)
+{
+  C3D_FVec c = Mtx_MultiplyFVecH(&clip, FVec3_New(p.x, p.y, p.z));
+  return c.x >= -c.w && c.x <= c.w
+      && c.y >= -c.w && c.y <= c.w
+      && c.z >= -c.w && c.z <= 0.0f;
+}
+
+static void
+check_frustum(generator_t &gen, distribution_t &dist)
+{
+  const size_t count = 1000;
+  std::vector<C3D_FVec> points(count);
+  std::vector<u32>      visible((count+31)/32);
+
+  for(size_t x = 0; x < 100; ++x)
+  {
+    C3D_Mtx proj, view, clip;
+    float fovy = C3D_AngleFromDegrees(60.0f);
+    C3D_FVec eye = FVec3_New(dist(gen), dist(gen), dist(gen));
+
+    Mtx_LookAt(&view, eye, FVec3_New(0.0f, 0.0f, 0.0f), FVec3_New(0.0f, 1.0f, 0.0f), false);
+    if(x & 1)
+      Mtx_PerspTilt(&proj, fovy, C3D_AspectRatioTop, 0.1f, 10.0f, false);
+    else
+      Mtx_Persp(&proj, fovy, C3D_AspectRatioTop, 0.1f, 10.0f, false);
+    Mtx_Multiply(&clip, &proj, &view);
+
+    C3D_Frustum f;
+    Frustum_FromMtx(&f, &clip);
+
+    // zero-sized spheres and boxes are points
+    for(size_t i = 0; i < count; ++i)
+      points[i] = FVec4_New(dist(gen), dist(gen), dist(gen), 0.0f);
+
+    Frustum_CullSpheres(&f, 1, points.data(), count, visible.data());
+    for(size_t i = 0; i < count; ++i)
+      assert(Frustum_IsVisible(visible.data(), i) == clipContains(clip, points[i]));
+
+    Frustum_CullAABBs(&f, 1, points.data(), points.data(), count, visible.data());
+    for(size_t i = 0; i < count; ++i)
+      assert(Frustum_IsVisible(visible.data(), i) == clipContains(clip, points[i]));
+  }
+
+  // check known spheres and boxes against a frustum looking down -z
+  {
+    C3D_Mtx proj;
+    Mtx_Persp(&proj, C3D_AngleFromDegrees(60.0f), 1.0f, 1.0f, 10.0f, false);
+
+    C3D_Frustum f;
+    Frustum_FromMtx(&f, &proj);
+
+    C3D_FVec spheres[] =
+    {
+      FVec4_New( 0.0f, 0.0f,  -5.0f, 1.0f), // inside
+      FVec4_New( 0.0f, 0.0f,   0.5f, 1.0f), // crosses near plane
+      FVec4_New( 0.0f, 0.0f,  -0.5f, 0.1f), // in front of near plane
+      FVec4_New( 0.0f, 0.0f, -12.0f, 1.0f), // behind far plane
+      FVec4_New(20.0f, 0.0f,  -5.0f, 1.0f), // right of frustum
+    };
+    const bool expected[] = { true, true, false, false, false };
+
+    Frustum_CullSpheres(&f, 1, spheres, 5, visible.data());
+    for(size_t i = 0; i < 5; ++i)
+      assert(Frustum_IsVisible(visible.data(), i) == expected[i]);
+
+    C3D_FVec mins[] = { FVec3_New(-20.0f, -20.0f, -5.0f), FVec3_New(5.0f, -1.0f, -5.0f) };
+    C3D_FVec maxs[] = { FVec3_New( 20.0f,  20.0f, -4.0f), FVec3_New(6.0f,  1.0f, -4.0f) };
+
+    Frustum_CullAABBs(&f, 1, mins, maxs, 2, visible.data());
+    assert(Frustum_IsVisible(visible.data(), 0));
+    assert(!Frustum_IsVisible(visible.data(), 1));
+  }
+
+  // check stereo pair
+  {
+    C3D_Mtx view, projL, projR, clipL, clipR;
+    C3D_Frustum f[2];
+    float fovx = C3D_AngleFromDegrees(60.0f), iod = 0.5f, screen = 2.0f;
+
+    Mtx_Identity(&view);
+    Frustum_FromPerspStereoTilt(f, &view, fovx, C3D_AspectRatioTop, 0.1f, 10.0f, iod, screen, false);
+    Mtx_PerspStereoTilt(&projL, fovx, C3D_AspectRatioTop, 0.1f, 10.0f, -iod, screen, false);
+    Mtx_PerspStereoTilt(&projR, fovx, C3D_AspectRatioTop, 0.1f, 10.0f,  iod, screen, false);
+    Mtx_Multiply(&clipL, &projL, &view);
+    Mtx_Multiply(&clipR, &projR, &view);
+
+    for(size_t i = 0; i < count; ++i)
+      points[i] = FVec4_New(dist(gen), dist(gen), dist(gen), 0.0f);
+
+    Frustum_CullSpheres(f, 2, points.data(), count, visible.data());
+    for(size_t i = 0; i < count; ++i)
+      assert(Frustum_IsVisible(visible.data(), i) == (clipContains(clipL, points[i]) || clipContains(clipR, points[i])));
+  }
+}
+
+static void
+check_lod()
+{
+  // a unit sphere 5 units down -z, with a 60 degree field of view along the shorter side
+  const float expected = 1.0f / (std::tan(C3D_AngleFromDegrees(30.0f)) * 5.0f);
+  C3D_FVec spheres[] =
+  {
+    FVec4_New(0.0f, 0.0f, -5.0f, 1.0f),
+    FVec4_New(0.0f, 0.0f, -0.5f, 1.0f), // reaches the eye
+  };
+  float sizes[2];
+
+  C3D_Mtx proj;
+  Mtx_Persp(&proj, C3D_AngleFromDegrees(60.0f), C3D_AspectRatioTop, 0.1f, 10.0f, false);
+  Lod_ProjectedSizes(&proj, nullptr, spheres, 2, sizes);
+  assert(std::abs(sizes[0] - expected) < 1e-5f);
+  assert(std::isinf(sizes[1]));
+
+  // both eyes of a stereo pair measure the same size as the tilted mono projection
+  C3D_Mtx view;
+  Mtx_Identity(&view);
+  Mtx_Translate(&view, 1.0f, 2.0f, 0.0f, true);
+  float mono[1], left[1], right[1];
+  Mtx_PerspTilt(&proj, C3D_AngleFromDegrees(60.0f), C3D_AspectRatioTop, 0.1f, 10.0f, false);
+  Lod_ProjectedSizes(&proj, &view, spheres, 1, mono);
+  Mtx_PerspStereoTilt(&proj, C3D_AngleFromDegrees(60.0f), C3D_AspectRatioTop, 0.1f, 10.0f, -0.5f, 2.0f, false);
+  Lod_ProjectedSizes(&proj, &view, spheres, 1, left);
+  Mtx_PerspStereoTilt(&proj, C3D_AngleFromDegrees(60.0f), C3D_AspectRatioTop, 0.1f, 10.0f, 0.5f, 2.0f, false);
+  Lod_ProjectedSizes(&proj, &view, spheres, 1, right);
+  assert(std::abs(mono[0] - expected) < 1e-5f);
+  assert(left[0] == right[0] && std::abs(left[0] - mono[0]) < 1e-5f);
+
+  // sizes within the band around a threshold keep the current level
+  const float minSizes[] = { 0.5f, 0.2f };
+  assert(Lod_Select(minSizes, 3, 0.1f, 1.0f,   2) == 0);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.01f,  0) == 2);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.47f,  0) == 0);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.53f,  1) == 1);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.44f,  0) == 1);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.56f,  1) == 0);
+  assert(Lod_Select(minSizes, 3, 0.1f, 0.3f,   5) == 1);
+}
+
 int main(int argc, char *argv[])
 {
   std::random_device rd;
   generator_t        gen(rd());
   distribution_t     dist(-10.0f, 10.0f);
 
+  bool bench = argc > 1 && std::string(argv[1]) == "--bench";
+
   check_matrix(gen, dist);
   check_quaternion(gen, dist);
+  check_batch(gen, dist, bench);
+  check_frustum(gen, dist);
+  check_lod();
+  check_mipmap(rd(), bench);
+  check_meshopt(rd());
+  check_cmdgen(bench);
+  check_particle();
+  check_tiling(rd());
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <c3d/meshopt.h>
+}
+
+namespace
+{
+typedef std::array<unsigned, 3> Tri;
+
+// Rotates the triangle so that its smallest index comes first, keeping the winding
+Tri
+canonical(unsigned a, unsigned b, unsigned c)
+{
+  if(b < a && b < c)
+    return Tri{{ b, c, a }};
+  if(c < a && c < b)
+    return Tri{{ c, a, b }};
+  return Tri{{ a, b, c }};
+}
+
+std::vector<Tri>
+triangles(const std::vector<u16> &list)
+{
+  std::vector<Tri> tris;
+  for(size_t i = 0; i + 2 < list.size(); i += 3)
+    tris.push_back(canonical(list[i], list[i+1], list[i+2]));
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+
+std::vector<Tri>
+stripTriangles(const std::vector<u16> &strip)
+{
+  std::vector<Tri> tris;
+  for(size_t i = 0; i + 2 < strip.size(); ++i)
+  {
+    unsigned a = strip[i], b = strip[i+1], c = strip[i+2];
+    if(a == b || b == c || a == c)
+      continue;
+    if(i & 1)
+      std::swap(a, b);
+    tris.push_back(canonical(a, b, c));
+  }
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+
+// Grid of w*h quads, two triangles each, in random order
+std::vector<u16>
+grid(unsigned w, unsigned h, std::default_random_engine &gen)
+{
+  std::vector<Tri> tris;
+  for(unsigned y = 0; y < h; ++y)
+  {
+    for(unsigned x = 0; x < w; ++x)
+    {
+      unsigned v = y*(w+1) + x;
+      tris.push_back(Tri{{ v, v+1, v+w+1 }});
+      tris.push_back(Tri{{ v+1, v+w+2, v+w+1 }});
+    }
+  }
+  std::shuffle(tris.begin(), tris.end(), gen);
+
+  std::vector<u16> list;
+  for(const Tri &t : tris)
+    list.insert(list.end(), t.begin(), t.end());
+  return list;
+}
+}
+
+void
+check_meshopt(unsigned seed)
+{
+  std::default_random_engine gen(seed);
+
+  const unsigned w = 31, h = 17, numVerts = (w+1)*(h+1);
+  std::vector<u16> src = grid(w, h, gen);
+
+  std::vector<u16> opt(src.size());
+  assert(C3D_IndexOptimizeCache(opt.data(), src.data(), src.size(), numVerts, 0));
+  assert(triangles(opt) == triangles(src));
+
+  float before = C3D_IndexACMR(src.data(), src.size(), 0);
+  float after  = C3D_IndexACMR(opt.data(), opt.size(), 0);
+  assert(after < before);
+  assert(after < 1.0f);
+
+  // In place
+  std::vector<u16> inPlace = src;
+  assert(C3D_IndexOptimizeCache(inPlace.data(), inPlace.data(), inPlace.size(), numVerts, 0));
+  assert(inPlace == opt);
+
+  // Vertices come out in first use order and describe the same triangles
+  std::vector<unsigned> verts(numVerts), fetched(numVerts);
+  for(unsigned i = 0; i < numVerts; ++i)
+    verts[i] = i * 2654435761u;
+  std::vector<u16> remapped = opt;
+  size_t used = C3D_VertexFetchOptimize(fetched.data(), remapped.data(), remapped.size(), verts.data(), numVerts, sizeof(unsigned));
+  assert(used == numVerts);
+  unsigned next = 0;
+  for(size_t i = 0; i < remapped.size(); ++i)
+  {
+    assert(fetched[remapped[i]] == verts[opt[i]]);
+    assert(remapped[i] <= next);
+    if(remapped[i] == next)
+      ++next;
+  }
+
+  // The strip holds the same triangles with the same winding
+  std::vector<u16> strip(opt.size()*2);
+  size_t stripLen = C3D_IndexToStrip(strip.data(), opt.data(), opt.size());
+  assert(stripLen <= strip.size());
+  strip.resize(stripLen);
+  assert(stripTriangles(strip) == triangles(opt));
+
+  // A list made from a strip gives the strip back
+  std::vector<u16> seq(64), fromStrip;
+  for(unsigned i = 0; i < seq.size(); ++i)
+    seq[i] = i;
+  std::shuffle(seq.begin(), seq.end(), gen);
+  for(size_t i = 0; i + 2 < seq.size(); ++i)
+  {
+    fromStrip.push_back(seq[i + (i & 1)]);
+    fromStrip.push_back(seq[i + !(i & 1)]);
+    fromStrip.push_back(seq[i+2]);
+  }
+  strip.assign(fromStrip.size()*2, 0);
+  assert(C3D_IndexToStrip(strip.data(), fromStrip.data(), fromStrip.size()) == seq.size());
+  strip.resize(seq.size());
+  assert(strip == seq);
+}
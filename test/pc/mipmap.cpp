@@ -0,0 +1,112 @@
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+extern "C" {
+#include "mipmap.h"
+}
+
+namespace
+{
+struct Field
+{
+  unsigned shift, bits;
+};
+
+struct Kernel
+{
+  const char    *name;
+  C3Di_MipKernel ref;
+  C3Di_MipKernel simd;
+  unsigned       bpp;      // bits per pixel of the format
+  unsigned       unitBits; // size of the unit the fields are packed into
+  unsigned       numFields;
+  Field          fields[4];
+};
+
+const Kernel kernels[] =
+{
+  { "RGBA8",    C3Di_MipRGBA8,    C3Di_MipRGBA8_SIMD,    32, 32, 4, {{24,8},{16,8},{8,8},{0,8}} },
+  { "RGB8",     C3Di_MipRGB8,     C3Di_MipRGB8_SIMD,     24,  8, 1, {{0,8}} },
+  { "RGBA5551", C3Di_MipRGBA5551, C3Di_MipRGBA5551_SIMD, 16, 16, 4, {{11,5},{6,5},{1,5},{0,1}} },
+  { "RGB565",   C3Di_MipRGB565,   C3Di_MipRGB565_SIMD,   16, 16, 3, {{11,5},{5,6},{0,5}} },
+  { "RGBA4",    C3Di_MipRGBA4,    C3Di_MipRGBA4_SIMD,    16, 16, 4, {{12,4},{8,4},{4,4},{0,4}} },
+  { "LA8",      C3Di_MipLA8,      C3Di_MipLA8_SIMD,      16, 16, 2, {{8,8},{0,8}} },
+  { "L8",       C3Di_MipL8,       C3Di_MipL8_SIMD,        8,  8, 1, {{0,8}} },
+  { "LA4",      C3Di_MipLA4,      C3Di_MipLA4_SIMD,       8,  8, 2, {{4,4},{0,4}} },
+  { "L4",       C3Di_MipL4,       C3Di_MipL4_SIMD,        4,  8, 2, {{4,4},{0,4}} },
+};
+
+inline unsigned
+readUnit(const unsigned char *p, unsigned bits)
+{
+  unsigned v = 0;
+  for(unsigned i = 0; i < bits/8; ++i)
+    v |= unsigned(p[i]) << (8*i);
+  return v;
+}
+
+// The packed kernels round differently, but must stay within one step of the reference
+void
+compare(const Kernel &k, const unsigned char *ref, const unsigned char *simd)
+{
+  unsigned size = 64*k.bpp/8;
+  for(unsigned i = 0; i < size; i += k.unitBits/8)
+  {
+    unsigned a = readUnit(ref + i, k.unitBits);
+    unsigned b = readUnit(simd + i, k.unitBits);
+    for(unsigned f = 0; f < k.numFields; ++f)
+    {
+      int fa = (a >> k.fields[f].shift) & ((1u << k.fields[f].bits) - 1);
+      int fb = (b >> k.fields[f].shift) & ((1u << k.fields[f].bits) - 1);
+      assert(std::abs(fa - fb) <= 1);
+    }
+  }
+}
+
+double
+benchmark(C3Di_MipKernel kernel, unsigned char *dst, const void *const src[4], unsigned iterations)
+{
+  auto start = std::chrono::steady_clock::now();
+  for(unsigned i = 0; i < iterations; ++i)
+    kernel(dst, src);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+}
+
+void
+check_mipmap(unsigned seed, bool bench)
+{
+  std::default_random_engine             gen(seed);
+  std::uniform_int_distribution<unsigned> dist(0, 255);
+
+  alignas(8) unsigned char src[4][256];
+  alignas(8) unsigned char ref[256];
+  alignas(8) unsigned char simd[256];
+  const void *const srcs[4] = { src[0], src[1], src[2], src[3] };
+
+  for(const Kernel &k : kernels)
+  {
+    for(unsigned iter = 0; iter < 1000; ++iter)
+    {
+      for(unsigned b = 0; b < 4; ++b)
+        for(unsigned i = 0; i < sizeof(src[b]); ++i)
+          src[b][i] = dist(gen);
+
+      k.ref(ref, srcs);
+      k.simd(simd, srcs);
+      compare(k, ref, simd);
+    }
+
+    if(bench)
+    {
+      double tRef  = benchmark(k.ref, ref, srcs, 100000);
+      double tSimd = benchmark(k.simd, simd, srcs, 100000);
+      std::printf("mipmap %-8s scalar %8.1f ns/block  packed %8.1f ns/block  (%.2fx)\n",
+                  k.name, tRef, tSimd, tRef / tSimd);
+    }
+  }
+}
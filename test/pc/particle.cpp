@@ -0,0 +1,63 @@
+#include <cassert>
+
+extern "C" {
+#include <c3d/particle.h>
+}
+
+namespace
+{
+C3D_Particle *
+emit(C3D_ParticleEmitter &e, float life)
+{
+  C3D_Particle *p = C3D_ParticleEmit(&e);
+  p->life = life;
+  return p;
+}
+
+// Index in the ring of the i-th live particle, oldest first
+unsigned
+slot(const C3D_ParticleEmitter &e, unsigned i)
+{
+  return (e.first + i) % e.capacity;
+}
+}
+
+void
+check_particle()
+{
+  C3D_Particle particles[4];
+  C3D_ParticleEmitter e;
+
+  assert(!C3D_ParticleEmitterInitWithBuffer(&e, nullptr, particles, 0));
+  assert(C3D_ParticleEmitterInitWithBuffer(&e, nullptr, particles, 4));
+
+  // A full ring replaces the oldest particle and wraps around
+  for(unsigned i = 0; i < 6; ++i)
+    emit(e, 1.0f + i);
+  assert(e.count == 4);
+  assert(e.first == 2);
+  assert(particles[slot(e, 0)].life == 3.0f);
+  assert(particles[slot(e, 3)].life == 6.0f);
+  assert(&particles[slot(e, 3)] == &particles[1]);
+
+  // Dead particles are dropped from the oldest end, across the end of the buffer
+  C3D_ParticleEmitterUpdate(&e, 4.5f);
+  assert(e.count == 2);
+  assert(e.first == 0);
+  assert(particles[slot(e, 0)].life == 5.0f);
+
+  // A particle that dies before an older one stays until the older one has died too
+  emit(e, 0.5f);
+  emit(e, 0.5f);
+  C3D_ParticleEmitterUpdate(&e, 1.0f);
+  assert(e.count == 3);
+  assert(particles[slot(e, 0)].life == 6.0f);
+  C3D_ParticleEmitterUpdate(&e, 1.0f);
+  assert(e.count == 0);
+
+  // Emptied rings start over wherever they stopped
+  emit(e, 1.0f);
+  assert(e.count == 1);
+  assert(e.verts == nullptr);
+  C3D_ParticleEmitterDelete(&e);
+}
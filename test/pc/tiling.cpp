@@ -0,0 +1,121 @@
+#include <cassert>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include <c3d/texture.h>
+}
+
+namespace
+{
+// Byte offset of a texel in a tiled level, for formats of at least 8 bits per texel
+unsigned
+tiledOffset(unsigned x, unsigned y, unsigned width, unsigned height, unsigned bytes)
+{
+  unsigned ty = height-1-y; // Tiled images are stored bottom-up
+  unsigned morton = 0;
+  for(unsigned i = 0; i < 3; ++i)
+    morton |= ((x >> i) & 1) << (2*i) | ((ty >> i) & 1) << (2*i+1);
+  return (((ty/8)*(width/8) + x/8)*64 + morton)*bytes;
+}
+
+// A 2D texture in plain heap memory, enough for the tiling helpers
+struct Tex
+{
+  C3D_Tex tex;
+  std::vector<u8> data;
+
+  Tex(u16 width, u16 height, GPU_TEXCOLOR fmt, unsigned bits, int maxLevel)
+  {
+    std::memset(&tex, 0, sizeof(tex));
+    tex.width = width;
+    tex.height = height;
+    tex.fmt = fmt;
+    tex.size = width*height*bits/8;
+    tex.maxLevel = maxLevel;
+    data.assign(C3D_TexCalcTotalSize(tex.size, maxLevel), 0);
+    tex.data = data.data();
+  }
+};
+
+std::vector<u8>
+randomImage(std::default_random_engine &gen, size_t size)
+{
+  std::uniform_int_distribution<unsigned> dist(0, 255);
+  std::vector<u8> image(size);
+  for(u8 &b : image)
+    b = dist(gen);
+  return image;
+}
+
+// Every texel lands where the reference layout puts it
+void
+check_layout(std::default_random_engine &gen)
+{
+  Tex t(16, 32, GPU_RGBA8, 32, 1);
+  std::vector<u8> image = randomImage(gen, 8*16*4);
+  assert(C3D_TexTileRect(&t.tex, image.data(), 8*4, GPU_TEXFACE_2D, 1, 0, 0, 8, 16));
+
+  const u8 *level = t.data.data() + t.tex.size;
+  for(unsigned y = 0; y < 16; ++y)
+    for(unsigned x = 0; x < 8; ++x)
+      assert(std::memcmp(level + tiledOffset(x, y, 8, 16, 4), &image[(y*8 + x)*4], 4) == 0);
+
+  // Level 0 is left alone
+  for(size_t i = 0; i < t.tex.size; ++i)
+    assert(t.data[i] == 0);
+}
+
+// A rectangle crossing tile edges comes back unchanged and nothing outside of it is written
+void
+check_roundtrip(std::default_random_engine &gen, GPU_TEXCOLOR fmt, unsigned bits)
+{
+  const unsigned x = 2, y = 5, w = 18, h = 11, stride = (w*bits/8 + 3) &~ 3;
+  Tex t(32, 16, fmt, bits, 0);
+  std::vector<u8> image = randomImage(gen, stride*h);
+
+  assert(C3D_TexTileRect(&t.tex, image.data(), stride, GPU_TEXFACE_2D, 0, x, y, w, h));
+  std::vector<u8> back(stride*h, 0);
+  assert(C3D_TexUntileRect(&t.tex, back.data(), stride, GPU_TEXFACE_2D, 0, x, y, w, h));
+  for(unsigned row = 0; row < h; ++row)
+    assert(std::memcmp(&back[row*stride], &image[row*stride], w*bits/8) == 0);
+
+  // Untiling the whole level shows zeros around the rectangle
+  const unsigned fullStride = 32*bits/8;
+  std::vector<u8> full(fullStride*16, 0xFF);
+  assert(C3D_TexUntileRect(&t.tex, full.data(), fullStride, GPU_TEXFACE_2D, 0, 0, 0, 32, 16));
+  for(unsigned row = 0; row < 16; ++row)
+    for(unsigned col = 0; col < fullStride; ++col)
+    {
+      unsigned px = col*8/bits;
+      bool inside = row >= y && row < y+h && px >= x && px < x+w;
+      u8 expected = inside ? image[(row-y)*stride + col - x*bits/8] : 0;
+      assert(full[row*fullStride + col] == expected);
+    }
+}
+
+void
+check_rejects()
+{
+  Tex t(16, 16, GPU_L4, 4, 0);
+  u8 image[16*16/2] = {};
+  assert(!C3D_TexTileRect(&t.tex, image, 8, GPU_TEXFACE_2D, 0, 1, 0, 4, 4)); // Odd x on a 4-bit format
+  assert(!C3D_TexTileRect(&t.tex, image, 8, GPU_TEXFACE_2D, 0, 0, 0, 3, 4)); // Odd width
+  assert(!C3D_TexTileRect(&t.tex, image, 8, GPU_TEXFACE_2D, 0, 8, 0, 16, 4)); // Past the right edge
+  assert(!C3D_TexTileRect(&t.tex, image, 8, GPU_TEXFACE_2D, 1, 0, 0, 4, 4)); // Missing level
+}
+}
+
+void
+check_tiling(unsigned seed)
+{
+  std::default_random_engine gen(seed);
+  check_layout(gen);
+  check_roundtrip(gen, GPU_RGBA8, 32);
+  check_roundtrip(gen, GPU_RGB8, 24);
+  check_roundtrip(gen, GPU_RGB565, 16);
+  check_roundtrip(gen, GPU_L8, 8);
+  check_roundtrip(gen, GPU_L4, 4);
+  check_rejects();
+}